@@ -0,0 +1,403 @@
+///////////////////////////////////////////////////////////////////////////////
+// animationsystem.cpp
+// ============
+// evaluate keyframe animation tracks for the 3D scene nodes
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "AnimationSystem.h"
+
+#include <algorithm>
+#include <cmath>
+
+// declaration of global variables
+namespace
+{
+	// the blend reads the track values as flat float arrays
+	static_assert(sizeof(glm::vec3) == 3 * sizeof(float),
+		"glm::vec3 must be three packed floats");
+
+	// the minimum number of tracks handed to each worker thread,
+	// smaller batches are cheaper to evaluate on the calling thread
+	const int g_TracksPerWorker = 256;
+}
+
+/***********************************************************
+ *  AnimationSystem()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+AnimationSystem::AnimationSystem()
+{
+	m_workGeneration = 0;
+	m_activeWorkers = 0;
+	m_pendingWorkers = 0;
+	m_tracksPerWorker = 0;
+	m_workTime = 0.0f;
+	m_bStopWorkers = false;
+}
+
+/***********************************************************
+ *  ~AnimationSystem()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+AnimationSystem::~AnimationSystem()
+{
+	StopWorkers();
+	Clear();
+}
+
+/***********************************************************
+ *  AddTrack()
+ *
+ *  This method is used for adding a new animation track
+ *  with the passed in keyframes for the target.
+ ***********************************************************/
+int AnimationSystem::AddTrack(
+	int target,
+	ANIMATION_CHANNEL channel,
+	const std::vector<KEYFRAME>& keyframes,
+	bool bLooping)
+{
+	// a track needs at least one keyframe to be evaluated
+	if (keyframes.size() == 0)
+	{
+		return(-1);
+	}
+
+	m_trackTarget.push_back(target);
+	m_trackChannel.push_back(channel);
+	m_trackFirstKey.push_back((int)m_keyTimes.size());
+	m_trackKeyCount.push_back((int)keyframes.size());
+	m_trackCursor.push_back(0);
+	m_trackLooping.push_back(bLooping ? 1 : 0);
+	m_trackActive.push_back(1);
+	m_trackResult.push_back(keyframes[0].value);
+	m_trackPrevious.push_back(keyframes[0].value);
+	m_trackFrom.push_back(keyframes[0].value);
+	m_trackTo.push_back(keyframes[0].value);
+	m_trackBlend.push_back(glm::vec3(0.0f));
+
+	for (int i = 0; i < keyframes.size(); i++)
+	{
+		m_keyTimes.push_back(keyframes[i].time);
+		m_keyValues.push_back(keyframes[i].value);
+	}
+
+	return((int)m_trackTarget.size() - 1);
+}
+
+/***********************************************************
+ *  SetTrackActive()
+ *
+ *  This method is used for enabling or disabling the
+ *  evaluation of the passed in track.
+ ***********************************************************/
+void AnimationSystem::SetTrackActive(int track, bool bActive)
+{
+	// a removed track has no target to be enabled for
+	if ((track >= 0) && (track < m_trackActive.size()) && (m_trackTarget[track] >= 0))
+	{
+		m_trackActive[track] = bActive ? 1 : 0;
+	}
+}
+
+/***********************************************************
+ *  RemoveTrack()
+ *
+ *  This method is used for stopping the passed in track and
+ *  detaching it from its target, so that a target reusing
+ *  the same index is not driven by it.
+ ***********************************************************/
+void AnimationSystem::RemoveTrack(int track)
+{
+	if ((track >= 0) && (track < m_trackActive.size()))
+	{
+		m_trackActive[track] = 0;
+		m_trackTarget[track] = -1;
+	}
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing all of the tracks.
+ ***********************************************************/
+void AnimationSystem::Clear()
+{
+	m_trackTarget.clear();
+	m_trackChannel.clear();
+	m_trackFirstKey.clear();
+	m_trackKeyCount.clear();
+	m_trackCursor.clear();
+	m_trackLooping.clear();
+	m_trackActive.clear();
+	m_trackResult.clear();
+	m_trackPrevious.clear();
+	m_trackFrom.clear();
+	m_trackTo.clear();
+	m_trackBlend.clear();
+	m_keyTimes.clear();
+	m_keyValues.clear();
+}
+
+/***********************************************************
+ *  IsMaterialChannel()
+ *
+ *  This method is used for checking whether the passed in
+ *  channel targets a material rather than a scene node.
+ ***********************************************************/
+bool AnimationSystem::IsMaterialChannel(ANIMATION_CHANNEL channel)
+{
+	return(channel >= CHANNEL_MATERIAL_AMBIENT_STRENGTH);
+}
+
+/***********************************************************
+ *  Evaluate()
+ *
+ *  This method is used for evaluating all of the active
+ *  tracks at the passed in time.  Large track counts are
+ *  split into contiguous ranges across the worker threads,
+ *  which are started once and then only woken for each
+ *  evaluation.
+ ***********************************************************/
+void AnimationSystem::Evaluate(float timeSeconds)
+{
+	int trackCount = GetTrackCount();
+	int workerCount = trackCount / g_TracksPerWorker;
+	int hardwareThreads = (int)std::thread::hardware_concurrency();
+
+	if (workerCount > hardwareThreads)
+	{
+		workerCount = hardwareThreads;
+	}
+
+	// small track counts are evaluated on the calling thread
+	if (workerCount <= 1)
+	{
+		EvaluateRange(0, trackCount, timeSeconds);
+		return;
+	}
+
+	if (m_workers.empty() == true)
+	{
+		StartWorkers(hardwareThreads - 1);
+	}
+
+	// each worker writes only to its own range of tracks, so
+	// no synchronization is needed beyond waiting for them
+	int tracksPerWorker = (trackCount + workerCount - 1) / workerCount;
+	{
+		std::lock_guard<std::mutex> lock(m_workerMutex);
+		m_tracksPerWorker = tracksPerWorker;
+		m_workTime = timeSeconds;
+		m_activeWorkers = workerCount - 1;
+		m_pendingWorkers = (int)m_workers.size();
+		m_workGeneration++;
+	}
+	m_workerStart.notify_all();
+
+	// the calling thread evaluates the first range
+	EvaluateRange(0, tracksPerWorker, timeSeconds);
+
+	std::unique_lock<std::mutex> lock(m_workerMutex);
+	m_workerDone.wait(lock, [this]() { return(m_pendingWorkers == 0); });
+}
+
+/***********************************************************
+ *  StartWorkers()
+ *
+ *  This method is used for starting the worker threads.
+ ***********************************************************/
+void AnimationSystem::StartWorkers(int workerCount)
+{
+	m_bStopWorkers = false;
+	for (int i = 0; i < workerCount; i++)
+	{
+		m_workers.push_back(std::thread(&AnimationSystem::WorkerThread, this, i));
+	}
+}
+
+/***********************************************************
+ *  StopWorkers()
+ *
+ *  This method is used for stopping the worker threads and
+ *  waiting for them to finish.
+ ***********************************************************/
+void AnimationSystem::StopWorkers()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_workerMutex);
+		m_bStopWorkers = true;
+	}
+	m_workerStart.notify_all();
+	for (int i = 0; i < m_workers.size(); i++)
+	{
+		m_workers[i].join();
+	}
+	m_workers.clear();
+}
+
+/***********************************************************
+ *  WorkerThread()
+ *
+ *  This method is run on each worker thread.  It waits for
+ *  the next evaluation, evaluates its range when it is one
+ *  of the active workers, and reports back, until the
+ *  workers are stopped.
+ ***********************************************************/
+void AnimationSystem::WorkerThread(int workerIndex)
+{
+	int seenGeneration = 0;
+
+	while (true)
+	{
+		int firstTrack = 0;
+		int lastTrack = 0;
+		float timeSeconds = 0.0f;
+		{
+			std::unique_lock<std::mutex> lock(m_workerMutex);
+			m_workerStart.wait(lock, [this, seenGeneration]()
+				{ return((m_bStopWorkers == true) || (m_workGeneration != seenGeneration)); });
+			if (m_bStopWorkers == true)
+			{
+				return;
+			}
+			seenGeneration = m_workGeneration;
+			if (workerIndex < m_activeWorkers)
+			{
+				firstTrack = (workerIndex + 1) * m_tracksPerWorker;
+				lastTrack = std::min(firstTrack + m_tracksPerWorker, GetTrackCount());
+				timeSeconds = m_workTime;
+			}
+		}
+
+		if (firstTrack < lastTrack)
+		{
+			EvaluateRange(firstTrack, lastTrack, timeSeconds);
+		}
+
+		bool bLast = false;
+		{
+			std::lock_guard<std::mutex> lock(m_workerMutex);
+			m_pendingWorkers--;
+			bLast = (m_pendingWorkers == 0);
+		}
+		if (bLast == true)
+		{
+			m_workerDone.notify_one();
+		}
+	}
+}
+
+/***********************************************************
+ *  EvaluateRange()
+ *
+ *  This method is used for evaluating the tracks in the
+ *  passed in range.  Each track remembers the keyframe it
+ *  was last evaluated at, so forward playback only has to
+ *  step past the keyframes crossed since the last frame.
+ *  The search only records the keyframe values and weight
+ *  of each track, and the blend is done afterwards for the
+ *  whole range in one loop without branches.
+ ***********************************************************/
+void AnimationSystem::EvaluateRange(int firstTrack, int lastTrack, float timeSeconds)
+{
+	if (firstTrack >= lastTrack)
+	{
+		return;
+	}
+
+	for (int track = firstTrack; track < lastTrack; track++)
+	{
+		// an inactive track blends its result with itself
+		if (m_trackActive[track] == 0)
+		{
+			m_trackFrom[track] = m_trackResult[track];
+			m_trackTo[track] = m_trackResult[track];
+			m_trackBlend[track] = glm::vec3(0.0f);
+			continue;
+		}
+
+		// keep the last result for interpolated rendering
+		m_trackPrevious[track] = m_trackResult[track];
+
+		const float* keyTimes = &m_keyTimes[m_trackFirstKey[track]];
+		const glm::vec3* keyValues = &m_keyValues[m_trackFirstKey[track]];
+		int keyCount = m_trackKeyCount[track];
+
+		// a single keyframe holds its value for all time
+		if (keyCount == 1)
+		{
+			m_trackFrom[track] = keyValues[0];
+			m_trackTo[track] = keyValues[0];
+			m_trackBlend[track] = glm::vec3(0.0f);
+			continue;
+		}
+
+		// wrap or clamp the time into the range of the keyframes
+		float startTime = keyTimes[0];
+		float endTime = keyTimes[keyCount - 1];
+		float localTime = timeSeconds;
+		if ((m_trackLooping[track] != 0) && (endTime > startTime))
+		{
+			localTime = startTime + std::fmod(timeSeconds - startTime, endTime - startTime);
+			if (localTime < startTime)
+			{
+				localTime += endTime - startTime;
+			}
+		}
+		if (localTime <= startTime)
+		{
+			m_trackCursor[track] = 0;
+			m_trackFrom[track] = keyValues[0];
+			m_trackTo[track] = keyValues[0];
+			m_trackBlend[track] = glm::vec3(0.0f);
+			continue;
+		}
+		if (localTime >= endTime)
+		{
+			m_trackCursor[track] = keyCount - 2;
+			m_trackFrom[track] = keyValues[keyCount - 1];
+			m_trackTo[track] = keyValues[keyCount - 1];
+			m_trackBlend[track] = glm::vec3(0.0f);
+			continue;
+		}
+
+		// restart the search when time has moved backwards,
+		// such as when a looping track wraps around
+		int key = m_trackCursor[track];
+		if (keyTimes[key] > localTime)
+		{
+			key = 0;
+		}
+		while ((key < keyCount - 2) && (keyTimes[key + 1] <= localTime))
+		{
+			key++;
+		}
+		m_trackCursor[track] = key;
+
+		// the weight between the surrounding keyframes
+		float span = keyTimes[key + 1] - keyTimes[key];
+		float blend = 0.0f;
+		if (span > 0.0f)
+		{
+			blend = (localTime - keyTimes[key]) / span;
+		}
+		m_trackFrom[track] = keyValues[key];
+		m_trackTo[track] = keyValues[key + 1];
+		m_trackBlend[track] = glm::vec3(blend);
+	}
+
+	// linearly interpolate every value of the range at once
+	const float* pFrom = &m_trackFrom[0].x;
+	const float* pTo = &m_trackTo[0].x;
+	const float* pBlend = &m_trackBlend[0].x;
+	float* pResult = &m_trackResult[0].x;
+	int lastValue = lastTrack * 3;
+	for (int i = firstTrack * 3; i < lastValue; i++)
+	{
+		pResult[i] = pFrom[i] + (pTo[i] - pFrom[i]) * pBlend[i];
+	}
+}
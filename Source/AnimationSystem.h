@@ -0,0 +1,132 @@
+///////////////////////////////////////////////////////////////////////////////
+// animationsystem.h
+// ============
+// evaluate keyframe animation tracks for the 3D scene nodes
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  AnimationSystem
+ *
+ *  This class stores keyframe animation tracks and evaluates
+ *  all of the active tracks in one batched pass each frame.
+ *  The track data is kept in parallel arrays so that the
+ *  evaluation loop only walks contiguous memory.  The
+ *  keyframe search branches per track, so it is kept apart
+ *  from the blend between the keyframes, which is a single
+ *  loop over flat arrays that the compiler can vectorize.
+ ***********************************************************/
+class AnimationSystem
+{
+public:
+	// constructor
+	AnimationSystem();
+	// destructor
+	~AnimationSystem();
+
+	// the scene values that an animation track can drive
+	enum ANIMATION_CHANNEL
+	{
+		CHANNEL_TRANSLATION,
+		CHANNEL_ROTATION,
+		CHANNEL_SCALE,
+		CHANNEL_MATERIAL_AMBIENT_STRENGTH,
+		CHANNEL_MATERIAL_DIFFUSE_COLOR,
+		CHANNEL_MATERIAL_SPECULAR_COLOR,
+		CHANNEL_MATERIAL_SHININESS
+	};
+
+	struct KEYFRAME
+	{
+		float time;
+		glm::vec3 value;
+	};
+
+	// add a new track for the passed in target index - the
+	// keyframes must be sorted by time, returns the track index
+	int AddTrack(
+		int target,
+		ANIMATION_CHANNEL channel,
+		const std::vector<KEYFRAME>& keyframes,
+		bool bLooping);
+	// enable or disable the evaluation of a track
+	void SetTrackActive(int track, bool bActive);
+	// stop a track for good and detach it from its target - the
+	// index stays taken, so the other track indices do not change
+	void RemoveTrack(int track);
+	// remove all of the defined tracks
+	void Clear();
+
+	// evaluate every active track at the passed in time
+	void Evaluate(float timeSeconds);
+
+	// accessors for the results of the last evaluation
+	int GetTrackCount() const { return((int)m_trackTarget.size()); }
+	bool IsTrackActive(int track) const { return(m_trackActive[track] != 0); }
+	int GetTrackTarget(int track) const { return(m_trackTarget[track]); }
+	ANIMATION_CHANNEL GetTrackChannel(int track) const { return(m_trackChannel[track]); }
+	const glm::vec3& GetTrackResult(int track) const { return(m_trackResult[track]); }
+	const glm::vec3& GetTrackPreviousResult(int track) const { return(m_trackPrevious[track]); }
+
+	// check whether a channel drives a material instead of a node
+	static bool IsMaterialChannel(ANIMATION_CHANNEL channel);
+
+private:
+	// per-track data, stored as parallel arrays
+	std::vector<int> m_trackTarget;
+	std::vector<ANIMATION_CHANNEL> m_trackChannel;
+	std::vector<int> m_trackFirstKey;
+	std::vector<int> m_trackKeyCount;
+	std::vector<int> m_trackCursor;
+	std::vector<char> m_trackLooping;
+	std::vector<char> m_trackActive;
+	std::vector<glm::vec3> m_trackResult;
+	// results of the evaluation before the last one, kept so
+	// that rendering can blend between two update steps
+	std::vector<glm::vec3> m_trackPrevious;
+	// the keyframe values that each track blends between, and the
+	// blend weight repeated for x, y and z, written by the search
+	std::vector<glm::vec3> m_trackFrom;
+	std::vector<glm::vec3> m_trackTo;
+	std::vector<glm::vec3> m_trackBlend;
+
+	// keyframe data shared by all of the tracks
+	std::vector<float> m_keyTimes;
+	std::vector<glm::vec3> m_keyValues;
+
+	// worker threads that evaluate the ranges of large track
+	// counts, started the first time they are needed and kept
+	// until the system is destroyed
+	std::vector<std::thread> m_workers;
+	// the lock and signals shared with the workers - each
+	// evaluation has a new generation, the workers below the
+	// active count evaluate a range of it, and every worker
+	// reports back once it has seen it
+	std::mutex m_workerMutex;
+	std::condition_variable m_workerStart;
+	std::condition_variable m_workerDone;
+	int m_workGeneration;
+	int m_activeWorkers;
+	int m_pendingWorkers;
+	int m_tracksPerWorker;
+	float m_workTime;
+	bool m_bStopWorkers;
+
+	// evaluate the tracks in the range [firstTrack, lastTrack)
+	void EvaluateRange(int firstTrack, int lastTrack, float timeSeconds);
+	// start the worker threads, and stop them
+	void StartWorkers(int workerCount);
+	void StopWorkers();
+	// the loop of a worker thread, which evaluates the range with
+	// its index plus one, the calling thread takes the first
+	void WorkerThread(int workerIndex);
+};
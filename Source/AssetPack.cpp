@@ -0,0 +1,513 @@
+///////////////////////////////////////////////////////////////////////////////
+// assetpack.cpp
+// ============
+// read the scene resources from one memory-mapped pack file
+//
+///////////////////////////////////////////////////////////////////////////////
+
+// the platform headers come first, so that windows.h does not
+// define min and max over the standard ones
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "AssetPack.h"
+
+#include "stb_image.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+// declaration of global variables
+namespace
+{
+	// marks the start of a pack file, and its layout version
+	const uint32_t g_PackMagic = 0x4B434150;	// "PACK"
+	const uint32_t g_PackVersion = 1;
+	// every file's data starts on this boundary, so it can be
+	// read as any type and uploaded as it is
+	const uint64_t g_DataAlignment = 64;
+
+	// the start of a pack file
+	struct PACK_HEADER
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t fileCount;
+		uint32_t bucketCount;
+		uint64_t directoryOffset;
+		uint64_t namesOffset;
+		uint64_t namesSize;
+	};
+
+	// one bucket of the directory, empty when its type is none
+	struct PACK_ENTRY
+	{
+		uint64_t nameHash;
+		uint64_t dataOffset;
+		uint64_t dataSize;
+		uint32_t nameOffset;
+		uint32_t type;
+		uint32_t width;
+		uint32_t height;
+		uint32_t colorChannels;
+		uint32_t padding;
+	};
+
+	// the file paths are looked up with forward slashes, so a
+	// path written either way finds the same file
+	std::string NormalizePath(const char* filePath)
+	{
+		std::string path = filePath;
+		for (int i = 0; i < path.size(); i++)
+		{
+			if (path[i] == '\\')
+			{
+				path[i] = '/';
+			}
+		}
+		return(path);
+	}
+
+	// FNV-1a hash of a normalized path
+	uint64_t HashPath(const std::string& path)
+	{
+		uint64_t hash = 14695981039346656037ull;
+		for (int i = 0; i < path.size(); i++)
+		{
+			hash = (hash ^ (unsigned char)path[i]) * 1099511628211ull;
+		}
+		return(hash);
+	}
+
+	// check whether a path names an image that is stored decoded
+	bool IsImagePath(const std::string& path)
+	{
+		const char* extensions[] = { ".jpg", ".jpeg", ".png", ".bmp", ".tga" };
+		for (int i = 0; i < 5; i++)
+		{
+			size_t length = strlen(extensions[i]);
+			if ((path.size() > length) &&
+				(path.compare(path.size() - length, length, extensions[i]) == 0))
+			{
+				return(true);
+			}
+		}
+		return(false);
+	}
+}
+
+/***********************************************************
+ *  AssetPack()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+AssetPack::AssetPack()
+{
+	m_pMapping = NULL;
+	m_mappingSize = 0;
+	m_fileHandle = -1;
+	m_mappingHandle = -1;
+	m_pDirectory = NULL;
+	m_bucketCount = 0;
+	m_namesOffset = 0;
+}
+
+/***********************************************************
+ *  ~AssetPack()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+AssetPack::~AssetPack()
+{
+	Close();
+	m_recordedFiles.clear();
+}
+
+/***********************************************************
+ *  Open()
+ *
+ *  This method is used for mapping a pack file and checking
+ *  that its directory can be trusted, so the lookups do not
+ *  have to check it again.
+ ***********************************************************/
+bool AssetPack::Open(const char* packPath)
+{
+	Close();
+
+	if (MapFile(packPath) == false)
+	{
+		return(false);
+	}
+	if (ValidatePack() == false)
+	{
+		std::cout << "Could not use the asset pack:" << packPath << std::endl;
+		Close();
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  MapFile()
+ *
+ *  This method is used for mapping the whole pack file into
+ *  memory, read only.  The pages are only read from disk as
+ *  the files in them are used.
+ ***********************************************************/
+bool AssetPack::MapFile(const char* packPath)
+{
+#ifdef _WIN32
+	HANDLE fileHandle = CreateFileA(
+		packPath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+	{
+		return(false);
+	}
+
+	LARGE_INTEGER fileSize;
+	HANDLE mappingHandle = NULL;
+	if ((GetFileSizeEx(fileHandle, &fileSize) == TRUE) && (fileSize.QuadPart > 0))
+	{
+		mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+	}
+	if (NULL == mappingHandle)
+	{
+		CloseHandle(fileHandle);
+		return(false);
+	}
+
+	void* pView = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	if (NULL == pView)
+	{
+		CloseHandle(mappingHandle);
+		CloseHandle(fileHandle);
+		return(false);
+	}
+
+	m_fileHandle = (intptr_t)fileHandle;
+	m_mappingHandle = (intptr_t)mappingHandle;
+	m_pMapping = (const unsigned char*)pView;
+	m_mappingSize = (size_t)fileSize.QuadPart;
+#else
+	int fileDescriptor = open(packPath, O_RDONLY);
+	if (fileDescriptor < 0)
+	{
+		return(false);
+	}
+
+	struct stat fileStatus;
+	if ((fstat(fileDescriptor, &fileStatus) != 0) || (fileStatus.st_size <= 0))
+	{
+		close(fileDescriptor);
+		return(false);
+	}
+
+	void* pView = mmap(NULL, (size_t)fileStatus.st_size, PROT_READ, MAP_SHARED, fileDescriptor, 0);
+	if (pView == MAP_FAILED)
+	{
+		close(fileDescriptor);
+		return(false);
+	}
+
+	m_fileHandle = fileDescriptor;
+	m_pMapping = (const unsigned char*)pView;
+	m_mappingSize = (size_t)fileStatus.st_size;
+#endif
+
+	return(true);
+}
+
+/***********************************************************
+ *  ValidatePack()
+ *
+ *  This method is used for checking that the header, the
+ *  directory and every file's data fit inside the mapping.
+ ***********************************************************/
+bool AssetPack::ValidatePack()
+{
+	if (m_mappingSize < sizeof(PACK_HEADER))
+	{
+		return(false);
+	}
+
+	PACK_HEADER header;
+	memcpy(&header, m_pMapping, sizeof(header));
+	if ((header.magic != g_PackMagic) || (header.version != g_PackVersion) ||
+		(header.bucketCount == 0) || ((header.bucketCount & (header.bucketCount - 1)) != 0))
+	{
+		return(false);
+	}
+
+	uint64_t directorySize = (uint64_t)header.bucketCount * sizeof(PACK_ENTRY);
+	if ((header.directoryOffset % sizeof(uint64_t) != 0) ||
+		(header.directoryOffset > m_mappingSize) ||
+		(directorySize > m_mappingSize - header.directoryOffset) ||
+		(header.namesSize == 0) ||
+		(header.namesOffset > m_mappingSize) ||
+		(header.namesSize > m_mappingSize - header.namesOffset) ||
+		(m_pMapping[header.namesOffset + header.namesSize - 1] != '\0'))
+	{
+		return(false);
+	}
+
+	const PACK_ENTRY* pEntries = (const PACK_ENTRY*)(m_pMapping + header.directoryOffset);
+	for (uint32_t i = 0; i < header.bucketCount; i++)
+	{
+		const PACK_ENTRY& entry = pEntries[i];
+		if (entry.type == ASSET_NONE)
+		{
+			continue;
+		}
+		if ((entry.type > ASSET_IMAGE) ||
+			(entry.nameOffset >= header.namesSize) ||
+			(entry.dataOffset > m_mappingSize) ||
+			(entry.dataSize > m_mappingSize - entry.dataOffset))
+		{
+			return(false);
+		}
+		if ((entry.type == ASSET_IMAGE) &&
+			((uint64_t)entry.width * entry.height * entry.colorChannels != entry.dataSize))
+		{
+			return(false);
+		}
+	}
+
+	m_pDirectory = pEntries;
+	m_bucketCount = header.bucketCount;
+	m_namesOffset = header.namesOffset;
+
+	return(true);
+}
+
+/***********************************************************
+ *  Close()
+ *
+ *  This method is used for unmapping the open pack.
+ ***********************************************************/
+void AssetPack::Close()
+{
+	if (NULL != m_pMapping)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(m_pMapping);
+		CloseHandle((HANDLE)m_mappingHandle);
+		CloseHandle((HANDLE)m_fileHandle);
+#else
+		munmap((void*)m_pMapping, m_mappingSize);
+		close((int)m_fileHandle);
+#endif
+	}
+
+	m_pMapping = NULL;
+	m_mappingSize = 0;
+	m_fileHandle = -1;
+	m_mappingHandle = -1;
+	m_pDirectory = NULL;
+	m_bucketCount = 0;
+	m_namesOffset = 0;
+}
+
+/***********************************************************
+ *  Find()
+ *
+ *  This method is used for finding a file by its path.  The
+ *  directory is an open addressing hash table, so the file
+ *  is in the bucket of its hash or one of the buckets after
+ *  it, before the first empty one.  The names are compared
+ *  as well, in case two paths have the same hash.
+ ***********************************************************/
+bool AssetPack::Find(const char* filePath, ASSET& asset) const
+{
+	if ((NULL == m_pMapping) || (NULL == filePath))
+	{
+		return(false);
+	}
+
+	std::string path = NormalizePath(filePath);
+	uint64_t hash = HashPath(path);
+	const PACK_ENTRY* pEntries = (const PACK_ENTRY*)m_pDirectory;
+	const char* pNames = (const char*)(m_pMapping + m_namesOffset);
+
+	for (uint32_t probe = 0; probe < m_bucketCount; probe++)
+	{
+		const PACK_ENTRY& entry = pEntries[(hash + probe) & (m_bucketCount - 1)];
+		if (entry.type == ASSET_NONE)
+		{
+			return(false);
+		}
+		if ((entry.nameHash == hash) && (path.compare(pNames + entry.nameOffset) == 0))
+		{
+			asset.type = (ASSET_TYPE)entry.type;
+			asset.pData = m_pMapping + entry.dataOffset;
+			asset.size = (size_t)entry.dataSize;
+			asset.width = (int)entry.width;
+			asset.height = (int)entry.height;
+			asset.colorChannels = (int)entry.colorChannels;
+			return(true);
+		}
+	}
+
+	return(false);
+}
+
+/***********************************************************
+ *  RecordFileRead()
+ *
+ *  This method is used for recording a file that had to be
+ *  read from disk.  The loader thread reads files too, so
+ *  the list is locked.
+ ***********************************************************/
+void AssetPack::RecordFileRead(const char* filePath)
+{
+	std::string path = NormalizePath(filePath);
+
+	std::lock_guard<std::mutex> lock(m_recordMutex);
+	for (int i = 0; i < m_recordedFiles.size(); i++)
+	{
+		if (m_recordedFiles[i].compare(path) == 0)
+		{
+			return;
+		}
+	}
+	m_recordedFiles.push_back(path);
+}
+
+/***********************************************************
+ *  Cook()
+ *
+ *  This method is used for writing the recorded files into
+ *  a new pack.  Images are decoded the same way the texture
+ *  loading decodes them, so the pixels can be uploaded as
+ *  they are, and every other file is kept as it is.  The
+ *  directory has at least twice as many buckets as files,
+ *  which keeps the probe sequences short.
+ ***********************************************************/
+bool AssetPack::Cook(const char* packPath)
+{
+	std::vector<std::string> files;
+	{
+		std::lock_guard<std::mutex> lock(m_recordMutex);
+		files = m_recordedFiles;
+	}
+
+	uint32_t bucketCount = 1;
+	while (bucketCount < files.size() * 2)
+	{
+		bucketCount *= 2;
+	}
+
+	std::vector<PACK_ENTRY> entries(bucketCount);
+	memset(&entries[0], 0, entries.size() * sizeof(PACK_ENTRY));
+	std::vector<std::vector<unsigned char> > fileData;
+	std::vector<uint32_t> fileBuckets;
+	std::string names;
+
+	stbi_set_flip_vertically_on_load(true);
+	for (int i = 0; i < files.size(); i++)
+	{
+		std::ifstream file(files[i].c_str(), std::ios::binary);
+		if (file.is_open() == false)
+		{
+			std::cout << "Could not open file for the asset pack:" << files[i] << std::endl;
+			continue;
+		}
+		std::vector<unsigned char> bytes(
+			(std::istreambuf_iterator<char>(file)),
+			std::istreambuf_iterator<char>());
+
+		PACK_ENTRY entry;
+		memset(&entry, 0, sizeof(entry));
+		entry.type = ASSET_FILE;
+
+		if ((IsImagePath(files[i]) == true) && (bytes.empty() == false))
+		{
+			int width = 0;
+			int height = 0;
+			int colorChannels = 0;
+			unsigned char* pixels = stbi_load_from_memory(
+				&bytes[0], (int)bytes.size(), &width, &height, &colorChannels, 0);
+			if (NULL != pixels)
+			{
+				bytes.assign(pixels, pixels + (size_t)width * height * colorChannels);
+				stbi_image_free(pixels);
+				entry.type = ASSET_IMAGE;
+				entry.width = (uint32_t)width;
+				entry.height = (uint32_t)height;
+				entry.colorChannels = (uint32_t)colorChannels;
+			}
+		}
+
+		entry.nameHash = HashPath(files[i]);
+		entry.nameOffset = (uint32_t)names.size();
+		entry.dataSize = bytes.size();
+		names += files[i];
+		names.push_back('\0');
+
+		uint32_t bucket = (uint32_t)(entry.nameHash & (bucketCount - 1));
+		while (entries[bucket].type != ASSET_NONE)
+		{
+			bucket = (bucket + 1) & (bucketCount - 1);
+		}
+		entries[bucket] = entry;
+		fileData.push_back(bytes);
+		fileBuckets.push_back(bucket);
+	}
+	names.push_back('\0');
+
+	// the header, the directory and the names, followed by the
+	// data of each file on an aligned offset
+	PACK_HEADER header;
+	header.magic = g_PackMagic;
+	header.version = g_PackVersion;
+	header.fileCount = (uint32_t)fileData.size();
+	header.bucketCount = bucketCount;
+	header.directoryOffset = sizeof(PACK_HEADER);
+	header.namesOffset = header.directoryOffset + bucketCount * sizeof(PACK_ENTRY);
+	header.namesSize = names.size();
+
+	uint64_t dataOffset = header.namesOffset + header.namesSize;
+	for (int i = 0; i < fileData.size(); i++)
+	{
+		dataOffset = (dataOffset + g_DataAlignment - 1) & ~(g_DataAlignment - 1);
+		entries[fileBuckets[i]].dataOffset = dataOffset;
+		dataOffset += fileData[i].size();
+	}
+
+	std::ofstream packFile(packPath, std::ios::binary | std::ios::trunc);
+	if (packFile.is_open() == false)
+	{
+		std::cout << "Could not write the asset pack:" << packPath << std::endl;
+		return(false);
+	}
+
+	packFile.write((const char*)&header, sizeof(header));
+	packFile.write((const char*)&entries[0], entries.size() * sizeof(PACK_ENTRY));
+	packFile.write(names.c_str(), names.size());
+	uint64_t writtenOffset = header.namesOffset + header.namesSize;
+	for (int i = 0; i < fileData.size(); i++)
+	{
+		const char padding[g_DataAlignment] = { 0 };
+		uint64_t fileOffset = entries[fileBuckets[i]].dataOffset;
+		packFile.write(padding, (std::streamsize)(fileOffset - writtenOffset));
+		if (fileData[i].empty() == false)
+		{
+			packFile.write((const char*)&fileData[i][0], fileData[i].size());
+		}
+		writtenOffset = fileOffset + fileData[i].size();
+	}
+
+	std::cout << "Cooked " << fileData.size() << " files into the asset pack:" << packPath << std::endl;
+
+	return(packFile.good());
+}
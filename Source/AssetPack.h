@@ -0,0 +1,103 @@
+///////////////////////////////////////////////////////////////////////////////
+// assetpack.h
+// ============
+// read the scene resources from one memory-mapped pack file
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  AssetPack
+ *
+ *  This class keeps the files that the scenes load - the
+ *  texture images, shader sources and other data - in one
+ *  pack file.  The pack starts with a hashed directory of
+ *  its files, and each file's data is aligned behind it.
+ *  The whole pack is mapped into memory when it is opened,
+ *  so finding a file is a hash lookup in the directory,
+ *  and its data is read right out of the mapping without
+ *  opening, seeking or copying anything.  Images are stored
+ *  already decoded, so they go straight to the texture
+ *  upload.  The pack is cooked from the files that a normal
+ *  start reads from disk, which are recorded as they are
+ *  read.
+ ***********************************************************/
+class AssetPack
+{
+public:
+	// constructor
+	AssetPack();
+	// destructor
+	~AssetPack();
+
+	// the kinds of files in the pack
+	enum ASSET_TYPE
+	{
+		ASSET_NONE,
+		// the bytes of the file as they are on disk
+		ASSET_FILE,
+		// the decoded pixels of an image file, bottom row first
+		ASSET_IMAGE
+	};
+
+	// a file found in the pack, pointing into the mapping
+	struct ASSET
+	{
+		ASSET_TYPE type;
+		const unsigned char* pData;
+		size_t size;
+		// size and channels of an image
+		int width;
+		int height;
+		int colorChannels;
+	};
+
+	// map a pack file into memory, returns false when there is
+	// no valid pack at the passed in path
+	bool Open(const char* packPath);
+	// unmap the open pack - the data of any found file is no
+	// longer valid afterwards
+	void Close();
+	bool IsOpen() const { return(NULL != m_pMapping); }
+
+	// find a file by the path that it would be read from disk
+	// with, returns false when it is not in the pack - this can
+	// be called from any thread
+	bool Find(const char* filePath, ASSET& asset) const;
+
+	// record a file that was read from disk instead of the pack,
+	// so that it is included when the pack is cooked
+	void RecordFileRead(const char* filePath);
+	// write every recorded file into a new pack file
+	bool Cook(const char* packPath);
+
+private:
+	// the mapped pack and the handles that keep it mapped
+	const unsigned char* m_pMapping;
+	size_t m_mappingSize;
+	intptr_t m_fileHandle;
+	intptr_t m_mappingHandle;
+	// the directory inside the mapping, with a power of two
+	// number of buckets
+	const void* m_pDirectory;
+	uint32_t m_bucketCount;
+	// where the file names start inside the mapping
+	uint64_t m_namesOffset;
+
+	// the files read from disk since the pack was created, and
+	// the lock for the loader thread that records them too
+	std::vector<std::string> m_recordedFiles;
+	std::mutex m_recordMutex;
+
+	// map the whole file into memory
+	bool MapFile(const char* packPath);
+	// check the header and directory of the mapped pack
+	bool ValidatePack();
+};
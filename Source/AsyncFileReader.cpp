@@ -0,0 +1,714 @@
+///////////////////////////////////////////////////////////////////////////////
+// asyncfilereader.cpp
+// ============
+// read whole files in the background with many reads in flight at once
+//
+///////////////////////////////////////////////////////////////////////////////
+
+// the platform headers come first, so that windows.h does not
+// define min and max over the standard ones
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+// io_uring is used where the kernel headers describe it
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define ASYNC_READER_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+#include "AsyncFileReader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// the largest range of a file that is read by one request,
+	// so that a large file is read by several at once
+	const uint64_t g_ReadChunkSize = 1024 * 1024;
+	// number of submission entries in the io_uring ring
+	const unsigned g_RingEntries = 64;
+	// number of fallback read threads - the reads mostly wait
+	// on the device, so there are more of them than cores
+	const int g_ReadThreadCount = 8;
+	// the value of a file handle that is not open
+	const intptr_t g_InvalidFileHandle = -1;
+}
+
+#ifdef ASYNC_READER_IO_URING
+/***********************************************************
+ *  RING
+ *
+ *  The file of the io_uring instance, and the submission
+ *  and completion rings that are shared with the kernel.
+ ***********************************************************/
+struct AsyncFileReader::RING
+{
+	int ringFile;
+	unsigned entryCount;
+
+	void* pSubmitMapping;
+	size_t submitMappingSize;
+	void* pCompleteMapping;
+	size_t completeMappingSize;
+	io_uring_sqe* pEntries;
+	size_t entriesSize;
+
+	unsigned* pSubmitHead;
+	unsigned* pSubmitTail;
+	unsigned submitMask;
+	unsigned* pSubmitArray;
+
+	unsigned* pCompleteHead;
+	unsigned* pCompleteTail;
+	unsigned completeMask;
+	io_uring_cqe* pCompletions;
+};
+
+namespace
+{
+	// hand the submitted entries to the kernel and/or wait for
+	// completions, retrying when interrupted by a signal
+	int EnterRing(int ringFile, unsigned submitCount, unsigned waitCount, unsigned flags)
+	{
+		int result = 0;
+		do
+		{
+			result = (int)syscall(__NR_io_uring_enter, ringFile, submitCount, waitCount, flags, NULL, 0);
+		} while ((result < 0) && (errno == EINTR));
+
+		return(result);
+	}
+}
+#endif
+
+/***********************************************************
+ *  AsyncFileReader()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+AsyncFileReader::AsyncFileReader(COMPLETION_CALLBACK callback)
+{
+	m_callback = callback;
+	m_bStop = false;
+	m_pRing = NULL;
+	m_inFlightCount = 0;
+}
+
+/***********************************************************
+ *  ~AsyncFileReader()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+AsyncFileReader::~AsyncFileReader()
+{
+	m_bStop = true;
+
+	// the chunks that were not handed to the kernel are dropped,
+	// but the ones in flight still write into their files, so
+	// the completion thread reaps them all before it returns
+	if (m_completionThread.joinable())
+	{
+		std::vector<FILE_READ*> droppedFiles;
+		{
+			std::lock_guard<std::mutex> lock(m_submitMutex);
+			while (m_queuedChunks.size() > 0)
+			{
+				CHUNK_READ* pChunk = m_queuedChunks.front();
+				m_queuedChunks.pop_front();
+				pChunk->pFile->chunksLeft--;
+				if (pChunk->pFile->chunksLeft == 0)
+				{
+					droppedFiles.push_back(pChunk->pFile);
+				}
+				delete pChunk;
+			}
+		}
+		for (int i = 0; i < droppedFiles.size(); i++)
+		{
+			FinishFile(droppedFiles[i]);
+		}
+
+		SubmitWakeup();
+		m_completionThread.join();
+	}
+	DestroyRing();
+
+	// the read threads finish the file they are reading - the
+	// lock makes sure none is between its check and its wait
+	{
+		std::lock_guard<std::mutex> lock(m_queueMutex);
+	}
+	m_queueCondition.notify_all();
+	for (int i = 0; i < m_readThreads.size(); i++)
+	{
+		m_readThreads[i].join();
+	}
+	m_readThreads.clear();
+	while (m_queuedFiles.size() > 0)
+	{
+		delete m_queuedFiles.front();
+		m_queuedFiles.pop_front();
+	}
+}
+
+/***********************************************************
+ *  Start()
+ *
+ *  This method is used for starting the reads - through an
+ *  io_uring ring when the kernel allows it, otherwise with
+ *  a pool of read threads.
+ ***********************************************************/
+bool AsyncFileReader::Start()
+{
+	if ((NULL != m_pRing) || (m_readThreads.size() > 0))
+	{
+		return(true);
+	}
+
+	if (SetupRing() == true)
+	{
+		m_completionThread = std::thread(&AsyncFileReader::CompletionThread, this);
+		return(true);
+	}
+
+	for (int i = 0; i < g_ReadThreadCount; i++)
+	{
+		m_readThreads.push_back(std::thread(&AsyncFileReader::ReadThread, this));
+	}
+
+	return(m_readThreads.size() > 0);
+}
+
+/***********************************************************
+ *  Read()
+ *
+ *  This method is used for queueing a file to be read.
+ *  With io_uring the file is opened right away and split
+ *  into chunks that are submitted as entries free up,
+ *  otherwise it waits for the next free read thread.
+ ***********************************************************/
+void AsyncFileReader::Read(const std::string& filePath)
+{
+	FILE_READ* pFile = new FILE_READ;
+	pFile->filePath = filePath;
+	pFile->fileHandle = g_InvalidFileHandle;
+	pFile->chunksLeft = 0;
+	pFile->bFailed = false;
+
+	if (NULL == m_pRing)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_queueMutex);
+			m_queuedFiles.push_back(pFile);
+		}
+		m_queueCondition.notify_one();
+		return;
+	}
+
+	uint64_t fileSize = 0;
+	if ((OpenFile(pFile, fileSize) == false) || (fileSize == 0))
+	{
+		pFile->bFailed = true;
+		FinishFile(pFile);
+		return;
+	}
+
+	pFile->data.resize((size_t)fileSize);
+	{
+		std::lock_guard<std::mutex> lock(m_submitMutex);
+		for (uint64_t offset = 0; offset < fileSize; offset += g_ReadChunkSize)
+		{
+			CHUNK_READ* pChunk = new CHUNK_READ;
+			pChunk->pFile = pFile;
+			pChunk->offset = offset;
+			pChunk->size = (size_t)std::min(g_ReadChunkSize, fileSize - offset);
+			m_queuedChunks.push_back(pChunk);
+			pFile->chunksLeft++;
+		}
+	}
+	SubmitChunks();
+}
+
+/***********************************************************
+ *  OpenFile()
+ *
+ *  This method is used for opening a file for reading and
+ *  getting its size.
+ ***********************************************************/
+bool AsyncFileReader::OpenFile(FILE_READ* pFile, uint64_t& fileSize)
+{
+	fileSize = 0;
+
+#ifdef _WIN32
+	HANDLE fileHandle = CreateFileA(
+		pFile->filePath.c_str(),
+		GENERIC_READ,
+		FILE_SHARE_READ,
+		NULL,
+		OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL,
+		NULL);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+	{
+		return(false);
+	}
+
+	LARGE_INTEGER size;
+	if (GetFileSizeEx(fileHandle, &size) == FALSE)
+	{
+		CloseHandle(fileHandle);
+		return(false);
+	}
+
+	pFile->fileHandle = (intptr_t)fileHandle;
+	fileSize = (uint64_t)size.QuadPart;
+#else
+	int fileDescriptor = open(pFile->filePath.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fileDescriptor < 0)
+	{
+		return(false);
+	}
+
+	struct stat fileStatus;
+	if ((fstat(fileDescriptor, &fileStatus) != 0) || (fileStatus.st_size < 0))
+	{
+		close(fileDescriptor);
+		return(false);
+	}
+
+	pFile->fileHandle = fileDescriptor;
+	fileSize = (uint64_t)fileStatus.st_size;
+#endif
+
+	return(true);
+}
+
+/***********************************************************
+ *  FinishFile()
+ *
+ *  This method is used for closing a file that is done,
+ *  and passing its data to the completion callback.
+ ***********************************************************/
+void AsyncFileReader::FinishFile(FILE_READ* pFile)
+{
+	if (pFile->fileHandle != g_InvalidFileHandle)
+	{
+#ifdef _WIN32
+		CloseHandle((HANDLE)pFile->fileHandle);
+#else
+		close((int)pFile->fileHandle);
+#endif
+		pFile->fileHandle = g_InvalidFileHandle;
+	}
+
+	if ((m_bStop == false) && m_callback)
+	{
+		READ_RESULT result;
+		result.filePath = pFile->filePath;
+		result.bSucceeded = (pFile->bFailed == false);
+		if (result.bSucceeded == true)
+		{
+			result.data.swap(pFile->data);
+		}
+		m_callback(result);
+	}
+
+	delete pFile;
+}
+
+/***********************************************************
+ *  SetupRing()
+ *
+ *  This method is used for creating an io_uring instance
+ *  and mapping its rings.  It fails on other platforms, on
+ *  kernels older than 5.6 that lack the plain read request,
+ *  and where io_uring has been disabled.
+ ***********************************************************/
+bool AsyncFileReader::SetupRing()
+{
+#ifdef ASYNC_READER_IO_URING
+	io_uring_params params;
+	memset(&params, 0, sizeof(params));
+
+	int ringFile = (int)syscall(__NR_io_uring_setup, g_RingEntries, &params);
+	if (ringFile < 0)
+	{
+		return(false);
+	}
+	// the feature flag came with the same kernel as the plain
+	// read request, which older kernels would reject
+	if ((params.features & IORING_FEAT_RW_CUR_POS) == 0)
+	{
+		close(ringFile);
+		return(false);
+	}
+
+	RING* pRing = new RING;
+	memset(pRing, 0, sizeof(RING));
+	pRing->ringFile = ringFile;
+	pRing->entryCount = params.sq_entries;
+	pRing->submitMappingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	pRing->completeMappingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+	// newer kernels map both rings with one call
+	if ((params.features & IORING_FEAT_SINGLE_MMAP) != 0)
+	{
+		pRing->submitMappingSize = std::max(pRing->submitMappingSize, pRing->completeMappingSize);
+		pRing->completeMappingSize = pRing->submitMappingSize;
+	}
+
+	pRing->pSubmitMapping = mmap(
+		NULL, pRing->submitMappingSize, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_POPULATE, ringFile, IORING_OFF_SQ_RING);
+	if (pRing->pSubmitMapping == MAP_FAILED)
+	{
+		close(ringFile);
+		delete pRing;
+		return(false);
+	}
+	if ((params.features & IORING_FEAT_SINGLE_MMAP) != 0)
+	{
+		pRing->pCompleteMapping = pRing->pSubmitMapping;
+	}
+	else
+	{
+		pRing->pCompleteMapping = mmap(
+			NULL, pRing->completeMappingSize, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, ringFile, IORING_OFF_CQ_RING);
+	}
+	pRing->entriesSize = params.sq_entries * sizeof(io_uring_sqe);
+	void* pEntries = mmap(
+		NULL, pRing->entriesSize, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_POPULATE, ringFile, IORING_OFF_SQES);
+	if ((pRing->pCompleteMapping == MAP_FAILED) || (pEntries == MAP_FAILED))
+	{
+		if (pRing->pCompleteMapping == MAP_FAILED)
+		{
+			pRing->pCompleteMapping = NULL;
+		}
+		if (pEntries != MAP_FAILED)
+		{
+			munmap(pEntries, pRing->entriesSize);
+		}
+		m_pRing = pRing;
+		DestroyRing();
+		return(false);
+	}
+	pRing->pEntries = (io_uring_sqe*)pEntries;
+
+	unsigned char* pSubmit = (unsigned char*)pRing->pSubmitMapping;
+	pRing->pSubmitHead = (unsigned*)(pSubmit + params.sq_off.head);
+	pRing->pSubmitTail = (unsigned*)(pSubmit + params.sq_off.tail);
+	pRing->submitMask = *(unsigned*)(pSubmit + params.sq_off.ring_mask);
+	pRing->pSubmitArray = (unsigned*)(pSubmit + params.sq_off.array);
+
+	unsigned char* pComplete = (unsigned char*)pRing->pCompleteMapping;
+	pRing->pCompleteHead = (unsigned*)(pComplete + params.cq_off.head);
+	pRing->pCompleteTail = (unsigned*)(pComplete + params.cq_off.tail);
+	pRing->completeMask = *(unsigned*)(pComplete + params.cq_off.ring_mask);
+	pRing->pCompletions = (io_uring_cqe*)(pComplete + params.cq_off.cqes);
+
+	m_pRing = pRing;
+	return(true);
+#else
+	return(false);
+#endif
+}
+
+/***********************************************************
+ *  DestroyRing()
+ *
+ *  This method is used for unmapping the rings and closing
+ *  the io_uring instance.
+ ***********************************************************/
+void AsyncFileReader::DestroyRing()
+{
+#ifdef ASYNC_READER_IO_URING
+	if (NULL == m_pRing)
+	{
+		return;
+	}
+
+	if (NULL != m_pRing->pEntries)
+	{
+		munmap(m_pRing->pEntries, m_pRing->entriesSize);
+	}
+	if ((NULL != m_pRing->pCompleteMapping) &&
+		(m_pRing->pCompleteMapping != m_pRing->pSubmitMapping))
+	{
+		munmap(m_pRing->pCompleteMapping, m_pRing->completeMappingSize);
+	}
+	munmap(m_pRing->pSubmitMapping, m_pRing->submitMappingSize);
+	close(m_pRing->ringFile);
+
+	delete m_pRing;
+	m_pRing = NULL;
+#endif
+}
+
+/***********************************************************
+ *  SubmitChunks()
+ *
+ *  This method is used for filling the free submission
+ *  entries with queued chunks and handing them to the
+ *  kernel.  One entry is always kept free for the wakeup
+ *  request that stops the completion thread.
+ ***********************************************************/
+void AsyncFileReader::SubmitChunks()
+{
+#ifdef ASYNC_READER_IO_URING
+	std::lock_guard<std::mutex> lock(m_submitMutex);
+
+	if ((NULL == m_pRing) || (m_bStop == true))
+	{
+		return;
+	}
+
+	unsigned tail = *m_pRing->pSubmitTail;
+	bool bSubmitted = false;
+	while ((m_queuedChunks.size() > 0) && (m_inFlightCount < (int)m_pRing->entryCount - 1))
+	{
+		CHUNK_READ* pChunk = m_queuedChunks.front();
+		m_queuedChunks.pop_front();
+
+		unsigned index = tail & m_pRing->submitMask;
+		io_uring_sqe* pEntry = &m_pRing->pEntries[index];
+		memset(pEntry, 0, sizeof(io_uring_sqe));
+		pEntry->opcode = IORING_OP_READ;
+		pEntry->fd = (int)pChunk->pFile->fileHandle;
+		pEntry->off = pChunk->offset;
+		pEntry->addr = (uint64_t)(uintptr_t)(pChunk->pFile->data.data() + pChunk->offset);
+		pEntry->len = (unsigned)pChunk->size;
+		pEntry->user_data = (uint64_t)(uintptr_t)pChunk;
+		m_pRing->pSubmitArray[index] = index;
+
+		tail++;
+		m_inFlightCount++;
+		bSubmitted = true;
+	}
+	if (bSubmitted == false)
+	{
+		return;
+	}
+
+	// the entries are published before the kernel reads the
+	// tail, and any the kernel left behind last time are
+	// submitted again along with the new ones
+	__atomic_store_n(m_pRing->pSubmitTail, tail, __ATOMIC_RELEASE);
+	unsigned pendingCount = tail - __atomic_load_n(m_pRing->pSubmitHead, __ATOMIC_ACQUIRE);
+	if (EnterRing(m_pRing->ringFile, pendingCount, 0, 0) < 0)
+	{
+		std::cout << "Could not submit file reads:" << errno << std::endl;
+	}
+#endif
+}
+
+/***********************************************************
+ *  SubmitWakeup()
+ *
+ *  This method is used for submitting an empty request, so
+ *  that the completion thread wakes up and sees the reader
+ *  is stopping.
+ ***********************************************************/
+void AsyncFileReader::SubmitWakeup()
+{
+#ifdef ASYNC_READER_IO_URING
+	std::lock_guard<std::mutex> lock(m_submitMutex);
+
+	unsigned tail = *m_pRing->pSubmitTail;
+	unsigned index = tail & m_pRing->submitMask;
+	io_uring_sqe* pEntry = &m_pRing->pEntries[index];
+	memset(pEntry, 0, sizeof(io_uring_sqe));
+	pEntry->opcode = IORING_OP_NOP;
+	pEntry->user_data = 0;
+	m_pRing->pSubmitArray[index] = index;
+	m_inFlightCount++;
+
+	__atomic_store_n(m_pRing->pSubmitTail, tail + 1, __ATOMIC_RELEASE);
+	unsigned pendingCount = tail + 1 - __atomic_load_n(m_pRing->pSubmitHead, __ATOMIC_ACQUIRE);
+	EnterRing(m_pRing->ringFile, pendingCount, 0, 0);
+#endif
+}
+
+/***********************************************************
+ *  CompletionThread()
+ *
+ *  This method is run on the completion thread.  It waits
+ *  for finished reads, queues the rest of any short read
+ *  again, passes each file on once all of its chunks are
+ *  in, and refills the submission ring.
+ ***********************************************************/
+void AsyncFileReader::CompletionThread()
+{
+#ifdef ASYNC_READER_IO_URING
+	while (true)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_submitMutex);
+			if ((m_bStop == true) && (m_inFlightCount == 0))
+			{
+				return;
+			}
+		}
+
+		if (EnterRing(m_pRing->ringFile, 0, 1, IORING_ENTER_GETEVENTS) < 0)
+		{
+			std::cout << "Could not wait for file reads:" << errno << std::endl;
+			return;
+		}
+
+		std::vector<FILE_READ*> finishedFiles;
+		unsigned head = *m_pRing->pCompleteHead;
+		unsigned tail = __atomic_load_n(m_pRing->pCompleteTail, __ATOMIC_ACQUIRE);
+		{
+			std::lock_guard<std::mutex> lock(m_submitMutex);
+			while (head != tail)
+			{
+				io_uring_cqe* pCompletion = &m_pRing->pCompletions[head & m_pRing->completeMask];
+				CHUNK_READ* pChunk = (CHUNK_READ*)(uintptr_t)pCompletion->user_data;
+				int result = pCompletion->res;
+				head++;
+				m_inFlightCount--;
+
+				// the wakeup request has no chunk
+				if (NULL == pChunk)
+				{
+					continue;
+				}
+
+				// a read that was interrupted or came up short is
+				// queued again for the rest of its range
+				if ((m_bStop == false) &&
+					((result == -EAGAIN) || (result == -EINTR) ||
+					((result > 0) && (result < (int)pChunk->size))))
+				{
+					if (result > 0)
+					{
+						pChunk->offset += (uint64_t)result;
+						pChunk->size -= (size_t)result;
+					}
+					m_queuedChunks.push_back(pChunk);
+					continue;
+				}
+
+				FILE_READ* pFile = pChunk->pFile;
+				if (result != (int)pChunk->size)
+				{
+					pFile->bFailed = true;
+				}
+				delete pChunk;
+
+				pFile->chunksLeft--;
+				if (pFile->chunksLeft == 0)
+				{
+					finishedFiles.push_back(pFile);
+				}
+			}
+			__atomic_store_n(m_pRing->pCompleteHead, head, __ATOMIC_RELEASE);
+		}
+
+		// the freed entries are refilled before the finished files
+		// are decoded, so the device stays busy in the meantime
+		SubmitChunks();
+		for (int i = 0; i < finishedFiles.size(); i++)
+		{
+			FinishFile(finishedFiles[i]);
+		}
+	}
+#endif
+}
+
+/***********************************************************
+ *  ReadThread()
+ *
+ *  This method is run on each fallback read thread.  It
+ *  reads the queued files one at a time until stopped.
+ ***********************************************************/
+void AsyncFileReader::ReadThread()
+{
+	while (true)
+	{
+		FILE_READ* pFile = NULL;
+		{
+			std::unique_lock<std::mutex> lock(m_queueMutex);
+			while ((m_queuedFiles.size() == 0) && (m_bStop == false))
+			{
+				m_queueCondition.wait(lock);
+			}
+			if (m_bStop == true)
+			{
+				return;
+			}
+			pFile = m_queuedFiles.front();
+			m_queuedFiles.pop_front();
+		}
+
+		uint64_t fileSize = 0;
+		if ((OpenFile(pFile, fileSize) == false) ||
+			(fileSize == 0) ||
+			(ReadWholeFile(pFile, fileSize) == false))
+		{
+			pFile->bFailed = true;
+		}
+		FinishFile(pFile);
+	}
+}
+
+/***********************************************************
+ *  ReadWholeFile()
+ *
+ *  This method is used for reading an open file into its
+ *  buffer with positional reads, one chunk at a time.
+ ***********************************************************/
+bool AsyncFileReader::ReadWholeFile(FILE_READ* pFile, uint64_t fileSize)
+{
+	pFile->data.resize((size_t)fileSize);
+
+	uint64_t offset = 0;
+	while (offset < fileSize)
+	{
+		size_t count = (size_t)std::min(g_ReadChunkSize, fileSize - offset);
+		unsigned char* pDestination = pFile->data.data() + offset;
+
+#ifdef _WIN32
+		OVERLAPPED position;
+		memset(&position, 0, sizeof(position));
+		position.Offset = (DWORD)(offset & 0xFFFFFFFF);
+		position.OffsetHigh = (DWORD)(offset >> 32);
+		DWORD bytesRead = 0;
+		if ((ReadFile((HANDLE)pFile->fileHandle, pDestination, (DWORD)count, &bytesRead, &position) == FALSE) ||
+			(bytesRead == 0))
+		{
+			return(false);
+		}
+		offset += bytesRead;
+#else
+		ssize_t bytesRead = pread((int)pFile->fileHandle, pDestination, count, (off_t)offset);
+		if ((bytesRead < 0) && (errno == EINTR))
+		{
+			continue;
+		}
+		if (bytesRead <= 0)
+		{
+			return(false);
+		}
+		offset += (uint64_t)bytesRead;
+#endif
+	}
+
+	return(true);
+}
@@ -0,0 +1,128 @@
+///////////////////////////////////////////////////////////////////////////////
+// asyncfilereader.h
+// ============
+// read whole files in the background with many reads in flight at once
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  AsyncFileReader
+ *
+ *  This class reads files into memory without blocking the
+ *  thread that asks for them.  Each file is split into
+ *  chunks that are read at their own offsets, so a large
+ *  file keeps several reads in flight, and many files keep
+ *  the device queue deep.  On Linux the chunks are handed
+ *  to the kernel through an io_uring submission ring, and a
+ *  single thread reaps the completions; everywhere else, or
+ *  when the kernel does not allow io_uring, a pool of
+ *  threads reads the files with positional reads.  Each
+ *  file is passed to the completion callback, on the
+ *  reader's own thread, as soon as its last chunk arrives,
+ *  so its decoding overlaps the reads of the others.
+ ***********************************************************/
+class AsyncFileReader
+{
+public:
+	// a file that has been read, or failed to be read
+	struct READ_RESULT
+	{
+		std::string filePath;
+		std::vector<unsigned char> data;
+		bool bSucceeded;
+	};
+
+	// called for every finished file, on the reader's thread or,
+	// when a file cannot even be opened, on the one that queued it
+	typedef std::function<void(READ_RESULT& result)> COMPLETION_CALLBACK;
+
+	// constructor
+	AsyncFileReader(COMPLETION_CALLBACK callback);
+	// destructor
+	~AsyncFileReader();
+
+	// start the io_uring ring or the read threads - returns
+	// false when neither could be started
+	bool Start();
+	// queue a file to be read
+	void Read(const std::string& filePath);
+
+	// check whether the reads go through io_uring
+	bool IsUsingIoUring() const { return(NULL != m_pRing); }
+
+private:
+	// a file being read and the chunks of it still outstanding
+	struct FILE_READ
+	{
+		std::string filePath;
+		intptr_t fileHandle;
+		std::vector<unsigned char> data;
+		int chunksLeft;
+		bool bFailed;
+	};
+
+	// a range of a file that is read with one request
+	struct CHUNK_READ
+	{
+		FILE_READ* pFile;
+		uint64_t offset;
+		size_t size;
+	};
+
+	// the mapped submission and completion rings, only defined
+	// where io_uring is available
+	struct RING;
+
+	COMPLETION_CALLBACK m_callback;
+	std::atomic<bool> m_bStop;
+
+	// the io_uring state - the ring, the chunks waiting for a
+	// free submission entry, the number in flight and the
+	// thread that reaps the completions
+	RING* m_pRing;
+	std::mutex m_submitMutex;
+	std::deque<CHUNK_READ*> m_queuedChunks;
+	int m_inFlightCount;
+	std::thread m_completionThread;
+
+	// the fallback state - the files waiting for a read thread
+	// and the threads themselves
+	std::mutex m_queueMutex;
+	std::condition_variable m_queueCondition;
+	std::deque<FILE_READ*> m_queuedFiles;
+	std::vector<std::thread> m_readThreads;
+
+	// open a file and find its size, returns false on failure
+	bool OpenFile(FILE_READ* pFile, uint64_t& fileSize);
+	// close a file and hand it to the completion callback,
+	// unless the reader is stopping
+	void FinishFile(FILE_READ* pFile);
+
+	// create and map the io_uring rings
+	bool SetupRing();
+	// release the rings
+	void DestroyRing();
+	// move queued chunks into free submission entries
+	void SubmitChunks();
+	// wake the completion thread with an empty request
+	void SubmitWakeup();
+	// reap completions until stopped and nothing is in flight
+	void CompletionThread();
+
+	// read the queued files until stopped
+	void ReadThread();
+	// read a whole file with positional reads
+	bool ReadWholeFile(FILE_READ* pFile, uint64_t fileSize);
+};
@@ -0,0 +1,345 @@
+///////////////////////////////////////////////////////////////////////////////
+// depthprepass.cpp
+// ============
+// draw the scene depth first, so the lighting only runs on visible pixels
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "DepthPrePass.h"
+
+#include <string>
+
+// declaration of global variables
+namespace
+{
+	const char* g_ViewName = "view";
+	const char* g_ProjectionName = "projection";
+	const char* g_ViewCountName = "viewCount";
+	const char* g_ViewProjectionName = "viewProjection";
+	const char* g_OverdrawIncrementName = "overdrawIncrement";
+
+	// overdraw above which the automatic mode turns the depth
+	// pass on, and below which it turns it off again
+	const float g_EnableOverdraw = 1.6f;
+	const float g_DisableOverdraw = 1.3f;
+	// brightness added by each fragment in the overdraw view,
+	// so that ten surfaces on one pixel show as white
+	const float g_OverdrawIncrement = 0.1f;
+}
+
+/***********************************************************
+ *  DepthPrePass()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+DepthPrePass::DepthPrePass(ShaderManager* pShaderManager, ShaderLibrary* pShaderLibrary)
+{
+	m_pShaderManager = pShaderManager;
+	m_pShaderLibrary = pShaderLibrary;
+	m_depthProgram = 0;
+	m_multiViewDepthProgram = 0;
+	m_overdrawProgram = 0;
+	m_multiViewOverdrawProgram = 0;
+	m_mode = PREPASS_AUTO;
+	m_bActive = false;
+	m_bOverdrawView = false;
+	for (int i = 0; i < QUERY_FRAMES; i++)
+	{
+		for (int j = 0; j < ViewManager::MAX_VIEWS; j++)
+		{
+			m_queries[i][j] = 0;
+		}
+		m_queryPassCount[i] = 0;
+		m_queryPixelCount[i] = 0.0;
+	}
+	m_queryFrame = 0;
+	m_overdraw = 0.0f;
+}
+
+/***********************************************************
+ *  ~DepthPrePass()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+DepthPrePass::~DepthPrePass()
+{
+	// the queries are not owned by the resource manager
+	if (m_queries[0][0] != 0)
+	{
+		glDeleteQueries(QUERY_FRAMES * ViewManager::MAX_VIEWS, &m_queries[0][0]);
+	}
+	m_pShaderManager = NULL;
+	m_pShaderLibrary = NULL;
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for loading the programs of the
+ *  depth pass and the overdraw view.  They share the vertex
+ *  stages of the scene programs, so the depth they produce
+ *  matches the lit pass.
+ ***********************************************************/
+bool DepthPrePass::Initialize(bool bMultiView)
+{
+	if (NULL == m_pShaderLibrary)
+	{
+		return(false);
+	}
+
+	m_depthProgram = m_pShaderLibrary->LoadProgram(
+		"../../Utilities/shaders/vertexShader.glsl",
+		NULL,
+		"../../Utilities/shaders/depthOnlyFragmentShader.glsl");
+	m_overdrawProgram = m_pShaderLibrary->LoadProgram(
+		"../../Utilities/shaders/vertexShader.glsl",
+		NULL,
+		"../../Utilities/shaders/overdrawFragmentShader.glsl");
+	if (bMultiView == true)
+	{
+		m_multiViewDepthProgram = m_pShaderLibrary->LoadProgram(
+			"../../Utilities/shaders/multiViewVertexShader.glsl",
+			"../../Utilities/shaders/multiViewGeometryShader.glsl",
+			"../../Utilities/shaders/depthOnlyFragmentShader.glsl");
+		m_multiViewOverdrawProgram = m_pShaderLibrary->LoadProgram(
+			"../../Utilities/shaders/multiViewVertexShader.glsl",
+			"../../Utilities/shaders/multiViewGeometryShader.glsl",
+			"../../Utilities/shaders/overdrawFragmentShader.glsl");
+	}
+
+	glGenQueries(QUERY_FRAMES * ViewManager::MAX_VIEWS, &m_queries[0][0]);
+
+	return((m_depthProgram != 0) && (m_overdrawProgram != 0));
+}
+
+/***********************************************************
+ *  RenderScene()
+ *
+ *  This method is used for drawing one pass of the scene.
+ *  The pass that writes the depth - the depth pass when it
+ *  is active, otherwise the lit pass - counts its passing
+ *  fragments, which is the number of fragments that would
+ *  be shaded without the depth pass.
+ ***********************************************************/
+void DepthPrePass::RenderScene(
+	SceneManager* pSceneManager,
+	const ViewManager::VIEW_DATA* pViews,
+	int viewCount,
+	bool bOpaqueOnly)
+{
+	if (m_bOverdrawView == true)
+	{
+		RenderOverdraw(pSceneManager, pViews, viewCount);
+		return;
+	}
+
+	int pass = m_queryPassCount[m_queryFrame];
+	GLuint query = 0;
+	if ((pass < ViewManager::MAX_VIEWS) && (m_queries[0][0] != 0))
+	{
+		query = m_queries[m_queryFrame][pass];
+		m_queryPassCount[m_queryFrame]++;
+		for (int i = 0; i < viewCount; i++)
+		{
+			m_queryPixelCount[m_queryFrame] += (double)pViews[i].width * pViews[i].height;
+		}
+	}
+
+	// the depth program is only available for the kind of pass
+	// that it was loaded for
+	bool bDepthPass = (m_bActive == true) &&
+		(((viewCount == 1) && (m_depthProgram != 0)) ||
+		 ((viewCount > 1) && (m_multiViewDepthProgram != 0)));
+
+	if (bDepthPass == true)
+	{
+		GLuint previousProgram = UseViewProgram(m_depthProgram, m_multiViewDepthProgram, pViews, viewCount);
+
+		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		if (query != 0)
+		{
+			glBeginQuery(GL_SAMPLES_PASSED, query);
+		}
+		pSceneManager->RenderSceneShapes(true);
+		if (query != 0)
+		{
+			glEndQuery(GL_SAMPLES_PASSED);
+		}
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+		m_pShaderManager->m_programID = previousProgram;
+		m_pShaderManager->use();
+
+		// only the fragments of the nearest surfaces are shaded -
+		// less or equal passes the same fragments as equal would,
+		// without depending on the two programs rounding alike
+		glDepthFunc(GL_LEQUAL);
+		glDepthMask(GL_FALSE);
+		pSceneManager->RenderScene(bOpaqueOnly);
+		glDepthMask(GL_TRUE);
+		glDepthFunc(GL_LESS);
+	}
+	else
+	{
+		if (query != 0)
+		{
+			glBeginQuery(GL_SAMPLES_PASSED, query);
+		}
+		pSceneManager->RenderScene(bOpaqueOnly);
+		if (query != 0)
+		{
+			glEndQuery(GL_SAMPLES_PASSED);
+		}
+	}
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for moving on to the next frame's
+ *  queries, after reading those of the oldest frame, and
+ *  deciding whether the next frame uses the depth pass.  A
+ *  frame that drew no passes keeps its queries.
+ ***********************************************************/
+void DepthPrePass::EndFrame()
+{
+	if (m_queryPassCount[m_queryFrame] > 0)
+	{
+		m_queryFrame = (m_queryFrame + 1) % QUERY_FRAMES;
+		CollectOverdraw();
+	}
+
+	switch (m_mode)
+	{
+	case PREPASS_OFF:
+		m_bActive = false;
+		break;
+	case PREPASS_ON:
+		m_bActive = true;
+		break;
+	case PREPASS_AUTO:
+		if (m_overdraw > g_EnableOverdraw)
+		{
+			m_bActive = true;
+		}
+		else if (m_overdraw < g_DisableOverdraw)
+		{
+			m_bActive = false;
+		}
+		break;
+	}
+}
+
+/***********************************************************
+ *  CollectOverdraw()
+ *
+ *  This method is used for reading the queries of the frame
+ *  whose slot is about to be reused, and dividing the
+ *  counted fragments by the pixels the frame covered.  The
+ *  slot is reused either way, so a result that is not ready
+ *  yet is skipped instead of waited for.
+ ***********************************************************/
+void DepthPrePass::CollectOverdraw()
+{
+	int passCount = m_queryPassCount[m_queryFrame];
+	double pixelCount = m_queryPixelCount[m_queryFrame];
+	GLuint64 sampleCount = 0;
+	bool bReady = (passCount > 0) && (pixelCount > 0.0);
+
+	for (int i = 0; (i < passCount) && (bReady == true); i++)
+	{
+		GLint available = 0;
+		glGetQueryObjectiv(m_queries[m_queryFrame][i], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available == 0)
+		{
+			bReady = false;
+		}
+		else
+		{
+			GLuint64 samples = 0;
+			glGetQueryObjectui64v(m_queries[m_queryFrame][i], GL_QUERY_RESULT, &samples);
+			sampleCount += samples;
+		}
+	}
+
+	if (bReady == true)
+	{
+		m_overdraw = (float)(sampleCount / pixelCount);
+	}
+
+	m_queryPassCount[m_queryFrame] = 0;
+	m_queryPixelCount[m_queryFrame] = 0.0;
+}
+
+/***********************************************************
+ *  RenderOverdraw()
+ *
+ *  This method is used for drawing every fragment of the
+ *  pass with additive blending and no depth test, so each
+ *  pixel shows how many surfaces cover it.
+ ***********************************************************/
+void DepthPrePass::RenderOverdraw(SceneManager* pSceneManager, const ViewManager::VIEW_DATA* pViews, int viewCount)
+{
+	if ((viewCount > 1) && (m_multiViewOverdrawProgram == 0))
+	{
+		return;
+	}
+
+	GLuint previousProgram = UseViewProgram(m_overdrawProgram, m_multiViewOverdrawProgram, pViews, viewCount);
+	m_pShaderManager->setFloatValue(g_OverdrawIncrementName, g_OverdrawIncrement);
+
+	GLint previousBlendSource = 0;
+	GLint previousBlendDestination = 0;
+	glGetIntegerv(GL_BLEND_SRC_RGB, &previousBlendSource);
+	glGetIntegerv(GL_BLEND_DST_RGB, &previousBlendDestination);
+
+	glDisable(GL_DEPTH_TEST);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_ONE, GL_ONE);
+	pSceneManager->RenderSceneShapes(false);
+	glBlendFunc(previousBlendSource, previousBlendDestination);
+	glDisable(GL_BLEND);
+	glEnable(GL_DEPTH_TEST);
+
+	m_pShaderManager->m_programID = previousProgram;
+	m_pShaderManager->use();
+}
+
+/***********************************************************
+ *  UseViewProgram()
+ *
+ *  This method is used for switching to the single or the
+ *  multi-view version of a program, by the number of views
+ *  in the pass, and setting the views into it.  The view
+ *  manager already set the viewports.  The program that was
+ *  in use before is returned.
+ ***********************************************************/
+GLuint DepthPrePass::UseViewProgram(
+	GLuint singleViewProgram,
+	GLuint multiViewProgram,
+	const ViewManager::VIEW_DATA* pViews,
+	int viewCount)
+{
+	GLuint previousProgram = m_pShaderManager->m_programID;
+
+	m_pShaderManager->m_programID = (viewCount > 1) ? multiViewProgram : singleViewProgram;
+	m_pShaderManager->use();
+
+	if (viewCount > 1)
+	{
+		for (int i = 0; i < viewCount; i++)
+		{
+			m_pShaderManager->setMat4Value(
+				std::string(g_ViewProjectionName) + "[" + std::to_string(i) + "]",
+				pViews[i].projection * pViews[i].view);
+		}
+		m_pShaderManager->setIntValue(g_ViewCountName, viewCount);
+	}
+	else
+	{
+		m_pShaderManager->setMat4Value(g_ViewName, pViews[0].view);
+		m_pShaderManager->setMat4Value(g_ProjectionName, pViews[0].projection);
+	}
+
+	return(previousProgram);
+}
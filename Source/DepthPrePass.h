@@ -0,0 +1,107 @@
+///////////////////////////////////////////////////////////////////////////////
+// depthprepass.h
+// ============
+// draw the scene depth first, so the lighting only runs on visible pixels
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+#include "ShaderLibrary.h"
+#include "SceneManager.h"
+#include "ViewManager.h"
+
+/***********************************************************
+ *  DepthPrePass
+ *
+ *  This class draws each pass of the scene in two steps
+ *  when pixels are shaded many times over.  The depth of
+ *  the opaque nodes is drawn first with a program that does
+ *  no shading, and the lit pass then only shades the
+ *  fragments that match the stored depth, with depth writes
+ *  off.  The overdraw - shaded fragments per pixel - is
+ *  measured with occlusion queries a few frames behind, so
+ *  reading the results never stalls, and in the automatic
+ *  mode the depth pass is used only while it is high.  An
+ *  overdraw view draws every fragment additively instead,
+ *  brighter where more surfaces cover a pixel.
+ ***********************************************************/
+class DepthPrePass
+{
+public:
+	// constructor
+	DepthPrePass(ShaderManager* pShaderManager, ShaderLibrary* pShaderLibrary);
+	// destructor
+	~DepthPrePass();
+
+	enum PREPASS_MODE
+	{
+		PREPASS_OFF,
+		PREPASS_ON,
+		// on while the measured overdraw is high
+		PREPASS_AUTO
+	};
+
+	// load the depth and overdraw programs for single and
+	// multi-view passes, and create the overdraw queries
+	bool Initialize(bool bMultiView);
+	void SetMode(PREPASS_MODE mode) { m_mode = mode; }
+	// draw the overdraw view instead of the lit scene
+	void SetOverdrawView(bool bOverdrawView) { m_bOverdrawView = bOverdrawView; }
+	bool IsOverdrawView() const { return(m_bOverdrawView); }
+
+	// draw one pass of the scene into the passed in views, with
+	// the depth pass first when it is active - the translucent
+	// nodes can be left for a separate transparency pass
+	void RenderScene(
+		SceneManager* pSceneManager,
+		const ViewManager::VIEW_DATA* pViews,
+		int viewCount,
+		bool bOpaqueOnly);
+	// finish the frame, collecting the overdraw of an earlier
+	// frame and deciding whether the depth pass is active
+	void EndFrame();
+
+	// get the latest measured overdraw
+	float GetOverdraw() const { return(m_overdraw); }
+	bool IsActive() const { return(m_bActive); }
+
+private:
+	// frames that the overdraw queries are read behind
+	static const int QUERY_FRAMES = 3;
+
+	// pointer to shader manager object
+	ShaderManager* m_pShaderManager;
+	// pointer to the library that builds the programs
+	ShaderLibrary* m_pShaderLibrary;
+	// depth and overdraw programs for single view passes and
+	// for passes that draw several views at once
+	GLuint m_depthProgram;
+	GLuint m_multiViewDepthProgram;
+	GLuint m_overdrawProgram;
+	GLuint m_multiViewOverdrawProgram;
+
+	PREPASS_MODE m_mode;
+	bool m_bActive;
+	bool m_bOverdrawView;
+
+	// one query per pass of each of the last frames, with the
+	// number of passes and pixels that each frame drew
+	GLuint m_queries[QUERY_FRAMES][ViewManager::MAX_VIEWS];
+	int m_queryPassCount[QUERY_FRAMES];
+	double m_queryPixelCount[QUERY_FRAMES];
+	int m_queryFrame;
+	float m_overdraw;
+
+	// switch to a program and set the views of the pass into it
+	GLuint UseViewProgram(
+		GLuint singleViewProgram,
+		GLuint multiViewProgram,
+		const ViewManager::VIEW_DATA* pViews,
+		int viewCount);
+	// draw the pass as the overdraw view
+	void RenderOverdraw(SceneManager* pSceneManager, const ViewManager::VIEW_DATA* pViews, int viewCount);
+	// read the queries of the oldest frame when they are ready
+	void CollectOverdraw();
+};
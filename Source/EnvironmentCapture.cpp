@@ -0,0 +1,390 @@
+///////////////////////////////////////////////////////////////////////////////
+// environmentcapture.cpp
+// ============
+// capture the 3D scene around a point into cube maps and 360 images
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "EnvironmentCapture.h"
+
+#include <glm/gtx/transform.hpp>
+
+#include <iostream>
+#include <string>
+
+// declaration of global variables
+namespace
+{
+	const char* g_FaceViewProjectionName = "faceViewProjection";
+	const char* g_CubeLayerName = "cubeLayer";
+	const char* g_CubeMapsName = "cubeMaps";
+	const char* g_CubeIndexName = "cubeIndex";
+
+	// direction and up vector of each cube map face, in the
+	// face order that OpenGL uses for the cube map layers
+	const glm::vec3 g_FaceDirections[EnvironmentCapture::FACE_COUNT] =
+	{
+		glm::vec3(1.0f, 0.0f, 0.0f),
+		glm::vec3(-1.0f, 0.0f, 0.0f),
+		glm::vec3(0.0f, 1.0f, 0.0f),
+		glm::vec3(0.0f, -1.0f, 0.0f),
+		glm::vec3(0.0f, 0.0f, 1.0f),
+		glm::vec3(0.0f, 0.0f, -1.0f)
+	};
+	const glm::vec3 g_FaceUps[EnvironmentCapture::FACE_COUNT] =
+	{
+		glm::vec3(0.0f, -1.0f, 0.0f),
+		glm::vec3(0.0f, -1.0f, 0.0f),
+		glm::vec3(0.0f, 0.0f, 1.0f),
+		glm::vec3(0.0f, 0.0f, -1.0f),
+		glm::vec3(0.0f, -1.0f, 0.0f),
+		glm::vec3(0.0f, -1.0f, 0.0f)
+	};
+}
+
+/***********************************************************
+ *  EnvironmentCapture()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+EnvironmentCapture::EnvironmentCapture(
+	ShaderManager* pShaderManager,
+	ShaderLibrary* pShaderLibrary,
+	ResourceManager* pResourceManager)
+{
+	m_pShaderManager = pShaderManager;
+	m_pShaderLibrary = pShaderLibrary;
+	m_pResourceManager = pResourceManager;
+	m_captureProgram = 0;
+	m_equirectProgram = 0;
+	m_faceSize = 0;
+	m_cubeCount = 0;
+}
+
+/***********************************************************
+ *  ~EnvironmentCapture()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+EnvironmentCapture::~EnvironmentCapture()
+{
+	// release the textures and framebuffers to the resource manager
+	m_readFramebuffer.Reset();
+	m_framebuffer.Reset();
+	m_depthTexture.Reset();
+	m_colorTexture.Reset();
+	m_emptyVertexArray.Reset();
+	m_pShaderManager = NULL;
+	m_pShaderLibrary = NULL;
+	m_pResourceManager = NULL;
+}
+
+/***********************************************************
+ *  IsSupported()
+ *
+ *  This method is used for checking whether the driver can
+ *  render into every layer of a cube map array in one pass.
+ ***********************************************************/
+bool EnvironmentCapture::IsSupported()
+{
+	return((GLEW_VERSION_4_0 || GLEW_ARB_texture_cube_map_array) ? true : false);
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for loading the shader programs of
+ *  the layered capture and the equirectangular conversion.
+ ***********************************************************/
+bool EnvironmentCapture::Initialize()
+{
+	if ((NULL == m_pShaderLibrary) || (NULL == m_pResourceManager) ||
+		(IsSupported() == false))
+	{
+		return(false);
+	}
+
+	m_captureProgram = m_pShaderLibrary->LoadProgram(
+		"../../Utilities/shaders/multiViewVertexShader.glsl",
+		"../../Utilities/shaders/cubeCaptureGeometryShader.glsl",
+		"../../Utilities/shaders/fragmentShader.glsl");
+	m_equirectProgram = m_pShaderLibrary->LoadProgram(
+		"../../Utilities/shaders/equirectVertexShader.glsl",
+		NULL,
+		"../../Utilities/shaders/equirectFragmentShader.glsl");
+	if ((m_captureProgram == 0) || (m_equirectProgram == 0))
+	{
+		return(false);
+	}
+
+	// the core profile needs a vertex array bound to draw, even
+	// when the vertices are generated in the shader
+	GLuint vertexArrayID = 0;
+	glGenVertexArrays(1, &vertexArrayID);
+	m_emptyVertexArray = ResourceRef(
+		m_pResourceManager,
+		m_pResourceManager->Register(ResourceManager::RESOURCE_VERTEX_ARRAY, vertexArrayID, 0));
+
+	return(true);
+}
+
+/***********************************************************
+ *  SetCubeMapSize()
+ *
+ *  This method is used for allocating the cube map arrays
+ *  that the captures are rendered into, with a framebuffer
+ *  that has every layer attached at once.
+ ***********************************************************/
+bool EnvironmentCapture::SetCubeMapSize(int faceSize, int cubeCount)
+{
+	if ((faceSize <= 0) || (cubeCount <= 0) || (NULL == m_pResourceManager))
+	{
+		return(false);
+	}
+	if ((faceSize == m_faceSize) && (cubeCount == m_cubeCount) &&
+		(m_framebuffer.IsValid() == true))
+	{
+		return(true);
+	}
+
+	ResourceRef colorTexture = CreateCubeMapArray(GL_RGBA8, faceSize, cubeCount);
+	ResourceRef depthTexture = CreateCubeMapArray(GL_DEPTH_COMPONENT24, faceSize, cubeCount);
+
+	GLint previousFramebuffer = 0;
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+
+	GLuint framebufferID = 0;
+	glGenFramebuffers(1, &framebufferID);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebufferID);
+	// attaching the whole texture makes the framebuffer layered
+	glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, colorTexture.GetName(), 0);
+	glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthTexture.GetName(), 0);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "Could not create cube map array:" << faceSize << "x" << faceSize << "x" << cubeCount << std::endl;
+		glDeleteFramebuffers(1, &framebufferID);
+		return(false);
+	}
+
+	GLuint readFramebufferID = 0;
+	glGenFramebuffers(1, &readFramebufferID);
+
+	m_framebuffer = ResourceRef(
+		m_pResourceManager,
+		m_pResourceManager->Register(ResourceManager::RESOURCE_FRAMEBUFFER, framebufferID, 0));
+	m_readFramebuffer = ResourceRef(
+		m_pResourceManager,
+		m_pResourceManager->Register(ResourceManager::RESOURCE_FRAMEBUFFER, readFramebufferID, 0));
+	m_colorTexture = colorTexture;
+	m_depthTexture = depthTexture;
+	m_faceSize = faceSize;
+	m_cubeCount = cubeCount;
+
+	return(true);
+}
+
+/***********************************************************
+ *  Capture()
+ *
+ *  This method is used for rendering the scene around the
+ *  passed in position into one cube of the array.  The six
+ *  face views are set into the capture program and the
+ *  scene is rendered once, with the geometry stage routing
+ *  each triangle to the faces that it covers.
+ ***********************************************************/
+bool EnvironmentCapture::Capture(
+	SceneManager* pSceneManager,
+	const glm::vec3& position,
+	int cubeIndex,
+	float nearPlane,
+	float farPlane)
+{
+	if ((NULL == pSceneManager) || (NULL == m_pShaderManager) ||
+		(m_captureProgram == 0) || (m_framebuffer.IsValid() == false) ||
+		(cubeIndex < 0) || (cubeIndex >= m_cubeCount))
+	{
+		return(false);
+	}
+
+	GLint previousFramebuffer = 0;
+	GLint previousViewport[4];
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+	glGetIntegerv(GL_VIEWPORT, previousViewport);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer.GetName());
+	glViewport(0, 0, m_faceSize, m_faceSize);
+	glEnable(GL_DEPTH_TEST);
+
+	// only clear the layers of this cube when the driver can,
+	// a layered clear would wipe the other cubes as well
+	if (GLEW_ARB_clear_texture)
+	{
+		const GLubyte clearColor[4] = { 0, 0, 0, 255 };
+		const GLfloat clearDepth = 1.0f;
+		glClearTexSubImage(m_colorTexture.GetName(), 0,
+			0, 0, cubeIndex * FACE_COUNT, m_faceSize, m_faceSize, FACE_COUNT,
+			GL_RGBA, GL_UNSIGNED_BYTE, clearColor);
+		glClearTexSubImage(m_depthTexture.GetName(), 0,
+			0, 0, cubeIndex * FACE_COUNT, m_faceSize, m_faceSize, FACE_COUNT,
+			GL_DEPTH_COMPONENT, GL_FLOAT, &clearDepth);
+	}
+	else
+	{
+		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	}
+
+	GLuint previousProgram = UseProgram(m_captureProgram);
+
+	// every face has a square 90 degree field of view
+	glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, nearPlane, farPlane);
+	for (int i = 0; i < FACE_COUNT; i++)
+	{
+		glm::mat4 view = glm::lookAt(position, position + g_FaceDirections[i], g_FaceUps[i]);
+		m_pShaderManager->setMat4Value(
+			std::string(g_FaceViewProjectionName) + "[" + std::to_string(i) + "]",
+			projection * view);
+	}
+	m_pShaderManager->setIntValue(g_CubeLayerName, cubeIndex * FACE_COUNT);
+	m_pShaderManager->setVec3Value("viewPosition", position);
+
+	// the lights are program state, so set them into the capture
+	// program, and draw every node since the faces see all around
+	pSceneManager->SetupSceneLights();
+	pSceneManager->SetCullingViews(NULL, 0);
+	pSceneManager->RenderScene();
+
+	UseProgram(previousProgram);
+	glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+	glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+
+	return(true);
+}
+
+/***********************************************************
+ *  DrawEquirectangular()
+ *
+ *  This method is used for drawing a captured cube as an
+ *  equirectangular 360 image into the bound framebuffer,
+ *  with one triangle that covers the viewport.
+ ***********************************************************/
+void EnvironmentCapture::DrawEquirectangular(int cubeIndex)
+{
+	if ((NULL == m_pShaderManager) || (m_equirectProgram == 0) ||
+		(cubeIndex < 0) || (cubeIndex >= m_cubeCount))
+	{
+		return;
+	}
+
+	GLuint previousProgram = UseProgram(m_equirectProgram);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, m_colorTexture.GetName());
+	m_pShaderManager->setIntValue(g_CubeMapsName, 0);
+	m_pShaderManager->setIntValue(g_CubeIndexName, cubeIndex);
+
+	glDisable(GL_DEPTH_TEST);
+	glBindVertexArray(m_emptyVertexArray.GetName());
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+	glEnable(GL_DEPTH_TEST);
+
+	glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, 0);
+	UseProgram(previousProgram);
+}
+
+/***********************************************************
+ *  ReadCubeFaces()
+ *
+ *  This method is used for reading the pixels of the six
+ *  faces of a captured cube, one face after another.
+ ***********************************************************/
+void EnvironmentCapture::ReadCubeFaces(int cubeIndex, void* pPixels)
+{
+	if ((cubeIndex < 0) || (cubeIndex >= m_cubeCount))
+	{
+		return;
+	}
+
+	GLint previousFramebuffer = 0;
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previousFramebuffer);
+
+	size_t faceBytes = (size_t)m_faceSize * m_faceSize * 4;
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_readFramebuffer.GetName());
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	for (int i = 0; i < FACE_COUNT; i++)
+	{
+		glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+			m_colorTexture.GetName(), 0, cubeIndex * FACE_COUNT + i);
+		glReadPixels(0, 0, m_faceSize, m_faceSize, GL_RGBA, GL_UNSIGNED_BYTE,
+			(char*)pPixels + faceBytes * i);
+	}
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, previousFramebuffer);
+}
+
+/***********************************************************
+ *  UseProgram()
+ *
+ *  This method is used for switching the shader program
+ *  that the shader manager sets its values into, returning
+ *  the program that was in use before.
+ ***********************************************************/
+GLuint EnvironmentCapture::UseProgram(GLuint programID)
+{
+	GLuint previousProgram = m_pShaderManager->m_programID;
+
+	if ((programID != 0) && (programID != previousProgram))
+	{
+		m_pShaderManager->m_programID = programID;
+		m_pShaderManager->use();
+	}
+
+	return(previousProgram);
+}
+
+/***********************************************************
+ *  CreateCubeMapArray()
+ *
+ *  This method is used for creating a cube map array with
+ *  six layers for each cube.
+ ***********************************************************/
+ResourceRef EnvironmentCapture::CreateCubeMapArray(GLenum format, int faceSize, int cubeCount)
+{
+	GLuint textureID = 0;
+	bool bDepth = (format == GL_DEPTH_COMPONENT24);
+
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, textureID);
+	if (GLEW_ARB_texture_storage)
+	{
+		glTexStorage3D(GL_TEXTURE_CUBE_MAP_ARRAY, 1, format, faceSize, faceSize, cubeCount * FACE_COUNT);
+	}
+	else
+	{
+		glTexImage3D(GL_TEXTURE_CUBE_MAP_ARRAY, 0, format, faceSize, faceSize, cubeCount * FACE_COUNT, 0,
+			bDepth ? GL_DEPTH_COMPONENT : GL_RGBA,
+			bDepth ? GL_UNSIGNED_INT : GL_UNSIGNED_BYTE,
+			NULL);
+	}
+
+	// no mipmaps are generated, and the faces are sampled with
+	// bilinear filtering for the conversion
+	glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MAX_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, 0);
+
+	return(ResourceRef(
+		m_pResourceManager,
+		m_pResourceManager->Register(
+			ResourceManager::RESOURCE_TEXTURE,
+			textureID,
+			(size_t)faceSize * faceSize * cubeCount * FACE_COUNT * 4)));
+}
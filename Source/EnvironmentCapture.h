@@ -0,0 +1,97 @@
+///////////////////////////////////////////////////////////////////////////////
+// environmentcapture.h
+// ============
+// capture the 3D scene around a point into cube maps and 360 images
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+#include "ShaderLibrary.h"
+#include "SceneManager.h"
+#include "ResourceManager.h"
+
+#include <glm/glm.hpp>
+
+/***********************************************************
+ *  EnvironmentCapture
+ *
+ *  This class renders the scene around a point into one
+ *  cube of a cube map array.  All six faces are drawn in a
+ *  single pass of the scene, with a geometry stage that
+ *  sends each triangle to the layers of the faces it
+ *  covers, instead of preparing and rendering the scene
+ *  once per face.  A captured cube can be read back face
+ *  by face, or drawn as an equirectangular 360 image.
+ ***********************************************************/
+class EnvironmentCapture
+{
+public:
+	// constructor
+	EnvironmentCapture(
+		ShaderManager* pShaderManager,
+		ShaderLibrary* pShaderLibrary,
+		ResourceManager* pResourceManager);
+	// destructor
+	~EnvironmentCapture();
+
+	// number of faces of a cube map, in the order +X, -X,
+	// +Y, -Y, +Z, -Z
+	static const int FACE_COUNT = 6;
+
+	// check whether layered rendering into cube map arrays is available
+	static bool IsSupported();
+	// load the capture and conversion programs
+	bool Initialize();
+
+	// allocate the cube map array, keeping the current one when
+	// the size and count already match
+	bool SetCubeMapSize(int faceSize, int cubeCount);
+	int GetFaceSize() const { return(m_faceSize); }
+	int GetCubeCount() const { return(m_cubeCount); }
+	GLuint GetCubeMapArray() const { return(m_colorTexture.GetName()); }
+
+	// render the scene around a position into one cube of the array
+	bool Capture(
+		SceneManager* pSceneManager,
+		const glm::vec3& position,
+		int cubeIndex,
+		float nearPlane,
+		float farPlane);
+	// draw a captured cube as an equirectangular image into the
+	// bound framebuffer, filling its current viewport
+	void DrawEquirectangular(int cubeIndex);
+	// read the RGBA pixels of the six faces of a captured cube,
+	// one face after another - the destination may be an offset
+	// into the bound pixel pack buffer
+	void ReadCubeFaces(int cubeIndex, void* pPixels);
+
+private:
+	// pointer to shader manager object
+	ShaderManager* m_pShaderManager;
+	// pointer to the library that builds the shader programs
+	ShaderLibrary* m_pShaderLibrary;
+	// pointer to the manager that owns the OpenGL resources
+	ResourceManager* m_pResourceManager;
+	// programs for the layered capture and the conversion
+	GLuint m_captureProgram;
+	GLuint m_equirectProgram;
+	// empty vertex array for the full screen triangle
+	ResourceRef m_emptyVertexArray;
+
+	// the cube map arrays and the framebuffers that draw into
+	// all of their layers and read from one of them
+	int m_faceSize;
+	int m_cubeCount;
+	ResourceRef m_colorTexture;
+	ResourceRef m_depthTexture;
+	ResourceRef m_framebuffer;
+	ResourceRef m_readFramebuffer;
+
+	// switch the program that the shader manager sets values
+	// into, returning the previous program
+	GLuint UseProgram(GLuint programID);
+	// create one cube map array texture
+	ResourceRef CreateCubeMapArray(GLenum format, int faceSize, int cubeCount);
+};
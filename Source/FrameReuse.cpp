@@ -0,0 +1,342 @@
+///////////////////////////////////////////////////////////////////////////////
+// framereuse.cpp
+// ============
+// reuse the last rendered frame while the view is static or barely moves
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameReuse.h"
+
+#include <cmath>
+
+// declaration of global variables
+namespace
+{
+	const char* g_PreviousColorName = "previousColor";
+	const char* g_PreviousDepthName = "previousDepth";
+	const char* g_PreviousInverseViewProjectionName = "previousInverseViewProjection";
+	const char* g_ViewProjectionName = "viewProjection";
+	const char* g_ViewportOriginName = "viewportOrigin";
+	const char* g_ViewportSizeName = "viewportSize";
+
+	// largest camera move between two frames that still moves
+	// the pixels of the last frame, in world units and degrees
+	const float g_MaxReuseDistance = 0.25f;
+	const float g_MaxReuseTurnDegrees = 3.0f;
+	// moved frames in a row before a full frame is drawn again
+	const int g_MaxReprojectedFrames = 8;
+}
+
+/***********************************************************
+ *  FrameReuse()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameReuse::FrameReuse(
+	ShaderManager* pShaderManager,
+	ShaderLibrary* pShaderLibrary,
+	ResourceManager* pResourceManager,
+	RenderTargetPool* pRenderTargetPool)
+{
+	m_pShaderManager = pShaderManager;
+	m_pShaderLibrary = pShaderLibrary;
+	m_pResourceManager = pResourceManager;
+	m_pRenderTargetPool = pRenderTargetPool;
+	m_reprojectProgram = 0;
+	m_bEnabled = true;
+	m_targets[0] = -1;
+	m_targets[1] = -1;
+	m_frameTarget = -1;
+	m_drawTarget = -1;
+	m_mode = REUSE_NONE;
+	m_frameViewCount = 0;
+	m_frameWidth = 0;
+	m_frameHeight = 0;
+	m_drawViewCount = 0;
+	m_reprojectedFrames = 0;
+	m_bFrameApproximate = false;
+}
+
+/***********************************************************
+ *  ~FrameReuse()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameReuse::~FrameReuse()
+{
+	// the targets are owned by the render target pool
+	m_emptyVertexArray.Reset();
+	m_pShaderManager = NULL;
+	m_pShaderLibrary = NULL;
+	m_pResourceManager = NULL;
+	m_pRenderTargetPool = NULL;
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for adding the two frame targets to
+ *  the render target pool and loading the program that
+ *  moves the pixels of the last frame.  Without the program
+ *  the last frame can still be shown again unchanged.
+ ***********************************************************/
+bool FrameReuse::Initialize(GLenum colorFormat, GLenum depthFormat)
+{
+	if ((NULL == m_pRenderTargetPool) || (NULL == m_pResourceManager))
+	{
+		return(false);
+	}
+
+	m_targets[0] = m_pRenderTargetPool->AddTarget(colorFormat, depthFormat);
+	m_targets[1] = m_pRenderTargetPool->AddTarget(colorFormat, depthFormat);
+	m_frameTarget = m_targets[0];
+
+	// the moved pixels are marked in the stencil buffer
+	if ((NULL != m_pShaderLibrary) &&
+		((depthFormat == GL_DEPTH24_STENCIL8) || (depthFormat == GL_DEPTH32F_STENCIL8)))
+	{
+		m_reprojectProgram = m_pShaderLibrary->LoadProgram(
+			"../../Utilities/shaders/frameReprojectVertexShader.glsl",
+			NULL,
+			"../../Utilities/shaders/frameReprojectFragmentShader.glsl");
+	}
+
+	GLuint vertexArrayID = 0;
+	glGenVertexArrays(1, &vertexArrayID);
+	m_emptyVertexArray = ResourceRef(
+		m_pResourceManager,
+		m_pResourceManager->Register(ResourceManager::RESOURCE_VERTEX_ARRAY, vertexArrayID, 0));
+
+	return(true);
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for deciding how the next frame can
+ *  reuse the latest one.  Any change to the scene, the
+ *  render size or the number of views needs a full frame.
+ ***********************************************************/
+FrameReuse::REUSE_MODE FrameReuse::BeginFrame(
+	const ViewManager::VIEW_DATA* pViews,
+	int viewCount,
+	bool bSceneChanged)
+{
+	int width = m_pRenderTargetPool->GetRenderWidth();
+	int height = m_pRenderTargetPool->GetRenderHeight();
+
+	m_mode = REUSE_NONE;
+	if ((m_bEnabled == true) &&
+		(bSceneChanged == false) &&
+		(m_frameViewCount > 0) &&
+		(viewCount == m_frameViewCount) &&
+		(width == m_frameWidth) &&
+		(height == m_frameHeight))
+	{
+		if (IsSameView(pViews, viewCount) == true)
+		{
+			// a moved frame is replaced by a full one as soon as
+			// the view stops changing
+			if (m_bFrameApproximate == false)
+			{
+				m_mode = REUSE_LAST_FRAME;
+			}
+		}
+		else if ((viewCount == 1) &&
+			(m_reprojectProgram != 0) &&
+			(m_reprojectedFrames < g_MaxReprojectedFrames) &&
+			(IsSmallMove(pViews[0]) == true))
+		{
+			m_mode = REUSE_REPROJECTED;
+		}
+	}
+
+	if (m_mode == REUSE_LAST_FRAME)
+	{
+		return(m_mode);
+	}
+
+	// draw into the target that does not hold the latest frame
+	m_drawTarget = (m_frameTarget == m_targets[0]) ? m_targets[1] : m_targets[0];
+	m_drawViewCount = viewCount;
+	for (int i = 0; i < viewCount; i++)
+	{
+		m_drawViews[i] = pViews[i];
+	}
+	m_pRenderTargetPool->Bind(m_drawTarget);
+
+	// Enable z-depth
+	glEnable(GL_DEPTH_TEST);
+
+	// Clear the frame, z and stencil buffers
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	glClearStencil(0);
+	glStencilMask(0xFF);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+	if (m_mode == REUSE_REPROJECTED)
+	{
+		Reproject(pViews[0]);
+	}
+
+	return(m_mode);
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for finishing the frame, making the
+ *  target it was drawn into hold the latest frame.
+ ***********************************************************/
+void FrameReuse::EndFrame()
+{
+	if (m_mode == REUSE_LAST_FRAME)
+	{
+		return;
+	}
+
+	if (m_mode == REUSE_REPROJECTED)
+	{
+		glDisable(GL_STENCIL_TEST);
+		m_reprojectedFrames++;
+	}
+	else
+	{
+		m_reprojectedFrames = 0;
+	}
+	m_bFrameApproximate = (m_mode == REUSE_REPROJECTED);
+
+	m_frameTarget = m_drawTarget;
+	m_frameViewCount = m_drawViewCount;
+	for (int i = 0; i < m_drawViewCount; i++)
+	{
+		m_frameViews[i] = m_drawViews[i];
+	}
+	m_frameWidth = m_pRenderTargetPool->GetRenderWidth();
+	m_frameHeight = m_pRenderTargetPool->GetRenderHeight();
+}
+
+/***********************************************************
+ *  IsSameView()
+ *
+ *  This method is used for checking whether the passed in
+ *  views match the views of the latest frame exactly.
+ ***********************************************************/
+bool FrameReuse::IsSameView(const ViewManager::VIEW_DATA* pViews, int viewCount) const
+{
+	for (int i = 0; i < viewCount; i++)
+	{
+		const ViewManager::VIEW_DATA& frameView = m_frameViews[i];
+		if ((pViews[i].view != frameView.view) ||
+			(pViews[i].projection != frameView.projection) ||
+			(pViews[i].x != frameView.x) ||
+			(pViews[i].y != frameView.y) ||
+			(pViews[i].width != frameView.width) ||
+			(pViews[i].height != frameView.height))
+		{
+			return(false);
+		}
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  IsSmallMove()
+ *
+ *  This method is used for checking whether a camera view
+ *  only moved and turned a little since the latest frame.
+ *  A changed projection or viewport is never a small move,
+ *  since zooming spreads the old pixels apart everywhere.
+ ***********************************************************/
+bool FrameReuse::IsSmallMove(const ViewManager::VIEW_DATA& view) const
+{
+	const ViewManager::VIEW_DATA& frameView = m_frameViews[0];
+
+	if ((view.projection != frameView.projection) ||
+		(view.x != frameView.x) ||
+		(view.y != frameView.y) ||
+		(view.width != frameView.width) ||
+		(view.height != frameView.height))
+	{
+		return(false);
+	}
+
+	// the camera position and forward direction are the last
+	// and the negated third column of the inverse view
+	glm::mat4 cameraToWorld = glm::inverse(view.view);
+	glm::mat4 frameCameraToWorld = glm::inverse(frameView.view);
+	float distance = glm::length(glm::vec3(cameraToWorld[3] - frameCameraToWorld[3]));
+	float turnCosine = glm::dot(
+		glm::normalize(glm::vec3(cameraToWorld[2])),
+		glm::normalize(glm::vec3(frameCameraToWorld[2])));
+
+	return((distance <= g_MaxReuseDistance) &&
+		(turnCosine >= std::cos(glm::radians(g_MaxReuseTurnDegrees))));
+}
+
+/***********************************************************
+ *  Reproject()
+ *
+ *  This method is used for drawing every pixel of the latest
+ *  frame as a point at the place the new view sees it, from
+ *  the pixel's depth.  The depth test keeps the nearest
+ *  point where several land on the same pixel, and each
+ *  point sets the stencil buffer, so that the scene is
+ *  then drawn only into the pixels that stayed empty.
+ ***********************************************************/
+void FrameReuse::Reproject(const ViewManager::VIEW_DATA& view)
+{
+	const ViewManager::VIEW_DATA& frameView = m_frameViews[0];
+
+	GLuint previousProgram = UseProgram(m_reprojectProgram);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, m_pRenderTargetPool->GetColorTexture(m_frameTarget));
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, m_pRenderTargetPool->GetDepthTexture(m_frameTarget));
+	glActiveTexture(GL_TEXTURE0);
+
+	m_pShaderManager->setIntValue(g_PreviousColorName, 0);
+	m_pShaderManager->setIntValue(g_PreviousDepthName, 1);
+	m_pShaderManager->setMat4Value(g_PreviousInverseViewProjectionName,
+		glm::inverse(frameView.projection * frameView.view));
+	m_pShaderManager->setMat4Value(g_ViewProjectionName, view.projection * view.view);
+	m_pShaderManager->setVec2Value(g_ViewportOriginName, (float)view.x, (float)view.y);
+	m_pShaderManager->setVec2Value(g_ViewportSizeName, (float)view.width, (float)view.height);
+
+	glViewport(view.x, view.y, view.width, view.height);
+	glEnable(GL_STENCIL_TEST);
+	glStencilFunc(GL_ALWAYS, 1, 0xFF);
+	glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+
+	glBindVertexArray(m_emptyVertexArray.GetName());
+	glDrawArrays(GL_POINTS, 0, view.width * view.height);
+	glBindVertexArray(0);
+
+	// the scene is only drawn where no point landed
+	glStencilFunc(GL_EQUAL, 0, 0xFF);
+	glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+
+	UseProgram(previousProgram);
+}
+
+/***********************************************************
+ *  UseProgram()
+ *
+ *  This method is used for switching the shader program
+ *  that the shader manager sets its values into, returning
+ *  the program that was in use before.
+ ***********************************************************/
+GLuint FrameReuse::UseProgram(GLuint programID)
+{
+	GLuint previousProgram = m_pShaderManager->m_programID;
+
+	if ((programID != 0) && (programID != previousProgram))
+	{
+		m_pShaderManager->m_programID = programID;
+		m_pShaderManager->use();
+	}
+
+	return(previousProgram);
+}
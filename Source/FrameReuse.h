@@ -0,0 +1,126 @@
+///////////////////////////////////////////////////////////////////////////////
+// framereuse.h
+// ============
+// reuse the last rendered frame while the view is static or barely moves
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+#include "ShaderLibrary.h"
+#include "ResourceManager.h"
+#include "RenderTargetPool.h"
+#include "ViewManager.h"
+
+#include <glm/glm.hpp>
+
+/***********************************************************
+ *  FrameReuse
+ *
+ *  This class lets a scene window reuse its last frame.
+ *  The frames alternate between two offscreen targets, so
+ *  the color and depth of the last frame are kept while the
+ *  next one is drawn.  When neither the views nor the scene
+ *  changed, the last frame is shown again without drawing
+ *  anything.  When only a single camera view moved by a
+ *  small amount, the pixels of the last frame are moved to
+ *  where the new view sees them, and the scene is drawn
+ *  again only into the pixels that nothing landed on.  A
+ *  full frame is drawn after a few moved frames, and as
+ *  soon as the camera stops, so the small errors of moving
+ *  pixels do not build up or stay on screen.
+ ***********************************************************/
+class FrameReuse
+{
+public:
+	// constructor
+	FrameReuse(
+		ShaderManager* pShaderManager,
+		ShaderLibrary* pShaderLibrary,
+		ResourceManager* pResourceManager,
+		RenderTargetPool* pRenderTargetPool);
+	// destructor
+	~FrameReuse();
+
+	enum REUSE_MODE
+	{
+		// the scene is drawn in full
+		REUSE_NONE,
+		// the last frame is shown again, nothing is drawn
+		REUSE_LAST_FRAME,
+		// the last frame was moved to the new view, the scene
+		// is drawn only where the stencil buffer is still zero
+		REUSE_REPROJECTED
+	};
+
+	// add the two targets that the frames alternate between and
+	// load the reprojection program
+	bool Initialize(GLenum colorFormat, GLenum depthFormat);
+	// turn reusing frames on or off, every frame is drawn in
+	// full while it is off
+	void SetEnabled(bool bEnabled) { m_bEnabled = bEnabled; }
+
+	// decide how the next frame reuses the last one, and unless
+	// the last frame is shown again, bind and clear the target
+	// for the new frame - the render size of the pool and the
+	// views of the frame need to be set already
+	REUSE_MODE BeginFrame(const ViewManager::VIEW_DATA* pViews, int viewCount, bool bSceneChanged);
+	// finish the frame started by BeginFrame()
+	void EndFrame();
+
+	// get the target that holds the latest frame
+	int GetFrameTarget() const { return(m_frameTarget); }
+	// get the target that the frame started by BeginFrame() is
+	// drawn into
+	int GetDrawTarget() const { return(m_drawTarget); }
+	// check whether the latest frame was moved from the one
+	// before it, and needs to be drawn in full once the view
+	// stops changing
+	bool IsFrameApproximate() const { return(m_bFrameApproximate); }
+
+private:
+	// pointer to shader manager object
+	ShaderManager* m_pShaderManager;
+	// pointer to the library that builds the reprojection program
+	ShaderLibrary* m_pShaderLibrary;
+	// pointer to the manager that owns the OpenGL resources
+	ResourceManager* m_pResourceManager;
+	// pointer to the pool that owns the frame targets
+	RenderTargetPool* m_pRenderTargetPool;
+	GLuint m_reprojectProgram;
+	// empty vertex array for the one point per pixel draw
+	ResourceRef m_emptyVertexArray;
+	bool m_bEnabled;
+
+	// the targets that the frames alternate between, the one
+	// holding the latest frame and the one being drawn
+	int m_targets[2];
+	int m_frameTarget;
+	int m_drawTarget;
+	REUSE_MODE m_mode;
+
+	// the views and size that the latest frame was drawn with
+	ViewManager::VIEW_DATA m_frameViews[ViewManager::MAX_VIEWS];
+	int m_frameViewCount;
+	int m_frameWidth;
+	int m_frameHeight;
+	// the views of the frame being drawn
+	ViewManager::VIEW_DATA m_drawViews[ViewManager::MAX_VIEWS];
+	int m_drawViewCount;
+	// number of moved frames since the last full frame
+	int m_reprojectedFrames;
+	bool m_bFrameApproximate;
+
+	// check whether the views are the ones of the latest frame
+	bool IsSameView(const ViewManager::VIEW_DATA* pViews, int viewCount) const;
+	// check whether a single view moved little enough from the
+	// view of the latest frame for its pixels to be reused
+	bool IsSmallMove(const ViewManager::VIEW_DATA& view) const;
+	// move the pixels of the latest frame into the new view and
+	// mark them in the stencil buffer
+	void Reproject(const ViewManager::VIEW_DATA& view);
+	// switch the program that the shader manager sets values
+	// into, returning the previous program
+	GLuint UseProgram(GLuint programID);
+};
@@ -0,0 +1,576 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpuculling.cpp
+// ============
+// cull and draw large numbers of mesh copies with commands built on the GPU
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "GpuCulling.h"
+
+#include <glm/gtx/transform.hpp>
+
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// threads per work group of the culling program
+	const int g_CullGroupSize = 64;
+	// the two steps of the culling program, run one after the
+	// other - testing the copies and building the commands
+	const int g_CullInstancesPhase = 0;
+	const int g_BuildCommandsPhase = 1;
+
+	// buffer bindings that the culling and drawing programs use
+	const GLuint g_InstanceBinding = 0;
+	const GLuint g_BatchBinding = 1;
+	const GLuint g_VisibleBinding = 2;
+	const GLuint g_CountBinding = 3;
+	const GLuint g_CommandBinding = 4;
+	// attribute of the drawing program that reads the index of
+	// the visible copy, after the position, normal and UV
+	const GLuint g_VisibleAttribute = 3;
+
+	// floats per captured vertex - position, normal and UV
+	const int g_VertexFloatCount = 8;
+	// outputs of the capture program, in the captured order
+	const char* g_CaptureVaryings[] = { "capturedPosition", "capturedNormal", "capturedTextureCoordinate" };
+	const int g_CaptureVaryingCount = 3;
+
+	// copies smaller than this radius on screen, in pixels, are
+	// not drawn unless another value is set
+	const float g_DefaultMinimumPixelRadius = 1.0f;
+
+	// the texture units that the drawing program can sample from
+	const int g_TextureSlotCount = 16;
+
+	// layout of one indirect draw command in the command buffer
+	struct DRAW_ARRAYS_COMMAND
+	{
+		GLuint count;
+		GLuint instanceCount;
+		GLuint first;
+		GLuint baseInstance;
+	};
+}
+
+/***********************************************************
+ *  GpuCulling()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+GpuCulling::GpuCulling(
+	SceneManager* pSceneManager,
+	ShaderManager* pShaderManager,
+	ShaderLibrary* pShaderLibrary,
+	ResourceManager* pResourceManager)
+{
+	m_pSceneManager = pSceneManager;
+	m_pShaderManager = pShaderManager;
+	m_pShaderLibrary = pShaderLibrary;
+	m_pResourceManager = pResourceManager;
+	m_captureProgram = 0;
+	m_cullProgram = 0;
+	m_drawProgram = 0;
+	for (int i = 0; i < SceneManager::MESH_TYPE_COUNT; i++)
+	{
+		m_meshRanges[i].firstVertex = 0;
+		m_meshRanges[i].vertexCount = 0;
+	}
+	m_bBuffersChanged = false;
+	m_minimumPixelRadius = g_DefaultMinimumPixelRadius;
+	m_drawCount = 0;
+}
+
+/***********************************************************
+ *  ~GpuCulling()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+GpuCulling::~GpuCulling()
+{
+	// release the OpenGL objects to the resource manager
+	m_commandBuffer.Reset();
+	m_countBuffer.Reset();
+	m_visibleBuffer.Reset();
+	m_batchBuffer.Reset();
+	m_instanceBuffer.Reset();
+	m_vertexArray.Reset();
+	m_vertexBuffer.Reset();
+	m_batches.clear();
+	m_instances.clear();
+	m_pSceneManager = NULL;
+	m_pShaderManager = NULL;
+	m_pShaderLibrary = NULL;
+	m_pResourceManager = NULL;
+}
+
+/***********************************************************
+ *  IsSupported()
+ *
+ *  This method is used for checking whether the context has
+ *  compute programs and multi-draw calls whose number of
+ *  draws is read from a buffer.
+ ***********************************************************/
+bool GpuCulling::IsSupported()
+{
+	bool bCompute = (GLEW_VERSION_4_3 || GLEW_ARB_compute_shader);
+	bool bDrawCount = (GLEW_VERSION_4_6 || GLEW_ARB_indirect_parameters);
+
+	return((bCompute == true) && (bDrawCount == true));
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for loading the programs and
+ *  capturing the basic meshes that the batches draw.
+ ***********************************************************/
+bool GpuCulling::Initialize()
+{
+	if ((NULL == m_pSceneManager) || (NULL == m_pShaderLibrary) || (NULL == m_pResourceManager))
+	{
+		return(false);
+	}
+	if (IsSupported() == false)
+	{
+		return(false);
+	}
+
+	m_captureProgram = m_pShaderLibrary->LoadFeedbackProgram(
+		"../../Utilities/shaders/meshCaptureVertexShader.glsl",
+		g_CaptureVaryings,
+		g_CaptureVaryingCount);
+	m_cullProgram = m_pShaderLibrary->LoadComputeProgram(
+		"../../Utilities/shaders/gpuCullComputeShader.glsl");
+	m_drawProgram = m_pShaderLibrary->LoadProgram(
+		"../../Utilities/shaders/gpuSceneVertexShader.glsl",
+		NULL,
+		"../../Utilities/shaders/gpuSceneFragmentShader.glsl");
+	if ((m_captureProgram == 0) || (m_cullProgram == 0) || (m_drawProgram == 0))
+	{
+		return(false);
+	}
+
+	return(CaptureMeshes());
+}
+
+/***********************************************************
+ *  CaptureMeshes()
+ *
+ *  This method is used for copying the untransformed
+ *  vertices of every basic mesh into one vertex buffer, as
+ *  separate triangles.  The meshes are first drawn with a
+ *  query that counts their triangles, so each one can be
+ *  given its own range, and then drawn again with transform
+ *  feedback writing into that range.  Nothing is drawn to
+ *  the screen while capturing.
+ ***********************************************************/
+bool GpuCulling::CaptureMeshes()
+{
+	GLuint query = 0;
+	GLuint totalVertexCount = 0;
+
+	GLuint previousProgram = UseProgram(m_captureProgram);
+	glEnable(GL_RASTERIZER_DISCARD);
+
+	glGenQueries(1, &query);
+	for (int i = 0; i < SceneManager::MESH_TYPE_COUNT; i++)
+	{
+		GLuint triangleCount = 0;
+
+		glBeginQuery(GL_PRIMITIVES_GENERATED, query);
+		m_pSceneManager->DrawSceneMesh((SceneManager::MESH_TYPE)i);
+		glEndQuery(GL_PRIMITIVES_GENERATED);
+		// only waited for once, while the scene is prepared
+		glGetQueryObjectuiv(query, GL_QUERY_RESULT, &triangleCount);
+
+		m_meshRanges[i].firstVertex = totalVertexCount;
+		m_meshRanges[i].vertexCount = triangleCount * 3;
+		totalVertexCount += m_meshRanges[i].vertexCount;
+	}
+	glDeleteQueries(1, &query);
+
+	if (totalVertexCount == 0)
+	{
+		glDisable(GL_RASTERIZER_DISCARD);
+		UseProgram(previousProgram);
+		std::cout << "Could not capture the basic meshes for GPU culling" << std::endl;
+		return(false);
+	}
+
+	GLsizeiptr vertexSize = g_VertexFloatCount * sizeof(float);
+	m_vertexBuffer = CreateBuffer(GL_ARRAY_BUFFER, totalVertexCount * vertexSize, NULL);
+
+	for (int i = 0; i < SceneManager::MESH_TYPE_COUNT; i++)
+	{
+		if (m_meshRanges[i].vertexCount == 0)
+		{
+			continue;
+		}
+
+		glBindBufferRange(
+			GL_TRANSFORM_FEEDBACK_BUFFER,
+			0,
+			m_vertexBuffer.GetName(),
+			m_meshRanges[i].firstVertex * vertexSize,
+			m_meshRanges[i].vertexCount * vertexSize);
+		glBeginTransformFeedback(GL_TRIANGLES);
+		m_pSceneManager->DrawSceneMesh((SceneManager::MESH_TYPE)i);
+		glEndTransformFeedback();
+	}
+	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+
+	glDisable(GL_RASTERIZER_DISCARD);
+	UseProgram(previousProgram);
+
+	// the captured vertices have the same attributes as the
+	// basic meshes, the visible copy index is added once the
+	// copies are uploaded
+	GLuint vertexArrayID = 0;
+	glGenVertexArrays(1, &vertexArrayID);
+	m_vertexArray = ResourceRef(
+		m_pResourceManager,
+		m_pResourceManager->Register(ResourceManager::RESOURCE_VERTEX_ARRAY, vertexArrayID, 0));
+
+	glBindVertexArray(vertexArrayID);
+	glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer.GetName());
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, (GLsizei)vertexSize, (void*)0);
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, (GLsizei)vertexSize, (void*)(3 * sizeof(float)));
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, (GLsizei)vertexSize, (void*)(6 * sizeof(float)));
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	return(true);
+}
+
+/***********************************************************
+ *  AddBatch()
+ *
+ *  This method is used for adding a batch of copies of a
+ *  basic mesh.  The material values and texture slot are
+ *  copied from the scene when the batch is added.
+ ***********************************************************/
+int GpuCulling::AddBatch(
+	SceneManager::MESH_TYPE mesh,
+	glm::vec4 color,
+	std::string materialTag,
+	std::string textureTag)
+{
+	BATCH_DATA batch;
+
+	if ((NULL == m_pSceneManager) || (mesh < 0) || (mesh >= SceneManager::MESH_TYPE_COUNT) ||
+		(m_meshRanges[mesh].vertexCount == 0))
+	{
+		return(-1);
+	}
+
+	batch.color = color;
+	batch.ambient = glm::vec4(0.0f);
+	batch.diffuse = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
+	batch.specular = glm::vec4(0.0f);
+	const SceneManager::MATERIAL_DATA* pMaterial =
+		m_pSceneManager->GetMaterialData(m_pSceneManager->GetMaterialHandle(materialTag));
+	if (NULL != pMaterial)
+	{
+		batch.ambient = glm::vec4(pMaterial->ambientColor, pMaterial->ambientStrength);
+		batch.diffuse = glm::vec4(pMaterial->diffuseColor, pMaterial->shininess);
+		batch.specular = glm::vec4(pMaterial->specularColor, 0.0f);
+	}
+	batch.textureSlot = -1;
+	if (textureTag.empty() == false)
+	{
+		batch.textureSlot = m_pSceneManager->GetTextureSlot(m_pSceneManager->GetTextureHandle(textureTag));
+	}
+	batch.firstVertex = m_meshRanges[mesh].firstVertex;
+	batch.vertexCount = m_meshRanges[mesh].vertexCount;
+	batch.firstInstance = 0;
+
+	m_batches.push_back(batch);
+	m_bBuffersChanged = true;
+
+	return((int)m_batches.size() - 1);
+}
+
+/***********************************************************
+ *  AddInstance()
+ *
+ *  This method is used for adding a copy to a batch.  The
+ *  model matrix and bounding sphere are built once here, so
+ *  the culling program only has to read them.
+ ***********************************************************/
+int GpuCulling::AddInstance(
+	int batch,
+	glm::vec3 scaleXYZ,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees,
+	glm::vec3 positionXYZ)
+{
+	INSTANCE_DATA instance;
+	SceneManager::SCENE_NODE node;
+
+	if ((batch < 0) || (batch >= m_batches.size()))
+	{
+		return(-1);
+	}
+
+	// same order of transformations as the scene nodes
+	instance.model =
+		glm::translate(positionXYZ) *
+		glm::rotate(glm::radians(XrotationDegrees), glm::vec3(1.0f, 0.0f, 0.0f)) *
+		glm::rotate(glm::radians(YrotationDegrees), glm::vec3(0.0f, 1.0f, 0.0f)) *
+		glm::rotate(glm::radians(ZrotationDegrees), glm::vec3(0.0f, 0.0f, 1.0f)) *
+		glm::scale(scaleXYZ);
+
+	node.scaleXYZ = scaleXYZ;
+	instance.sphere = glm::vec4(positionXYZ, m_pSceneManager->GetSceneNodeRadius(node));
+	instance.batch = (GLuint)batch;
+	instance.padding[0] = 0;
+	instance.padding[1] = 0;
+	instance.padding[2] = 0;
+
+	m_instances.push_back(instance);
+	m_bBuffersChanged = true;
+
+	return((int)m_instances.size() - 1);
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing every batch and copy.
+ *  The buffers are kept until copies are added again.
+ ***********************************************************/
+void GpuCulling::Clear()
+{
+	m_batches.clear();
+	m_instances.clear();
+	m_bBuffersChanged = true;
+}
+
+/***********************************************************
+ *  UpdateBuffers()
+ *
+ *  This method is used for uploading the copies and batches
+ *  into their buffers.  The copies are sorted by batch, and
+ *  each batch gets the range of the visible index buffer
+ *  that its visible copies are written into, so the copies
+ *  of a batch can be drawn by one instanced command.
+ ***********************************************************/
+void GpuCulling::UpdateBuffers()
+{
+	std::vector<INSTANCE_DATA> sortedInstances(m_instances.size());
+	std::vector<GLuint> batchFill(m_batches.size(), 0);
+
+	// count the copies of each batch to find where its range
+	// starts, then place each copy into its batch's range
+	for (int i = 0; i < m_instances.size(); i++)
+	{
+		batchFill[m_instances[i].batch]++;
+	}
+	GLuint firstInstance = 0;
+	for (int i = 0; i < m_batches.size(); i++)
+	{
+		m_batches[i].firstInstance = firstInstance;
+		firstInstance += batchFill[i];
+		batchFill[i] = 0;
+	}
+	for (int i = 0; i < m_instances.size(); i++)
+	{
+		const INSTANCE_DATA& instance = m_instances[i];
+		sortedInstances[m_batches[instance.batch].firstInstance + batchFill[instance.batch]] = instance;
+		batchFill[instance.batch]++;
+	}
+
+	// the counts hold the number of commands, then the number
+	// of visible copies of each batch
+	size_t countSize = (1 + m_batches.size()) * sizeof(GLuint);
+
+	m_instanceBuffer = CreateBuffer(
+		GL_SHADER_STORAGE_BUFFER,
+		sortedInstances.size() * sizeof(INSTANCE_DATA),
+		&sortedInstances[0]);
+	m_batchBuffer = CreateBuffer(
+		GL_SHADER_STORAGE_BUFFER,
+		m_batches.size() * sizeof(BATCH_DATA),
+		&m_batches[0]);
+	m_visibleBuffer = CreateBuffer(GL_SHADER_STORAGE_BUFFER, sortedInstances.size() * sizeof(GLuint), NULL);
+	m_countBuffer = CreateBuffer(GL_SHADER_STORAGE_BUFFER, countSize, NULL);
+	m_commandBuffer = CreateBuffer(GL_SHADER_STORAGE_BUFFER, m_batches.size() * sizeof(DRAW_ARRAYS_COMMAND), NULL);
+
+	// each drawn copy reads its own visible index - the base
+	// instance of the batch's command starts it at the batch's
+	// range, so the program needs no draw parameters
+	glBindVertexArray(m_vertexArray.GetName());
+	glBindBuffer(GL_ARRAY_BUFFER, m_visibleBuffer.GetName());
+	glEnableVertexAttribArray(g_VisibleAttribute);
+	glVertexAttribIPointer(g_VisibleAttribute, 1, GL_UNSIGNED_INT, sizeof(GLuint), (void*)0);
+	glVertexAttribDivisor(g_VisibleAttribute, 1);
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/***********************************************************
+ *  Render()
+ *
+ *  This method is used for culling the copies and drawing
+ *  the visible ones into each of the passed in views.  The
+ *  counts are cleared, the culling program tests every
+ *  copy and then turns the counts into commands, and one
+ *  multi-draw call draws as many commands as it built.
+ ***********************************************************/
+void GpuCulling::Render(const ViewManager::VIEW_DATA* pViews, int viewCount)
+{
+	if ((m_cullProgram == 0) || (m_drawProgram == 0) ||
+		(NULL == m_pShaderManager) || (NULL == m_pSceneManager))
+	{
+		return;
+	}
+	if (m_bBuffersChanged == true)
+	{
+		if (m_instances.empty() == false)
+		{
+			UpdateBuffers();
+		}
+		m_bBuffersChanged = false;
+	}
+	if (m_instances.empty() == true)
+	{
+		return;
+	}
+
+	GLuint instanceCount = (GLuint)m_instances.size();
+	GLuint batchCount = (GLuint)m_batches.size();
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_InstanceBinding, m_instanceBuffer.GetName());
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_BatchBinding, m_batchBuffer.GetName());
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_VisibleBinding, m_visibleBuffer.GetName());
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_CountBinding, m_countBuffer.GetName());
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_CommandBinding, m_commandBuffer.GetName());
+
+	// the lights and texture units stay the same for every view
+	GLuint previousProgram = UseProgram(m_drawProgram);
+	m_pSceneManager->SetupSceneLights();
+	for (int i = 0; i < g_TextureSlotCount; i++)
+	{
+		m_pShaderManager->setIntValue("sceneTextures[" + std::to_string(i) + "]", i);
+	}
+	m_pSceneManager->BindGLTextures();
+
+	// the counts of the culling program as well
+	UseProgram(m_cullProgram);
+	m_pShaderManager->setIntValue("instanceCount", instanceCount);
+	m_pShaderManager->setIntValue("batchCount", batchCount);
+	m_pShaderManager->setFloatValue("minimumPixelRadius", m_minimumPixelRadius);
+
+	for (int i = 0; i < viewCount; i++)
+	{
+		const ViewManager::VIEW_DATA& view = pViews[i];
+		glm::mat4 viewProjection = view.projection * view.view;
+		glm::vec3 cameraPosition = glm::vec3(glm::inverse(view.view)[3]);
+
+		// the frustum planes, as sums and differences of the
+		// view-projection rows like the scene's own culling
+		glm::vec4 row0 = glm::vec4(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+		glm::vec4 row1 = glm::vec4(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+		glm::vec4 row2 = glm::vec4(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+		glm::vec4 row3 = glm::vec4(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+		glm::vec4 planes[6] = { row3 + row0, row3 - row0, row3 + row1, row3 - row1, row3 + row2, row3 - row2 };
+
+		UseProgram(m_cullProgram);
+		for (int j = 0; j < 6; j++)
+		{
+			float length = glm::length(glm::vec3(planes[j]));
+			if (length > 0.0f)
+			{
+				planes[j] /= length;
+			}
+			m_pShaderManager->setVec4Value("frustumPlanes[" + std::to_string(j) + "]", planes[j]);
+		}
+		// pixels covered by one unit at a distance of one, and
+		// whether the size on screen shrinks with the distance
+		m_pShaderManager->setFloatValue("pixelScale", 0.5f * view.height * view.projection[1][1]);
+		m_pShaderManager->setBoolValue("bPerspective", view.projection[2][3] != 0.0f);
+		m_pShaderManager->setVec3Value("cameraPosition", cameraPosition);
+
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_countBuffer.GetName());
+		glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, NULL);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+		m_pShaderManager->setIntValue("cullPhase", g_CullInstancesPhase);
+		glDispatchCompute((instanceCount + g_CullGroupSize - 1) / g_CullGroupSize, 1, 1);
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+		m_pShaderManager->setIntValue("cullPhase", g_BuildCommandsPhase);
+		glDispatchCompute((batchCount + g_CullGroupSize - 1) / g_CullGroupSize, 1, 1);
+		glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+
+		UseProgram(m_drawProgram);
+		m_pShaderManager->setMat4Value("view", view.view);
+		m_pShaderManager->setMat4Value("projection", view.projection);
+		m_pShaderManager->setVec3Value("viewPosition", cameraPosition);
+
+		glViewport(view.x, view.y, view.width, view.height);
+		glBindVertexArray(m_vertexArray.GetName());
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer.GetName());
+		glBindBuffer(GL_PARAMETER_BUFFER, m_countBuffer.GetName());
+		if (GLEW_VERSION_4_6)
+		{
+			glMultiDrawArraysIndirectCount(GL_TRIANGLES, (void*)0, 0, batchCount, 0);
+		}
+		else
+		{
+			glMultiDrawArraysIndirectCountARB(GL_TRIANGLES, (void*)0, 0, batchCount, 0);
+		}
+		m_drawCount++;
+		glBindBuffer(GL_PARAMETER_BUFFER, 0);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		glBindVertexArray(0);
+	}
+
+	UseProgram(previousProgram);
+}
+
+/***********************************************************
+ *  CreateBuffer()
+ *
+ *  This method is used for creating a buffer of the passed
+ *  in size, filled with the passed in data when there is
+ *  any, and handing it to the resource manager.
+ ***********************************************************/
+ResourceRef GpuCulling::CreateBuffer(GLenum target, size_t byteCount, const void* pData)
+{
+	GLuint bufferID = 0;
+
+	glGenBuffers(1, &bufferID);
+	glBindBuffer(target, bufferID);
+	glBufferData(target, byteCount, pData, GL_DYNAMIC_DRAW);
+	glBindBuffer(target, 0);
+
+	return(ResourceRef(
+		m_pResourceManager,
+		m_pResourceManager->Register(ResourceManager::RESOURCE_BUFFER, bufferID, byteCount)));
+}
+
+/***********************************************************
+ *  UseProgram()
+ *
+ *  This method is used for switching the shader program
+ *  that the shader manager sets its values into, returning
+ *  the program that was in use before.
+ ***********************************************************/
+GLuint GpuCulling::UseProgram(GLuint programID)
+{
+	GLuint previousProgram = m_pShaderManager->m_programID;
+
+	if ((programID != 0) && (programID != previousProgram))
+	{
+		m_pShaderManager->m_programID = programID;
+		m_pShaderManager->use();
+	}
+
+	return(previousProgram);
+}
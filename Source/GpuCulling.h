@@ -0,0 +1,169 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpuculling.h
+// ============
+// cull and draw large numbers of mesh copies with commands built on the GPU
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneManager.h"
+#include "ViewManager.h"
+#include "ShaderManager.h"
+#include "ShaderLibrary.h"
+#include "ResourceManager.h"
+
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  GpuCulling
+ *
+ *  This class draws many copies of the basic meshes without
+ *  a draw call, or even a visibility test, per copy on the
+ *  CPU.  The copies are grouped into batches of the same
+ *  mesh, color, material and texture, and kept in a buffer
+ *  on the GPU.  For each view a compute program tests every
+ *  copy against the view frustum and a minimum size on
+ *  screen, writes the indices of the visible copies next to
+ *  the others of their batch, and then builds one indirect
+ *  draw command for each batch that has any visible copies.
+ *  All the batches are drawn by a single multi-draw call
+ *  whose number of commands is read from the GPU too, so
+ *  nothing is read back.  The basic meshes are captured once
+ *  into a shared vertex buffer with transform feedback, so
+ *  every batch draws from the same vertex array.
+ ***********************************************************/
+class GpuCulling
+{
+public:
+	// constructor
+	GpuCulling(
+		SceneManager* pSceneManager,
+		ShaderManager* pShaderManager,
+		ShaderLibrary* pShaderLibrary,
+		ResourceManager* pResourceManager);
+	// destructor
+	~GpuCulling();
+
+	// check whether compute programs and multi-draw calls that
+	// read their count from a buffer are available
+	static bool IsSupported();
+	// load the capture, culling and drawing programs and capture
+	// the basic meshes, returns false when unsupported
+	bool Initialize();
+
+	// add a batch of copies of a basic mesh that share a color,
+	// material and texture - returns the index of the batch or
+	// -1 on failure
+	int AddBatch(
+		SceneManager::MESH_TYPE mesh,
+		glm::vec4 color,
+		std::string materialTag,
+		std::string textureTag);
+	// add a copy to a batch, returns the index of the copy
+	int AddInstance(
+		int batch,
+		glm::vec3 scaleXYZ,
+		float XrotationDegrees,
+		float YrotationDegrees,
+		float ZrotationDegrees,
+		glm::vec3 positionXYZ);
+	// remove every batch and copy
+	void Clear();
+
+	// set the radius on screen, in pixels, below which a copy is
+	// too small to be drawn
+	void SetMinimumPixelRadius(float pixelRadius) { m_minimumPixelRadius = pixelRadius; }
+
+	// cull and draw the copies into each of the passed in views
+	void Render(const ViewManager::VIEW_DATA* pViews, int viewCount);
+
+	// get the number of batches and copies
+	int GetBatchCount() const { return((int)m_batches.size()); }
+	int GetInstanceCount() const { return((int)m_instances.size()); }
+	// get the number of multi-draw calls since the count was reset
+	int GetDrawCount() const { return(m_drawCount); }
+	void ResetDrawCount() { m_drawCount = 0; }
+
+private:
+	// a copy as it is stored in the instance buffer, matching
+	// the std430 layout that the programs read it with
+	struct INSTANCE_DATA
+	{
+		glm::mat4 model;
+		// world space bounding sphere, center and radius
+		glm::vec4 sphere;
+		GLuint batch;
+		GLuint padding[3];
+	};
+
+	// a batch as it is stored in the batch buffer, with the
+	// range of the captured mesh and of its visible copies
+	struct BATCH_DATA
+	{
+		glm::vec4 color;
+		// ambient color and strength
+		glm::vec4 ambient;
+		// diffuse color and shininess
+		glm::vec4 diffuse;
+		glm::vec4 specular;
+		GLint textureSlot;
+		GLuint firstVertex;
+		GLuint vertexCount;
+		GLuint firstInstance;
+	};
+
+	// the range of a basic mesh in the captured vertex buffer
+	struct MESH_RANGE
+	{
+		GLuint firstVertex;
+		GLuint vertexCount;
+	};
+
+	// pointer to the scene whose meshes, materials and
+	// textures the batches use
+	SceneManager* m_pSceneManager;
+	// pointer to shader manager object
+	ShaderManager* m_pShaderManager;
+	// pointer to the library that builds the programs
+	ShaderLibrary* m_pShaderLibrary;
+	// pointer to the manager that owns the OpenGL resources
+	ResourceManager* m_pResourceManager;
+	GLuint m_captureProgram;
+	GLuint m_cullProgram;
+	GLuint m_drawProgram;
+
+	// the basic meshes captured as triangles, and the vertex
+	// array that draws them with the visible copy indices
+	ResourceRef m_vertexBuffer;
+	ResourceRef m_vertexArray;
+	MESH_RANGE m_meshRanges[SceneManager::MESH_TYPE_COUNT];
+
+	// the copies and batches as they were added
+	std::vector<BATCH_DATA> m_batches;
+	std::vector<INSTANCE_DATA> m_instances;
+	bool m_bBuffersChanged;
+	float m_minimumPixelRadius;
+	// number of multi-draw calls since the count was reset
+	int m_drawCount;
+
+	// the buffers that the culling program reads and writes -
+	// the copies sorted by batch, the batches, the visible copy
+	// indices, the draw and visible counts, and the commands
+	ResourceRef m_instanceBuffer;
+	ResourceRef m_batchBuffer;
+	ResourceRef m_visibleBuffer;
+	ResourceRef m_countBuffer;
+	ResourceRef m_commandBuffer;
+
+	// capture the basic meshes into the shared vertex buffer
+	bool CaptureMeshes();
+	// create a buffer of the passed in size and data
+	ResourceRef CreateBuffer(GLenum target, size_t byteCount, const void* pData);
+	// upload the copies and batches, sorting the copies by batch
+	void UpdateBuffers();
+	// switch the program that the shader manager sets values
+	// into, returning the previous program
+	GLuint UseProgram(GLuint programID);
+};
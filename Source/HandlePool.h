@@ -0,0 +1,198 @@
+///////////////////////////////////////////////////////////////////////////////
+// handlepool.h
+// ============
+// dense storage for scene resources addressed by generational handles
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  HandlePool
+ *
+ *  This template stores items in a dense array and hands
+ *  out 32-bit handles made of a slot index (low 16 bits)
+ *  and a slot generation (high 16 bits).  Removing an item
+ *  bumps the generation of its slot, so handles to removed
+ *  items are detected with one compare, and the slot can be
+ *  safely reused when a resource is reloaded.  The items
+ *  stay packed, so they can be iterated or uploaded as one
+ *  contiguous array.
+ ***********************************************************/
+template <typename T>
+class HandlePool
+{
+public:
+	// handle to an item in the pool - a value of zero is
+	// never handed out, so it can be used as "no item"
+	struct HANDLE
+	{
+		uint32_t value;
+
+		bool operator==(const HANDLE& other) const { return(value == other.value); }
+		bool operator!=(const HANDLE& other) const { return(value != other.value); }
+	};
+
+	static HANDLE InvalidHandle()
+	{
+		HANDLE handle;
+		handle.value = 0;
+		return(handle);
+	}
+
+	/***********************************************************
+	 *  Add()
+	 *
+	 *  This method is used for adding an item to the pool and
+	 *  getting the handle for it.
+	 ***********************************************************/
+	HANDLE Add(const T& item)
+	{
+		uint16_t index = 0;
+
+		if (m_freeSlots.size() > 0)
+		{
+			index = m_freeSlots.back();
+			m_freeSlots.pop_back();
+		}
+		else
+		{
+			if (m_slots.size() >= 0xFFFF)
+			{
+				return(InvalidHandle());
+			}
+
+			SLOT slot;
+			slot.generation = 1;
+			slot.denseIndex = 0;
+			m_slots.push_back(slot);
+			index = (uint16_t)(m_slots.size() - 1);
+		}
+
+		m_slots[index].denseIndex = (uint32_t)m_items.size();
+		m_items.push_back(item);
+		m_denseSlots.push_back(index);
+
+		HANDLE handle;
+		handle.value = ((uint32_t)m_slots[index].generation << 16) | index;
+		return(handle);
+	}
+
+	/***********************************************************
+	 *  Remove()
+	 *
+	 *  This method is used for removing the item for the passed
+	 *  in handle.  The last item is moved into the hole so that
+	 *  the items stay packed.
+	 ***********************************************************/
+	bool Remove(HANDLE handle)
+	{
+		if (IsValid(handle) == false)
+		{
+			return(false);
+		}
+
+		uint16_t index = (uint16_t)(handle.value & 0xFFFF);
+		uint32_t denseIndex = m_slots[index].denseIndex;
+		uint32_t lastIndex = (uint32_t)m_items.size() - 1;
+
+		if (denseIndex != lastIndex)
+		{
+			m_items[denseIndex] = m_items[lastIndex];
+			m_denseSlots[denseIndex] = m_denseSlots[lastIndex];
+			m_slots[m_denseSlots[denseIndex]].denseIndex = denseIndex;
+		}
+		m_items.pop_back();
+		m_denseSlots.pop_back();
+
+		// bump the generation so existing handles become stale,
+		// skipping zero so that a handle value is never zero
+		m_slots[index].generation++;
+		if (m_slots[index].generation == 0)
+		{
+			m_slots[index].generation = 1;
+		}
+		m_freeSlots.push_back(index);
+
+		return(true);
+	}
+
+	/***********************************************************
+	 *  Clear()
+	 *
+	 *  This method is used for removing every item, making all
+	 *  of the handed out handles stale.
+	 ***********************************************************/
+	void Clear()
+	{
+		while (m_items.size() > 0)
+		{
+			HANDLE handle;
+			uint16_t index = m_denseSlots.back();
+			handle.value = ((uint32_t)m_slots[index].generation << 16) | index;
+			Remove(handle);
+		}
+	}
+
+	/***********************************************************
+	 *  IsValid()
+	 *
+	 *  This method is used for checking whether the passed in
+	 *  handle still refers to an item in the pool.
+	 ***********************************************************/
+	bool IsValid(HANDLE handle) const
+	{
+		uint16_t index = (uint16_t)(handle.value & 0xFFFF);
+		return((index < m_slots.size()) &&
+			(m_slots[index].generation == (uint16_t)(handle.value >> 16)));
+	}
+
+	/***********************************************************
+	 *  Get()
+	 *
+	 *  This method is used for getting the item for the passed
+	 *  in handle, or NULL when the handle is stale.
+	 ***********************************************************/
+	T* Get(HANDLE handle)
+	{
+		if (IsValid(handle) == false)
+		{
+			return(NULL);
+		}
+
+		return(&m_items[m_slots[handle.value & 0xFFFF].denseIndex]);
+	}
+
+	const T* Get(HANDLE handle) const
+	{
+		if (IsValid(handle) == false)
+		{
+			return(NULL);
+		}
+
+		return(&m_items[m_slots[handle.value & 0xFFFF].denseIndex]);
+	}
+
+	// access to the packed items, in no particular order
+	int Size() const { return((int)m_items.size()); }
+	T* Data() { return(m_items.data()); }
+	const T* Data() const { return(m_items.data()); }
+
+private:
+	struct SLOT
+	{
+		uint16_t generation;
+		uint32_t denseIndex;
+	};
+
+	// packed items and the slot that owns each of them
+	std::vector<T> m_items;
+	std::vector<uint16_t> m_denseSlots;
+	// slots indexed by handle, and the slots free for reuse
+	std::vector<SLOT> m_slots;
+	std::vector<uint16_t> m_freeSlots;
+};
@@ -0,0 +1,592 @@
+///////////////////////////////////////////////////////////////////////////////
+// impostorsystem.cpp
+// ============
+// draw distant copies of compound props as pre-rendered billboards
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ImpostorSystem.h"
+
+#include <glm/gtx/transform.hpp>
+
+#include <cmath>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// view directions baked for each prop - the azimuths go all
+	// the way around, the elevations go up from the horizon
+	const int g_AzimuthCount = 8;
+	const int g_ElevationCount = 3;
+	const float g_ElevationStepDegrees = 30.0f;
+	const int g_ViewCount = g_AzimuthCount * g_ElevationCount;
+	// size of one baked view in the atlas, in pixels
+	const int g_AtlasCellSize = 128;
+	// most props that the atlas has rows for
+	const int g_MaxProps = 16;
+
+	// default distance beyond which copies become impostors
+	const float g_DefaultImpostorDistance = 40.0f;
+	// copies switch back to geometry a little closer than they
+	// switched to impostors, so they do not flicker at the border
+	const float g_GeometryDistanceFactor = 0.9f;
+
+	// floats per impostor in the instance buffer - the center,
+	// the half size of the quad and the atlas row
+	const int g_InstanceFloatCount = 5;
+
+	const float PI = 3.14159265358979f;
+}
+
+/***********************************************************
+ *  ImpostorSystem()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ImpostorSystem::ImpostorSystem(
+	SceneManager* pSceneManager,
+	ViewManager* pViewManager,
+	ShaderManager* pShaderManager,
+	ShaderLibrary* pShaderLibrary,
+	ResourceManager* pResourceManager)
+{
+	m_pSceneManager = pSceneManager;
+	m_pViewManager = pViewManager;
+	m_pShaderManager = pShaderManager;
+	m_pShaderLibrary = pShaderLibrary;
+	m_pResourceManager = pResourceManager;
+	m_billboardProgram = 0;
+	m_impostorDistance = g_DefaultImpostorDistance;
+	m_impostorCount = 0;
+	m_instanceBufferSize = 0;
+	m_bInstancesChanged = false;
+}
+
+/***********************************************************
+ *  ~ImpostorSystem()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ImpostorSystem::~ImpostorSystem()
+{
+	// release the OpenGL objects to the resource manager
+	m_vertexArray.Reset();
+	m_instanceBuffer.Reset();
+	m_atlasFramebuffer.Reset();
+	m_atlasDepth.Reset();
+	m_atlasTexture.Reset();
+	m_props.clear();
+	m_instances.clear();
+	m_pSceneManager = NULL;
+	m_pViewManager = NULL;
+	m_pShaderManager = NULL;
+	m_pShaderLibrary = NULL;
+	m_pResourceManager = NULL;
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for loading the billboard program
+ *  and creating the vertex array for the instanced quads.
+ ***********************************************************/
+bool ImpostorSystem::Initialize()
+{
+	if ((NULL == m_pShaderLibrary) || (NULL == m_pResourceManager))
+	{
+		return(false);
+	}
+
+	m_billboardProgram = m_pShaderLibrary->LoadProgram(
+		"../../Utilities/shaders/impostorVertexShader.glsl",
+		NULL,
+		"../../Utilities/shaders/impostorFragmentShader.glsl");
+	if (m_billboardProgram == 0)
+	{
+		return(false);
+	}
+
+	GLuint vertexArrayID = 0;
+	glGenVertexArrays(1, &vertexArrayID);
+	m_vertexArray = ResourceRef(
+		m_pResourceManager,
+		m_pResourceManager->Register(ResourceManager::RESOURCE_VERTEX_ARRAY, vertexArrayID, 0));
+
+	return(true);
+}
+
+/***********************************************************
+ *  DefineProp()
+ *
+ *  This method is used for defining a prop from a group of
+ *  scene nodes.  The bounding sphere of the nodes is the
+ *  area that each of the prop's atlas views covers.
+ ***********************************************************/
+int ImpostorSystem::DefineProp(std::string name, const std::vector<std::string>& nodeTags)
+{
+	PROP prop;
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+
+	if ((NULL == m_pSceneManager) || (m_props.size() >= g_MaxProps))
+	{
+		return(-1);
+	}
+
+	prop.name = name;
+	prop.atlasRow = (int)m_props.size();
+	prop.bBaked = false;
+	prop.radius = 0.0f;
+
+	// collect the nodes and the box around their bounding spheres
+	for (int i = 0; i < nodeTags.size(); i++)
+	{
+		SceneManager::SCENE_NODE node;
+		if (m_pSceneManager->GetSceneNode(nodeTags[i], node) == false)
+		{
+			std::cout << "Could not define impostor prop:" << name << ", missing scene node " << nodeTags[i] << std::endl;
+			return(-1);
+		}
+
+		float nodeRadius = m_pSceneManager->GetSceneNodeRadius(node);
+		glm::vec3 nodeMin = node.positionXYZ - glm::vec3(nodeRadius);
+		glm::vec3 nodeMax = node.positionXYZ + glm::vec3(nodeRadius);
+		boundsMin = (i == 0) ? nodeMin : glm::min(boundsMin, nodeMin);
+		boundsMax = (i == 0) ? nodeMax : glm::max(boundsMax, nodeMax);
+
+		prop.nodeTags.push_back(nodeTags[i]);
+		prop.nodeIndices.push_back(m_pSceneManager->FindSceneNode(nodeTags[i]));
+	}
+	if (prop.nodeTags.size() == 0)
+	{
+		return(-1);
+	}
+
+	// a sphere around the center of the box that holds every node
+	prop.center = (boundsMin + boundsMax) * 0.5f;
+	for (int i = 0; i < prop.nodeTags.size(); i++)
+	{
+		SceneManager::SCENE_NODE node;
+		m_pSceneManager->GetSceneNode(prop.nodeTags[i], node);
+		prop.radius = glm::max(prop.radius,
+			glm::length(node.positionXYZ - prop.center) + m_pSceneManager->GetSceneNodeRadius(node));
+	}
+
+	m_props.push_back(prop);
+
+	return((int)m_props.size() - 1);
+}
+
+/***********************************************************
+ *  FindProp()
+ *
+ *  This method is used for finding a defined prop by name.
+ ***********************************************************/
+int ImpostorSystem::FindProp(std::string name) const
+{
+	int index = 0;
+
+	while (index < m_props.size())
+	{
+		if (m_props[index].name.compare(name) == 0)
+		{
+			return(index);
+		}
+		index++;
+	}
+
+	return(-1);
+}
+
+/***********************************************************
+ *  AddInstance()
+ *
+ *  This method is used for placing a copy of a prop.  The
+ *  copy gets its own scene nodes for when it is close, and
+ *  starts out drawn with its real geometry.
+ ***********************************************************/
+int ImpostorSystem::AddInstance(int prop, const glm::vec3& position, float scale)
+{
+	INSTANCE instance;
+
+	if ((NULL == m_pSceneManager) || (prop < 0) || (prop >= m_props.size()) || (scale <= 0.0f))
+	{
+		return(-1);
+	}
+
+	const PROP& source = m_props[prop];
+	instance.prop = prop;
+	instance.position = position;
+	instance.scale = scale;
+	instance.bImpostor = false;
+
+	std::string tagPrefix = source.name + "#" + std::to_string(m_instances.size()) + ".";
+	for (int i = 0; i < source.nodeTags.size(); i++)
+	{
+		SceneManager::SCENE_NODE node;
+		m_pSceneManager->GetSceneNode(source.nodeTags[i], node);
+
+		instance.nodeIndices.push_back(m_pSceneManager->AddSceneNode(
+			tagPrefix + source.nodeTags[i],
+			node.mesh,
+			node.scaleXYZ * scale,
+			node.rotationDegrees.x,
+			node.rotationDegrees.y,
+			node.rotationDegrees.z,
+			position + (node.positionXYZ - source.center) * scale,
+			node.color,
+			node.material,
+			node.texture));
+	}
+
+	m_instances.push_back(instance);
+
+	return((int)m_instances.size() - 1);
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for baking the atlas views of props
+ *  that have copies but no views yet, and for switching
+ *  each copy between its geometry and its impostor by the
+ *  distance from the camera.
+ ***********************************************************/
+bool ImpostorSystem::Update(const glm::vec3& cameraPosition)
+{
+	bool bSwitched = false;
+
+	if ((NULL == m_pSceneManager) || (m_billboardProgram == 0))
+	{
+		return(false);
+	}
+
+	for (int i = 0; i < m_instances.size(); i++)
+	{
+		INSTANCE& instance = m_instances[i];
+		PROP& prop = m_props[instance.prop];
+		float distance = glm::length(cameraPosition - instance.position);
+
+		bool bImpostor = instance.bImpostor;
+		if (distance > m_impostorDistance)
+		{
+			bImpostor = true;
+		}
+		else if (distance < m_impostorDistance * g_GeometryDistanceFactor)
+		{
+			bImpostor = false;
+		}
+
+		// a prop is only baked once a copy of it needs the views
+		if ((bImpostor == true) && (prop.bBaked == false))
+		{
+			if (BakeProp(prop) == false)
+			{
+				bImpostor = false;
+			}
+		}
+
+		if (bImpostor != instance.bImpostor)
+		{
+			instance.bImpostor = bImpostor;
+			for (int j = 0; j < instance.nodeIndices.size(); j++)
+			{
+				m_pSceneManager->SetSceneNodeHidden(instance.nodeIndices[j], bImpostor);
+			}
+			m_impostorCount += (bImpostor == true) ? 1 : -1;
+			bSwitched = true;
+		}
+	}
+
+	if (bSwitched == true)
+	{
+		m_bInstancesChanged = true;
+	}
+
+	return(bSwitched);
+}
+
+/***********************************************************
+ *  Render()
+ *
+ *  This method is used for drawing every impostor with one
+ *  instanced draw per view.  The quads are turned towards
+ *  each view's camera, and the view of the atlas is picked
+ *  in the vertex stage from the direction to the camera.
+ ***********************************************************/
+void ImpostorSystem::Render(const ViewManager::VIEW_DATA* pViews, int viewCount)
+{
+	if ((m_impostorCount == 0) || (NULL == m_pShaderManager) || (m_billboardProgram == 0))
+	{
+		return;
+	}
+
+	if (m_bInstancesChanged == true)
+	{
+		UpdateInstanceBuffer();
+		m_bInstancesChanged = false;
+	}
+
+	GLuint previousProgram = UseProgram(m_billboardProgram);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, m_atlasTexture.GetName());
+	m_pShaderManager->setIntValue("impostorAtlas", 0);
+	m_pShaderManager->setIntValue("azimuthCount", g_AzimuthCount);
+	m_pShaderManager->setIntValue("elevationCount", g_ElevationCount);
+	m_pShaderManager->setFloatValue("elevationStep", glm::radians(g_ElevationStepDegrees));
+	m_pShaderManager->setVec2Value("atlasCellSize",
+		glm::vec2(1.0f / g_ViewCount, 1.0f / g_MaxProps));
+
+	glBindVertexArray(m_vertexArray.GetName());
+	for (int i = 0; i < viewCount; i++)
+	{
+		const ViewManager::VIEW_DATA& view = pViews[i];
+
+		glViewport(view.x, view.y, view.width, view.height);
+		m_pShaderManager->setMat4Value("viewProjection", view.projection * view.view);
+		m_pShaderManager->setVec3Value("cameraPosition", glm::vec3(glm::inverse(view.view)[3]));
+		glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, m_impostorCount);
+	}
+	glBindVertexArray(0);
+
+	UseProgram(previousProgram);
+}
+
+/***********************************************************
+ *  CreateAtlas()
+ *
+ *  This method is used for creating the atlas texture, with
+ *  one row of views for each prop, and the framebuffer that
+ *  the views are baked through.
+ ***********************************************************/
+bool ImpostorSystem::CreateAtlas()
+{
+	int width = g_ViewCount * g_AtlasCellSize;
+	int height = g_MaxProps * g_AtlasCellSize;
+	int levelCount = 1 + (int)std::floor(std::log2((float)std::max(width, height)));
+	GLint previousFramebuffer = 0;
+
+	GLuint textureID = 0;
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_2D, textureID);
+	if (GLEW_ARB_texture_storage)
+	{
+		glTexStorage2D(GL_TEXTURE_2D, levelCount, GL_RGBA8, width, height);
+	}
+	else
+	{
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	}
+	// the impostors are small on screen, so they are mipmapped
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	m_atlasTexture = ResourceRef(
+		m_pResourceManager,
+		m_pResourceManager->Register(
+			ResourceManager::RESOURCE_TEXTURE,
+			textureID,
+			(size_t)width * height * 4 + (size_t)width * height * 4 / 3));
+
+	// the depth buffer is only needed while baking
+	GLuint depthID = 0;
+	glGenRenderbuffers(1, &depthID);
+	glBindRenderbuffer(GL_RENDERBUFFER, depthID);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+	GLuint framebufferID = 0;
+	glGenFramebuffers(1, &framebufferID);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebufferID);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textureID, 0);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthID);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+
+	m_atlasDepth = ResourceRef(
+		m_pResourceManager,
+		m_pResourceManager->Register(
+			ResourceManager::RESOURCE_RENDERBUFFER,
+			depthID,
+			(size_t)width * height * 4));
+
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "Could not create impostor atlas:" << width << "x" << height << std::endl;
+		glDeleteFramebuffers(1, &framebufferID);
+		m_atlasDepth.Reset();
+		m_atlasTexture.Reset();
+		return(false);
+	}
+
+	m_atlasFramebuffer = ResourceRef(
+		m_pResourceManager,
+		m_pResourceManager->Register(ResourceManager::RESOURCE_FRAMEBUFFER, framebufferID, 0));
+
+	return(true);
+}
+
+/***********************************************************
+ *  BakeProp()
+ *
+ *  This method is used for rendering a prop into its row of
+ *  the atlas, once from each view direction, with an
+ *  orthographic camera that fits the prop's bounding sphere.
+ ***********************************************************/
+bool ImpostorSystem::BakeProp(PROP& prop)
+{
+	GLint previousFramebuffer = 0;
+	GLint previousViewport[4];
+
+	if ((NULL == m_pViewManager) || (NULL == m_pResourceManager))
+	{
+		return(false);
+	}
+	if ((m_atlasFramebuffer.IsValid() == false) && (CreateAtlas() == false))
+	{
+		return(false);
+	}
+
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+	glGetIntegerv(GL_VIEWPORT, previousViewport);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_atlasFramebuffer.GetName());
+	glEnable(GL_DEPTH_TEST);
+
+	glm::mat4 projection = glm::ortho(
+		-prop.radius, prop.radius,
+		-prop.radius, prop.radius,
+		0.01f, prop.radius * 4.0f);
+
+	for (int elevation = 0; elevation < g_ElevationCount; elevation++)
+	{
+		for (int azimuth = 0; azimuth < g_AzimuthCount; azimuth++)
+		{
+			float azimuthRadians = azimuth * 2.0f * PI / g_AzimuthCount;
+			float elevationRadians = glm::radians(elevation * g_ElevationStepDegrees);
+			glm::vec3 direction = glm::vec3(
+				std::cos(elevationRadians) * std::sin(azimuthRadians),
+				std::sin(elevationRadians),
+				std::cos(elevationRadians) * std::cos(azimuthRadians));
+			glm::vec3 eye = prop.center + direction * prop.radius * 2.0f;
+
+			int x = (elevation * g_AzimuthCount + azimuth) * g_AtlasCellSize;
+			int y = prop.atlasRow * g_AtlasCellSize;
+
+			// clear only this view's cell, leaving transparent
+			// pixels around the prop
+			glEnable(GL_SCISSOR_TEST);
+			glScissor(x, y, g_AtlasCellSize, g_AtlasCellSize);
+			glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			glDisable(GL_SCISSOR_TEST);
+
+			m_pViewManager->PrepareExternalView(
+				glm::lookAt(eye, prop.center, glm::vec3(0.0f, 1.0f, 0.0f)),
+				projection,
+				eye,
+				x, y, g_AtlasCellSize, g_AtlasCellSize);
+			m_pSceneManager->SetupSceneLights();
+			m_pViewManager->PrepareViewPass(0);
+			m_pSceneManager->RenderSceneNodes(prop.nodeIndices);
+		}
+	}
+
+	glBindTexture(GL_TEXTURE_2D, m_atlasTexture.GetName());
+	glGenerateMipmap(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+	glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+
+	prop.bBaked = true;
+
+	return(true);
+}
+
+/***********************************************************
+ *  UpdateInstanceBuffer()
+ *
+ *  This method is used for writing the copies that are
+ *  drawn as impostors into the instance buffer, growing the
+ *  buffer when it is too small.
+ ***********************************************************/
+void ImpostorSystem::UpdateInstanceBuffer()
+{
+	std::vector<float> instanceData;
+
+	for (int i = 0; i < m_instances.size(); i++)
+	{
+		const INSTANCE& instance = m_instances[i];
+		if (instance.bImpostor == false)
+		{
+			continue;
+		}
+
+		const PROP& prop = m_props[instance.prop];
+		instanceData.push_back(instance.position.x);
+		instanceData.push_back(instance.position.y);
+		instanceData.push_back(instance.position.z);
+		instanceData.push_back(prop.radius * instance.scale);
+		instanceData.push_back((float)prop.atlasRow);
+	}
+
+	size_t byteCount = instanceData.size() * sizeof(float);
+	if (byteCount == 0)
+	{
+		return;
+	}
+
+	if ((m_instanceBuffer.IsValid() == false) || (m_instanceBufferSize < byteCount))
+	{
+		GLuint bufferID = 0;
+		glGenBuffers(1, &bufferID);
+		m_instanceBuffer = ResourceRef(
+			m_pResourceManager,
+			m_pResourceManager->Register(ResourceManager::RESOURCE_BUFFER, bufferID, byteCount));
+		m_instanceBufferSize = byteCount;
+
+		// point the per copy attributes at the new buffer
+		GLsizei stride = g_InstanceFloatCount * sizeof(float);
+		glBindVertexArray(m_vertexArray.GetName());
+		glBindBuffer(GL_ARRAY_BUFFER, bufferID);
+		glBufferData(GL_ARRAY_BUFFER, byteCount, NULL, GL_DYNAMIC_DRAW);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, stride, (void*)0);
+		glVertexAttribDivisor(0, 1);
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, stride, (void*)(4 * sizeof(float)));
+		glVertexAttribDivisor(1, 1);
+		glBindVertexArray(0);
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer.GetName());
+	glBufferSubData(GL_ARRAY_BUFFER, 0, byteCount, &instanceData[0]);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/***********************************************************
+ *  UseProgram()
+ *
+ *  This method is used for switching the shader program
+ *  that the shader manager sets its values into, returning
+ *  the program that was in use before.
+ ***********************************************************/
+GLuint ImpostorSystem::UseProgram(GLuint programID)
+{
+	GLuint previousProgram = m_pShaderManager->m_programID;
+
+	if ((programID != 0) && (programID != previousProgram))
+	{
+		m_pShaderManager->m_programID = programID;
+		m_pShaderManager->use();
+	}
+
+	return(previousProgram);
+}
@@ -0,0 +1,131 @@
+///////////////////////////////////////////////////////////////////////////////
+// impostorsystem.h
+// ============
+// draw distant copies of compound props as pre-rendered billboards
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneManager.h"
+#include "ViewManager.h"
+#include "ShaderLibrary.h"
+#include "ResourceManager.h"
+
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  ImpostorSystem
+ *
+ *  This class replaces distant copies of compound props,
+ *  made of several scene nodes, with single camera facing
+ *  quads.  Each prop is rendered once from a set of view
+ *  directions into a shared atlas, the first time a copy
+ *  of it is placed.  Copies beyond the impostor distance
+ *  hide their scene nodes and are drawn together in one
+ *  instanced draw, with each quad showing the atlas view
+ *  nearest to the direction it is seen from.  Copies that
+ *  come closer show their real geometry again.
+ ***********************************************************/
+class ImpostorSystem
+{
+public:
+	// constructor
+	ImpostorSystem(
+		SceneManager* pSceneManager,
+		ViewManager* pViewManager,
+		ShaderManager* pShaderManager,
+		ShaderLibrary* pShaderLibrary,
+		ResourceManager* pResourceManager);
+	// destructor
+	~ImpostorSystem();
+
+	// load the billboard program, returns false when unsupported
+	bool Initialize();
+
+	// define a prop from the scene nodes with the passed in tags,
+	// returns the index of the prop or -1 on failure
+	int DefineProp(std::string name, const std::vector<std::string>& nodeTags);
+	// find a defined prop by name
+	int FindProp(std::string name) const;
+	// place a copy of a prop, centered on the passed in position
+	// and uniformly scaled - returns the index of the copy
+	int AddInstance(int prop, const glm::vec3& position, float scale);
+
+	// set the distance beyond which copies are drawn as impostors
+	void SetImpostorDistance(float distance) { m_impostorDistance = distance; }
+
+	// bake the atlas views of new props and switch the copies
+	// between geometry and impostors, returns true when any
+	// copy switched
+	bool Update(const glm::vec3& cameraPosition);
+	// draw the impostors into each of the passed in views
+	void Render(const ViewManager::VIEW_DATA* pViews, int viewCount);
+
+	// get the number of copies currently drawn as impostors
+	int GetImpostorCount() const { return(m_impostorCount); }
+
+private:
+	struct PROP
+	{
+		std::string name;
+		// scene node tags and indices of the original prop
+		std::vector<std::string> nodeTags;
+		std::vector<int> nodeIndices;
+		// bounding sphere of the original prop
+		glm::vec3 center;
+		float radius;
+		// row of the atlas that holds the prop's views
+		int atlasRow;
+		bool bBaked;
+	};
+
+	struct INSTANCE
+	{
+		int prop;
+		glm::vec3 position;
+		float scale;
+		// scene nodes added for the real geometry of the copy
+		std::vector<int> nodeIndices;
+		bool bImpostor;
+	};
+
+	// pointers to the scene the props are taken from, the view
+	// used for baking and the shader manager of the scene program
+	SceneManager* m_pSceneManager;
+	ViewManager* m_pViewManager;
+	ShaderManager* m_pShaderManager;
+	// pointer to the library that builds the billboard program
+	ShaderLibrary* m_pShaderLibrary;
+	// pointer to the manager that owns the OpenGL resources
+	ResourceManager* m_pResourceManager;
+	GLuint m_billboardProgram;
+
+	std::vector<PROP> m_props;
+	std::vector<INSTANCE> m_instances;
+	float m_impostorDistance;
+	int m_impostorCount;
+
+	// atlas of the baked views, one row per prop, and the
+	// framebuffer and depth buffer that the views are baked through
+	ResourceRef m_atlasTexture;
+	ResourceRef m_atlasDepth;
+	ResourceRef m_atlasFramebuffer;
+	// per copy data of the impostors and the vertex array
+	// that feeds it to the billboard program
+	ResourceRef m_instanceBuffer;
+	ResourceRef m_vertexArray;
+	size_t m_instanceBufferSize;
+	bool m_bInstancesChanged;
+
+	// create the atlas texture and framebuffer
+	bool CreateAtlas();
+	// render a prop from every atlas view direction
+	bool BakeProp(PROP& prop);
+	// upload the impostor copies into the instance buffer
+	void UpdateInstanceBuffer();
+	// switch the program that the shader manager sets values
+	// into, returning the previous program
+	GLuint UseProgram(GLuint programID);
+};
@@ -0,0 +1,979 @@
+///////////////////////////////////////////////////////////////////////////////
+// jpegdecoder.cpp
+// ============
+// decode JPEG images straight to a half, quarter or eighth of their size
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "JpegDecoder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// declaration of global variables
+namespace
+{
+	// the position in the 8x8 block of each coefficient, in the
+	// order they are stored
+	const int g_ZigZag[64] =
+	{
+		0,  1,  8, 16,  9,  2,  3, 10,
+		17, 24, 32, 25, 18, 11,  4,  5,
+		12, 19, 26, 33, 40, 48, 41, 34,
+		27, 20, 13,  6,  7, 14, 21, 28,
+		35, 42, 49, 56, 57, 50, 43, 36,
+		29, 22, 15, 23, 30, 37, 44, 51,
+		58, 59, 52, 45, 38, 31, 39, 46,
+		53, 60, 61, 54, 47, 55, 62, 63
+	};
+
+	const float g_Pi = 3.14159265358979f;
+	// bits of the codes that are decoded with one table lookup
+	const int g_LookupBits = 9;
+
+	// read a big-endian 16-bit value
+	int ReadWord(const unsigned char* pData)
+	{
+		return((pData[0] << 8) | pData[1]);
+	}
+
+	// turn the bits of a coefficient into its signed value
+	int Extend(int value, int bitCount)
+	{
+		if (value < (1 << (bitCount - 1)))
+		{
+			return(value - (1 << bitCount) + 1);
+		}
+		return(value);
+	}
+
+	unsigned char ClampSample(float value)
+	{
+		if (value <= 0.0f)
+		{
+			return(0);
+		}
+		if (value >= 255.0f)
+		{
+			return(255);
+		}
+		return((unsigned char)(value + 0.5f));
+	}
+}
+
+/***********************************************************
+ *  JpegDecoder()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+JpegDecoder::JpegDecoder()
+{
+	m_pData = NULL;
+	m_size = 0;
+	m_position = 0;
+	m_bitBuffer = 0;
+	m_bitCount = 0;
+	m_bHitMarker = false;
+	m_restartInterval = 0;
+	m_width = 0;
+	m_height = 0;
+	m_bFrameRead = false;
+	m_bTransformRGB = false;
+	m_maxHorizontalSampling = 1;
+	m_maxVerticalSampling = 1;
+	m_blockSize = 0;
+	memset(m_quantTables, 0, sizeof(m_quantTables));
+	memset(m_dcTables, 0, sizeof(m_dcTables));
+	memset(m_acTables, 0, sizeof(m_acTables));
+	memset(m_transform, 0, sizeof(m_transform));
+}
+
+/***********************************************************
+ *  ~JpegDecoder()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+JpegDecoder::~JpegDecoder()
+{
+}
+
+/***********************************************************
+ *  IsJpeg()
+ *
+ *  This method is used for checking for the start of image
+ *  marker that every JPEG file begins with.
+ ***********************************************************/
+bool JpegDecoder::IsJpeg(const unsigned char* pData, size_t size)
+{
+	return((NULL != pData) && (size >= 4) && (pData[0] == 0xFF) && (pData[1] == 0xD8));
+}
+
+/***********************************************************
+ *  ChooseScaleShift()
+ *
+ *  This method is used for finding how many times an image
+ *  can be halved while its longer side stays at least the
+ *  passed in size.
+ ***********************************************************/
+int JpegDecoder::ChooseScaleShift(int width, int height, int minimumSize)
+{
+	int longerSide = std::max(width, height);
+	int scaleShift = 0;
+
+	while ((scaleShift < 3) &&
+		(((longerSide + (2 << scaleShift) - 1) >> (scaleShift + 1)) >= minimumSize))
+	{
+		scaleShift++;
+	}
+
+	return(scaleShift);
+}
+
+/***********************************************************
+ *  ReadHeader()
+ *
+ *  This method is used for reading the size of the image
+ *  from its frame header, without decoding it.
+ ***********************************************************/
+bool JpegDecoder::ReadHeader(const unsigned char* pData, size_t size, int& width, int& height, int& colorChannels)
+{
+	m_pData = pData;
+	m_size = size;
+	m_blockSize = 0;
+	m_bFrameRead = false;
+	m_components.clear();
+
+	if (ReadSegments(false) == false)
+	{
+		return(false);
+	}
+
+	width = m_width;
+	height = m_height;
+	colorChannels = (m_components.size() == 1) ? 1 : 3;
+
+	return(true);
+}
+
+/***********************************************************
+ *  Decode()
+ *
+ *  This method is used for decoding the image at a reduced
+ *  size.  Each 8x8 block becomes an 8, 4, 2 or 1 sample
+ *  wide block, and the components are converted to gray or
+ *  RGB pixels at the reduced size.
+ ***********************************************************/
+bool JpegDecoder::Decode(
+	const unsigned char* pData,
+	size_t size,
+	int scaleShift,
+	bool bFlipVertically,
+	std::vector<unsigned char>& pixels,
+	int& width,
+	int& height,
+	int& colorChannels)
+{
+	pixels.clear();
+	width = 0;
+	height = 0;
+	colorChannels = 0;
+
+	if ((scaleShift < 0) || (scaleShift > 3))
+	{
+		return(false);
+	}
+
+	m_pData = pData;
+	m_size = size;
+	m_restartInterval = 0;
+	m_bFrameRead = false;
+	m_bTransformRGB = false;
+	m_components.clear();
+	memset(m_dcTables, 0, sizeof(m_dcTables));
+	memset(m_acTables, 0, sizeof(m_acTables));
+	m_blockSize = 8 >> scaleShift;
+	BuildTransform();
+
+	if (ReadSegments(true) == false)
+	{
+		return(false);
+	}
+
+	width = (m_width + (1 << scaleShift) - 1) >> scaleShift;
+	height = (m_height + (1 << scaleShift) - 1) >> scaleShift;
+	colorChannels = (m_components.size() == 1) ? 1 : 3;
+	ConvertColors(bFlipVertically, pixels, width, height);
+
+	// the samples are only needed until they are converted
+	for (int i = 0; i < m_components.size(); i++)
+	{
+		m_components[i].samples.clear();
+		m_components[i].samples.shrink_to_fit();
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  ReadSegments()
+ *
+ *  This method is used for stepping through the marker
+ *  segments of the file, reading the tables and the frame
+ *  header, and decoding each scan when requested.
+ ***********************************************************/
+bool JpegDecoder::ReadSegments(bool bDecodeScans)
+{
+	if (IsJpeg(m_pData, m_size) == false)
+	{
+		return(false);
+	}
+
+	m_position = 2;
+	while (m_position + 4 <= m_size)
+	{
+		if (m_pData[m_position] != 0xFF)
+		{
+			m_position++;
+			continue;
+		}
+		int marker = m_pData[m_position + 1];
+		// fill bytes, and stuffed zeros left after a scan
+		if ((marker == 0xFF) || (marker == 0x00))
+		{
+			m_position++;
+			continue;
+		}
+		m_position += 2;
+
+		// the end of the image, and the markers without a length
+		if (marker == 0xD9)
+		{
+			break;
+		}
+		if (((marker >= 0xD0) && (marker <= 0xD7)) || (marker == 0x01))
+		{
+			continue;
+		}
+
+		size_t length = (size_t)ReadWord(m_pData + m_position);
+		if ((length < 2) || (m_position + length > m_size))
+		{
+			return(false);
+		}
+		size_t segmentStart = m_position + 2;
+		size_t segmentLength = length - 2;
+		m_position = segmentStart;
+
+		bool bRead = true;
+		switch (marker)
+		{
+		// baseline and extended sequential Huffman frames
+		case 0xC0:
+		case 0xC1:
+			bRead = ReadFrameHeader(segmentLength);
+			if ((bRead == true) && (bDecodeScans == false))
+			{
+				return(true);
+			}
+			break;
+		// progressive, lossless and arithmetic coded frames
+		case 0xC2:
+		case 0xC3:
+		case 0xC5:
+		case 0xC6:
+		case 0xC7:
+		case 0xC9:
+		case 0xCA:
+		case 0xCB:
+		case 0xCD:
+		case 0xCE:
+		case 0xCF:
+			return(false);
+		case 0xC4:
+			bRead = ReadHuffmanTables(segmentLength);
+			break;
+		case 0xDB:
+			bRead = ReadQuantTables(segmentLength);
+			break;
+		case 0xDD:
+			bRead = (segmentLength >= 2);
+			if (bRead == true)
+			{
+				m_restartInterval = ReadWord(m_pData + segmentStart);
+			}
+			break;
+		// an Adobe segment tells whether three components are RGB
+		case 0xEE:
+			if ((segmentLength >= 12) && (memcmp(m_pData + segmentStart, "Adobe", 5) == 0))
+			{
+				m_bTransformRGB = (m_pData[segmentStart + 11] == 0);
+			}
+			break;
+		case 0xDA:
+			if ((m_bFrameRead == false) || (bDecodeScans == false))
+			{
+				return(false);
+			}
+			// the scan leaves the position after its coded data
+			if (ReadScan(segmentLength) == false)
+			{
+				return(false);
+			}
+			continue;
+		default:
+			break;
+		}
+
+		if (bRead == false)
+		{
+			return(false);
+		}
+		m_position = segmentStart + segmentLength;
+	}
+
+	// a file cut short keeps the blocks decoded so far
+	return((m_bFrameRead == true) && (bDecodeScans == true));
+}
+
+/***********************************************************
+ *  ReadFrameHeader()
+ *
+ *  This method is used for reading the size of the image
+ *  and its color components, and making room for the
+ *  samples of each component at the reduced size.
+ ***********************************************************/
+bool JpegDecoder::ReadFrameHeader(size_t length)
+{
+	const unsigned char* pSegment = m_pData + m_position;
+
+	if ((m_bFrameRead == true) || (length < 6))
+	{
+		return(false);
+	}
+	// only 8-bit samples, and no height defined after the scan
+	if (pSegment[0] != 8)
+	{
+		return(false);
+	}
+	m_height = ReadWord(pSegment + 1);
+	m_width = ReadWord(pSegment + 3);
+	int componentCount = pSegment[5];
+	if ((m_width <= 0) || (m_height <= 0) ||
+		((componentCount != 1) && (componentCount != 3)) ||
+		(length < 6 + componentCount * 3))
+	{
+		return(false);
+	}
+
+	m_components.clear();
+	m_maxHorizontalSampling = 1;
+	m_maxVerticalSampling = 1;
+	for (int i = 0; i < componentCount; i++)
+	{
+		COMPONENT component;
+		component.id = pSegment[6 + i * 3];
+		component.horizontalSampling = pSegment[7 + i * 3] >> 4;
+		component.verticalSampling = pSegment[7 + i * 3] & 15;
+		component.quantTable = pSegment[8 + i * 3] & 3;
+		component.dcTable = 0;
+		component.acTable = 0;
+		component.dcPrediction = 0;
+		component.sampleStride = 0;
+		component.sampleRows = 0;
+		if ((component.horizontalSampling < 1) || (component.horizontalSampling > 4) ||
+			(component.verticalSampling < 1) || (component.verticalSampling > 4))
+		{
+			return(false);
+		}
+		// a single component is always coded block by block
+		if (componentCount == 1)
+		{
+			component.horizontalSampling = 1;
+			component.verticalSampling = 1;
+		}
+		m_maxHorizontalSampling = std::max(m_maxHorizontalSampling, component.horizontalSampling);
+		m_maxVerticalSampling = std::max(m_maxVerticalSampling, component.verticalSampling);
+		m_components.push_back(component);
+	}
+
+	// the samples cover whole coding units, at the reduced size
+	if (m_blockSize > 0)
+	{
+		int unitsX = (m_width + 8 * m_maxHorizontalSampling - 1) / (8 * m_maxHorizontalSampling);
+		int unitsY = (m_height + 8 * m_maxVerticalSampling - 1) / (8 * m_maxVerticalSampling);
+		for (int i = 0; i < m_components.size(); i++)
+		{
+			COMPONENT& component = m_components[i];
+			component.sampleStride = unitsX * component.horizontalSampling * m_blockSize;
+			component.sampleRows = unitsY * component.verticalSampling * m_blockSize;
+			component.samples.assign((size_t)component.sampleStride * component.sampleRows, 128);
+		}
+	}
+
+	m_bFrameRead = true;
+	return(true);
+}
+
+/***********************************************************
+ *  ReadHuffmanTables()
+ *
+ *  This method is used for reading the Huffman tables of a
+ *  segment, and building the code ranges and the lookup
+ *  table of the short codes for each.
+ ***********************************************************/
+bool JpegDecoder::ReadHuffmanTables(size_t length)
+{
+	const unsigned char* pSegment = m_pData + m_position;
+	size_t offset = 0;
+
+	while (offset + 17 <= length)
+	{
+		int tableClass = pSegment[offset] >> 4;
+		int tableIndex = pSegment[offset] & 15;
+		if ((tableClass > 1) || (tableIndex > 3))
+		{
+			return(false);
+		}
+		const unsigned char* pCounts = pSegment + offset + 1;
+		int valueCount = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			valueCount += pCounts[i];
+		}
+		if ((valueCount > 256) || (offset + 17 + valueCount > length))
+		{
+			return(false);
+		}
+
+		HUFFMAN_TABLE& table = (tableClass == 0) ? m_dcTables[tableIndex] : m_acTables[tableIndex];
+		memset(&table, 0, sizeof(HUFFMAN_TABLE));
+		memcpy(table.values, pSegment + offset + 17, valueCount);
+
+		// the codes of each length follow on from the shorter ones
+		int code = 0;
+		int valueIndex = 0;
+		for (int codeLength = 1; codeLength <= 16; codeLength++)
+		{
+			int count = pCounts[codeLength - 1];
+			// the codes of a length must fit in that many bits,
+			// or the lookup and the decoding would run past the table
+			if (code + count > (1 << codeLength))
+			{
+				return(false);
+			}
+			table.valuePointer[codeLength] = valueIndex;
+			table.minCode[codeLength] = code;
+			table.maxCode[codeLength] = (count > 0) ? code + count - 1 : -1;
+
+			if (codeLength <= g_LookupBits)
+			{
+				for (int i = 0; i < count; i++)
+				{
+					int shift = g_LookupBits - codeLength;
+					int first = (code + i) << shift;
+					uint16_t entry = (uint16_t)((codeLength << 8) | table.values[valueIndex + i]);
+					for (int j = 0; j < (1 << shift); j++)
+					{
+						table.lookup[first + j] = entry;
+					}
+				}
+			}
+
+			code = (code + count) << 1;
+			valueIndex += count;
+		}
+		table.maxCode[17] = 0x7FFFFFFF;
+		table.bDefined = true;
+
+		offset += 17 + valueCount;
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  ReadQuantTables()
+ *
+ *  This method is used for reading the quantization tables
+ *  of a segment, in the natural order of the block.
+ ***********************************************************/
+bool JpegDecoder::ReadQuantTables(size_t length)
+{
+	const unsigned char* pSegment = m_pData + m_position;
+	size_t offset = 0;
+
+	while (offset < length)
+	{
+		int precision = pSegment[offset] >> 4;
+		int tableIndex = pSegment[offset] & 3;
+		size_t tableSize = (precision == 0) ? 64 : 128;
+		if (offset + 1 + tableSize > length)
+		{
+			return(false);
+		}
+
+		for (int i = 0; i < 64; i++)
+		{
+			const unsigned char* pValue = pSegment + offset + 1 + i * (precision + 1);
+			m_quantTables[tableIndex][g_ZigZag[i]] =
+				(uint16_t)((precision == 0) ? pValue[0] : ReadWord(pValue));
+		}
+		offset += 1 + tableSize;
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  ReadScan()
+ *
+ *  This method is used for reading a scan header and then
+ *  decoding the blocks of the scan - a scan of one
+ *  component goes through its blocks in rows, and a scan of
+ *  several goes through the coding units that hold the
+ *  blocks of each of them.
+ ***********************************************************/
+bool JpegDecoder::ReadScan(size_t length)
+{
+	const unsigned char* pSegment = m_pData + m_position;
+	std::vector<int> scanComponents;
+
+	if (length < 1)
+	{
+		return(false);
+	}
+	int componentCount = pSegment[0];
+	if ((componentCount < 1) || (componentCount > 4) || (length < 4 + componentCount * 2))
+	{
+		return(false);
+	}
+	for (int i = 0; i < componentCount; i++)
+	{
+		int id = pSegment[1 + i * 2];
+		int tables = pSegment[2 + i * 2];
+		int index = -1;
+		for (int j = 0; j < m_components.size(); j++)
+		{
+			if (m_components[j].id == id)
+			{
+				index = j;
+			}
+		}
+		if (index < 0)
+		{
+			return(false);
+		}
+		m_components[index].dcTable = (tables >> 4) & 3;
+		m_components[index].acTable = tables & 3;
+		m_components[index].dcPrediction = 0;
+		scanComponents.push_back(index);
+	}
+	m_position += length;
+	ResetBits();
+
+	if (scanComponents.size() == 1)
+	{
+		COMPONENT& component = m_components[scanComponents[0]];
+		int componentWidth = (m_width * component.horizontalSampling + m_maxHorizontalSampling - 1) / m_maxHorizontalSampling;
+		int componentHeight = (m_height * component.verticalSampling + m_maxVerticalSampling - 1) / m_maxVerticalSampling;
+		int blocksX = (componentWidth + 7) / 8;
+		int blocksY = (componentHeight + 7) / 8;
+		for (int i = 0; i < blocksX * blocksY; i++)
+		{
+			if ((m_restartInterval > 0) && (i > 0) && ((i % m_restartInterval) == 0))
+			{
+				if (ReadRestartMarker() == false)
+				{
+					return(true);
+				}
+			}
+			if (DecodeBlock(component, i % blocksX, i / blocksX) == false)
+			{
+				return(false);
+			}
+		}
+		return(true);
+	}
+
+	int unitsX = (m_width + 8 * m_maxHorizontalSampling - 1) / (8 * m_maxHorizontalSampling);
+	int unitsY = (m_height + 8 * m_maxVerticalSampling - 1) / (8 * m_maxVerticalSampling);
+	for (int i = 0; i < unitsX * unitsY; i++)
+	{
+		if ((m_restartInterval > 0) && (i > 0) && ((i % m_restartInterval) == 0))
+		{
+			if (ReadRestartMarker() == false)
+			{
+				return(true);
+			}
+		}
+
+		int unitX = i % unitsX;
+		int unitY = i / unitsX;
+		for (int c = 0; c < scanComponents.size(); c++)
+		{
+			COMPONENT& component = m_components[scanComponents[c]];
+			for (int v = 0; v < component.verticalSampling; v++)
+			{
+				for (int h = 0; h < component.horizontalSampling; h++)
+				{
+					if (DecodeBlock(
+						component,
+						unitX * component.horizontalSampling + h,
+						unitY * component.verticalSampling + v) == false)
+					{
+						return(false);
+					}
+				}
+			}
+		}
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  ResetBits()
+ *
+ *  This method is used for dropping the bits read ahead, at
+ *  the start of a scan and at each restart marker.
+ ***********************************************************/
+void JpegDecoder::ResetBits()
+{
+	m_bitBuffer = 0;
+	m_bitCount = 0;
+	m_bHitMarker = false;
+}
+
+/***********************************************************
+ *  NextByte()
+ *
+ *  This method is used for reading the next byte of coded
+ *  data, skipping the zero stuffed after each 0xFF.  At a
+ *  marker the position stays put and zeros are returned.
+ ***********************************************************/
+int JpegDecoder::NextByte()
+{
+	if ((m_bHitMarker == true) || (m_position >= m_size))
+	{
+		return(0);
+	}
+
+	int value = m_pData[m_position];
+	if (value == 0xFF)
+	{
+		int next = (m_position + 1 < m_size) ? m_pData[m_position + 1] : 0xD9;
+		if (next != 0x00)
+		{
+			m_bHitMarker = true;
+			return(0);
+		}
+		m_position++;
+	}
+	m_position++;
+
+	return(value);
+}
+
+/***********************************************************
+ *  FillBits()
+ *
+ *  This method is used for reading ahead until there are
+ *  more bits than the longest code and value need.
+ ***********************************************************/
+void JpegDecoder::FillBits()
+{
+	while (m_bitCount <= 24)
+	{
+		m_bitBuffer |= (uint32_t)NextByte() << (24 - m_bitCount);
+		m_bitCount += 8;
+	}
+}
+
+/***********************************************************
+ *  ReadBits()
+ *
+ *  This method is used for reading up to 16 bits as an
+ *  unsigned value.
+ ***********************************************************/
+int JpegDecoder::ReadBits(int count)
+{
+	if (count <= 0)
+	{
+		return(0);
+	}
+
+	FillBits();
+	int value = (int)(m_bitBuffer >> (32 - count));
+	m_bitBuffer <<= count;
+	m_bitCount -= count;
+
+	return(value);
+}
+
+/***********************************************************
+ *  DecodeHuffman()
+ *
+ *  This method is used for decoding one Huffman coded
+ *  value - short codes with one lookup, and longer codes
+ *  by comparing them with the last code of each length.
+ *  Returns -1 for a code that is not in the table.
+ ***********************************************************/
+int JpegDecoder::DecodeHuffman(const HUFFMAN_TABLE& table)
+{
+	FillBits();
+
+	int entry = table.lookup[m_bitBuffer >> (32 - g_LookupBits)];
+	if (entry != 0)
+	{
+		int codeLength = entry >> 8;
+		m_bitBuffer <<= codeLength;
+		m_bitCount -= codeLength;
+		return(entry & 255);
+	}
+
+	for (int codeLength = g_LookupBits + 1; codeLength <= 16; codeLength++)
+	{
+		int code = (int)(m_bitBuffer >> (32 - codeLength));
+		if (code <= table.maxCode[codeLength])
+		{
+			m_bitBuffer <<= codeLength;
+			m_bitCount -= codeLength;
+			return(table.values[table.valuePointer[codeLength] + code - table.minCode[codeLength]]);
+		}
+	}
+
+	return(-1);
+}
+
+/***********************************************************
+ *  ReadRestartMarker()
+ *
+ *  This method is used for stepping over a restart marker,
+ *  after which the coded data starts on a new byte and the
+ *  DC predictions start again from zero.
+ ***********************************************************/
+bool JpegDecoder::ReadRestartMarker()
+{
+	ResetBits();
+	while (m_position + 1 < m_size)
+	{
+		if ((m_pData[m_position] == 0xFF) &&
+			(m_pData[m_position + 1] >= 0xD0) && (m_pData[m_position + 1] <= 0xD7))
+		{
+			m_position += 2;
+			for (int i = 0; i < m_components.size(); i++)
+			{
+				m_components[i].dcPrediction = 0;
+			}
+			return(true);
+		}
+		// any other marker ends the scan early
+		if ((m_pData[m_position] == 0xFF) &&
+			(m_pData[m_position + 1] != 0x00) && (m_pData[m_position + 1] != 0xFF))
+		{
+			return(false);
+		}
+		m_position++;
+	}
+
+	return(false);
+}
+
+/***********************************************************
+ *  DecodeBlock()
+ *
+ *  This method is used for decoding one 8x8 block into the
+ *  samples of its component.  Every coefficient has to be
+ *  decoded to find where the next block starts, but only
+ *  the frequencies that the reduced block can show are
+ *  kept and transformed.
+ ***********************************************************/
+bool JpegDecoder::DecodeBlock(COMPONENT& component, int blockX, int blockY)
+{
+	const HUFFMAN_TABLE& dcTable = m_dcTables[component.dcTable];
+	const HUFFMAN_TABLE& acTable = m_acTables[component.acTable];
+	const uint16_t* pQuant = m_quantTables[component.quantTable];
+	float coefficients[64];
+	int blockSize = m_blockSize;
+
+	if ((dcTable.bDefined == false) || (acTable.bDefined == false))
+	{
+		return(false);
+	}
+	memset(coefficients, 0, sizeof(coefficients));
+
+	int bitCount = DecodeHuffman(dcTable);
+	if ((bitCount < 0) || (bitCount > 11))
+	{
+		return(false);
+	}
+	if (bitCount > 0)
+	{
+		component.dcPrediction += Extend(ReadBits(bitCount), bitCount);
+	}
+	coefficients[0] = (float)(component.dcPrediction * pQuant[0]);
+
+	int index = 1;
+	while (index < 64)
+	{
+		int symbol = DecodeHuffman(acTable);
+		if (symbol < 0)
+		{
+			return(false);
+		}
+		int zeroRun = symbol >> 4;
+		int size = symbol & 15;
+		if (size == 0)
+		{
+			// a run of sixteen zeros, or the end of the block
+			if (zeroRun != 15)
+			{
+				break;
+			}
+			index += 16;
+			continue;
+		}
+
+		index += zeroRun;
+		if (index > 63)
+		{
+			return(false);
+		}
+		int value = Extend(ReadBits(size), size);
+		int position = g_ZigZag[index];
+		if (((position & 7) < blockSize) && ((position >> 3) < blockSize))
+		{
+			coefficients[position] = (float)(value * pQuant[position]);
+		}
+		index++;
+	}
+
+	// the separable inverse transform, rows first and then columns,
+	// on the low frequency corner of the block only
+	unsigned char* pSamples = component.samples.data() +
+		(size_t)blockY * blockSize * component.sampleStride + (size_t)blockX * blockSize;
+	if ((blockX + 1) * blockSize > component.sampleStride ||
+		(blockY + 1) * blockSize > component.sampleRows)
+	{
+		return(true);
+	}
+
+	float rows[8][8];
+	for (int v = 0; v < blockSize; v++)
+	{
+		for (int x = 0; x < blockSize; x++)
+		{
+			float sum = 0.0f;
+			for (int u = 0; u < blockSize; u++)
+			{
+				sum += coefficients[v * 8 + u] * m_transform[x][u];
+			}
+			rows[v][x] = sum;
+		}
+	}
+	for (int y = 0; y < blockSize; y++)
+	{
+		for (int x = 0; x < blockSize; x++)
+		{
+			float sum = 0.0f;
+			for (int v = 0; v < blockSize; v++)
+			{
+				sum += rows[v][x] * m_transform[y][v];
+			}
+			pSamples[(size_t)y * component.sampleStride + x] = ClampSample(sum + 128.0f);
+		}
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  BuildTransform()
+ *
+ *  This method is used for filling the weights of the
+ *  inverse transform at the output block size.  Each output
+ *  sample covers several full size samples, and the weight
+ *  of each frequency is scaled by its average over them, so
+ *  the result is the full decode box filtered down.
+ ***********************************************************/
+void JpegDecoder::BuildTransform()
+{
+	int blockSize = m_blockSize;
+	int samplesPerOutput = 8 / blockSize;
+
+	memset(m_transform, 0, sizeof(m_transform));
+	for (int u = 0; u < blockSize; u++)
+	{
+		float weight = (u == 0) ? 0.5f / std::sqrt(2.0f) : 0.5f;
+		if ((u > 0) && (samplesPerOutput > 1))
+		{
+			weight *= std::sin(samplesPerOutput * u * g_Pi / 16.0f) /
+				(samplesPerOutput * std::sin(u * g_Pi / 16.0f));
+		}
+		for (int x = 0; x < blockSize; x++)
+		{
+			m_transform[x][u] = weight * std::cos((2 * x + 1) * u * g_Pi / (2.0f * blockSize));
+		}
+	}
+}
+
+/***********************************************************
+ *  ConvertColors()
+ *
+ *  This method is used for converting the component samples
+ *  into gray or RGB pixels, taking the nearest sample of
+ *  the subsampled color components.
+ ***********************************************************/
+void JpegDecoder::ConvertColors(bool bFlipVertically, std::vector<unsigned char>& pixels, int width, int height)
+{
+	int channelCount = (m_components.size() == 1) ? 1 : 3;
+
+	pixels.resize((size_t)width * height * channelCount);
+	for (int y = 0; y < height; y++)
+	{
+		int imageRow = (bFlipVertically == true) ? (height - 1 - y) : y;
+		unsigned char* pOut = pixels.data() + (size_t)y * width * channelCount;
+
+		const unsigned char* pRows[3] = { NULL, NULL, NULL };
+		for (int c = 0; c < channelCount; c++)
+		{
+			const COMPONENT& component = m_components[c];
+			int sampleRow = imageRow * component.verticalSampling / m_maxVerticalSampling;
+			sampleRow = std::min(sampleRow, component.sampleRows - 1);
+			pRows[c] = component.samples.data() + (size_t)sampleRow * component.sampleStride;
+		}
+
+		for (int x = 0; x < width; x++)
+		{
+			int samples[3] = { 0, 0, 0 };
+			for (int c = 0; c < channelCount; c++)
+			{
+				const COMPONENT& component = m_components[c];
+				int sampleColumn = x * component.horizontalSampling / m_maxHorizontalSampling;
+				sampleColumn = std::min(sampleColumn, component.sampleStride - 1);
+				samples[c] = pRows[c][sampleColumn];
+			}
+
+			if (channelCount == 1)
+			{
+				pOut[x] = (unsigned char)samples[0];
+			}
+			else if (m_bTransformRGB == true)
+			{
+				pOut[x * 3 + 0] = (unsigned char)samples[0];
+				pOut[x * 3 + 1] = (unsigned char)samples[1];
+				pOut[x * 3 + 2] = (unsigned char)samples[2];
+			}
+			else
+			{
+				float luma = (float)samples[0];
+				float blue = (float)samples[1] - 128.0f;
+				float red = (float)samples[2] - 128.0f;
+				pOut[x * 3 + 0] = ClampSample(luma + 1.402f * red);
+				pOut[x * 3 + 1] = ClampSample(luma - 0.344136f * blue - 0.714136f * red);
+				pOut[x * 3 + 2] = ClampSample(luma + 1.772f * blue);
+			}
+		}
+	}
+}
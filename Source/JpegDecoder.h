@@ -0,0 +1,138 @@
+///////////////////////////////////////////////////////////////////////////////
+// jpegdecoder.h
+// ============
+// decode JPEG images straight to a half, quarter or eighth of their size
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  JpegDecoder
+ *
+ *  This class decodes baseline JPEG images at full size or
+ *  at 1/2, 1/4 or 1/8 of it.  The image data is stored as
+ *  8x8 blocks of frequencies, and a smaller image only needs
+ *  the lowest frequencies of each block, so each block is
+ *  turned back into 4x4, 2x2 or 1x1 pixels by a smaller
+ *  inverse transform, and at 1/8 the block's average is
+ *  the pixel.  This skips most of the transform, color
+ *  conversion and memory of a full decode, which makes it
+ *  suited to previews, low mip levels and thumbnails.  The
+ *  result matches a box filtered full decode in its low
+ *  frequencies.  Progressive and arithmetic coded images
+ *  are not supported, and are left to the full decoder.
+ ***********************************************************/
+class JpegDecoder
+{
+public:
+	// constructor
+	JpegDecoder();
+	// destructor
+	~JpegDecoder();
+
+	// check whether the data starts like a JPEG file
+	static bool IsJpeg(const unsigned char* pData, size_t size);
+	// get the number of halvings that keeps the longer side of
+	// the image at least the passed in size, at most three
+	static int ChooseScaleShift(int width, int height, int minimumSize);
+
+	// read the full size and the number of color channels,
+	// returns false when the image cannot be decoded here
+	bool ReadHeader(const unsigned char* pData, size_t size, int& width, int& height, int& colorChannels);
+	// decode the image at its size divided by two to the power
+	// of the scale shift (0 to 3), rounded up - the pixels are
+	// gray or RGB, optionally with the bottom row first
+	bool Decode(
+		const unsigned char* pData,
+		size_t size,
+		int scaleShift,
+		bool bFlipVertically,
+		std::vector<unsigned char>& pixels,
+		int& width,
+		int& height,
+		int& colorChannels);
+
+private:
+	// a Huffman table, in the form of the decoding procedure of
+	// the JPEG standard
+	struct HUFFMAN_TABLE
+	{
+		bool bDefined;
+		// the length and value of every code of up to nine bits,
+		// indexed by the next nine bits, zero for longer codes
+		uint16_t lookup[512];
+		int minCode[17];
+		int maxCode[18];
+		int valuePointer[17];
+		unsigned char values[256];
+	};
+
+	// a color component of the frame and its decoded samples
+	struct COMPONENT
+	{
+		int id;
+		int horizontalSampling;
+		int verticalSampling;
+		int quantTable;
+		int dcTable;
+		int acTable;
+		int dcPrediction;
+		std::vector<unsigned char> samples;
+		int sampleStride;
+		int sampleRows;
+	};
+
+	// the data being decoded, and the entropy coded bits that
+	// have been read ahead, starting at the highest bit
+	const unsigned char* m_pData;
+	size_t m_size;
+	size_t m_position;
+	uint32_t m_bitBuffer;
+	int m_bitCount;
+	// the coded data has run into a marker, and reads zeros
+	bool m_bHitMarker;
+
+	// the tables and the frame
+	uint16_t m_quantTables[4][64];
+	HUFFMAN_TABLE m_dcTables[4];
+	HUFFMAN_TABLE m_acTables[4];
+	int m_restartInterval;
+	int m_width;
+	int m_height;
+	bool m_bFrameRead;
+	bool m_bTransformRGB;
+	std::vector<COMPONENT> m_components;
+	int m_maxHorizontalSampling;
+	int m_maxVerticalSampling;
+
+	// the output block size and the inverse transform weights
+	// for it, one row per output sample
+	int m_blockSize;
+	float m_transform[8][8];
+
+	// read the segments up to the frame header, or to the end
+	bool ReadSegments(bool bDecodeScans);
+	bool ReadFrameHeader(size_t length);
+	bool ReadHuffmanTables(size_t length);
+	bool ReadQuantTables(size_t length);
+	bool ReadScan(size_t length);
+
+	// the entropy coded data
+	void ResetBits();
+	int NextByte();
+	void FillBits();
+	int ReadBits(int count);
+	int DecodeHuffman(const HUFFMAN_TABLE& table);
+	bool ReadRestartMarker();
+	bool DecodeBlock(COMPONENT& component, int blockX, int blockY);
+
+	// fill the weights of the scaled inverse transform
+	void BuildTransform();
+	// convert the component samples into the output pixels
+	void ConvertColors(bool bFlipVertically, std::vector<unsigned char>& pixels, int width, int height);
+};
@@ -0,0 +1,207 @@
+///////////////////////////////////////////////////////////////////////////////
+// loadscheduler.cpp
+// ============
+// resume loading coroutines on worker threads or on the OpenGL thread
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "LoadScheduler.h"
+
+#include <algorithm>
+#include <chrono>
+
+// declaration of global variables
+namespace
+{
+	// longest wait for context thread work while a task that is
+	// waited for may finish on a worker thread instead
+	const int g_ContextWaitMilliseconds = 1;
+}
+
+/***********************************************************
+ *  LoadScheduler()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+LoadScheduler::LoadScheduler()
+{
+	m_contextThread = std::this_thread::get_id();
+	m_bStop = false;
+
+	// one core is left for the context thread, but there is at
+	// least one worker, since reading files mostly waits on I/O
+	int workerCount = std::max((int)std::thread::hardware_concurrency() - 1, 1);
+	for (int i = 0; i < workerCount; i++)
+	{
+		m_workers.push_back(std::thread(&LoadScheduler::WorkerThread, this));
+	}
+}
+
+/***********************************************************
+ *  ~LoadScheduler()
+ *
+ *  The destructor for the class.  The coroutines that are
+ *  still queued are not resumed again, so the tasks that
+ *  own them can be destroyed afterwards.
+ ***********************************************************/
+LoadScheduler::~LoadScheduler()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bStop = true;
+	}
+	m_workerCondition.notify_all();
+	for (int i = 0; i < m_workers.size(); i++)
+	{
+		m_workers[i].join();
+	}
+	m_workers.clear();
+
+	m_workerQueue.clear();
+	m_contextQueue.clear();
+}
+
+/***********************************************************
+ *  await_ready()
+ *
+ *  This method is used for checking whether the awaiting
+ *  coroutine is already on the right kind of thread.
+ ***********************************************************/
+bool LoadScheduler::THREAD_SWITCH::await_ready() const
+{
+	return(pScheduler->IsContextThread() == bContextThread);
+}
+
+/***********************************************************
+ *  await_suspend()
+ *
+ *  This method is used for queueing the suspended coroutine
+ *  for the thread it is waiting for.
+ ***********************************************************/
+void LoadScheduler::THREAD_SWITCH::await_suspend(std::coroutine_handle<> handle)
+{
+	pScheduler->Schedule(handle, bContextThread);
+}
+
+/***********************************************************
+ *  RunContextWork()
+ *
+ *  This method is used for resuming the coroutines that
+ *  wait for the context thread, in the order they arrived.
+ *  It has to be called on the context thread.
+ ***********************************************************/
+int LoadScheduler::RunContextWork(int maxResumes)
+{
+	int resumeCount = 0;
+
+	if (IsContextThread() == false)
+	{
+		return(0);
+	}
+
+	while (resumeCount < maxResumes)
+	{
+		std::coroutine_handle<> handle;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_contextQueue.size() == 0)
+			{
+				break;
+			}
+			handle = m_contextQueue.front();
+			m_contextQueue.pop_front();
+		}
+
+		handle.resume();
+		resumeCount++;
+	}
+
+	return(resumeCount);
+}
+
+/***********************************************************
+ *  GetContextWorkCount()
+ *
+ *  This method is used for getting the number of coroutines
+ *  that wait for the context thread.
+ ***********************************************************/
+int LoadScheduler::GetContextWorkCount()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return((int)m_contextQueue.size());
+}
+
+/***********************************************************
+ *  Schedule()
+ *
+ *  This method is used for queueing a suspended coroutine
+ *  to be resumed by a worker or by the context thread.
+ ***********************************************************/
+void LoadScheduler::Schedule(std::coroutine_handle<> handle, bool bContextThread)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (bContextThread == true)
+		{
+			m_contextQueue.push_back(handle);
+		}
+		else
+		{
+			m_workerQueue.push_back(handle);
+		}
+	}
+
+	if (bContextThread == true)
+	{
+		m_contextCondition.notify_one();
+	}
+	else
+	{
+		m_workerCondition.notify_one();
+	}
+}
+
+/***********************************************************
+ *  WaitForContextWork()
+ *
+ *  This method is used for blocking the context thread
+ *  until a coroutine is queued for it, or a short time has
+ *  passed.
+ ***********************************************************/
+void LoadScheduler::WaitForContextWork()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	if (m_contextQueue.size() == 0)
+	{
+		m_contextCondition.wait_for(lock, std::chrono::milliseconds(g_ContextWaitMilliseconds));
+	}
+}
+
+/***********************************************************
+ *  WorkerThread()
+ *
+ *  This method is run on each worker thread.  It resumes
+ *  the coroutines queued for the workers until stopped.
+ ***********************************************************/
+void LoadScheduler::WorkerThread()
+{
+	while (true)
+	{
+		std::coroutine_handle<> handle;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			while ((m_workerQueue.size() == 0) && (m_bStop == false))
+			{
+				m_workerCondition.wait(lock);
+			}
+			if (m_bStop == true)
+			{
+				return;
+			}
+			handle = m_workerQueue.front();
+			m_workerQueue.pop_front();
+		}
+
+		handle.resume();
+	}
+}
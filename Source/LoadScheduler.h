@@ -0,0 +1,104 @@
+///////////////////////////////////////////////////////////////////////////////
+// loadscheduler.h
+// ============
+// resume loading coroutines on worker threads or on the OpenGL thread
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "LoadTask.h"
+
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  LoadScheduler
+ *
+ *  This class moves loading coroutines between threads.  A
+ *  coroutine awaits OnWorker() before it reads or decodes
+ *  files, and is resumed by one of the worker threads, and
+ *  awaits OnContext() before it calls OpenGL, and is resumed
+ *  by the thread that owns the context.  That thread is the
+ *  one that creates the scheduler, and it resumes a limited
+ *  number of coroutines each time it calls RunContextWork()
+ *  from the render loop, so loading never stalls a frame.
+ *  A coroutine that is already on the right thread carries
+ *  on without suspending.
+ ***********************************************************/
+class LoadScheduler
+{
+public:
+	// constructor - the calling thread becomes the context thread
+	LoadScheduler();
+	// destructor
+	~LoadScheduler();
+
+	// the awaitable that moves a coroutine to a thread
+	struct THREAD_SWITCH
+	{
+		LoadScheduler* pScheduler;
+		bool bContextThread;
+
+		bool await_ready() const;
+		void await_suspend(std::coroutine_handle<> handle);
+		void await_resume() {}
+	};
+
+	// continue the awaiting coroutine on a worker thread
+	THREAD_SWITCH OnWorker() { return(THREAD_SWITCH{ this, false }); }
+	// continue the awaiting coroutine on the context thread
+	THREAD_SWITCH OnContext() { return(THREAD_SWITCH{ this, true }); }
+
+	// resume at most the passed in number of coroutines waiting
+	// for the context thread, returns how many were resumed
+	int RunContextWork(int maxResumes);
+	// resume the coroutines waiting for the context thread until
+	// the passed in task has finished, for loads that have to be
+	// complete before the caller can carry on
+	template <typename T>
+	T& RunUntilDone(LoadTask<T>& task)
+	{
+		task.Start();
+		while (task.IsDone() == false)
+		{
+			WaitForContextWork();
+			RunContextWork(1);
+		}
+		return(task.GetResult());
+	}
+
+	// queue a suspended coroutine for a worker thread, for the
+	// awaitables that finish on threads of their own
+	void ResumeOnWorker(std::coroutine_handle<> handle) { Schedule(handle, false); }
+
+	// check whether the calling thread is the context thread
+	bool IsContextThread() const { return(std::this_thread::get_id() == m_contextThread); }
+	// get the number of coroutines waiting for the context thread
+	int GetContextWorkCount();
+
+private:
+	std::thread::id m_contextThread;
+	std::vector<std::thread> m_workers;
+
+	// the suspended coroutines, by the thread they wait for, and
+	// the lock and signals shared with the worker threads
+	std::mutex m_mutex;
+	std::condition_variable m_workerCondition;
+	std::condition_variable m_contextCondition;
+	std::deque<std::coroutine_handle<>> m_workerQueue;
+	std::deque<std::coroutine_handle<>> m_contextQueue;
+	bool m_bStop;
+
+	// queue a suspended coroutine for a thread
+	void Schedule(std::coroutine_handle<> handle, bool bContextThread);
+	// wait until a coroutine is queued for the context thread, or
+	// briefly, since a task can also finish on a worker thread
+	void WaitForContextWork();
+	// resume coroutines queued for the workers until stopped
+	void WorkerThread();
+};
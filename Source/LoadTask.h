@@ -0,0 +1,167 @@
+///////////////////////////////////////////////////////////////////////////////
+// loadtask.h
+// ============
+// coroutine type for loading code that suspends between threads
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <utility>
+
+/***********************************************************
+ *  LoadTask
+ *
+ *  This template is the return type of the loading
+ *  coroutines.  A task does not run until it is started or
+ *  awaited, so several can be started at once and awaited
+ *  one after another, and they run concurrently whenever
+ *  they suspend to switch threads.  When a task finishes,
+ *  the coroutine that awaits it resumes right away on the
+ *  same thread.  Whether the task has finished is kept in
+ *  an atomic state, since the awaiting coroutine and the
+ *  task can be on different threads at the time.  A task
+ *  must not be destroyed while it is running, only before
+ *  it starts, after it finishes, or while it is suspended
+ *  and the scheduler that holds it has been stopped.
+ ***********************************************************/
+template <typename T>
+class LoadTask
+{
+public:
+	// the progress of a task, as seen by its awaiting coroutine
+	enum TASK_STATE
+	{
+		TASK_RUNNING,
+		TASK_AWAITED,
+		TASK_DONE
+	};
+
+	// the part of the promise that does not depend on the value
+	struct PROMISE_BASE
+	{
+		std::atomic<int> state;
+		std::coroutine_handle<> continuation;
+
+		PROMISE_BASE() : state(TASK_RUNNING) {}
+
+		std::suspend_always initial_suspend() noexcept { return {}; }
+
+		// at the end, hand over to the awaiting coroutine if it
+		// is already waiting, otherwise it sees the done state
+		struct FINAL_AWAITER
+		{
+			bool await_ready() noexcept { return(false); }
+			template <typename PROMISE>
+			std::coroutine_handle<> await_suspend(std::coroutine_handle<PROMISE> handle) noexcept
+			{
+				PROMISE_BASE& promise = handle.promise();
+				if (promise.state.exchange(TASK_DONE) == TASK_AWAITED)
+				{
+					return(promise.continuation);
+				}
+				return(std::noop_coroutine());
+			}
+			void await_resume() noexcept {}
+		};
+		FINAL_AWAITER final_suspend() noexcept { return {}; }
+
+		void unhandled_exception() { std::terminate(); }
+	};
+
+	struct promise_type : PROMISE_BASE
+	{
+		T value;
+
+		LoadTask get_return_object()
+		{
+			return(LoadTask(std::coroutine_handle<promise_type>::from_promise(*this)));
+		}
+		void return_value(T result) { value = std::move(result); }
+	};
+
+	LoadTask() : m_bStarted(false) {}
+	explicit LoadTask(std::coroutine_handle<promise_type> handle) : m_handle(handle), m_bStarted(false) {}
+	LoadTask(LoadTask&& other) noexcept : m_handle(other.m_handle), m_bStarted(other.m_bStarted)
+	{
+		other.m_handle = nullptr;
+	}
+	LoadTask& operator=(LoadTask&& other) noexcept
+	{
+		if (this != &other)
+		{
+			Destroy();
+			m_handle = other.m_handle;
+			m_bStarted = other.m_bStarted;
+			other.m_handle = nullptr;
+		}
+		return(*this);
+	}
+	LoadTask(const LoadTask&) = delete;
+	LoadTask& operator=(const LoadTask&) = delete;
+	~LoadTask() { Destroy(); }
+
+	// run the task on the calling thread until it first suspends,
+	// without waiting for it to finish
+	void Start()
+	{
+		if ((m_handle) && (m_bStarted == false))
+		{
+			m_bStarted = true;
+			m_handle.resume();
+		}
+	}
+	// check whether the task has finished - this can be polled
+	// from the thread that started the task
+	bool IsDone() const
+	{
+		return((m_handle) && (m_handle.promise().state.load() == TASK_DONE));
+	}
+	// get the result of a finished task
+	T& GetResult() { return(m_handle.promise().value); }
+
+	// awaiting a task starts it if needed, and resumes the awaiting
+	// coroutine with the result once it is done
+	struct AWAITER
+	{
+		LoadTask* pTask;
+
+		bool await_ready() const { return(pTask->IsDone()); }
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting)
+		{
+			promise_type& promise = pTask->m_handle.promise();
+			promise.continuation = awaiting;
+			if (pTask->m_bStarted == false)
+			{
+				pTask->m_bStarted = true;
+				promise.state.store(TASK_AWAITED);
+				return(pTask->m_handle);
+			}
+			// a task that finished in the meantime keeps its done state
+			int expected = TASK_RUNNING;
+			if (promise.state.compare_exchange_strong(expected, TASK_AWAITED) == false)
+			{
+				return(awaiting);
+			}
+			return(std::noop_coroutine());
+		}
+		T await_resume() { return(std::move(pTask->m_handle.promise().value)); }
+	};
+	AWAITER operator co_await() { return(AWAITER{ this }); }
+
+private:
+	std::coroutine_handle<promise_type> m_handle;
+	bool m_bStarted;
+
+	void Destroy()
+	{
+		if (m_handle)
+		{
+			m_handle.destroy();
+			m_handle = nullptr;
+		}
+	}
+};
@@ -10,9 +10,32 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include "SceneManager.h"
+#include "SceneStreamer.h"
+#include "SceneEditQueue.h"
 #include "ViewManager.h"
+#include "ResourceManager.h"
+#include "ResourceCache.h"
+#include "ShaderLibrary.h"
+#include "RenderTargetPool.h"
+#include "FrameReuse.h"
+#include "DepthPrePass.h"
+#include "TransparencyPass.h"
+#include "RenderServer.h"
+#include "EnvironmentCapture.h"
+#include "ImpostorSystem.h"
+#include "VirtualTextures.h"
+#include "GpuCulling.h"
+#include "PotentiallyVisibleSets.h"
+#include "AssetPack.h"
+#include "LoadScheduler.h"
 #include "ShapeMeshes.h"
 #include "ShaderManager.h"
+#include "StressScene.h"
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
 
 // Namespace for declaring global variables
 namespace
@@ -23,18 +46,142 @@ namespace
 	// Main GLFW window
 	GLFWwindow* g_Window = nullptr;
 
-	// scene manager object for managing the 3D scene prepare and render
-	SceneManager* g_SceneManager = nullptr;
+	// one display window with the view, the scene and the
+	// offscreen target that it shows - every scene is rendered
+	// in the main window's context, so that all of them share
+	// one set of textures, meshes and shader programs
+	struct SCENE_WINDOW
+	{
+		// view manager object for managing the 3D view setup and projection to 2D
+		ViewManager* pViewManager;
+		// scene manager object for managing the 3D scene prepare and render
+		SceneManager* pSceneManager;
+		// edits to the scene from other threads, applied once a frame
+		SceneEditQueue* pEditQueue;
+		// render target pool object for the offscreen framebuffers
+		RenderTargetPool* pRenderTargetPool;
+		// impostor system object for the distant copies of props
+		ImpostorSystem* pImpostors;
+		// GPU culling object for large numbers of mesh copies, NULL
+		// when compute programs or indirect draw counts are missing
+		GpuCulling* pGpuCulling;
+		// potentially visible sets of the scene nodes, baked for the
+		// nodes of the prepared scene, NULL when not used
+		PotentiallyVisibleSets* pVisibleSets;
+		// frame reuse object for the two offscreen targets that
+		// the scene is rendered into in turn
+		FrameReuse* pFrameReuse;
+		// depth pre-pass object for the scenes with high overdraw
+		DepthPrePass* pDepthPrePass;
+		// transparency pass object for the translucent nodes, NULL
+		// when they are blended with the opaque nodes instead
+		TransparencyPass* pTransparencyPass;
+		// scene changes that have not been rendered yet
+		bool bSceneChanged;
+	};
+	// the main window comes first, followed by the extra windows
+	std::vector<SCENE_WINDOW> g_SceneWindows;
+
 	// shader manager object for dynamic interaction with the shader code
 	ShaderManager* g_ShaderManager = nullptr;
-	// view manager object for managing the 3D view setup and projection to 2D
-	ViewManager* g_ViewManager = nullptr;
+	// resource manager object that owns the OpenGL resources
+	ResourceManager* g_ResourceManager = nullptr;
+	// resource cache object for the textures and meshes shared by the scenes
+	ResourceCache* g_ResourceCache = nullptr;
+	// shader library object for the additional shader programs
+	ShaderLibrary* g_ShaderLibrary = nullptr;
+	// virtual textures object that the large textures are paged
+	// through, when they are enabled
+	VirtualTextures* g_VirtualTextures = nullptr;
+	// asset pack object that the image and GLSL files are read
+	// from, when the pack file exists
+	AssetPack* g_AssetPack = nullptr;
+	// scheduler that moves the loading coroutines between the
+	// worker threads and this thread, which owns the context
+	LoadScheduler* g_LoadScheduler = nullptr;
+	// most coroutines resumed on this thread in one frame
+	const int g_MaxLoadResumesPerFrame = 8;
+	// the pack file that is deployed next to the application
+	const char* g_AssetPackFile = "sceneAssets.pack";
+	// the GLSL files of the main scene program
+	const char* g_VertexShaderFile = "../../Utilities/shaders/vertexShader.glsl";
+	const char* g_FragmentShaderFile = "../../Utilities/shaders/fragmentShader.glsl";
+
+	// number of extra windows that show their own copy of the
+	// scene, through the resources already loaded for the main
+	// window - each one only adds its scene nodes and a target
+	const int g_ExtraWindowCount = 0;
+
+	// length of one simulation update step, in seconds - camera
+	// movement and animations always advance by this amount
+	const double g_FixedTimeStep = 1.0 / 120.0;
+	// longest frame time that is simulated, so that a frame spike
+	// cannot cause a jump or a long catch-up of update steps
+	const double g_MaxFrameTime = 0.25;
+	// highest rate the scene is rendered at, zero for no limit -
+	// lowering this saves power without changing the simulation
+	const double g_MaxRenderRate = 0.0;
+	// when true, frames are only rendered when the view or the
+	// animated scene content has changed
+	const bool g_bRenderOnDemand = false;
+	// when true, the last frame is shown again while nothing
+	// changed, and moved to the new view for small camera moves
+	const bool g_bFrameReuse = true;
+	// whether the depth of the scene is drawn before the lit
+	// pass - in the automatic mode only while overdraw is high
+	const DepthPrePass::PREPASS_MODE g_DepthPrePassMode = DepthPrePass::PREPASS_AUTO;
+	// when true, the camera view only draws the scene nodes that
+	// can be seen from the cell it is in - the sets are baked on
+	// the first start and kept in the passed in file
+	const bool g_bVisibleSets = true;
+	const char* g_VisibleSetsFile = "sceneVisibleSets.pvs";
+	// size of the view cells that the sets are baked for
+	const float g_VisibleSetCellSize = 2.0f;
+	// when true, the textures larger than one page are paged
+	// into a fixed cache by what the main window samples, for
+	// scenes whose textures do not fit into video memory
+	const bool g_bVirtualTextures = false;
+	// longest time the render server waits for a request before
+	// it checks the window events again, in seconds
+	const double g_ServerPollTime = 0.1;
+
+	// one sweep of the benchmark - generated scenes of growing
+	// object counts, with the other parameters fixed
+	struct BENCHMARK_SWEEP
+	{
+		const char* name;
+		StressScene::DISTRIBUTION distribution;
+		int materialCount;
+		int textureCount;
+		int lightCount;
+		bool bGpuInstances;
+	};
+	const BENCHMARK_SWEEP g_BenchmarkSweeps[] =
+	{
+		{ "uniform", StressScene::DISTRIBUTION_UNIFORM, 8, 4, 4, false },
+		{ "clustered", StressScene::DISTRIBUTION_CLUSTERED, 8, 4, 4, false },
+		{ "grid", StressScene::DISTRIBUTION_GRID, 8, 4, 4, false },
+		{ "untextured", StressScene::DISTRIBUTION_UNIFORM, 1, 0, 1, false },
+		{ "many materials", StressScene::DISTRIBUTION_UNIFORM, 64, 8, 4, false },
+		{ "gpu instances", StressScene::DISTRIBUTION_UNIFORM, 8, 4, 4, true }
+	};
+	const int g_BenchmarkObjectCounts[] = { 100, 300, 1000, 3000, 10000, 30000, 100000 };
+	// frames drawn before each scene is measured, and measured
+	const int g_BenchmarkWarmupFrames = 10;
+	const int g_BenchmarkFrames = 60;
+	// a sweep stops at the first scene with a frame longer than
+	// this, in seconds, since the larger ones only take longer
+	const double g_BenchmarkFrameLimit = 0.25;
 }
 
 // Function declarations - all functions that are called manually
 // need to be pre-declared at the beginning of the source code.
 bool InitializeGLFW();
 bool InitializeGLEW();
+bool CreateSceneWindow(ViewManager* pViewManager, GLuint multiViewProgram);
+bool RenderSceneWindow(SCENE_WINDOW& sceneWindow, float interpolation);
+bool RunRenderServer(const char* socketPath);
+bool RunBenchmark(const char* resultsPath);
 
 
 /***********************************************************
@@ -45,6 +192,31 @@ bool InitializeGLEW();
  ***********************************************************/
 int main(int argc, char* argv[])
 {
+	// "--render-server <socket path>" renders images for the
+	// clients of a local socket instead of showing the window
+	const char* renderServerPath = NULL;
+	// "--cook-pack <pack path>" loads the scene from the loose
+	// files and writes every file it read into a new asset pack
+	const char* cookPackPath = NULL;
+	// "--benchmark <results path>" draws generated scenes of
+	// growing sizes and writes how long their frames took
+	const char* benchmarkPath = NULL;
+	for (int i = 1; i < argc - 1; i++)
+	{
+		if (std::string(argv[i]).compare("--render-server") == 0)
+		{
+			renderServerPath = argv[i + 1];
+		}
+		else if (std::string(argv[i]).compare("--cook-pack") == 0)
+		{
+			cookPackPath = argv[i + 1];
+		}
+		else if (std::string(argv[i]).compare("--benchmark") == 0)
+		{
+			benchmarkPath = argv[i + 1];
+		}
+	}
+
 	// if GLFW fails initialization, then terminate the application
 	if (InitializeGLFW() == false)
 	{
@@ -54,11 +226,11 @@ int main(int argc, char* argv[])
 	// try to create a new shader manager object
 	g_ShaderManager = new ShaderManager();
 	// try to create a new view manager object
-	g_ViewManager = new ViewManager(
+	ViewManager* pMainViewManager = new ViewManager(
 		g_ShaderManager);
 
 	// try to create the main display window
-	g_Window = g_ViewManager->CreateDisplayWindow(WINDOW_TITLE);
+	g_Window = pMainViewManager->CreateDisplayWindow(WINDOW_TITLE);
 
 	// if GLEW fails initialization, then terminate the application
 	if (InitializeGLEW() == false)
@@ -66,52 +238,273 @@ int main(int argc, char* argv[])
 		return(EXIT_FAILURE);
 	}
 
-	// load the shader code from the external GLSL files
-	g_ShaderManager->LoadShaders(
-		"../../Utilities/shaders/vertexShader.glsl",
-		"../../Utilities/shaders/fragmentShader.glsl");
+	// the files are read from the asset pack when there is one,
+	// while cooking a new pack they are all read from disk
+	g_AssetPack = new AssetPack();
+	if (NULL == cookPackPath)
+	{
+		g_AssetPack->Open(g_AssetPackFile);
+	}
+
+	// try to create a new resource manager object for the OpenGL resources
+	g_ResourceManager = new ResourceManager();
+	// try to create a new resource cache object shared by the scenes
+	g_ResourceCache = new ResourceCache(g_ResourceManager);
+	g_ResourceCache->SetAssetPack(g_AssetPack);
+	g_ShaderLibrary = new ShaderLibrary(g_ResourceManager);
+	g_ShaderLibrary->SetAssetPack(g_AssetPack);
+	g_LoadScheduler = new LoadScheduler();
+
+	// load the shader code of the main program - from the asset
+	// pack when it has the GLSL files, otherwise from the files
+	AssetPack::ASSET vertexShaderAsset;
+	AssetPack::ASSET fragmentShaderAsset;
+	if ((g_AssetPack->Find(g_VertexShaderFile, vertexShaderAsset) == true) &&
+		(g_AssetPack->Find(g_FragmentShaderFile, fragmentShaderAsset) == true))
+	{
+		g_ShaderManager->m_programID = g_ShaderLibrary->LoadProgram(
+			g_VertexShaderFile,
+			NULL,
+			g_FragmentShaderFile);
+	}
+	else
+	{
+		g_ShaderManager->LoadShaders(g_VertexShaderFile, g_FragmentShaderFile);
+		g_AssetPack->RecordFileRead(g_VertexShaderFile);
+		g_AssetPack->RecordFileRead(g_FragmentShaderFile);
+	}
 	g_ShaderManager->use();
 
-	// try to create a new scene manager object and prepare the 3D scene
-	g_SceneManager = new SceneManager(g_ShaderManager);
-	g_SceneManager->PrepareScene();
+	// viewport arrays let the split view layout draw all of its
+	// views in one pass, otherwise each view is drawn separately
+	GLuint multiViewProgram = 0;
+	if (GLEW_ARB_viewport_array)
+	{
+		multiViewProgram = g_ShaderLibrary->LoadProgram(
+			"../../Utilities/shaders/multiViewVertexShader.glsl",
+			"../../Utilities/shaders/multiViewGeometryShader.glsl",
+			g_FragmentShaderFile);
+	}
+
+	// the large textures are paged before any scene loads them
+	if ((g_bVirtualTextures == true) && (VirtualTextures::IsSupported() == true))
+	{
+		g_VirtualTextures = new VirtualTextures(g_ShaderManager, g_ShaderLibrary, g_ResourceManager);
+		if (g_VirtualTextures->Initialize(multiViewProgram != 0) == true)
+		{
+			g_ResourceCache->SetVirtualTextures(g_VirtualTextures);
+		}
+		else
+		{
+			delete g_VirtualTextures;
+			g_VirtualTextures = NULL;
+		}
+	}
+
+	// prepare the 3D scene for the main window
+	CreateSceneWindow(pMainViewManager, multiViewProgram);
+
+	// the extra windows share the main window's OpenGL objects
+	for (int i = 0; i < g_ExtraWindowCount; i++)
+	{
+		ViewManager* pViewManager = new ViewManager(g_ShaderManager);
+		if (NULL == pViewManager->CreateDisplayWindow(WINDOW_TITLE, g_Window))
+		{
+			delete pViewManager;
+			break;
+		}
+		CreateSceneWindow(pViewManager, multiViewProgram);
+	}
+
+	// once the scenes are loaded, every file they read is known
+	if (NULL != cookPackPath)
+	{
+		g_AssetPack->Cook(cookPackPath);
+		glfwSetWindowShouldClose(g_Window, GLFW_TRUE);
+	}
+
+	// in render server mode the interactive loop is skipped
+	if (NULL != renderServerPath)
+	{
+		RunRenderServer(renderServerPath);
+		glfwSetWindowShouldClose(g_Window, GLFW_TRUE);
+	}
+
+	// and in benchmark mode
+	if (NULL != benchmarkPath)
+	{
+		RunBenchmark(benchmarkPath);
+		glfwSetWindowShouldClose(g_Window, GLFW_TRUE);
+	}
+
+	// timing state for the fixed-timestep update loop
+	double previousTime = glfwGetTime();
+	double lastRenderTime = 0.0;
+	double accumulator = 0.0;
+	double simulationTime = 0.0;
 
 	// loop will keep running until the application is closed 
 	// or until an error has occurred
 	while (!glfwWindowShouldClose(g_Window))
 	{
-		// Enable z-depth
-		glEnable(GL_DEPTH_TEST);
+		double currentTime = glfwGetTime();
+		double frameTime = currentTime - previousTime;
+		previousTime = currentTime;
 
-		// Clear the frame and z buffers
-		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		// clamp long frames instead of simulating all of them
+		if (frameTime > g_MaxFrameTime)
+		{
+			frameTime = g_MaxFrameTime;
+		}
+		accumulator += frameTime;
 
-		// convert from 3D object space to 2D view
-		g_ViewManager->PrepareSceneView();
+		// advance the cameras and animations in fixed steps
+		while (accumulator >= g_FixedTimeStep)
+		{
+			simulationTime += g_FixedTimeStep;
+			for (int i = 0; i < g_SceneWindows.size(); i++)
+			{
+				g_SceneWindows[i].pViewManager->UpdateView((float)g_FixedTimeStep);
+				g_SceneWindows[i].pSceneManager->UpdateAnimations((float)simulationTime);
+			}
+			accumulator -= g_FixedTimeStep;
+		}
 
-		// refresh the 3D scene
-		g_SceneManager->RenderScene();
+		// carry on the loading coroutines that wait for the context
+		g_LoadScheduler->RunContextWork(g_MaxLoadResumesPerFrame);
 
+		// fraction of the next step that has already elapsed,
+		// used to blend the rendered state between two steps
+		float interpolation = (float)(accumulator / g_FixedTimeStep);
 
-		// Flips the the back buffer with the front buffer every frame.
-		glfwSwapBuffers(g_Window);
+		// apply the edits queued by other threads, write the
+		// blended animation state into the scene nodes, stream the
+		// objects around each camera and switch the distant props
+		// to impostors - all before any scene is culled
+		for (int i = 0; i < g_SceneWindows.size(); i++)
+		{
+			if (g_SceneWindows[i].pEditQueue->ApplyEdits(g_SceneWindows[i].pSceneManager) > 0)
+			{
+				g_SceneWindows[i].bSceneChanged = true;
+			}
+			if (g_SceneWindows[i].pSceneManager->ApplyAnimations(interpolation) == true)
+			{
+				g_SceneWindows[i].bSceneChanged = true;
+			}
+			if (g_SceneWindows[i].pSceneManager->UpdateStreaming(
+				g_SceneWindows[i].pViewManager->GetCameraPosition()) == true)
+			{
+				g_SceneWindows[i].bSceneChanged = true;
+			}
+			if (g_SceneWindows[i].pImpostors->Update(
+				g_SceneWindows[i].pViewManager->GetCameraPosition()) == true)
+			{
+				g_SceneWindows[i].bSceneChanged = true;
+			}
+		}
+
+		// render every window that needs a new frame, unless the
+		// render rate is being limited
+		bool bRendered = false;
+		if ((g_MaxRenderRate <= 0.0) ||
+			(currentTime - lastRenderTime >= 1.0 / g_MaxRenderRate))
+		{
+			for (int i = 0; i < g_SceneWindows.size(); i++)
+			{
+				if (RenderSceneWindow(g_SceneWindows[i], interpolation) == true)
+				{
+					bRendered = true;
+				}
+			}
+		}
+
+		if (bRendered == false)
+		{
+			// sleep until the next update step is due or until
+			// new events arrive, instead of spinning
+			glfwWaitEventsTimeout(g_FixedTimeStep);
+			continue;
+		}
+		lastRenderTime = currentTime;
+
+		// delete the released resources the GPU has finished with
+		for (int i = 0; i < g_SceneWindows.size(); i++)
+		{
+			g_SceneWindows[i].pRenderTargetPool->EndFrame();
+		}
+		g_ResourceManager->EndFrame();
 
 		// query the latest GLFW events
 		glfwPollEvents();
 	}
 
+	// stop the loading coroutines before the scenes they load,
+	// once the streamed textures in flight have arrived
+	for (int i = 0; i < g_SceneWindows.size(); i++)
+	{
+		g_SceneWindows[i].pSceneManager->GetStreamer()->FinishTextureLoads();
+	}
+	if (NULL != g_LoadScheduler)
+	{
+		delete g_LoadScheduler;
+		g_LoadScheduler = NULL;
+	}
+
 	// clear the allocated manager objects from memory
-	if (NULL != g_SceneManager)
+	for (int i = 0; i < g_SceneWindows.size(); i++)
+	{
+		delete g_SceneWindows[i].pImpostors;
+		if (NULL != g_SceneWindows[i].pGpuCulling)
+		{
+			delete g_SceneWindows[i].pGpuCulling;
+		}
+		if (NULL != g_SceneWindows[i].pVisibleSets)
+		{
+			delete g_SceneWindows[i].pVisibleSets;
+		}
+		delete g_SceneWindows[i].pEditQueue;
+		delete g_SceneWindows[i].pSceneManager;
+		delete g_SceneWindows[i].pFrameReuse;
+		delete g_SceneWindows[i].pDepthPrePass;
+		if (NULL != g_SceneWindows[i].pTransparencyPass)
+		{
+			delete g_SceneWindows[i].pTransparencyPass;
+		}
+		delete g_SceneWindows[i].pRenderTargetPool;
+	}
+	if (NULL != g_ResourceCache)
+	{
+		delete g_ResourceCache;
+		g_ResourceCache = NULL;
+	}
+	if (NULL != g_VirtualTextures)
+	{
+		delete g_VirtualTextures;
+		g_VirtualTextures = NULL;
+	}
+	if (NULL != g_ShaderLibrary)
+	{
+		delete g_ShaderLibrary;
+		g_ShaderLibrary = NULL;
+	}
+	if (NULL != g_ResourceManager)
 	{
-		delete g_SceneManager;
-		g_SceneManager = NULL;
+		// anything still live here was not released by its owner
+		g_ResourceManager->ReportLiveResources();
+		delete g_ResourceManager;
+		g_ResourceManager = NULL;
 	}
-	if (NULL != g_ViewManager)
+	// the pack is unmapped once nothing reads from it
+	if (NULL != g_AssetPack)
 	{
-		delete g_ViewManager;
-		g_ViewManager = NULL;
+		delete g_AssetPack;
+		g_AssetPack = NULL;
 	}
+	for (int i = 0; i < g_SceneWindows.size(); i++)
+	{
+		delete g_SceneWindows[i].pViewManager;
+	}
+	g_SceneWindows.clear();
 	if (NULL != g_ShaderManager)
 	{
 		delete g_ShaderManager;
@@ -122,6 +515,343 @@ int main(int argc, char* argv[])
 	exit(EXIT_SUCCESS); 
 }
 
+/***********************************************************
+ *  CreateSceneWindow()
+ *
+ *  This function is used to prepare a 3D scene and an
+ *  offscreen target for a view whose window is created.
+ *  The scene takes its textures and meshes from the shared
+ *  resource cache, so only the first scene loads them.  The
+ *  extra windows are prepared by the loading coroutines,
+ *  which find most of their resources already cached.
+ ***********************************************************/
+bool CreateSceneWindow(ViewManager* pViewManager, GLuint multiViewProgram)
+{
+	SCENE_WINDOW sceneWindow;
+
+	pViewManager->SetMultiViewProgram(multiViewProgram);
+	sceneWindow.pViewManager = pViewManager;
+
+	// try to create a new scene manager object and prepare the 3D scene
+	sceneWindow.pSceneManager = new SceneManager(g_ShaderManager, g_ResourceCache);
+	sceneWindow.pEditQueue = new SceneEditQueue();
+	if (pViewManager->GetWindow() == g_Window)
+	{
+		sceneWindow.pSceneManager->PrepareScene();
+	}
+	else
+	{
+		LoadTask<bool> sceneLoad = sceneWindow.pSceneManager->PrepareSceneAsync(g_LoadScheduler);
+		g_LoadScheduler->RunUntilDone(sceneLoad);
+	}
+	// the objects around the table are streamed in as the camera
+	// moves towards them, their textures loaded by coroutines
+	// that the render loop carries on
+	sceneWindow.pSceneManager->GetStreamer()->SetLoadScheduler(g_LoadScheduler);
+	sceneWindow.pSceneManager->DefineStreamedObjects();
+
+	// the visible sets cover the nodes of the prepared scene, any
+	// nodes that are added later are always drawn
+	sceneWindow.pVisibleSets = NULL;
+	if (g_bVisibleSets == true)
+	{
+		sceneWindow.pVisibleSets = new PotentiallyVisibleSets();
+		if (sceneWindow.pVisibleSets->Load(g_VisibleSetsFile, sceneWindow.pSceneManager) == false)
+		{
+			if (sceneWindow.pVisibleSets->Bake(sceneWindow.pSceneManager, g_VisibleSetCellSize) == true)
+			{
+				sceneWindow.pVisibleSets->Save(g_VisibleSetsFile);
+			}
+			else
+			{
+				delete sceneWindow.pVisibleSets;
+				sceneWindow.pVisibleSets = NULL;
+			}
+		}
+	}
+
+	// the props of the scene can be placed again as copies that
+	// are drawn as billboards when they are far from the camera
+	sceneWindow.pImpostors = new ImpostorSystem(
+		sceneWindow.pSceneManager,
+		pViewManager,
+		g_ShaderManager,
+		g_ShaderLibrary,
+		g_ResourceManager);
+	if (sceneWindow.pImpostors->Initialize() == true)
+	{
+		sceneWindow.pSceneManager->DefineSceneImpostors(sceneWindow.pImpostors);
+	}
+
+	// large numbers of mesh copies are culled and drawn on the GPU
+	// when it can build its own draw commands
+	sceneWindow.pGpuCulling = NULL;
+	if (GpuCulling::IsSupported() == true)
+	{
+		sceneWindow.pGpuCulling = new GpuCulling(
+			sceneWindow.pSceneManager,
+			g_ShaderManager,
+			g_ShaderLibrary,
+			g_ResourceManager);
+		if (sceneWindow.pGpuCulling->Initialize() == false)
+		{
+			delete sceneWindow.pGpuCulling;
+			sceneWindow.pGpuCulling = NULL;
+		}
+	}
+
+	// the scene is rendered offscreen at the framebuffer size and
+	// copied into the window, the targets follow window resizes,
+	// and the last frame is kept in a second target while the
+	// next one is rendered
+	sceneWindow.pRenderTargetPool = new RenderTargetPool(g_ResourceManager);
+	sceneWindow.pFrameReuse = new FrameReuse(
+		g_ShaderManager,
+		g_ShaderLibrary,
+		g_ResourceManager,
+		sceneWindow.pRenderTargetPool);
+	sceneWindow.pFrameReuse->Initialize(GL_RGBA8, GL_DEPTH24_STENCIL8);
+	sceneWindow.pFrameReuse->SetEnabled(g_bFrameReuse);
+
+	// the depth pass needs a multi-view version when the split
+	// view layout is drawn in one pass
+	sceneWindow.pDepthPrePass = new DepthPrePass(g_ShaderManager, g_ShaderLibrary);
+	sceneWindow.pDepthPrePass->Initialize(multiViewProgram != 0);
+	sceneWindow.pDepthPrePass->SetMode(g_DepthPrePassMode);
+
+	// the translucent nodes are drawn without sorting when the
+	// weighted blending targets are supported
+	sceneWindow.pTransparencyPass = new TransparencyPass(g_ShaderManager, g_ShaderLibrary, g_ResourceManager);
+	if (sceneWindow.pTransparencyPass->Initialize(multiViewProgram != 0) == false)
+	{
+		delete sceneWindow.pTransparencyPass;
+		sceneWindow.pTransparencyPass = NULL;
+	}
+	sceneWindow.bSceneChanged = true;
+
+	g_SceneWindows.push_back(sceneWindow);
+
+	return(true);
+}
+
+/***********************************************************
+ *  RenderSceneWindow()
+ *
+ *  This function is used to render the scene of a window
+ *  into its offscreen target and show it in the window.
+ *  It returns false when the window did not need a frame.
+ ***********************************************************/
+bool RenderSceneWindow(SCENE_WINDOW& sceneWindow, float interpolation)
+{
+	ViewManager* pViewManager = sceneWindow.pViewManager;
+	SceneManager* pSceneManager = sceneWindow.pSceneManager;
+	RenderTargetPool* pRenderTargetPool = sceneWindow.pRenderTargetPool;
+	FrameReuse* pFrameReuse = sceneWindow.pFrameReuse;
+	DepthPrePass* pDepthPrePass = sceneWindow.pDepthPrePass;
+
+	// an extra window that was closed is hidden and skipped
+	if ((pViewManager->GetWindow() != g_Window) &&
+		(glfwWindowShouldClose(pViewManager->GetWindow())))
+	{
+		glfwHideWindow(pViewManager->GetWindow());
+		return(false);
+	}
+
+	// decide whether this window renders a new frame
+	int framebufferWidth = 0;
+	int framebufferHeight = 0;
+	pViewManager->GetFramebufferSize(framebufferWidth, framebufferHeight);
+	if ((framebufferWidth <= 0) || (framebufferHeight <= 0))
+	{
+		// the window is minimized
+		return(false);
+	}
+	// switching the overdraw view changes the whole frame
+	if (pDepthPrePass->IsOverdrawView() != pViewManager->IsOverdrawView())
+	{
+		pDepthPrePass->SetOverdrawView(pViewManager->IsOverdrawView());
+		sceneWindow.bSceneChanged = true;
+	}
+
+	// a frame moved from the last one is replaced by a full one
+	// once the view stops changing
+	if ((g_bRenderOnDemand == true) &&
+		(sceneWindow.bSceneChanged == false) &&
+		(pViewManager->HasViewChanged() == false) &&
+		(pFrameReuse->IsFrameApproximate() == false))
+	{
+		return(false);
+	}
+	bool bSceneChanged = sceneWindow.bSceneChanged;
+	sceneWindow.bSceneChanged = false;
+
+	// render at the current size
+	pRenderTargetPool->SetRenderSize(framebufferWidth, framebufferHeight);
+
+	// convert from 3D object space to 2D view
+	pViewManager->PrepareSceneView(interpolation);
+
+	// the lights are program state, so they need to be set
+	// again whenever the view layout switched programs, or
+	// when the program is shared with the other scenes
+	if ((pViewManager->ConsumeProgramChanged() == true) ||
+		(g_SceneWindows.size() > 1))
+	{
+		pSceneManager->SetupSceneLights();
+	}
+
+	// bind the offscreen target for the frame, unless the last
+	// frame can be shown again - a frame moved from the last one
+	// only needs the scene in the pixels that were left empty
+	ViewManager::VIEW_DATA views[ViewManager::MAX_VIEWS];
+	int viewCount = pViewManager->GetViews(views);
+	FrameReuse::REUSE_MODE reuseMode = pFrameReuse->BeginFrame(views, viewCount, bSceneChanged);
+
+	// the feedback of the main window asks for the pages that
+	// its frames sample, and the pages asked for a few frames
+	// ago are loaded before this one is drawn
+	bool bPagedTextures = (NULL != g_VirtualTextures) && (pViewManager->GetWindow() == g_Window);
+	if ((bPagedTextures == true) && (reuseMode != FrameReuse::REUSE_LAST_FRAME))
+	{
+		g_VirtualTextures->RenderFeedback(pSceneManager, views, viewCount, framebufferWidth, framebufferHeight);
+		g_VirtualTextures->UpdatePages();
+	}
+
+	// refresh the 3D scene once per pass of the view layout,
+	// culling against every view that the pass draws into
+	for (int pass = 0;
+		(reuseMode != FrameReuse::REUSE_LAST_FRAME) && (pass < pViewManager->GetViewPassCount());
+		pass++)
+	{
+		glm::mat4 cullingViews[ViewManager::MAX_VIEWS];
+		int cullingViewCount = 0;
+
+		pViewManager->PrepareViewPass(pass);
+		cullingViewCount = pViewManager->GetCullingViews(pass, cullingViews);
+		pSceneManager->SetCullingViews(cullingViews, cullingViewCount);
+
+		ViewManager::VIEW_DATA passViews[ViewManager::MAX_VIEWS];
+		int passViewCount = pViewManager->GetPassViews(pass, passViews);
+
+		// the sets were baked for rays from a point, so they only
+		// apply to a pass of the single perspective camera view
+		const uint32_t* pVisibleSet = NULL;
+		if ((NULL != sceneWindow.pVisibleSets) && (passViewCount == 1) &&
+			(passViews[0].projection[2][3] != 0.0f))
+		{
+			pVisibleSet = sceneWindow.pVisibleSets->GetCellSet(pViewManager->GetCameraPosition());
+		}
+		pSceneManager->SetVisibleSet(
+			pVisibleSet,
+			(NULL != sceneWindow.pVisibleSets) ? sceneWindow.pVisibleSets->GetNodeCount() : 0);
+		GLuint sceneProgram = 0;
+		if (bPagedTextures == true)
+		{
+			sceneProgram = g_VirtualTextures->BeginPass(pSceneManager, passViews, passViewCount);
+		}
+		pDepthPrePass->RenderScene(pSceneManager, passViews, passViewCount,
+			NULL != sceneWindow.pTransparencyPass);
+		if (bPagedTextures == true)
+		{
+			g_VirtualTextures->EndPass(sceneProgram);
+		}
+		if (NULL != sceneWindow.pGpuCulling)
+		{
+			sceneWindow.pGpuCulling->Render(passViews, passViewCount);
+		}
+		sceneWindow.pImpostors->Render(passViews, passViewCount);
+
+		// the translucent nodes go over everything that is opaque
+		if (NULL != sceneWindow.pTransparencyPass)
+		{
+			int drawTarget = pFrameReuse->GetDrawTarget();
+			sceneWindow.pTransparencyPass->Render(
+				pSceneManager,
+				passViews,
+				passViewCount,
+				pRenderTargetPool->GetDepthTexture(drawTarget),
+				pRenderTargetPool->GetAllocatedWidth(drawTarget),
+				pRenderTargetPool->GetAllocatedHeight(drawTarget));
+		}
+	}
+	// other renders of the scene draw every node
+	pSceneManager->SetVisibleSet(NULL, 0);
+	pFrameReuse->EndFrame();
+	pDepthPrePass->EndFrame();
+
+	if (pViewManager->GetWindow() == g_Window)
+	{
+		// copy the rendered frame into the window
+		pRenderTargetPool->BlitToWindow(pFrameReuse->GetFrameTarget());
+
+		// Flips the the back buffer with the front buffer every frame.
+		glfwSwapBuffers(g_Window);
+	}
+	else
+	{
+		// the extra windows show the frame from their own context
+		pViewManager->PresentTexture(
+			pRenderTargetPool->GetColorTexture(pFrameReuse->GetFrameTarget()),
+			framebufferWidth,
+			framebufferHeight);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  RunRenderServer()
+ *
+ *  This function is used to serve render requests from a
+ *  local socket with the main window's scene, until the
+ *  application is closed.  The window is hidden, since
+ *  the images are only sent to the clients.
+ ***********************************************************/
+bool RunRenderServer(const char* socketPath)
+{
+	RenderServer renderServer(
+		g_SceneWindows[0].pViewManager,
+		g_SceneWindows[0].pSceneManager,
+		g_ResourceManager);
+
+	// cube map and 360 requests are captured in one layered pass
+	EnvironmentCapture environmentCapture(g_ShaderManager, g_ShaderLibrary, g_ResourceManager);
+	if (environmentCapture.Initialize() == true)
+	{
+		renderServer.SetEnvironmentCapture(&environmentCapture);
+	}
+	// clients can change the scene through its edit queue
+	renderServer.SetEditQueue(g_SceneWindows[0].pEditQueue);
+
+	if (renderServer.Start(socketPath) == false)
+	{
+		return(false);
+	}
+	glfwHideWindow(g_Window);
+
+	while (!glfwWindowShouldClose(g_Window))
+	{
+		renderServer.WaitForRequests(g_ServerPollTime);
+
+		// the requests see the edits queued before they were taken
+		g_SceneWindows[0].pEditQueue->ApplyEdits(g_SceneWindows[0].pSceneManager);
+
+		// render the queued requests in batches, and delete the
+		// released resources the GPU has finished with
+		if (renderServer.ProcessRequests() > 0)
+		{
+			g_ResourceManager->EndFrame();
+		}
+
+		// query the latest GLFW events
+		glfwPollEvents();
+	}
+
+	renderServer.Stop();
+
+	return(true);
+}
+
 /***********************************************************
  *	InitializeGLFW()
  * 
@@ -174,4 +904,119 @@ bool InitializeGLEW()
 	std::cout << "INFO: OpenGL Version: " << glGetString(GL_VERSION) << "\n" << std::endl;
 
 	return(true);
-}
\ No newline at end of file
+}
+
+/***********************************************************
+ *  RunBenchmark()
+ *
+ *  This function is used to draw generated scenes of each
+ *  sweep in the main window, one object count after the
+ *  other, and write the frame times, draw calls and video
+ *  memory of each scene as a line of comma separated values
+ *  that can be plotted against the object count.  Every
+ *  frame is drawn in full, without waiting for the display,
+ *  and is finished before it is timed.  The generated
+ *  objects are added to the scene that is already there.
+ ***********************************************************/
+bool RunBenchmark(const char* resultsPath)
+{
+	SCENE_WINDOW& sceneWindow = g_SceneWindows[0];
+	SceneManager* pSceneManager = sceneWindow.pSceneManager;
+	GpuCulling* pGpuCulling = sceneWindow.pGpuCulling;
+
+	std::ofstream results(resultsPath);
+	if (results.is_open() == false)
+	{
+		std::cout << "Could not open benchmark results:" << resultsPath << std::endl;
+		return(false);
+	}
+	results << "sweep,objects,materials,textures,lights,averageFrameMs,worstFrameMs,drawCalls,videoMemoryBytes" << std::endl;
+
+	glfwSwapInterval(0);
+	StressScene stressScene(pSceneManager, g_ResourceManager, pGpuCulling);
+
+	int sweepCount = sizeof(g_BenchmarkSweeps) / sizeof(g_BenchmarkSweeps[0]);
+	int objectCountCount = sizeof(g_BenchmarkObjectCounts) / sizeof(g_BenchmarkObjectCounts[0]);
+	for (int sweep = 0; (sweep < sweepCount) && !glfwWindowShouldClose(g_Window); sweep++)
+	{
+		const BENCHMARK_SWEEP& benchmarkSweep = g_BenchmarkSweeps[sweep];
+		if ((benchmarkSweep.bGpuInstances == true) && (NULL == pGpuCulling))
+		{
+			std::cout << "Benchmark skipped " << benchmarkSweep.name << ", GPU culling is not supported" << std::endl;
+			continue;
+		}
+
+		for (int i = 0; (i < objectCountCount) && !glfwWindowShouldClose(g_Window); i++)
+		{
+			StressScene::STRESS_PARAMETERS parameters = StressScene::GetDefaultParameters();
+			parameters.objectCount = g_BenchmarkObjectCounts[i];
+			parameters.distribution = benchmarkSweep.distribution;
+			parameters.materialCount = benchmarkSweep.materialCount;
+			parameters.textureCount = benchmarkSweep.textureCount;
+			parameters.lightCount = benchmarkSweep.lightCount;
+			parameters.bGpuInstances = benchmarkSweep.bGpuInstances;
+			if (stressScene.Generate(parameters) == false)
+			{
+				std::cout << "Could not generate benchmark scene:" << benchmarkSweep.name << ", " << parameters.objectCount << " objects" << std::endl;
+				break;
+			}
+
+			double totalTime = 0.0;
+			double worstTime = 0.0;
+			long long drawCount = 0;
+			for (int frame = 0; frame < g_BenchmarkWarmupFrames + g_BenchmarkFrames; frame++)
+			{
+				sceneWindow.bSceneChanged = true;
+				pSceneManager->ResetDrawCount();
+				if (NULL != pGpuCulling)
+				{
+					pGpuCulling->ResetDrawCount();
+				}
+
+				double startTime = glfwGetTime();
+				RenderSceneWindow(sceneWindow, 0.0f);
+				glFinish();
+				double frameTime = glfwGetTime() - startTime;
+
+				sceneWindow.pRenderTargetPool->EndFrame();
+				g_ResourceManager->EndFrame();
+				glfwPollEvents();
+
+				if (frame >= g_BenchmarkWarmupFrames)
+				{
+					totalTime += frameTime;
+					worstTime = std::max(worstTime, frameTime);
+					drawCount += pSceneManager->GetDrawCount();
+					if (NULL != pGpuCulling)
+					{
+						drawCount += pGpuCulling->GetDrawCount();
+					}
+				}
+			}
+
+			size_t videoBytes = 0;
+			for (int type = 0; type < ResourceManager::RESOURCE_TYPE_COUNT; type++)
+			{
+				videoBytes += g_ResourceManager->GetLiveBytes((ResourceManager::RESOURCE_TYPE)type);
+			}
+			double averageTime = totalTime / g_BenchmarkFrames;
+			long long averageDraws = drawCount / g_BenchmarkFrames;
+
+			results << benchmarkSweep.name << "," << stressScene.GetObjectCount() << "," <<
+				parameters.materialCount << "," << stressScene.GetTextureCount() << "," <<
+				stressScene.GetLightCount() << "," << averageTime * 1000.0 << "," <<
+				worstTime * 1000.0 << "," << averageDraws << "," << videoBytes << std::endl;
+			std::cout << "Benchmark " << benchmarkSweep.name << ", objects:" << stressScene.GetObjectCount() <<
+				", frame:" << averageTime * 1000.0 << "ms, draw calls:" << averageDraws <<
+				", video memory:" << videoBytes << std::endl;
+
+			if (worstTime > g_BenchmarkFrameLimit)
+			{
+				break;
+			}
+		}
+	}
+	stressScene.Clear();
+
+	return(true);
+}
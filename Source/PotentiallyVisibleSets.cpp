@@ -0,0 +1,581 @@
+///////////////////////////////////////////////////////////////////////////////
+// potentiallyvisiblesets.cpp
+// ============
+// bake which scene nodes can be seen from each cell of the scene's space
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "PotentiallyVisibleSets.h"
+
+#include <glm/gtx/transform.hpp>
+
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <thread>
+
+// declaration of global variables
+namespace
+{
+	// random points that rays are cast from in each cell, and
+	// rays cast in random directions from each point
+	const int g_SamplePointsPerCell = 16;
+	const int g_RaysPerSamplePoint = 512;
+	// tries to find a sample point outside of the solid nodes
+	const int g_SamplePointTries = 8;
+	// most cells along one axis, larger scenes get larger cells
+	const int g_MaxCellsPerAxis = 64;
+
+	// half sizes of the solid basic meshes in their own space -
+	// the box is one unit across, the plane two units and flat,
+	// with a little thickness so rays along it still hit it
+	const glm::vec3 g_BoxHalfExtents = glm::vec3(0.5f, 0.5f, 0.5f);
+	const glm::vec3 g_PlaneHalfExtents = glm::vec3(1.0f, 0.001f, 1.0f);
+
+	// marks the start of a sets file, and its version
+	const uint32_t g_FileMagic = 0x31535650;	// "PVS1"
+
+	const float PI = 3.14159265358979f;
+}
+
+/***********************************************************
+ *  PotentiallyVisibleSets()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+PotentiallyVisibleSets::PotentiallyVisibleSets()
+{
+	m_gridMin = glm::vec3(0.0f);
+	m_cellSize = 0.0f;
+	m_cellsX = 0;
+	m_cellsY = 0;
+	m_cellsZ = 0;
+	m_cellCount = 0;
+	m_nodeCount = 0;
+	m_wordsPerCell = 0;
+	m_sceneSignature = 0;
+}
+
+/***********************************************************
+ *  ~PotentiallyVisibleSets()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+PotentiallyVisibleSets::~PotentiallyVisibleSets()
+{
+	m_cellBits.clear();
+	m_bakeNodes.clear();
+}
+
+/***********************************************************
+ *  Bake()
+ *
+ *  This method is used for baking the visible set of every
+ *  cell.  The grid covers the bounding spheres of all the
+ *  scene nodes, and the cells are split into ranges across
+ *  worker threads - each cell only writes its own bitset,
+ *  so no synchronization is needed beyond joining them.
+ ***********************************************************/
+bool PotentiallyVisibleSets::Bake(SceneManager* pSceneManager, float cellSize)
+{
+	if ((NULL == pSceneManager) || (cellSize <= 0.0f))
+	{
+		return(false);
+	}
+
+	GatherNodes(pSceneManager);
+
+	glm::vec3 boundsMin = glm::vec3(0.0f);
+	glm::vec3 boundsMax = glm::vec3(0.0f);
+	bool bFirst = true;
+	for (int i = 0; i < m_bakeNodes.size(); i++)
+	{
+		const BAKE_NODE& node = m_bakeNodes[i];
+		if (node.bValid == false)
+		{
+			continue;
+		}
+		glm::vec3 nodeMin = node.center - glm::vec3(node.radius);
+		glm::vec3 nodeMax = node.center + glm::vec3(node.radius);
+		boundsMin = (bFirst == true) ? nodeMin : glm::min(boundsMin, nodeMin);
+		boundsMax = (bFirst == true) ? nodeMax : glm::max(boundsMax, nodeMax);
+		bFirst = false;
+	}
+	if (bFirst == true)
+	{
+		m_bakeNodes.clear();
+		return(false);
+	}
+
+	// grow the cells until the grid fits the cell limit
+	glm::vec3 boundsSize = boundsMax - boundsMin;
+	float largestSide = glm::max(boundsSize.x, glm::max(boundsSize.y, boundsSize.z));
+	if (largestSide / cellSize > g_MaxCellsPerAxis)
+	{
+		cellSize = largestSide / g_MaxCellsPerAxis;
+	}
+
+	m_gridMin = boundsMin;
+	m_cellSize = cellSize;
+	m_cellsX = glm::max(1, (int)std::ceil(boundsSize.x / cellSize));
+	m_cellsY = glm::max(1, (int)std::ceil(boundsSize.y / cellSize));
+	m_cellsZ = glm::max(1, (int)std::ceil(boundsSize.z / cellSize));
+	m_cellCount = m_cellsX * m_cellsY * m_cellsZ;
+	m_nodeCount = (int)m_bakeNodes.size();
+	m_wordsPerCell = (m_nodeCount + 31) / 32;
+	m_cellBits.assign((size_t)m_cellCount * m_wordsPerCell, 0);
+	m_sceneSignature = ComputeSceneSignature(pSceneManager);
+
+	int workerCount = (int)std::thread::hardware_concurrency();
+	if (workerCount > m_cellCount)
+	{
+		workerCount = m_cellCount;
+	}
+	if (workerCount < 1)
+	{
+		workerCount = 1;
+	}
+
+	std::vector<std::thread> workers;
+	int cellsPerWorker = (m_cellCount + workerCount - 1) / workerCount;
+	for (int i = 1; i < workerCount; i++)
+	{
+		int firstCell = i * cellsPerWorker;
+		int lastCell = glm::min(firstCell + cellsPerWorker, m_cellCount);
+		if (firstCell < lastCell)
+		{
+			workers.push_back(std::thread(
+				&PotentiallyVisibleSets::BakeCells, this, firstCell, lastCell));
+		}
+	}
+
+	// the calling thread bakes the first range
+	BakeCells(0, glm::min(cellsPerWorker, m_cellCount));
+
+	for (int i = 0; i < workers.size(); i++)
+	{
+		workers[i].join();
+	}
+
+	m_bakeNodes.clear();
+
+	return(true);
+}
+
+/***********************************************************
+ *  GatherNodes()
+ *
+ *  This method is used for building the ray test data of
+ *  every scene node index.  Opaque boxes and planes block
+ *  the rays, every other node is only tested by its
+ *  bounding sphere, so it never hides what is behind it.
+ ***********************************************************/
+void PotentiallyVisibleSets::GatherNodes(SceneManager* pSceneManager)
+{
+	SceneManager::MESH_HANDLE boxMesh = pSceneManager->GetMeshHandle(SceneManager::MESH_BOX);
+	SceneManager::MESH_HANDLE planeMesh = pSceneManager->GetMeshHandle(SceneManager::MESH_PLANE);
+
+	m_bakeNodes.resize(pSceneManager->GetSceneNodeCount());
+	for (int i = 0; i < m_bakeNodes.size(); i++)
+	{
+		BAKE_NODE& bakeNode = m_bakeNodes[i];
+		SceneManager::SCENE_NODE node;
+
+		bakeNode.bValid = pSceneManager->GetSceneNode(i, node);
+		bakeNode.bOccluder = false;
+		if (bakeNode.bValid == false)
+		{
+			continue;
+		}
+
+		bakeNode.center = node.positionXYZ;
+		bakeNode.radius = pSceneManager->GetSceneNodeRadius(node);
+
+		// a node flattened to nothing along an axis has no
+		// space of its own to test the rays in
+		bool bSolid = (node.color.a >= 1.0f) &&
+			(node.scaleXYZ.x != 0.0f) && (node.scaleXYZ.y != 0.0f) && (node.scaleXYZ.z != 0.0f);
+		if (bSolid == true)
+		{
+			if (node.mesh == boxMesh)
+			{
+				bakeNode.bOccluder = true;
+				bakeNode.halfExtents = g_BoxHalfExtents;
+			}
+			else if (node.mesh == planeMesh)
+			{
+				bakeNode.bOccluder = true;
+				bakeNode.halfExtents = g_PlaneHalfExtents;
+			}
+		}
+
+		if (bakeNode.bOccluder == true)
+		{
+			// same order of transformations as the scene nodes
+			glm::mat4 model =
+				glm::translate(node.positionXYZ) *
+				glm::rotate(glm::radians(node.rotationDegrees.x), glm::vec3(1.0f, 0.0f, 0.0f)) *
+				glm::rotate(glm::radians(node.rotationDegrees.y), glm::vec3(0.0f, 1.0f, 0.0f)) *
+				glm::rotate(glm::radians(node.rotationDegrees.z), glm::vec3(0.0f, 0.0f, 1.0f)) *
+				glm::scale(node.scaleXYZ);
+			bakeNode.worldToLocal = glm::inverse(model);
+		}
+	}
+}
+
+/***********************************************************
+ *  ComputeSceneSignature()
+ *
+ *  This method is used for hashing the placement and the
+ *  mesh of every scene node, so that sets baked for a
+ *  different layout are not loaded - the mesh decides
+ *  whether a node is an occluder.
+ ***********************************************************/
+uint32_t PotentiallyVisibleSets::ComputeSceneSignature(SceneManager* pSceneManager) const
+{
+	// FNV-1a over the bytes of the node placements
+	uint32_t hash = 2166136261u;
+	int nodeCount = pSceneManager->GetSceneNodeCount();
+
+	for (int i = 0; i < nodeCount; i++)
+	{
+		SceneManager::SCENE_NODE node;
+		float values[10] = { 0.0f };
+		uint32_t meshValue = 0;
+
+		if (pSceneManager->GetSceneNode(i, node) == true)
+		{
+			meshValue = node.mesh.value;
+			values[0] = node.positionXYZ.x;
+			values[1] = node.positionXYZ.y;
+			values[2] = node.positionXYZ.z;
+			values[3] = node.scaleXYZ.x;
+			values[4] = node.scaleXYZ.y;
+			values[5] = node.scaleXYZ.z;
+			values[6] = node.rotationDegrees.x;
+			values[7] = node.rotationDegrees.y;
+			values[8] = node.rotationDegrees.z;
+			values[9] = node.color.a;
+		}
+
+		const unsigned char* pBytes = (const unsigned char*)values;
+		for (int j = 0; j < sizeof(values); j++)
+		{
+			hash = (hash ^ pBytes[j]) * 16777619u;
+		}
+		pBytes = (const unsigned char*)&meshValue;
+		for (int j = 0; j < sizeof(meshValue); j++)
+		{
+			hash = (hash ^ pBytes[j]) * 16777619u;
+		}
+	}
+
+	return(hash ^ (uint32_t)nodeCount);
+}
+
+/***********************************************************
+ *  BakeCells()
+ *
+ *  This method is used for baking the cells in the passed
+ *  in range, run on the worker threads.
+ ***********************************************************/
+void PotentiallyVisibleSets::BakeCells(int firstCell, int lastCell)
+{
+	for (int cell = firstCell; cell < lastCell; cell++)
+	{
+		BakeCell(cell);
+	}
+}
+
+/***********************************************************
+ *  BakeCell()
+ *
+ *  This method is used for baking the set of one cell.  The
+ *  nodes that reach into the cell are always visible, then
+ *  rays are cast from random points inside the cell that
+ *  are not buried in a solid node.  Each cell has its own
+ *  random sequence, so a bake gives the same sets no matter
+ *  how the cells are split across the threads.
+ ***********************************************************/
+void PotentiallyVisibleSets::BakeCell(int cell)
+{
+	uint32_t* pBits = &m_cellBits[(size_t)cell * m_wordsPerCell];
+	int cellX = cell % m_cellsX;
+	int cellY = (cell / m_cellsX) % m_cellsY;
+	int cellZ = cell / (m_cellsX * m_cellsY);
+	glm::vec3 cellMin = m_gridMin + glm::vec3(cellX, cellY, cellZ) * m_cellSize;
+	glm::vec3 cellMax = cellMin + glm::vec3(m_cellSize);
+
+	for (int i = 0; i < m_bakeNodes.size(); i++)
+	{
+		const BAKE_NODE& node = m_bakeNodes[i];
+		if (node.bValid == false)
+		{
+			continue;
+		}
+		glm::vec3 closest = glm::clamp(node.center, cellMin, cellMax);
+		if (glm::length(closest - node.center) <= node.radius)
+		{
+			pBits[i / 32] |= (1u << (i % 32));
+		}
+	}
+
+	std::mt19937 random((uint32_t)cell * 2654435761u + 1u);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	for (int sample = 0; sample < g_SamplePointsPerCell; sample++)
+	{
+		glm::vec3 origin;
+		bool bBuried = true;
+		for (int tries = 0; (tries < g_SamplePointTries) && (bBuried == true); tries++)
+		{
+			origin = cellMin + glm::vec3(unit(random), unit(random), unit(random)) * m_cellSize;
+			bBuried = false;
+			for (int i = 0; (i < m_bakeNodes.size()) && (bBuried == false); i++)
+			{
+				const BAKE_NODE& node = m_bakeNodes[i];
+				if ((node.bValid == true) && (node.bOccluder == true))
+				{
+					glm::vec3 local = glm::vec3(node.worldToLocal * glm::vec4(origin, 1.0f));
+					bBuried =
+						(std::fabs(local.x) <= node.halfExtents.x) &&
+						(std::fabs(local.y) <= node.halfExtents.y) &&
+						(std::fabs(local.z) <= node.halfExtents.z);
+				}
+			}
+		}
+		if (bBuried == true)
+		{
+			continue;
+		}
+
+		for (int ray = 0; ray < g_RaysPerSamplePoint; ray++)
+		{
+			// uniformly distributed direction on the unit sphere
+			float z = unit(random) * 2.0f - 1.0f;
+			float angle = unit(random) * 2.0f * PI;
+			float ringRadius = std::sqrt(glm::max(0.0f, 1.0f - z * z));
+			glm::vec3 direction = glm::vec3(ringRadius * std::cos(angle), ringRadius * std::sin(angle), z);
+
+			CastRay(origin, direction, pBits);
+		}
+	}
+}
+
+/***********************************************************
+ *  CastRay()
+ *
+ *  This method is used for casting one ray from a cell.
+ *  The nearest solid node that the ray hits is found
+ *  first, then that node and every node whose bounding
+ *  sphere the ray enters before it are marked as visible.
+ ***********************************************************/
+void PotentiallyVisibleSets::CastRay(const glm::vec3& origin, const glm::vec3& direction, uint32_t* pBits) const
+{
+	float nearestOccluder = 1e30f;
+	int occluderIndex = -1;
+
+	for (int i = 0; i < m_bakeNodes.size(); i++)
+	{
+		const BAKE_NODE& node = m_bakeNodes[i];
+		if ((node.bValid == false) || (node.bOccluder == false))
+		{
+			continue;
+		}
+
+		// slab test against the box in the node's own space - the
+		// distances along the ray are the same in both spaces
+		glm::vec3 localOrigin = glm::vec3(node.worldToLocal * glm::vec4(origin, 1.0f));
+		glm::vec3 localDirection = glm::vec3(node.worldToLocal * glm::vec4(direction, 0.0f));
+		float nearT = 0.0f;
+		float farT = nearestOccluder;
+		bool bHit = true;
+		for (int axis = 0; (axis < 3) && (bHit == true); axis++)
+		{
+			if (std::fabs(localDirection[axis]) < 1e-8f)
+			{
+				bHit = (std::fabs(localOrigin[axis]) <= node.halfExtents[axis]);
+			}
+			else
+			{
+				float t1 = (-node.halfExtents[axis] - localOrigin[axis]) / localDirection[axis];
+				float t2 = (node.halfExtents[axis] - localOrigin[axis]) / localDirection[axis];
+				nearT = glm::max(nearT, glm::min(t1, t2));
+				farT = glm::min(farT, glm::max(t1, t2));
+				bHit = (nearT <= farT);
+			}
+		}
+
+		if (bHit == true)
+		{
+			nearestOccluder = nearT;
+			occluderIndex = i;
+		}
+	}
+
+	if (occluderIndex >= 0)
+	{
+		pBits[occluderIndex / 32] |= (1u << (occluderIndex % 32));
+	}
+
+	for (int i = 0; i < m_bakeNodes.size(); i++)
+	{
+		const BAKE_NODE& node = m_bakeNodes[i];
+		if ((node.bValid == false) || (node.bOccluder == true))
+		{
+			continue;
+		}
+
+		// the ray enters the sphere before the occluder when the
+		// nearer of its crossings is in front of the occluder
+		glm::vec3 offset = origin - node.center;
+		float b = glm::dot(offset, direction);
+		float c = glm::dot(offset, offset) - node.radius * node.radius;
+		float discriminant = b * b - c;
+		if (discriminant < 0.0f)
+		{
+			continue;
+		}
+		float root = std::sqrt(discriminant);
+		float farT = -b + root;
+		float nearT = glm::max(-b - root, 0.0f);
+		if ((farT >= 0.0f) && (nearT <= nearestOccluder))
+		{
+			pBits[i / 32] |= (1u << (i % 32));
+		}
+	}
+}
+
+/***********************************************************
+ *  GetCellSet()
+ *
+ *  This method is used for getting the bitset of the cell
+ *  that holds the passed in position.
+ ***********************************************************/
+const uint32_t* PotentiallyVisibleSets::GetCellSet(const glm::vec3& position) const
+{
+	if (m_cellCount == 0)
+	{
+		return(NULL);
+	}
+
+	glm::vec3 cellPosition = (position - m_gridMin) / m_cellSize;
+	int cellX = (int)std::floor(cellPosition.x);
+	int cellY = (int)std::floor(cellPosition.y);
+	int cellZ = (int)std::floor(cellPosition.z);
+	if ((cellX < 0) || (cellX >= m_cellsX) ||
+		(cellY < 0) || (cellY >= m_cellsY) ||
+		(cellZ < 0) || (cellZ >= m_cellsZ))
+	{
+		return(NULL);
+	}
+
+	int cell = (cellZ * m_cellsY + cellY) * m_cellsX + cellX;
+	return(&m_cellBits[(size_t)cell * m_wordsPerCell]);
+}
+
+/***********************************************************
+ *  Load()
+ *
+ *  This method is used for reading baked sets from a file.
+ *  The file is only used when it was baked for the same
+ *  placement of the scene nodes.
+ ***********************************************************/
+bool PotentiallyVisibleSets::Load(const std::string& filePath, SceneManager* pSceneManager)
+{
+	std::ifstream file(filePath, std::ios::binary);
+	uint32_t header[6];
+	float grid[4];
+
+	if ((NULL == pSceneManager) || (file.is_open() == false))
+	{
+		return(false);
+	}
+
+	file.read((char*)header, sizeof(header));
+	file.read((char*)grid, sizeof(grid));
+	if ((file.good() == false) || (header[0] != g_FileMagic) ||
+		(header[1] != ComputeSceneSignature(pSceneManager)) ||
+		(header[2] != (uint32_t)pSceneManager->GetSceneNodeCount()))
+	{
+		return(false);
+	}
+
+	// the bake never makes more cells per axis than this, which
+	// also keeps the cell count from overflowing
+	for (int i = 3; i < 6; i++)
+	{
+		if ((header[i] == 0) || (header[i] > (uint32_t)g_MaxCellsPerAxis))
+		{
+			std::cout << "Could not read the visible sets file:" << filePath << ", the grid size is not valid" << std::endl;
+			return(false);
+		}
+	}
+
+	int cellCount = (int)(header[3] * header[4] * header[5]);
+	int wordsPerCell = ((int)header[2] + 31) / 32;
+	std::vector<uint32_t> cellBits((size_t)cellCount * wordsPerCell);
+	if (cellBits.empty() == false)
+	{
+		file.read((char*)&cellBits[0], cellBits.size() * sizeof(uint32_t));
+	}
+	if ((file.good() == false) || (cellCount == 0) || (grid[3] <= 0.0f))
+	{
+		std::cout << "Could not read the visible sets file:" << filePath << std::endl;
+		return(false);
+	}
+
+	m_sceneSignature = header[1];
+	m_nodeCount = (int)header[2];
+	m_cellsX = (int)header[3];
+	m_cellsY = (int)header[4];
+	m_cellsZ = (int)header[5];
+	m_cellCount = cellCount;
+	m_wordsPerCell = wordsPerCell;
+	m_gridMin = glm::vec3(grid[0], grid[1], grid[2]);
+	m_cellSize = grid[3];
+	m_cellBits.swap(cellBits);
+
+	return(true);
+}
+
+/***********************************************************
+ *  Save()
+ *
+ *  This method is used for writing the baked sets into a
+ *  file, after a small header with the grid layout and the
+ *  signature of the scene nodes they were baked for.
+ ***********************************************************/
+bool PotentiallyVisibleSets::Save(const std::string& filePath) const
+{
+	uint32_t header[6] = {
+		g_FileMagic,
+		m_sceneSignature,
+		(uint32_t)m_nodeCount,
+		(uint32_t)m_cellsX,
+		(uint32_t)m_cellsY,
+		(uint32_t)m_cellsZ };
+	float grid[4] = { m_gridMin.x, m_gridMin.y, m_gridMin.z, m_cellSize };
+
+	if (m_cellCount == 0)
+	{
+		return(false);
+	}
+
+	std::ofstream file(filePath, std::ios::binary | std::ios::trunc);
+	if (file.is_open() == false)
+	{
+		std::cout << "Could not write the visible sets file:" << filePath << std::endl;
+		return(false);
+	}
+
+	file.write((const char*)header, sizeof(header));
+	file.write((const char*)grid, sizeof(grid));
+	if (m_cellBits.empty() == false)
+	{
+		file.write((const char*)&m_cellBits[0], m_cellBits.size() * sizeof(uint32_t));
+	}
+
+	return(file.good());
+}
@@ -0,0 +1,102 @@
+///////////////////////////////////////////////////////////////////////////////
+// potentiallyvisiblesets.h
+// ============
+// bake which scene nodes can be seen from each cell of the scene's space
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneManager.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  PotentiallyVisibleSets
+ *
+ *  This class divides the space around the scene into a
+ *  grid of view cells, and finds for each cell the scene
+ *  nodes that could be seen from anywhere inside it.  Rays
+ *  are cast in every direction from random points in the
+ *  cell, and every node that a ray reaches before it hits
+ *  a solid box or plane is marked as visible.  The cells
+ *  are baked on worker threads, and each cell keeps its set
+ *  as a bitset with one bit per node index, so a render only
+ *  has to step through the set bits.  The sets only hold the
+ *  nodes that existed when they were baked, and are stored
+ *  in a file so that the bake only runs on the first start,
+ *  or after the scene nodes have changed.
+ ***********************************************************/
+class PotentiallyVisibleSets
+{
+public:
+	// constructor
+	PotentiallyVisibleSets();
+	// destructor
+	~PotentiallyVisibleSets();
+
+	// bake the sets for the current nodes of the scene, with
+	// cubic cells of the passed in size
+	bool Bake(SceneManager* pSceneManager, float cellSize);
+	// read the sets from a file, returns false when there is no
+	// file or it was baked for different scene nodes
+	bool Load(const std::string& filePath, SceneManager* pSceneManager);
+	// write the baked sets into a file
+	bool Save(const std::string& filePath) const;
+
+	// get the bitset of the cell that holds the passed in
+	// position, NULL when the position is outside of the grid
+	const uint32_t* GetCellSet(const glm::vec3& position) const;
+	// get the number of node indices that the bitsets cover
+	int GetNodeCount() const { return(m_nodeCount); }
+	bool IsBaked() const { return(m_cellCount > 0); }
+
+private:
+	// a scene node as the rays are tested against it
+	struct BAKE_NODE
+	{
+		// bounding sphere, tested for the nodes that are seen
+		glm::vec3 center;
+		float radius;
+		// the oriented box of solid boxes and planes, tested in
+		// the node's own space for the nodes that block the rays
+		bool bOccluder;
+		glm::mat4 worldToLocal;
+		glm::vec3 halfExtents;
+		bool bValid;
+	};
+
+	// corner of the grid, size of its cells and number of cells
+	// along each axis
+	glm::vec3 m_gridMin;
+	float m_cellSize;
+	int m_cellsX;
+	int m_cellsY;
+	int m_cellsZ;
+	int m_cellCount;
+	// number of node indices in each bitset, the words that each
+	// bitset takes and the bitsets of all cells one after another
+	int m_nodeCount;
+	int m_wordsPerCell;
+	std::vector<uint32_t> m_cellBits;
+	// value that changes when the baked scene nodes change
+	uint32_t m_sceneSignature;
+
+	// the nodes of the scene being baked
+	std::vector<BAKE_NODE> m_bakeNodes;
+
+	// build the ray test data for the current scene nodes
+	void GatherNodes(SceneManager* pSceneManager);
+	// compute a value from the placement of the scene nodes
+	uint32_t ComputeSceneSignature(SceneManager* pSceneManager) const;
+	// bake the cells in the passed in range
+	void BakeCells(int firstCell, int lastCell);
+	// bake the set of one cell into its bitset
+	void BakeCell(int cell);
+	// cast one ray, marking the nodes it reaches
+	void CastRay(const glm::vec3& origin, const glm::vec3& direction, uint32_t* pBits) const;
+};
@@ -0,0 +1,992 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderserver.cpp
+// ============
+// render images of the loaded 3D scene for requests from a local socket
+//
+///////////////////////////////////////////////////////////////////////////////
+
+// the socket headers come first, since winsock2.h has to be
+// included before anything that pulls in windows.h
+#ifdef _WIN32
+#include <winsock2.h>
+#include <afunix.h>
+#pragma comment(lib, "Ws2_32.lib")
+#else
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+#include "RenderServer.h"
+#include "SceneEditQueue.h"
+
+#include <glm/gtx/transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// most requests that are rendered before reading back
+	const int g_MaxBatchSize = 8;
+	// most requests waiting to be rendered, over all clients
+	const int g_MaxQueuedRequests = 64;
+	// time the accept thread waits before trying again, after
+	// the process ran out of file handles or buffers
+	const int g_AcceptRetryMilliseconds = 100;
+	// largest image and number of node overrides accepted
+	const int g_MaxImageSize = 8192;
+	const int g_MaxOverrideCount = 256;
+
+#ifdef _WIN32
+	const uintptr_t g_InvalidSocket = (uintptr_t)INVALID_SOCKET;
+	const int g_ShutdownBoth = SD_BOTH;
+	const int g_SendFlags = 0;
+#else
+	const int g_InvalidSocket = -1;
+	const int g_ShutdownBoth = SHUT_RDWR;
+	// a client that disconnects must not raise SIGPIPE
+#ifdef MSG_NOSIGNAL
+	const int g_SendFlags = MSG_NOSIGNAL;
+#else
+	const int g_SendFlags = 0;
+#endif
+#endif
+
+	// what the accept thread does after accept() has failed
+	enum ACCEPT_ERROR
+	{
+		ACCEPT_RETRY,
+		ACCEPT_BACK_OFF,
+		ACCEPT_FATAL
+	};
+
+	// sort the error of the last failed accept() - running out of
+	// handles or buffers clears up once clients disconnect, so it
+	// is retried after a pause instead of spinning
+	ACCEPT_ERROR GetAcceptError()
+	{
+#ifdef _WIN32
+		int error = WSAGetLastError();
+		if ((error == WSAEINTR) || (error == WSAECONNRESET) || (error == WSAEWOULDBLOCK))
+		{
+			return(ACCEPT_RETRY);
+		}
+		if ((error == WSAEMFILE) || (error == WSAENOBUFS))
+		{
+			return(ACCEPT_BACK_OFF);
+		}
+#else
+		if ((errno == EINTR) || (errno == ECONNABORTED) || (errno == EAGAIN) || (errno == EPROTO))
+		{
+			return(ACCEPT_RETRY);
+		}
+		if ((errno == EMFILE) || (errno == ENFILE) || (errno == ENOBUFS) || (errno == ENOMEM))
+		{
+			return(ACCEPT_BACK_OFF);
+		}
+#endif
+		return(ACCEPT_FATAL);
+	}
+
+	// close a socket handle
+	template <typename T>
+	void CloseSocket(T socketHandle)
+	{
+#ifdef _WIN32
+		closesocket((SOCKET)socketHandle);
+#else
+		close(socketHandle);
+#endif
+	}
+
+	// remove the file of a socket path left behind by a run
+	// that did not shut down cleanly
+	void RemoveSocketFile(const std::string& socketPath)
+	{
+#ifdef _WIN32
+		DeleteFileA(socketPath.c_str());
+#else
+		unlink(socketPath.c_str());
+#endif
+	}
+
+	// read exactly the passed in number of bytes from a socket,
+	// returns false when the connection is closed first
+	template <typename T>
+	bool ReceiveAll(T socketHandle, void* pData, size_t byteCount)
+	{
+		char* pBytes = (char*)pData;
+		while (byteCount > 0)
+		{
+#ifdef _WIN32
+			int received = recv((SOCKET)socketHandle, pBytes, (int)std::min(byteCount, (size_t)0x40000000), 0);
+#else
+			ssize_t received = recv(socketHandle, pBytes, byteCount, 0);
+			if ((received < 0) && (errno == EINTR))
+			{
+				continue;
+			}
+#endif
+			if (received <= 0)
+			{
+				return(false);
+			}
+			pBytes += received;
+			byteCount -= received;
+		}
+		return(true);
+	}
+
+	// write exactly the passed in number of bytes to a socket,
+	// returns false when the connection is closed first
+	template <typename T>
+	bool SendAll(T socketHandle, const void* pData, size_t byteCount)
+	{
+		const char* pBytes = (const char*)pData;
+		while (byteCount > 0)
+		{
+#ifdef _WIN32
+			int sent = send((SOCKET)socketHandle, pBytes, (int)std::min(byteCount, (size_t)0x40000000), g_SendFlags);
+#else
+			ssize_t sent = send(socketHandle, pBytes, byteCount, g_SendFlags);
+			if ((sent < 0) && (errno == EINTR))
+			{
+				continue;
+			}
+#endif
+			if (sent <= 0)
+			{
+				return(false);
+			}
+			pBytes += sent;
+			byteCount -= sent;
+		}
+		return(true);
+	}
+}
+
+/***********************************************************
+ *  RenderServer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+RenderServer::RenderServer(
+	ViewManager* pViewManager,
+	SceneManager* pSceneManager,
+	ResourceManager* pResourceManager)
+{
+	m_pViewManager = pViewManager;
+	m_pSceneManager = pSceneManager;
+	m_pResourceManager = pResourceManager;
+	m_pRenderTargetPool = new RenderTargetPool(pResourceManager);
+	m_renderTarget = m_pRenderTargetPool->AddTarget(GL_RGBA8, GL_DEPTH24_STENCIL8);
+	m_pCapture = NULL;
+	m_pEditQueue = NULL;
+	m_listenSocket = g_InvalidSocket;
+	m_bRunning = false;
+	m_nextConnectionID = 1;
+}
+
+/***********************************************************
+ *  ~RenderServer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+RenderServer::~RenderServer()
+{
+	Stop();
+	m_readbackBuffers.clear();
+	m_readbackSizes.clear();
+	if (NULL != m_pRenderTargetPool)
+	{
+		delete m_pRenderTargetPool;
+		m_pRenderTargetPool = NULL;
+	}
+	m_pViewManager = NULL;
+	m_pSceneManager = NULL;
+	m_pResourceManager = NULL;
+}
+
+/***********************************************************
+ *  Start()
+ *
+ *  This method is used for creating the socket at the
+ *  passed in path and starting to accept clients on it.
+ ***********************************************************/
+bool RenderServer::Start(const char* socketPath)
+{
+	sockaddr_un address;
+
+	if (m_bRunning == true)
+	{
+		return(true);
+	}
+
+	memset(&address, 0, sizeof(address));
+	if (strlen(socketPath) >= sizeof(address.sun_path))
+	{
+		std::cout << "Could not start render server:" << socketPath << ", the socket path is too long" << std::endl;
+		return(false);
+	}
+	address.sun_family = AF_UNIX;
+	memcpy(address.sun_path, socketPath, strlen(socketPath));
+
+#ifdef _WIN32
+	WSADATA wsaData;
+	if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+	{
+		std::cout << "Could not start render server:" << socketPath << ", winsock is not available" << std::endl;
+		return(false);
+	}
+#endif
+
+	m_socketPath = socketPath;
+	RemoveSocketFile(m_socketPath);
+
+	m_listenSocket = (SOCKET_HANDLE)socket(AF_UNIX, SOCK_STREAM, 0);
+	if ((m_listenSocket == g_InvalidSocket) ||
+		(bind(m_listenSocket, (sockaddr*)&address, sizeof(address)) != 0) ||
+		(listen(m_listenSocket, 8) != 0))
+	{
+		std::cout << "Could not start render server:" << socketPath << ", the socket could not be opened" << std::endl;
+		if (m_listenSocket != g_InvalidSocket)
+		{
+			CloseSocket(m_listenSocket);
+			m_listenSocket = g_InvalidSocket;
+		}
+#ifdef _WIN32
+		WSACleanup();
+#endif
+		return(false);
+	}
+
+	m_bRunning = true;
+	m_acceptThread = std::thread(&RenderServer::AcceptThread, this);
+
+	std::cout << "INFO: Render server listening on " << socketPath << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  Stop()
+ *
+ *  This method is used for closing the listening socket and
+ *  every client connection, dropping the queued requests.
+ ***********************************************************/
+void RenderServer::Stop()
+{
+	if (m_bRunning == false)
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bRunning = false;
+	}
+
+	// shutting the sockets down wakes the threads that are
+	// blocked in accept and recv
+	shutdown(m_listenSocket, g_ShutdownBoth);
+	CloseSocket(m_listenSocket);
+	m_listenSocket = g_InvalidSocket;
+	if (m_acceptThread.joinable())
+	{
+		m_acceptThread.join();
+	}
+
+	// no new connections are added once the accept thread is done
+	for (int i = 0; i < m_connections.size(); i++)
+	{
+		shutdown(m_connections[i]->socket, g_ShutdownBoth);
+		if (m_connections[i]->reader.joinable())
+		{
+			m_connections[i]->reader.join();
+		}
+		CloseSocket(m_connections[i]->socket);
+		delete m_connections[i];
+	}
+	m_connections.clear();
+	m_requests.clear();
+
+	RemoveSocketFile(m_socketPath);
+#ifdef _WIN32
+	WSACleanup();
+#endif
+}
+
+/***********************************************************
+ *  WaitForRequests()
+ *
+ *  This method is used for waiting until a request has been
+ *  queued, or until the passed in timeout has passed.
+ *  Returns true when there are queued requests.
+ ***********************************************************/
+bool RenderServer::WaitForRequests(double timeoutSeconds)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	if (m_requests.size() == 0)
+	{
+		m_condition.wait_for(lock,
+			std::chrono::duration<double>(timeoutSeconds));
+	}
+
+	return(m_requests.size() > 0);
+}
+
+/***********************************************************
+ *  ProcessRequests()
+ *
+ *  This method is used for rendering a batch of the queued
+ *  requests and sending the images to the clients.  Every
+ *  request of the batch is drawn and its read back started
+ *  before the first one is waited on.  The animations that
+ *  the requests posed are evaluated again at the times they
+ *  had before the batch.
+ ***********************************************************/
+int RenderServer::ProcessRequests()
+{
+	std::vector<PENDING_REQUEST> batch;
+	std::vector<bool> rendered;
+	bool bPosed = false;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		while ((m_requests.size() > 0) && (batch.size() < g_MaxBatchSize))
+		{
+			batch.push_back(m_requests.front());
+			m_requests.pop_front();
+		}
+	}
+
+	if (batch.size() == 0)
+	{
+		CloseFinishedConnections();
+		return(0);
+	}
+
+	// render requests of the same size together, so that the
+	// target is not resized back and forth within a batch
+	std::stable_sort(batch.begin(), batch.end(),
+		[](const PENDING_REQUEST& a, const PENDING_REQUEST& b)
+		{
+			return((a.request.width < b.request.width) ||
+				((a.request.width == b.request.width) && (a.request.height < b.request.height)));
+		});
+
+	if (m_readbackBuffers.size() < batch.size())
+	{
+		m_readbackBuffers.resize(batch.size());
+		m_readbackSizes.resize(batch.size(), 0);
+	}
+
+	float previousAnimationTime = 0.0f;
+	float animationTime = 0.0f;
+	if (NULL != m_pSceneManager)
+	{
+		previousAnimationTime = m_pSceneManager->GetPreviousAnimationTime();
+		animationTime = m_pSceneManager->GetAnimationTime();
+	}
+	for (int i = 0; i < batch.size(); i++)
+	{
+		rendered.push_back((batch[i].bValid == true) && (RenderRequest(batch[i], i) == true));
+		if ((batch[i].bValid == true) && (batch[i].request.animationTime >= 0.0f))
+		{
+			bPosed = true;
+		}
+	}
+
+	// put back both of the steps that the scene blends between
+	if ((bPosed == true) && (NULL != m_pSceneManager))
+	{
+		m_pSceneManager->UpdateAnimations(previousAnimationTime);
+		m_pSceneManager->UpdateAnimations(animationTime);
+		m_pSceneManager->ApplyAnimations(1.0f);
+	}
+
+	// mapping the first buffer waits for the GPU, by then the
+	// whole batch has been submitted
+	for (int i = 0; i < batch.size(); i++)
+	{
+		RENDER_RESPONSE response;
+		response.magic = RESPONSE_MAGIC;
+		response.requestID = batch[i].request.requestID;
+		response.width = 0;
+		response.height = 0;
+		response.byteCount = 0;
+
+		if (batch[i].bValid == false)
+		{
+			response.status = STATUS_INVALID_REQUEST;
+			SendResponse(batch[i].connectionID, response, NULL);
+			continue;
+		}
+
+		const void* pPixels = NULL;
+		if (rendered[i] == true)
+		{
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, m_readbackBuffers[i].GetName());
+			pPixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0,
+				(GLsizeiptr)batch[i].request.width * batch[i].request.height * 4,
+				GL_MAP_READ_BIT);
+		}
+
+		if (NULL != pPixels)
+		{
+			response.status = STATUS_OK;
+			response.width = batch[i].request.width;
+			response.height = batch[i].request.height;
+			response.byteCount = (uint32_t)response.width * response.height * 4;
+		}
+		else
+		{
+			response.status = STATUS_RENDER_FAILED;
+		}
+		SendResponse(batch[i].connectionID, response, pPixels);
+
+		if (rendered[i] == true)
+		{
+			if (NULL != pPixels)
+			{
+				glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+			}
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		}
+	}
+
+	m_pRenderTargetPool->EndFrame();
+	CloseFinishedConnections();
+
+	return((int)batch.size());
+}
+
+/***********************************************************
+ *  RenderRequest()
+ *
+ *  This method is used for rendering the scene for one
+ *  request, with its node overrides applied only for the
+ *  duration of the draw, and starting the read back of the
+ *  image into a pixel buffer.
+ ***********************************************************/
+bool RenderServer::RenderRequest(const PENDING_REQUEST& pending, int readbackIndex)
+{
+	const RENDER_REQUEST& request = pending.request;
+	std::vector<std::string> overriddenTags;
+	std::vector<SceneManager::SCENE_NODE> savedNodes;
+	bool bRendered = false;
+
+	if ((NULL == m_pViewManager) || (NULL == m_pSceneManager))
+	{
+		return(false);
+	}
+
+	// pose the animations at the requested time, until the end
+	// of the batch
+	if (request.animationTime >= 0.0f)
+	{
+		m_pSceneManager->UpdateAnimations(request.animationTime);
+		m_pSceneManager->ApplyAnimations(1.0f);
+	}
+
+	// apply the node overrides, keeping the original nodes
+	for (int i = 0; i < pending.overrides.size(); i++)
+	{
+		const NODE_OVERRIDE& nodeOverride = pending.overrides[i];
+		std::string tag(nodeOverride.tag, strnlen(nodeOverride.tag, sizeof(nodeOverride.tag)));
+		SceneManager::SCENE_NODE node;
+
+		if (m_pSceneManager->GetSceneNode(tag, node) == false)
+		{
+			continue;
+		}
+		overriddenTags.push_back(tag);
+		savedNodes.push_back(node);
+
+		if (nodeOverride.flags & OVERRIDE_SCALE)
+			node.scaleXYZ = glm::vec3(nodeOverride.scaleXYZ[0], nodeOverride.scaleXYZ[1], nodeOverride.scaleXYZ[2]);
+		if (nodeOverride.flags & OVERRIDE_ROTATION)
+			node.rotationDegrees = glm::vec3(nodeOverride.rotationDegrees[0], nodeOverride.rotationDegrees[1], nodeOverride.rotationDegrees[2]);
+		if (nodeOverride.flags & OVERRIDE_POSITION)
+			node.positionXYZ = glm::vec3(nodeOverride.positionXYZ[0], nodeOverride.positionXYZ[1], nodeOverride.positionXYZ[2]);
+		if (nodeOverride.flags & OVERRIDE_COLOR)
+			node.color = glm::vec4(nodeOverride.color[0], nodeOverride.color[1], nodeOverride.color[2], nodeOverride.color[3]);
+		if (nodeOverride.flags & OVERRIDE_HIDDEN)
+			node.mesh = HandlePool<SceneManager::MESH_DATA>::InvalidHandle();
+		m_pSceneManager->SetSceneNode(tag, node);
+	}
+
+	if ((request.projection == PROJECTION_CUBE_MAP) ||
+		(request.projection == PROJECTION_EQUIRECTANGULAR))
+	{
+		bRendered = RenderCapture(request);
+	}
+	else
+	{
+		bRendered = RenderView(request);
+	}
+
+	// undo the overrides in reverse, in case a tag was repeated
+	for (int i = (int)savedNodes.size() - 1; i >= 0; i--)
+	{
+		m_pSceneManager->SetSceneNode(overriddenTags[i], savedNodes[i]);
+	}
+
+	if ((bRendered == false) || (NULL == m_pResourceManager))
+	{
+		return(false);
+	}
+
+	// grow the pixel buffer for this slot of the batch when needed
+	size_t byteCount = (size_t)request.width * request.height * 4;
+	if ((m_readbackBuffers[readbackIndex].IsValid() == false) ||
+		(m_readbackSizes[readbackIndex] < byteCount))
+	{
+		GLuint bufferID = 0;
+		glGenBuffers(1, &bufferID);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, bufferID);
+		glBufferData(GL_PIXEL_PACK_BUFFER, byteCount, NULL, GL_STREAM_READ);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		m_readbackBuffers[readbackIndex] = ResourceRef(
+			m_pResourceManager,
+			m_pResourceManager->Register(ResourceManager::RESOURCE_BUFFER, bufferID, byteCount));
+		m_readbackSizes[readbackIndex] = byteCount;
+	}
+
+	// copy the image into the pixel buffer without waiting for it
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, m_readbackBuffers[readbackIndex].GetName());
+	if (request.projection == PROJECTION_CUBE_MAP)
+	{
+		m_pCapture->ReadCubeFaces(0, 0);
+	}
+	else
+	{
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glReadPixels(0, 0, request.width, request.height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	return(true);
+}
+
+/***********************************************************
+ *  RenderView()
+ *
+ *  This method is used for rendering the scene into the
+ *  render target with the camera and projection of a
+ *  request.
+ ***********************************************************/
+bool RenderServer::RenderView(const RENDER_REQUEST& request)
+{
+	glm::vec3 cameraPosition(request.cameraPosition[0], request.cameraPosition[1], request.cameraPosition[2]);
+	glm::vec3 cameraTarget(request.cameraTarget[0], request.cameraTarget[1], request.cameraTarget[2]);
+	glm::vec3 cameraUp(request.cameraUp[0], request.cameraUp[1], request.cameraUp[2]);
+	float aspectRatio = (float)request.width / (float)request.height;
+
+	glm::mat4 view = glm::lookAt(cameraPosition, cameraTarget, cameraUp);
+	glm::mat4 projection;
+	if (request.projection == PROJECTION_ORTHOGRAPHIC)
+	{
+		projection = glm::ortho(
+			-request.fieldOfView * aspectRatio, request.fieldOfView * aspectRatio,
+			-request.fieldOfView, request.fieldOfView,
+			request.nearPlane, request.farPlane);
+	}
+	else
+	{
+		projection = glm::perspective(glm::radians(request.fieldOfView),
+			aspectRatio,
+			request.nearPlane, request.farPlane);
+	}
+	glm::mat4 viewProjection = projection * view;
+
+	m_pRenderTargetPool->SetRenderSize(request.width, request.height);
+	if (m_pRenderTargetPool->Bind(m_renderTarget) == false)
+	{
+		return(false);
+	}
+
+	glEnable(GL_DEPTH_TEST);
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	m_pViewManager->PrepareExternalView(view, projection, cameraPosition, 0, 0, request.width, request.height);
+	m_pSceneManager->SetupSceneLights();
+	m_pViewManager->PrepareViewPass(0);
+	m_pSceneManager->SetCullingViews(&viewProjection, 1);
+	m_pSceneManager->RenderScene();
+
+	return(true);
+}
+
+/***********************************************************
+ *  RenderCapture()
+ *
+ *  This method is used for capturing the scene around the
+ *  camera position of a request into a cube map.  For a 360
+ *  request the cube is then drawn as an equirectangular
+ *  image into the render target, with faces about as wide
+ *  as a quarter of the image, which is what one face covers
+ *  along the horizon.
+ ***********************************************************/
+bool RenderServer::RenderCapture(const RENDER_REQUEST& request)
+{
+	glm::vec3 cameraPosition(request.cameraPosition[0], request.cameraPosition[1], request.cameraPosition[2]);
+	int faceSize = request.width;
+
+	if (NULL == m_pCapture)
+	{
+		return(false);
+	}
+	if (request.projection == PROJECTION_EQUIRECTANGULAR)
+	{
+		faceSize = std::max(request.width / 4, 16);
+	}
+
+	if ((m_pCapture->SetCubeMapSize(faceSize, 1) == false) ||
+		(m_pCapture->Capture(m_pSceneManager, cameraPosition, 0, request.nearPlane, request.farPlane) == false))
+	{
+		return(false);
+	}
+
+	if (request.projection == PROJECTION_EQUIRECTANGULAR)
+	{
+		m_pRenderTargetPool->SetRenderSize(request.width, request.height);
+		if (m_pRenderTargetPool->Bind(m_renderTarget) == false)
+		{
+			return(false);
+		}
+		m_pCapture->DrawEquirectangular(0);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  SendResponse()
+ *
+ *  This method is used for sending a response header and
+ *  its pixels to a client.  A client that has disconnected
+ *  in the meantime is skipped.
+ ***********************************************************/
+void RenderServer::SendResponse(int connectionID, const RENDER_RESPONSE& response, const void* pPixels)
+{
+	CONNECTION* pConnection = NULL;
+
+	// the connections are only deleted on this thread, so the
+	// connection stays usable after the lock is released
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (int i = 0; i < m_connections.size(); i++)
+		{
+			if (m_connections[i]->connectionID == connectionID)
+			{
+				pConnection = m_connections[i];
+			}
+		}
+	}
+	if (NULL == pConnection)
+	{
+		return;
+	}
+
+	SendResponse(pConnection, response, pPixels);
+}
+
+void RenderServer::SendResponse(CONNECTION* pConnection, const RENDER_RESPONSE& response, const void* pPixels)
+{
+	std::lock_guard<std::mutex> lock(pConnection->sendMutex);
+	if ((SendAll(pConnection->socket, &response, sizeof(response)) == true) &&
+		(response.byteCount > 0) && (NULL != pPixels))
+	{
+		SendAll(pConnection->socket, pPixels, response.byteCount);
+	}
+}
+
+/***********************************************************
+ *  CloseFinishedConnections()
+ *
+ *  This method is used for closing the sockets of the
+ *  clients whose reader thread has finished, once none of
+ *  their requests are waiting to be answered.
+ ***********************************************************/
+void RenderServer::CloseFinishedConnections()
+{
+	std::vector<CONNECTION*> finished;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		int index = 0;
+		while (index < m_connections.size())
+		{
+			bool bAnswered = true;
+			for (int i = 0; i < m_requests.size(); i++)
+			{
+				if (m_requests[i].connectionID == m_connections[index]->connectionID)
+				{
+					bAnswered = false;
+				}
+			}
+
+			if ((m_connections[index]->bReaderDone == true) && (bAnswered == true))
+			{
+				finished.push_back(m_connections[index]);
+				m_connections[index] = m_connections.back();
+				m_connections.pop_back();
+			}
+			else
+			{
+				index++;
+			}
+		}
+	}
+
+	for (int i = 0; i < finished.size(); i++)
+	{
+		if (finished[i]->reader.joinable())
+		{
+			finished[i]->reader.join();
+		}
+		CloseSocket(finished[i]->socket);
+		delete finished[i];
+	}
+}
+
+/***********************************************************
+ *  AcceptThread()
+ *
+ *  This method is run on the accept thread.  It starts a
+ *  reader thread for each client that connects, until the
+ *  server is stopped or the listening socket fails.
+ ***********************************************************/
+void RenderServer::AcceptThread()
+{
+	while (true)
+	{
+		SOCKET_HANDLE clientSocket = (SOCKET_HANDLE)accept(m_listenSocket, NULL, NULL);
+		ACCEPT_ERROR acceptError = ACCEPT_RETRY;
+		if (clientSocket == g_InvalidSocket)
+		{
+			acceptError = GetAcceptError();
+		}
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if (m_bRunning == false)
+		{
+			if (clientSocket != g_InvalidSocket)
+			{
+				CloseSocket(clientSocket);
+			}
+			return;
+		}
+		if (clientSocket == g_InvalidSocket)
+		{
+			if (acceptError == ACCEPT_FATAL)
+			{
+				std::cout << "Could not accept render clients:" << m_socketPath << ", the socket has failed" << std::endl;
+				return;
+			}
+			if (acceptError == ACCEPT_BACK_OFF)
+			{
+				lock.unlock();
+				std::this_thread::sleep_for(std::chrono::milliseconds(g_AcceptRetryMilliseconds));
+			}
+			continue;
+		}
+
+#if defined(__APPLE__)
+		// there is no MSG_NOSIGNAL, so turn SIGPIPE off per socket
+		int noSignal = 1;
+		setsockopt(clientSocket, SOL_SOCKET, SO_NOSIGPIPE, &noSignal, sizeof(noSignal));
+#endif
+
+		CONNECTION* pConnection = new CONNECTION();
+		pConnection->connectionID = m_nextConnectionID++;
+		pConnection->socket = clientSocket;
+		pConnection->bReaderDone = false;
+		pConnection->reader = std::thread(&RenderServer::ReaderThread, this, pConnection);
+		m_connections.push_back(pConnection);
+	}
+}
+
+/***********************************************************
+ *  ReaderThread()
+ *
+ *  This method is run on a reader thread.  It reads the
+ *  requests of one client and queues them for rendering.
+ *  A request that cannot be parsed is answered with an
+ *  error and ends the connection, since the rest of the
+ *  stream can no longer be trusted.  A request that finds
+ *  the queue full is answered as busy from this thread.
+ ***********************************************************/
+void RenderServer::ReaderThread(CONNECTION* pConnection)
+{
+	bool bReading = true;
+
+	while (bReading == true)
+	{
+		PENDING_REQUEST pending;
+		pending.connectionID = pConnection->connectionID;
+		pending.bValid = false;
+
+		// the magic value tells the render and edit requests apart
+		uint32_t magic = 0;
+		if (ReceiveAll(pConnection->socket, &magic, sizeof(magic)) == false)
+		{
+			break;
+		}
+		if (magic == EDIT_MAGIC)
+		{
+			if (ReadEditRequest(pConnection) == false)
+			{
+				break;
+			}
+			continue;
+		}
+		pending.request.magic = magic;
+		if (ReceiveAll(pConnection->socket, (char*)&pending.request + sizeof(magic),
+			sizeof(pending.request) - sizeof(magic)) == false)
+		{
+			break;
+		}
+
+		// the cube map faces are stacked, so the image must be
+		// six faces high, and the captures have a fixed view angle
+		const RENDER_REQUEST& request = pending.request;
+		bool bCapture = ((request.projection == PROJECTION_CUBE_MAP) ||
+			(request.projection == PROJECTION_EQUIRECTANGULAR));
+		if ((request.magic == REQUEST_MAGIC) &&
+			(request.projection >= PROJECTION_PERSPECTIVE) &&
+			(request.projection <= PROJECTION_EQUIRECTANGULAR) &&
+			(request.width > 0) && (request.width <= g_MaxImageSize) &&
+			(request.height > 0) && (request.height <= g_MaxImageSize) &&
+			((request.projection != PROJECTION_CUBE_MAP) ||
+				(request.height == request.width * EnvironmentCapture::FACE_COUNT)) &&
+			(request.overrideCount >= 0) && (request.overrideCount <= g_MaxOverrideCount) &&
+			(request.nearPlane > 0.0f) && (request.farPlane > request.nearPlane) &&
+			((bCapture == true) || (request.fieldOfView > 0.0f)))
+		{
+			pending.overrides.resize(request.overrideCount);
+			if ((request.overrideCount > 0) &&
+				(ReceiveAll(pConnection->socket, &pending.overrides[0],
+					sizeof(NODE_OVERRIDE) * request.overrideCount) == false))
+			{
+				break;
+			}
+			pending.bValid = true;
+		}
+		else
+		{
+			bReading = false;
+		}
+
+		bool bQueued = false;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if ((pending.bValid == false) || (m_requests.size() < g_MaxQueuedRequests))
+			{
+				m_requests.push_back(pending);
+				bQueued = true;
+			}
+		}
+		if (bQueued == false)
+		{
+			RENDER_RESPONSE response;
+			response.magic = RESPONSE_MAGIC;
+			response.requestID = request.requestID;
+			response.status = STATUS_BUSY;
+			response.width = 0;
+			response.height = 0;
+			response.byteCount = 0;
+			SendResponse(pConnection, response, NULL);
+			continue;
+		}
+		m_condition.notify_one();
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	pConnection->bReaderDone = true;
+}
+
+/***********************************************************
+ *  ReadEditRequest()
+ *
+ *  This method is run on a reader thread.  It reads the
+ *  rest of an edit request, whose magic value has been read
+ *  already, and pushes the edit onto the edit queue, which
+ *  takes edits from any thread.  The request is answered as
+ *  soon as it is queued, and is applied before the next
+ *  batch of render requests.  Light edits are not taken.
+ ***********************************************************/
+bool RenderServer::ReadEditRequest(CONNECTION* pConnection)
+{
+	EDIT_REQUEST request;
+
+	request.magic = EDIT_MAGIC;
+	if (ReceiveAll(pConnection->socket, (char*)&request + sizeof(request.magic),
+		sizeof(request) - sizeof(request.magic)) == false)
+	{
+		return(false);
+	}
+
+	RENDER_RESPONSE response;
+	response.magic = RESPONSE_MAGIC;
+	response.requestID = request.requestID;
+	response.status = STATUS_INVALID_REQUEST;
+	response.width = 0;
+	response.height = 0;
+	response.byteCount = 0;
+
+	std::string nodeTag(request.nodeTag, strnlen(request.nodeTag, sizeof(request.nodeTag)));
+	if ((NULL != m_pEditQueue) &&
+		(request.type >= SceneEditQueue::EDIT_ADD_NODE) &&
+		(request.type <= SceneEditQueue::EDIT_SET_TEXTURE) &&
+		((request.type != SceneEditQueue::EDIT_ADD_NODE) ||
+			((request.mesh >= 0) && (request.mesh < SceneManager::MESH_TYPE_COUNT))) &&
+		(nodeTag.empty() == false))
+	{
+		std::string materialTag(request.materialTag, strnlen(request.materialTag, sizeof(request.materialTag)));
+		std::string textureTag(request.textureTag, strnlen(request.textureTag, sizeof(request.textureTag)));
+		glm::vec3 scaleXYZ(request.scaleXYZ[0], request.scaleXYZ[1], request.scaleXYZ[2]);
+		glm::vec3 rotationDegrees(request.rotationDegrees[0], request.rotationDegrees[1], request.rotationDegrees[2]);
+		glm::vec3 positionXYZ(request.positionXYZ[0], request.positionXYZ[1], request.positionXYZ[2]);
+
+		switch (request.type)
+		{
+		case SceneEditQueue::EDIT_ADD_NODE:
+			m_pEditQueue->AddNode(
+				nodeTag,
+				(SceneManager::MESH_TYPE)request.mesh,
+				scaleXYZ,
+				rotationDegrees,
+				positionXYZ,
+				glm::vec4(request.color[0], request.color[1], request.color[2], request.color[3]),
+				materialTag,
+				textureTag);
+			break;
+		case SceneEditQueue::EDIT_REMOVE_NODE:
+			m_pEditQueue->RemoveNode(nodeTag);
+			break;
+		case SceneEditQueue::EDIT_SET_TRANSFORM:
+			m_pEditQueue->SetTransform(nodeTag, scaleXYZ, rotationDegrees, positionXYZ);
+			break;
+		case SceneEditQueue::EDIT_SET_MATERIAL:
+			m_pEditQueue->SetMaterial(nodeTag, materialTag);
+			break;
+		default:
+			m_pEditQueue->SetTexture(nodeTag, textureTag);
+			break;
+		}
+		response.status = STATUS_OK;
+	}
+
+	SendResponse(pConnection, response, NULL);
+
+	return(true);
+}
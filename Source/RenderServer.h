@@ -0,0 +1,263 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderserver.h
+// ============
+// render images of the loaded 3D scene for requests from a local socket
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ViewManager.h"
+#include "SceneManager.h"
+#include "RenderTargetPool.h"
+#include "EnvironmentCapture.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class SceneEditQueue;
+
+/***********************************************************
+ *  RenderServer
+ *
+ *  This class keeps the 3D scene loaded and renders images
+ *  of it for clients that connect to a Unix domain socket,
+ *  so that each image does not pay for the start up of the
+ *  application.  A client sends a RENDER_REQUEST followed
+ *  by its NODE_OVERRIDE entries, and receives a
+ *  RENDER_RESPONSE followed by the RGBA pixels, with the
+ *  rows ordered from the bottom of the image up.  Several
+ *  requests may be sent without waiting, the responses come
+ *  back in the order the requests were rendered, carrying
+ *  the request ID.
+ *  The sockets are read on background threads, and the
+ *  queued requests are rendered in batches on the thread
+ *  that owns the OpenGL context.  The pixels of a batch are
+ *  only read back once every request of the batch has been
+ *  drawn, so that the GPU is not waited on per image.
+ *  A client may also send an EDIT_REQUEST, which is pushed
+ *  onto the edit queue of the scene by the reader thread and
+ *  stays in place for the requests rendered after it - a
+ *  render request that was already queued may see it too.
+ *  It is answered with a RENDER_RESPONSE without pixels.
+ *  A request that arrives while the queue is full is
+ *  answered right away with a busy status, so a client
+ *  cannot make the queue grow without bound.
+ *  The cube map projection returns the six faces around
+ *  the camera position stacked one above the other, and the
+ *  equirectangular projection returns a 360 image, both
+ *  captured in one pass of the scene.
+ ***********************************************************/
+class RenderServer
+{
+public:
+	// constructor
+	RenderServer(
+		ViewManager* pViewManager,
+		SceneManager* pSceneManager,
+		ResourceManager* pResourceManager);
+	// destructor
+	~RenderServer();
+
+	// values that start every request and response, to catch
+	// a client that is out of step with the message layout
+	static const uint32_t REQUEST_MAGIC = 0x51455252;
+	static const uint32_t RESPONSE_MAGIC = 0x53455252;
+	static const uint32_t EDIT_MAGIC = 0x54494445;
+
+	enum PROJECTION_TYPE
+	{
+		PROJECTION_PERSPECTIVE,
+		PROJECTION_ORTHOGRAPHIC,
+		// six square faces, the height is six times the width
+		PROJECTION_CUBE_MAP,
+		// 360 image, usually twice as wide as it is high
+		PROJECTION_EQUIRECTANGULAR
+	};
+
+	// which values of a NODE_OVERRIDE are applied
+	enum OVERRIDE_FLAGS
+	{
+		OVERRIDE_SCALE = 1,
+		OVERRIDE_ROTATION = 2,
+		OVERRIDE_POSITION = 4,
+		OVERRIDE_COLOR = 8,
+		OVERRIDE_HIDDEN = 16
+	};
+
+	enum RESPONSE_STATUS
+	{
+		STATUS_OK,
+		STATUS_INVALID_REQUEST,
+		STATUS_RENDER_FAILED,
+		// the queue was full, the request can be sent again later
+		STATUS_BUSY
+	};
+
+	// camera and image settings of one requested image
+	struct RENDER_REQUEST
+	{
+		uint32_t magic;
+		uint32_t requestID;
+		int32_t width;
+		int32_t height;
+		float cameraPosition[3];
+		float cameraTarget[3];
+		float cameraUp[3];
+		int32_t projection;
+		// vertical field of view in degrees for a perspective
+		// projection, half the view height for an orthographic one,
+		// not used by the captures
+		float fieldOfView;
+		float nearPlane;
+		float farPlane;
+		// time the animations are posed at, negative to render
+		// the scene as it is
+		float animationTime;
+		// number of NODE_OVERRIDE entries that follow
+		int32_t overrideCount;
+	};
+
+	// change to a scene node that only applies to one request
+	struct NODE_OVERRIDE
+	{
+		char tag[64];
+		uint32_t flags;
+		float scaleXYZ[3];
+		float rotationDegrees[3];
+		float positionXYZ[3];
+		float color[4];
+	};
+
+	// change to the scene that is kept for the later requests
+	struct EDIT_REQUEST
+	{
+		uint32_t magic;
+		uint32_t requestID;
+		// one of the node edits of SceneEditQueue::EDIT_TYPE
+		int32_t type;
+		char nodeTag[64];
+		// the values that the kind of edit uses
+		int32_t mesh;
+		float scaleXYZ[3];
+		float rotationDegrees[3];
+		float positionXYZ[3];
+		float color[4];
+		char materialTag[64];
+		char textureTag[64];
+	};
+
+	// header sent back for each request, followed by
+	// byteCount bytes of pixels
+	struct RENDER_RESPONSE
+	{
+		uint32_t magic;
+		uint32_t requestID;
+		int32_t status;
+		int32_t width;
+		int32_t height;
+		uint32_t byteCount;
+	};
+
+	// set the capture used for the cube map and 360 requests,
+	// without one those requests fail
+	void SetEnvironmentCapture(EnvironmentCapture* pCapture) { m_pCapture = pCapture; }
+	// set the queue that the edit requests are pushed onto,
+	// without one those requests fail
+	void SetEditQueue(SceneEditQueue* pEditQueue) { m_pEditQueue = pEditQueue; }
+
+	// start listening on the socket at the passed in path
+	bool Start(const char* socketPath);
+	// close the socket and every client connection
+	void Stop();
+
+	// wait until requests are queued or the timeout has passed
+	bool WaitForRequests(double timeoutSeconds);
+	// render one batch of the queued requests and send the
+	// images back, returns the number of requests handled
+	int ProcessRequests();
+
+private:
+#ifdef _WIN32
+	typedef uintptr_t SOCKET_HANDLE;
+#else
+	typedef int SOCKET_HANDLE;
+#endif
+
+	struct CONNECTION
+	{
+		int connectionID;
+		SOCKET_HANDLE socket;
+		std::thread reader;
+		// set by the reader thread once the client stopped sending,
+		// the socket is closed after the queued requests are answered
+		bool bReaderDone;
+		// held while a response is written, since the reader thread
+		// answers the edit and busy requests itself
+		std::mutex sendMutex;
+	};
+
+	struct PENDING_REQUEST
+	{
+		int connectionID;
+		// false when the request could not be parsed
+		bool bValid;
+		RENDER_REQUEST request;
+		std::vector<NODE_OVERRIDE> overrides;
+	};
+
+	// pointers to the view and the scene that are rendered
+	ViewManager* m_pViewManager;
+	SceneManager* m_pSceneManager;
+	// pointer to the manager that owns the OpenGL resources
+	ResourceManager* m_pResourceManager;
+	// offscreen target the requests are rendered into
+	RenderTargetPool* m_pRenderTargetPool;
+	int m_renderTarget;
+	// capture for the cube map and 360 requests, may be NULL
+	EnvironmentCapture* m_pCapture;
+	// queue for the edit requests, may be NULL
+	SceneEditQueue* m_pEditQueue;
+	// pixel buffers that a batch is read back into, and their sizes
+	std::vector<ResourceRef> m_readbackBuffers;
+	std::vector<size_t> m_readbackSizes;
+
+	// listening socket and the thread accepting the clients
+	std::string m_socketPath;
+	SOCKET_HANDLE m_listenSocket;
+	std::thread m_acceptThread;
+	bool m_bRunning;
+	// connected clients and the queued requests, shared with
+	// the socket threads
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	std::vector<CONNECTION*> m_connections;
+	int m_nextConnectionID;
+	std::deque<PENDING_REQUEST> m_requests;
+
+	// accept clients until the server is stopped
+	void AcceptThread();
+	// read the requests of one client until it disconnects
+	void ReaderThread(CONNECTION* pConnection);
+	// read the rest of an edit request, push it onto the edit
+	// queue and answer it - returns false when the client is gone
+	bool ReadEditRequest(CONNECTION* pConnection);
+	// close the connections whose reader thread has finished and
+	// whose requests have all been answered
+	void CloseFinishedConnections();
+
+	// render a request and start reading its pixels back
+	bool RenderRequest(const PENDING_REQUEST& pending, int readbackIndex);
+	// render the scene with the camera of a request
+	bool RenderView(const RENDER_REQUEST& request);
+	// capture the scene around the camera for a cube map or 360 request
+	bool RenderCapture(const RENDER_REQUEST& request);
+	// send a response header and its pixels to a client
+	void SendResponse(int connectionID, const RENDER_RESPONSE& response, const void* pPixels);
+	void SendResponse(CONNECTION* pConnection, const RENDER_RESPONSE& response, const void* pPixels);
+};
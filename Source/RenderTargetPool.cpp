@@ -0,0 +1,401 @@
+///////////////////////////////////////////////////////////////////////////////
+// rendertargetpool.cpp
+// ============
+// offscreen render targets that follow the size of the window framebuffer
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "RenderTargetPool.h"
+
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// allocated sizes are rounded up to a multiple of this
+	const int g_SizeGranularity = 64;
+	// extra room allocated when a target grows, in percent
+	const int g_GrowSlackPercent = 25;
+	// a target is oversized when its area is this many times
+	// larger than the area that is rendered
+	const int g_ShrinkAreaRatio = 2;
+	// frames that a target has to stay oversized before it is
+	// allocated again at a smaller size
+	const int g_ShrinkDelayFrames = 120;
+
+	// round a rendered size up to the size that is allocated
+	int AllocationSize(int size)
+	{
+		size += size * g_GrowSlackPercent / 100;
+		return(((size + g_SizeGranularity - 1) / g_SizeGranularity) * g_SizeGranularity);
+	}
+
+	// estimate the memory used by one pixel of a format
+	int BytesPerPixel(GLenum format)
+	{
+		switch (format)
+		{
+		case GL_RGBA16F:
+		case GL_RG32F:
+			return(8);
+		case GL_RGBA32F:
+			return(16);
+		case GL_R8:
+			return(1);
+		case GL_R16F:
+			return(2);
+		default:
+			return(4);
+		}
+	}
+
+	// check whether a format is a depth format
+	bool IsDepthFormat(GLenum format)
+	{
+		return((format == GL_DEPTH_COMPONENT24) ||
+			(format == GL_DEPTH_COMPONENT32F) ||
+			(format == GL_DEPTH24_STENCIL8) ||
+			(format == GL_DEPTH32F_STENCIL8));
+	}
+
+	// allocate the storage of the bound texture - immutable
+	// storage is used when the driver supports it
+	void AllocateTextureStorage(GLenum format, int width, int height)
+	{
+		if (GLEW_ARB_texture_storage)
+		{
+			glTexStorage2D(GL_TEXTURE_2D, 1, format, width, height);
+			return;
+		}
+
+		GLenum pixelFormat = GL_RGBA;
+		GLenum pixelType = GL_FLOAT;
+		switch (format)
+		{
+		case GL_DEPTH24_STENCIL8:
+			pixelFormat = GL_DEPTH_STENCIL;
+			pixelType = GL_UNSIGNED_INT_24_8;
+			break;
+		case GL_DEPTH32F_STENCIL8:
+			pixelFormat = GL_DEPTH_STENCIL;
+			pixelType = GL_FLOAT_32_UNSIGNED_INT_24_8_REV;
+			break;
+		case GL_DEPTH_COMPONENT24:
+		case GL_DEPTH_COMPONENT32F:
+			pixelFormat = GL_DEPTH_COMPONENT;
+			break;
+		case GL_R8:
+		case GL_R16F:
+			pixelFormat = GL_RED;
+			break;
+		case GL_RG32F:
+			pixelFormat = GL_RG;
+			break;
+		default:
+			break;
+		}
+		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, pixelFormat, pixelType, NULL);
+	}
+}
+
+/***********************************************************
+ *  RenderTargetPool()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+RenderTargetPool::RenderTargetPool(ResourceManager* pResourceManager)
+{
+	m_pResourceManager = pResourceManager;
+	m_renderWidth = 0;
+	m_renderHeight = 0;
+}
+
+/***********************************************************
+ *  ~RenderTargetPool()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+RenderTargetPool::~RenderTargetPool()
+{
+	// release the targets to the resource manager
+	m_targets.clear();
+	m_pResourceManager = NULL;
+}
+
+/***********************************************************
+ *  AddTarget()
+ *
+ *  This method is used for adding a render target to the
+ *  pool.  Nothing is allocated until the target is bound.
+ ***********************************************************/
+int RenderTargetPool::AddTarget(GLenum colorFormat, GLenum depthFormat)
+{
+	RENDER_TARGET target;
+	target.colorFormat = colorFormat;
+	target.depthFormat = depthFormat;
+	target.width = 0;
+	target.height = 0;
+	target.oversizedFrames = 0;
+	m_targets.push_back(target);
+
+	return((int)m_targets.size() - 1);
+}
+
+/***********************************************************
+ *  SetRenderSize()
+ *
+ *  This method is used for setting the size that the targets
+ *  are rendered at, normally the window framebuffer size.
+ ***********************************************************/
+void RenderTargetPool::SetRenderSize(int width, int height)
+{
+	m_renderWidth = width;
+	m_renderHeight = height;
+}
+
+/***********************************************************
+ *  Bind()
+ *
+ *  This method is used for binding a target for rendering.
+ *  The target is allocated again first when it is too
+ *  small, or when it has been oversized for long enough.
+ ***********************************************************/
+bool RenderTargetPool::Bind(int target)
+{
+	if ((target < 0) || (target >= m_targets.size()) ||
+		(m_renderWidth <= 0) || (m_renderHeight <= 0))
+	{
+		return(false);
+	}
+
+	RENDER_TARGET& renderTarget = m_targets[target];
+	if (NeedsResize(renderTarget) == true)
+	{
+		if (Allocate(renderTarget) == false)
+		{
+			return(false);
+		}
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, renderTarget.framebuffer.GetName());
+	glViewport(0, 0, m_renderWidth, m_renderHeight);
+
+	return(true);
+}
+
+/***********************************************************
+ *  BlitToWindow()
+ *
+ *  This method is used for copying the rendered area of a
+ *  target into the window framebuffer.
+ ***********************************************************/
+void RenderTargetPool::BlitToWindow(int target)
+{
+	if ((target < 0) || (target >= m_targets.size()))
+	{
+		return;
+	}
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_targets[target].framebuffer.GetName());
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glBlitFramebuffer(
+		0, 0, m_renderWidth, m_renderHeight,
+		0, 0, m_renderWidth, m_renderHeight,
+		GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for counting how long each target
+ *  has been much larger than the rendered area.
+ ***********************************************************/
+void RenderTargetPool::EndFrame()
+{
+	for (int i = 0; i < m_targets.size(); i++)
+	{
+		RENDER_TARGET& target = m_targets[i];
+		if ((target.width > 0) && (target.height > 0) &&
+			(target.width * target.height >
+				g_ShrinkAreaRatio * AllocationSize(m_renderWidth) * AllocationSize(m_renderHeight)))
+		{
+			target.oversizedFrames++;
+		}
+		else
+		{
+			target.oversizedFrames = 0;
+		}
+	}
+}
+
+/***********************************************************
+ *  GetFramebuffer()
+ *
+ *  These methods are used for getting the OpenGL objects
+ *  and the allocated size of a target.
+ ***********************************************************/
+GLuint RenderTargetPool::GetFramebuffer(int target) const
+{
+	if ((target < 0) || (target >= m_targets.size()))
+	{
+		return(0);
+	}
+	return(m_targets[target].framebuffer.GetName());
+}
+
+GLuint RenderTargetPool::GetColorTexture(int target) const
+{
+	if ((target < 0) || (target >= m_targets.size()))
+	{
+		return(0);
+	}
+	return(m_targets[target].colorTexture.GetName());
+}
+
+GLuint RenderTargetPool::GetDepthTexture(int target) const
+{
+	if ((target < 0) || (target >= m_targets.size()))
+	{
+		return(0);
+	}
+	return(m_targets[target].depthTexture.GetName());
+}
+
+int RenderTargetPool::GetAllocatedWidth(int target) const
+{
+	if ((target < 0) || (target >= m_targets.size()))
+	{
+		return(0);
+	}
+	return(m_targets[target].width);
+}
+
+int RenderTargetPool::GetAllocatedHeight(int target) const
+{
+	if ((target < 0) || (target >= m_targets.size()))
+	{
+		return(0);
+	}
+	return(m_targets[target].height);
+}
+
+/***********************************************************
+ *  NeedsResize()
+ *
+ *  This method is used for checking whether a target has to
+ *  be allocated again for the current render size.
+ ***********************************************************/
+bool RenderTargetPool::NeedsResize(const RENDER_TARGET& target) const
+{
+	// grow right away, the rendered area has to fit
+	if ((target.width < m_renderWidth) || (target.height < m_renderHeight))
+	{
+		return(true);
+	}
+
+	// shrink only once the target has stayed oversized
+	return(target.oversizedFrames >= g_ShrinkDelayFrames);
+}
+
+/***********************************************************
+ *  Allocate()
+ *
+ *  This method is used for creating the framebuffer and the
+ *  attachments of a target at a size that fits the current
+ *  render size with some room to spare.  The old objects are
+ *  released to the resource manager, which deletes them
+ *  once the GPU has finished with them.
+ ***********************************************************/
+bool RenderTargetPool::Allocate(RENDER_TARGET& target)
+{
+	if (NULL == m_pResourceManager)
+	{
+		return(false);
+	}
+
+	int width = AllocationSize(m_renderWidth);
+	int height = AllocationSize(m_renderHeight);
+
+	GLuint framebufferID = 0;
+	glGenFramebuffers(1, &framebufferID);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebufferID);
+
+	ResourceRef colorTexture;
+	ResourceRef depthTexture;
+	if (target.colorFormat != GL_NONE)
+	{
+		colorTexture = CreateAttachment(target.colorFormat, width, height);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+			GL_TEXTURE_2D, colorTexture.GetName(), 0);
+	}
+	else
+	{
+		glDrawBuffer(GL_NONE);
+		glReadBuffer(GL_NONE);
+	}
+	if (target.depthFormat != GL_NONE)
+	{
+		GLenum attachment = GL_DEPTH_ATTACHMENT;
+		if ((target.depthFormat == GL_DEPTH24_STENCIL8) ||
+			(target.depthFormat == GL_DEPTH32F_STENCIL8))
+		{
+			attachment = GL_DEPTH_STENCIL_ATTACHMENT;
+		}
+		depthTexture = CreateAttachment(target.depthFormat, width, height);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, attachment,
+			GL_TEXTURE_2D, depthTexture.GetName(), 0);
+	}
+
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "Could not create render target:" << width << "x" << height << std::endl;
+		glDeleteFramebuffers(1, &framebufferID);
+		return(false);
+	}
+
+	target.framebuffer = ResourceRef(
+		m_pResourceManager,
+		m_pResourceManager->Register(ResourceManager::RESOURCE_FRAMEBUFFER, framebufferID, 0));
+	target.colorTexture = colorTexture;
+	target.depthTexture = depthTexture;
+	target.width = width;
+	target.height = height;
+	target.oversizedFrames = 0;
+
+	return(true);
+}
+
+/***********************************************************
+ *  CreateAttachment()
+ *
+ *  This method is used for creating one texture attachment
+ *  of the passed in format.
+ ***********************************************************/
+ResourceRef RenderTargetPool::CreateAttachment(GLenum format, int width, int height)
+{
+	GLuint textureID = 0;
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_2D, textureID);
+	AllocateTextureStorage(format, width, height);
+
+	// the targets are sampled one texel at a time
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	if (IsDepthFormat(format) == true)
+	{
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	return(ResourceRef(
+		m_pResourceManager,
+		m_pResourceManager->Register(
+			ResourceManager::RESOURCE_TEXTURE,
+			textureID,
+			(size_t)width * height * BytesPerPixel(format))));
+}
@@ -0,0 +1,86 @@
+///////////////////////////////////////////////////////////////////////////////
+// rendertargetpool.h
+// ============
+// offscreen render targets that follow the size of the window framebuffer
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ResourceManager.h"
+
+#include <vector>
+
+/***********************************************************
+ *  RenderTargetPool
+ *
+ *  This class owns the offscreen framebuffers that the 3D
+ *  scenes are rendered into.  The targets are only resized
+ *  when they are bound, and they are allocated with some
+ *  slack so that dragging the window edge does not create
+ *  new textures every frame - a target grows as soon as it
+ *  is too small, but only shrinks after the window has
+ *  stayed much smaller than the target for a while.  The
+ *  scene is drawn into the lower left corner of the target
+ *  at the exact framebuffer size.
+ ***********************************************************/
+class RenderTargetPool
+{
+public:
+	// constructor
+	RenderTargetPool(ResourceManager* pResourceManager);
+	// destructor
+	~RenderTargetPool();
+
+	// add a target with the passed in color and depth formats,
+	// either may be GL_NONE - returns the index of the target
+	int AddTarget(GLenum colorFormat, GLenum depthFormat);
+
+	// set the size that the targets are rendered at this frame
+	void SetRenderSize(int width, int height);
+	int GetRenderWidth() const { return(m_renderWidth); }
+	int GetRenderHeight() const { return(m_renderHeight); }
+
+	// bind a target for rendering, resizing it when needed
+	bool Bind(int target);
+	// copy the rendered area of a target into the window
+	void BlitToWindow(int target);
+	// count the frame towards shrinking the oversized targets
+	void EndFrame();
+
+	// get the OpenGL objects and allocated size of a target
+	GLuint GetFramebuffer(int target) const;
+	GLuint GetColorTexture(int target) const;
+	GLuint GetDepthTexture(int target) const;
+	int GetAllocatedWidth(int target) const;
+	int GetAllocatedHeight(int target) const;
+
+private:
+	struct RENDER_TARGET
+	{
+		GLenum colorFormat;
+		GLenum depthFormat;
+		int width;
+		int height;
+		// frames that the target has been oversized for
+		int oversizedFrames;
+		ResourceRef framebuffer;
+		ResourceRef colorTexture;
+		ResourceRef depthTexture;
+	};
+
+	// pointer to the manager that owns the OpenGL resources
+	ResourceManager* m_pResourceManager;
+	// the pooled render targets
+	std::vector<RENDER_TARGET> m_targets;
+	// size that the targets are rendered at this frame
+	int m_renderWidth;
+	int m_renderHeight;
+
+	// check whether a target needs a new allocation
+	bool NeedsResize(const RENDER_TARGET& target) const;
+	// create the OpenGL objects of a target at a new size
+	bool Allocate(RENDER_TARGET& target);
+	// create one texture attachment of a target
+	ResourceRef CreateAttachment(GLenum format, int width, int height);
+};
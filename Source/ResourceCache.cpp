@@ -0,0 +1,956 @@
+///////////////////////////////////////////////////////////////////////////////
+// resourcecache.cpp
+// ============
+// share the loaded textures and meshes between the 3D scenes
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ResourceCache.h"
+#include "JpegDecoder.h"
+#include "VirtualTextures.h"
+
+#ifndef STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+// declaration of global variables
+namespace
+{
+	// the previews are decoded at an eighth of the full size, and
+	// loaded as the third mip level of the texture
+	const int g_PreviewScaleShift = 3;
+	// smaller images are decoded at full size right away
+	const int g_PreviewMinimumSize = 512;
+}
+
+/***********************************************************
+ *  ResourceCache()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ResourceCache::ResourceCache(ResourceManager* pResourceManager)
+{
+	m_pResourceManager = pResourceManager;
+	m_pAssetPack = NULL;
+	m_pVirtualTextures = NULL;
+	m_pShapeMeshes = new ShapeMeshes();
+	m_bStopLoader = false;
+	m_pFileReader = NULL;
+	m_pStageReader = NULL;
+
+	// indicate to always flip images vertically when loaded, this
+	// is set once here because the loader thread decodes as well
+	stbi_set_flip_vertically_on_load(true);
+}
+
+/***********************************************************
+ *  ~ResourceCache()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ResourceCache::~ResourceCache()
+{
+	// stop the loader thread and drop the images it decoded
+	if (m_loaderThread.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_loaderMutex);
+			m_bStopLoader = true;
+		}
+		m_loaderCondition.notify_all();
+		m_loaderThread.join();
+	}
+	// the reader waits for the reads it has in flight
+	if (NULL != m_pFileReader)
+	{
+		delete m_pFileReader;
+		m_pFileReader = NULL;
+	}
+	m_readFiles.clear();
+	if (NULL != m_pStageReader)
+	{
+		delete m_pStageReader;
+		m_pStageReader = NULL;
+	}
+	m_stageReads.clear();
+	for (int i = 0; i < m_decodedImages.size(); i++)
+	{
+		FreeImage(m_decodedImages[i]);
+	}
+	m_decodedImages.clear();
+
+	// release the cached textures to the resource manager
+	m_textures.clear();
+	m_pResourceManager = NULL;
+	if (NULL != m_pShapeMeshes)
+	{
+		delete m_pShapeMeshes;
+		m_pShapeMeshes = NULL;
+	}
+}
+
+/***********************************************************
+ *  AcquireTexture()
+ *
+ *  This method is used for getting a reference to the
+ *  texture for an image file.  The file is only read and
+ *  uploaded the first time any scene asks for it.
+ ***********************************************************/
+ResourceRef ResourceCache::AcquireTexture(const char* filename)
+{
+	int index = 0;
+
+	while (index < m_textures.size())
+	{
+		if (m_textures[index].filename.compare(filename) == 0)
+		{
+			return(m_textures[index].texture);
+		}
+		index++;
+	}
+
+	CACHED_TEXTURE cached;
+	cached.filename = filename;
+	cached.bPreview = false;
+	cached.texture = LoadTexture(filename);
+	if (cached.texture.IsValid() == false)
+	{
+		return(ResourceRef());
+	}
+	m_textures.push_back(cached);
+
+	return(cached.texture);
+}
+
+/***********************************************************
+ *  RequestTexture()
+ *
+ *  This method is used for queueing an image file to be
+ *  decoded on the loader thread.  Files that are already
+ *  loaded, queued or known to fail are not queued again.
+ ***********************************************************/
+void ResourceCache::RequestTexture(const char* filename)
+{
+	if (GetTextureState(filename) != TEXTURE_NOT_LOADED)
+	{
+		return;
+	}
+
+	// the loader thread and the file reader are only started
+	// once they are needed - the files that the reader has read
+	// are queued for the loader thread to decode
+	if (!m_loaderThread.joinable())
+	{
+		m_pFileReader = new AsyncFileReader(
+			[this](AsyncFileReader::READ_RESULT& result)
+			{
+				{
+					std::lock_guard<std::mutex> lock(m_loaderMutex);
+					m_readFiles.push_back(AsyncFileReader::READ_RESULT());
+					m_readFiles.back().filePath.swap(result.filePath);
+					m_readFiles.back().data.swap(result.data);
+					m_readFiles.back().bSucceeded = result.bSucceeded;
+				}
+				m_loaderCondition.notify_one();
+			});
+		m_pFileReader->Start();
+		m_loaderThread = std::thread(&ResourceCache::LoaderThread, this);
+	}
+
+	m_pendingFiles.push_back(filename);
+	{
+		std::lock_guard<std::mutex> lock(m_loaderMutex);
+		m_requestedFiles.push_back(filename);
+	}
+	m_loaderCondition.notify_one();
+}
+
+/***********************************************************
+ *  GetTextureState()
+ *
+ *  This method is used for getting whether the texture for
+ *  an image file is loaded, still loading, or has failed.
+ ***********************************************************/
+ResourceCache::TEXTURE_STATE ResourceCache::GetTextureState(const char* filename) const
+{
+	for (int i = 0; i < m_textures.size(); i++)
+	{
+		if (m_textures[i].filename.compare(filename) == 0)
+		{
+			return(TEXTURE_LOADED);
+		}
+	}
+	for (int i = 0; i < m_pendingFiles.size(); i++)
+	{
+		if (m_pendingFiles[i].compare(filename) == 0)
+		{
+			return(TEXTURE_LOADING);
+		}
+	}
+	for (int i = 0; i < m_failedFiles.size(); i++)
+	{
+		if (m_failedFiles[i].compare(filename) == 0)
+		{
+			return(TEXTURE_FAILED);
+		}
+	}
+
+	return(TEXTURE_NOT_LOADED);
+}
+
+/***********************************************************
+ *  UploadLoadedTextures()
+ *
+ *  This method is used for creating the OpenGL textures for
+ *  the images that the loader thread has decoded.  Only a
+ *  few are uploaded per call, so that a burst of finished
+ *  loads does not stall a frame.  A preview makes the
+ *  texture loaded, and the full image that follows it is
+ *  uploaded into the same texture, while a preview that
+ *  arrives after its full image is dropped.
+ ***********************************************************/
+int ResourceCache::UploadLoadedTextures(int maxUploads)
+{
+	std::vector<DECODED_IMAGE> images;
+	{
+		std::lock_guard<std::mutex> lock(m_loaderMutex);
+		while ((m_decodedImages.size() > 0) && (images.size() < maxUploads))
+		{
+			images.push_back(m_decodedImages.back());
+			m_decodedImages.pop_back();
+		}
+	}
+
+	for (int i = 0; i < images.size(); i++)
+	{
+		int cachedIndex = -1;
+		for (int j = 0; j < m_textures.size(); j++)
+		{
+			if (m_textures[j].filename.compare(images[i].filename) == 0)
+			{
+				cachedIndex = j;
+				break;
+			}
+		}
+		if (images[i].bPreview == true)
+		{
+			if ((cachedIndex >= 0) || (GetTextureState(images[i].filename.c_str()) != TEXTURE_LOADING))
+			{
+				FreeImage(images[i]);
+				continue;
+			}
+		}
+		else if ((cachedIndex >= 0) && (m_textures[cachedIndex].bPreview == true))
+		{
+			UpgradePreviewTexture(m_textures[cachedIndex], images[i]);
+			continue;
+		}
+
+		CACHED_TEXTURE cached;
+		cached.filename = images[i].filename;
+		cached.bPreview = images[i].bPreview;
+		cached.texture = CreateTexture(images[i]);
+		// a preview that fails leaves the full image to report
+		if ((cached.texture.IsValid() == false) && (cached.bPreview == true))
+		{
+			continue;
+		}
+
+		for (int j = 0; j < m_pendingFiles.size(); j++)
+		{
+			if (m_pendingFiles[j].compare(cached.filename) == 0)
+			{
+				m_pendingFiles[j] = m_pendingFiles.back();
+				m_pendingFiles.pop_back();
+				break;
+			}
+		}
+		if (cached.texture.IsValid() == true)
+		{
+			m_textures.push_back(cached);
+		}
+		else
+		{
+			m_failedFiles.push_back(cached.filename);
+		}
+	}
+
+	return((int)images.size());
+}
+
+/***********************************************************
+ *  ReadImageFile()
+ *
+ *  This method is used for reading an image file into
+ *  memory.  Images in the asset pack are not read, since
+ *  their pixels are used where they are mapped.
+ ***********************************************************/
+bool ResourceCache::ReadImageFile(const char* filename, std::vector<unsigned char>& data)
+{
+	data.clear();
+
+	AssetPack::ASSET asset;
+	if ((NULL != m_pAssetPack) &&
+		(m_pAssetPack->Find(filename, asset) == true) &&
+		(asset.type == AssetPack::ASSET_IMAGE))
+	{
+		return(true);
+	}
+
+	std::ifstream file(filename, std::ios::binary);
+	if (!file.is_open())
+	{
+		std::cout << "Could not load image:" << filename << std::endl;
+		return(false);
+	}
+	data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+	return(true);
+}
+
+/***********************************************************
+ *  ReadImageFileAsync()
+ *
+ *  This method is used for reading an image file on the
+ *  stage reader, which keeps the reads of every file in
+ *  flight at once.  The passed in function is called with
+ *  the data on the reader's thread.  When the reader cannot
+ *  be started, the file is read on the calling thread.
+ ***********************************************************/
+void ResourceCache::ReadImageFileAsync(const char* filename, READ_CALLBACK callback)
+{
+	std::vector<unsigned char> data;
+	bool bQueued = false;
+
+	AssetPack::ASSET asset;
+	if ((NULL != m_pAssetPack) &&
+		(m_pAssetPack->Find(filename, asset) == true) &&
+		(asset.type == AssetPack::ASSET_IMAGE))
+	{
+		callback(true, data);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_stageMutex);
+		if (NULL == m_pStageReader)
+		{
+			// hand each read file to the first function waiting for it
+			m_pStageReader = new AsyncFileReader(
+				[this](AsyncFileReader::READ_RESULT& result)
+				{
+					READ_CALLBACK readCallback;
+					{
+						std::lock_guard<std::mutex> lock(m_stageMutex);
+						std::multimap<std::string, READ_CALLBACK>::iterator found = m_stageReads.find(result.filePath);
+						if (found != m_stageReads.end())
+						{
+							readCallback.swap(found->second);
+							m_stageReads.erase(found);
+						}
+					}
+					if (result.bSucceeded == false)
+					{
+						std::cout << "Could not load image:" << result.filePath << std::endl;
+					}
+					if (readCallback)
+					{
+						readCallback(result.bSucceeded, result.data);
+					}
+				});
+			if (m_pStageReader->Start() == false)
+			{
+				delete m_pStageReader;
+				m_pStageReader = NULL;
+			}
+		}
+		if (NULL != m_pStageReader)
+		{
+			m_stageReads.insert(std::make_pair(std::string(filename), callback));
+			bQueued = true;
+		}
+	}
+
+	// a file that cannot be opened is finished inside Read(), so
+	// the lock must not be held here
+	if (bQueued == true)
+	{
+		m_pStageReader->Read(filename);
+	}
+	else
+	{
+		bool bRead = ReadImageFile(filename, data);
+		callback(bRead, data);
+	}
+}
+
+/***********************************************************
+ *  DecodeImageFile()
+ *
+ *  This method is used for decoding an image file that was
+ *  read by ReadImageFile(), or for finding its pixels in
+ *  the asset pack.
+ ***********************************************************/
+bool ResourceCache::DecodeImageFile(
+	const char* filename,
+	const std::vector<unsigned char>& data,
+	DECODED_IMAGE& image)
+{
+	if (FindPackedImage(filename, image) == true)
+	{
+		return(true);
+	}
+
+	return(DecodeImageData(filename, data.data(), data.size(), image));
+}
+
+/***********************************************************
+ *  AddDecodedTexture()
+ *
+ *  This method is used for creating the texture for a
+ *  decoded image and caching it, so that AcquireTexture()
+ *  finds it.  An image whose texture is already cached is
+ *  freed and the cached texture is returned, after the
+ *  image has replaced the preview it may have.
+ ***********************************************************/
+ResourceRef ResourceCache::AddDecodedTexture(DECODED_IMAGE& image)
+{
+	for (int i = 0; i < m_textures.size(); i++)
+	{
+		if (m_textures[i].filename.compare(image.filename) == 0)
+		{
+			if ((m_textures[i].bPreview == true) && (image.bPreview == false))
+			{
+				UpgradePreviewTexture(m_textures[i], image);
+			}
+			FreeImage(image);
+			return(m_textures[i].texture);
+		}
+	}
+
+	CACHED_TEXTURE cached;
+	cached.filename = image.filename;
+	cached.bPreview = image.bPreview;
+	cached.texture = CreateTexture(image);
+	if (cached.texture.IsValid() == false)
+	{
+		return(ResourceRef());
+	}
+	m_textures.push_back(cached);
+
+	return(cached.texture);
+}
+
+/***********************************************************
+ *  ReleaseUnusedTextures()
+ *
+ *  This method is used for dropping the cached textures that
+ *  only the cache itself still refers to.
+ ***********************************************************/
+void ResourceCache::ReleaseUnusedTextures()
+{
+	if (NULL == m_pResourceManager)
+	{
+		return;
+	}
+
+	int index = 0;
+	while (index < m_textures.size())
+	{
+		if (m_pResourceManager->GetReferenceCount(m_textures[index].texture.GetHandle()) <= 1)
+		{
+			if (NULL != m_pVirtualTextures)
+			{
+				m_pVirtualTextures->RemoveTexture(m_textures[index].texture.GetName());
+			}
+			m_textures[index] = m_textures.back();
+			m_textures.pop_back();
+		}
+		else
+		{
+			index++;
+		}
+	}
+}
+
+/***********************************************************
+ *  IsShapeMeshLoaded()
+ *
+ *  These methods are used for tracking which of the shared
+ *  basic shape meshes have been loaded.
+ ***********************************************************/
+bool ResourceCache::IsShapeMeshLoaded(int meshIndex) const
+{
+	return((meshIndex >= 0) &&
+		(meshIndex < m_loadedShapeMeshes.size()) &&
+		(m_loadedShapeMeshes[meshIndex] == true));
+}
+
+void ResourceCache::SetShapeMeshLoaded(int meshIndex)
+{
+	if (meshIndex < 0)
+	{
+		return;
+	}
+	if (meshIndex >= m_loadedShapeMeshes.size())
+	{
+		m_loadedShapeMeshes.resize(meshIndex + 1, false);
+	}
+	m_loadedShapeMeshes[meshIndex] = true;
+}
+
+/***********************************************************
+ *  LoadTexture()
+ *
+ *  This method is used for loading a texture from an image
+ *  file right away, on the calling thread.
+ ***********************************************************/
+ResourceRef ResourceCache::LoadTexture(const char* filename)
+{
+	DECODED_IMAGE image;
+
+	if (DecodeImage(filename, image) == false)
+	{
+		return(ResourceRef());
+	}
+
+	return(CreateTexture(image));
+}
+
+/***********************************************************
+ *  DecodeImage()
+ *
+ *  This method is used for parsing the image data from an
+ *  image file, which is read through the stage reader.  It
+ *  does not touch OpenGL, so it can run on the loader thread.
+ ***********************************************************/
+bool ResourceCache::DecodeImage(const char* filename, DECODED_IMAGE& image)
+{
+	if (FindPackedImage(filename, image) == true)
+	{
+		return(true);
+	}
+
+	// read the file through the stage reader and wait for it,
+	// the reader has all of the chunks of the file in flight
+	std::vector<unsigned char> data;
+	std::mutex readMutex;
+	std::condition_variable readCondition;
+	bool bReadDone = false;
+
+	ReadImageFileAsync(filename,
+		[&data, &readMutex, &readCondition, &bReadDone](bool bRead, std::vector<unsigned char>& fileData)
+		{
+			{
+				std::lock_guard<std::mutex> lock(readMutex);
+				data.swap(fileData);
+				bReadDone = true;
+			}
+			readCondition.notify_one();
+		});
+	{
+		std::unique_lock<std::mutex> lock(readMutex);
+		readCondition.wait(lock, [&bReadDone]() { return(bReadDone); });
+	}
+
+	return(DecodeImageData(filename, data.data(), data.size(), image));
+}
+
+/***********************************************************
+ *  FindPackedImage()
+ *
+ *  This method is used for getting a pre-decoded image from
+ *  the asset pack, which is used right where it is mapped,
+ *  without reading or decoding the file.  Images that are
+ *  not in the pack are recorded for the next cook.
+ ***********************************************************/
+bool ResourceCache::FindPackedImage(const char* filename, DECODED_IMAGE& image)
+{
+	image.filename = filename;
+	image.pixels = NULL;
+	image.width = 0;
+	image.height = 0;
+	image.colorChannels = 0;
+	image.bMapped = false;
+	image.bPreview = false;
+	image.fullWidth = 0;
+	image.fullHeight = 0;
+
+	if (NULL == m_pAssetPack)
+	{
+		return(false);
+	}
+
+	AssetPack::ASSET asset;
+	if ((m_pAssetPack->Find(filename, asset) == true) &&
+		(asset.type == AssetPack::ASSET_IMAGE))
+	{
+		image.pixels = (unsigned char*)asset.pData;
+		image.width = asset.width;
+		image.height = asset.height;
+		image.colorChannels = asset.colorChannels;
+		image.fullWidth = asset.width;
+		image.fullHeight = asset.height;
+		image.bMapped = true;
+		return(true);
+	}
+	m_pAssetPack->RecordFileRead(filename);
+
+	return(false);
+}
+
+/***********************************************************
+ *  DecodeImageData()
+ *
+ *  This method is used for parsing the image data from an
+ *  image file that the file reader has read into memory.
+ ***********************************************************/
+bool ResourceCache::DecodeImageData(
+	const std::string& filename,
+	const unsigned char* pData,
+	size_t size,
+	DECODED_IMAGE& image)
+{
+	image.filename = filename;
+	image.pixels = NULL;
+	image.width = 0;
+	image.height = 0;
+	image.colorChannels = 0;
+	image.bMapped = false;
+	image.bPreview = false;
+	image.fullWidth = 0;
+	image.fullHeight = 0;
+
+	if (size > 0)
+	{
+		image.pixels = stbi_load_from_memory(
+			pData,
+			(int)size,
+			&image.width,
+			&image.height,
+			&image.colorChannels,
+			0);
+	}
+
+	// if the image was not read or decoded
+	if (NULL == image.pixels)
+	{
+		std::cout << "Could not load image:" << filename << std::endl;
+		return(false);
+	}
+	image.fullWidth = image.width;
+	image.fullHeight = image.height;
+
+	return(true);
+}
+
+/***********************************************************
+ *  DecodePreviewData()
+ *
+ *  This method is used for decoding a JPEG file that has
+ *  been read into memory at an eighth of its size, for the
+ *  low mip levels of its texture.  Only large RGB images
+ *  get a preview, and the decoder leaves progressive files
+ *  to the full decode.
+ ***********************************************************/
+bool ResourceCache::DecodePreviewData(
+	const std::string& filename,
+	const unsigned char* pData,
+	size_t size,
+	DECODED_IMAGE& image)
+{
+	JpegDecoder decoder;
+	std::vector<unsigned char> pixels;
+
+	image.filename = filename;
+	image.pixels = NULL;
+	image.width = 0;
+	image.height = 0;
+	image.colorChannels = 0;
+	image.bMapped = false;
+	image.bPreview = true;
+
+	if ((JpegDecoder::IsJpeg(pData, size) == false) ||
+		(decoder.ReadHeader(pData, size, image.fullWidth, image.fullHeight, image.colorChannels) == false) ||
+		(image.colorChannels != 3) ||
+		(std::max(image.fullWidth, image.fullHeight) < g_PreviewMinimumSize))
+	{
+		return(false);
+	}
+
+	// the rows are flipped to match the images from stb_image
+	if (decoder.Decode(
+		pData,
+		size,
+		g_PreviewScaleShift,
+		true,
+		pixels,
+		image.width,
+		image.height,
+		image.colorChannels) == false)
+	{
+		return(false);
+	}
+
+	image.pixels = new unsigned char[pixels.size()];
+	memcpy(image.pixels, pixels.data(), pixels.size());
+
+	return(true);
+}
+
+/***********************************************************
+ *  CreateTexture()
+ *
+ *  This method is used for creating an OpenGL texture from
+ *  a decoded image, configuring the texture mapping
+ *  parameters and generating the mipmaps.  The image data
+ *  is freed afterwards.
+ ***********************************************************/
+ResourceRef ResourceCache::CreateTexture(DECODED_IMAGE& image)
+{
+	GLuint textureID = 0;
+
+	if (NULL == image.pixels)
+	{
+		return(ResourceRef());
+	}
+
+	if (image.bPreview == true)
+		std::cout << "Successfully loaded preview:" << image.filename << ", width:" << image.width << ", height:" << image.height << ", channels:" << image.colorChannels << std::endl;
+	else
+		std::cout << "Successfully loaded image:" << image.filename << ", width:" << image.width << ", height:" << image.height << ", channels:" << image.colorChannels << std::endl;
+
+	// a large image is paged, and only the texture of its
+	// resident level is created here
+	if ((image.bPreview == false) &&
+		(NULL != m_pVirtualTextures) &&
+		(NULL != m_pResourceManager) &&
+		(m_pVirtualTextures->CanAddTexture(image.width, image.height, image.colorChannels) == true))
+	{
+		size_t pagedBytes = 0;
+		textureID = m_pVirtualTextures->AddTexture(
+			image.pixels,
+			image.width,
+			image.height,
+			image.colorChannels,
+			pagedBytes);
+		FreeImage(image);
+		if (textureID == 0)
+		{
+			return(ResourceRef());
+		}
+
+		return(ResourceRef(
+			m_pResourceManager,
+			m_pResourceManager->Register(
+				ResourceManager::RESOURCE_TEXTURE,
+				textureID,
+				pagedBytes)));
+	}
+
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_2D, textureID);
+
+	// set the texture wrapping parameters
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	// set texture filtering parameters
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	// a preview is loaded as the mip level of its size, which
+	// is rounded down where the preview was rounded up, and
+	// the texture is sampled from that level until the full
+	// image replaces it
+	if ((image.bPreview == true) && (image.colorChannels == 3))
+	{
+		int levelWidth = std::max(image.fullWidth >> g_PreviewScaleShift, 1);
+		int levelHeight = std::max(image.fullHeight >> g_PreviewScaleShift, 1);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, image.width);
+		glTexImage2D(GL_TEXTURE_2D, g_PreviewScaleShift, GL_RGB8, levelWidth, levelHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, image.pixels);
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, g_PreviewScaleShift);
+	}
+	// if the loaded image is in RGB format
+	else if (image.colorChannels == 3)
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, image.width, image.height, 0, GL_RGB, GL_UNSIGNED_BYTE, image.pixels);
+	// if the loaded image is in RGBA format - it supports transparency
+	else if (image.colorChannels == 4)
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, image.width, image.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.pixels);
+	else
+	{
+		std::cout << "Not implemented to handle image with " << image.colorChannels << " channels" << std::endl;
+		FreeImage(image);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		glDeleteTextures(1, &textureID);
+		return(ResourceRef());
+	}
+
+	// generate the texture mipmaps for mapping textures to lower resolutions
+	if (image.bPreview == false)
+		glGenerateMipmap(GL_TEXTURE_2D);
+
+	// free the image data from local memory
+	FreeImage(image);
+	glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
+
+	if (NULL == m_pResourceManager)
+	{
+		glDeleteTextures(1, &textureID);
+		return(ResourceRef());
+	}
+
+	// hand the texture to the resource manager, which deletes
+	// it once the last reference has been released - the
+	// size estimate includes a third extra for the mipmaps,
+	// and for a preview it is already that of the full image
+	size_t textureBytes = (size_t)image.fullWidth * image.fullHeight * 4;
+	textureBytes += textureBytes / 3;
+	return(ResourceRef(
+		m_pResourceManager,
+		m_pResourceManager->Register(
+			ResourceManager::RESOURCE_TEXTURE,
+			textureID,
+			textureBytes)));
+}
+
+/***********************************************************
+ *  UpgradePreviewTexture()
+ *
+ *  This method is used for uploading the full image into
+ *  the texture that was created for its preview, and
+ *  generating the mipmaps from it.  The texture stays the
+ *  same, so the scenes that use it draw the full image from
+ *  the next frame on.  If the full image failed to decode,
+ *  the preview is kept.
+ ***********************************************************/
+void ResourceCache::UpgradePreviewTexture(CACHED_TEXTURE& cached, DECODED_IMAGE& image)
+{
+	if ((NULL == image.pixels) ||
+		(image.colorChannels != 3) ||
+		(cached.texture.IsValid() == false))
+	{
+		FreeImage(image);
+		return;
+	}
+
+	std::cout << "Successfully loaded image:" << image.filename << ", width:" << image.width << ", height:" << image.height << ", channels:" << image.colorChannels << std::endl;
+
+	glBindTexture(GL_TEXTURE_2D, cached.texture.GetName());
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, image.width, image.height, 0, GL_RGB, GL_UNSIGNED_BYTE, image.pixels);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+	glGenerateMipmap(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	FreeImage(image);
+	cached.bPreview = false;
+}
+
+/***********************************************************
+ *  FreeImage()
+ *
+ *  This method is used for freeing the pixels of a decoded
+ *  image, unless they are part of the mapped asset pack.
+ ***********************************************************/
+void ResourceCache::FreeImage(DECODED_IMAGE& image)
+{
+	if ((NULL != image.pixels) && (image.bMapped == false))
+	{
+		if (image.bPreview == true)
+			delete[] image.pixels;
+		else
+			stbi_image_free(image.pixels);
+	}
+	image.pixels = NULL;
+}
+
+/***********************************************************
+ *  LoaderThread()
+ *
+ *  This method is run on the loader thread.  It passes the
+ *  requested image files to the file reader as they come
+ *  in, so that the reads queue up, and decodes the files
+ *  that have been read one at a time, handing them back for
+ *  the upload, until the cache is destroyed.  The preview
+ *  of a large JPEG file is handed back before its full
+ *  decode starts.
+ ***********************************************************/
+void ResourceCache::LoaderThread()
+{
+	while (true)
+	{
+		std::deque<std::string> requestedFiles;
+		AsyncFileReader::READ_RESULT readFile;
+		bool bReadFile = false;
+		{
+			std::unique_lock<std::mutex> lock(m_loaderMutex);
+			while ((m_requestedFiles.size() == 0) &&
+				(m_readFiles.size() == 0) &&
+				(m_bStopLoader == false))
+			{
+				m_loaderCondition.wait(lock);
+			}
+			if (m_bStopLoader == true)
+			{
+				return;
+			}
+			requestedFiles.swap(m_requestedFiles);
+			if (m_readFiles.size() > 0)
+			{
+				readFile.filePath.swap(m_readFiles.front().filePath);
+				readFile.data.swap(m_readFiles.front().data);
+				readFile.bSucceeded = m_readFiles.front().bSucceeded;
+				m_readFiles.pop_front();
+				bReadFile = true;
+			}
+		}
+
+		// the images in the asset pack are ready right away, and
+		// the others are read before they can be decoded
+		for (int i = 0; i < requestedFiles.size(); i++)
+		{
+			DECODED_IMAGE image;
+			if (FindPackedImage(requestedFiles[i].c_str(), image) == true)
+			{
+				std::lock_guard<std::mutex> lock(m_loaderMutex);
+				m_decodedImages.push_back(image);
+			}
+			else
+			{
+				m_pFileReader->Read(requestedFiles[i]);
+			}
+		}
+
+		// a failed decode is handed back as well, with no pixels,
+		// so that the file is no longer reported as loading
+		if (bReadFile == true)
+		{
+			// a paged image has no preview, since its resident
+			// level is built from the full decode
+			DECODED_IMAGE preview;
+			if ((NULL == m_pVirtualTextures) &&
+				(DecodePreviewData(readFile.filePath, readFile.data.data(), readFile.data.size(), preview) == true))
+			{
+				std::lock_guard<std::mutex> lock(m_loaderMutex);
+				m_decodedImages.push_back(preview);
+			}
+
+			DECODED_IMAGE image;
+			DecodeImageData(readFile.filePath, readFile.data.data(), readFile.data.size(), image);
+
+			std::lock_guard<std::mutex> lock(m_loaderMutex);
+			m_decodedImages.push_back(image);
+		}
+	}
+}
@@ -0,0 +1,196 @@
+///////////////////////////////////////////////////////////////////////////////
+// resourcecache.h
+// ============
+// share the loaded textures and meshes between the 3D scenes
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ResourceManager.h"
+#include "ShapeMeshes.h"
+#include "AssetPack.h"
+#include "AsyncFileReader.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class VirtualTextures;
+
+/***********************************************************
+ *  ResourceCache
+ *
+ *  This class loads each texture file and each basic shape
+ *  mesh only once, no matter how many scenes use them.  The
+ *  scenes hold references to the cached textures, and the
+ *  cache keeps its own reference so that a texture stays
+ *  loaded when a scene is unloaded and prepared again.
+ *  Textures can also be requested ahead of time, in which
+ *  case the image files are decoded on a loader thread and
+ *  only the upload is done on the thread that owns the
+ *  OpenGL context.  The loader thread hands all requested
+ *  files to an asynchronous reader at once, and decodes
+ *  each one as soon as its data has arrived, while the
+ *  others are still being read.  Textures loaded right away
+ *  read their files through a second reader, so that each
+ *  file is still read in chunks that are all in flight.
+ *  A large JPEG file is first decoded at an eighth of its
+ *  size, which only takes a fraction of the full decode, and
+ *  uploaded as the low mip levels of its texture, so that
+ *  the texture can be drawn while the full image is still
+ *  being decoded.
+ ***********************************************************/
+class ResourceCache
+{
+public:
+	// constructor
+	ResourceCache(ResourceManager* pResourceManager);
+	// destructor
+	~ResourceCache();
+
+	// loading state of the texture for an image file
+	enum TEXTURE_STATE
+	{
+		TEXTURE_NOT_LOADED,
+		TEXTURE_LOADING,
+		TEXTURE_LOADED,
+		TEXTURE_FAILED
+	};
+
+	// get the texture for an image file, loading it on first use -
+	// the returned reference is empty when the file fails to load
+	ResourceRef AcquireTexture(const char* filename);
+	// queue an image file to be decoded on the loader thread
+	void RequestTexture(const char* filename);
+	// get the loading state of the texture for an image file
+	TEXTURE_STATE GetTextureState(const char* filename) const;
+	// create the textures for the images decoded by the loader
+	// thread, at most the passed in number per call
+	int UploadLoadedTextures(int maxUploads);
+	// release the cached textures that no scene refers to
+	void ReleaseUnusedTextures();
+
+	// image file decoded into memory, waiting to be uploaded
+	struct DECODED_IMAGE
+	{
+		std::string filename;
+		unsigned char* pixels;
+		int width;
+		int height;
+		int colorChannels;
+		// the pixels point into the mapped asset pack, and are
+		// not freed after the upload
+		bool bMapped;
+		// the pixels are a reduced size preview of an image of
+		// the full width and height, allocated with new[]
+		bool bPreview;
+		int fullWidth;
+		int fullHeight;
+	};
+
+	// the stages of loading a texture, for loaders that schedule
+	// them on their own threads - reading and decoding an image
+	// file can run on any thread, while adding the texture to
+	// the cache has to run on the OpenGL thread
+	bool ReadImageFile(const char* filename, std::vector<unsigned char>& data);
+	// start reading an image file on a file reader, and call the
+	// passed in function with the data once it has arrived, on the
+	// reader's thread - images in the asset pack are passed on
+	// right away, without data
+	typedef std::function<void(bool bRead, std::vector<unsigned char>& data)> READ_CALLBACK;
+	void ReadImageFileAsync(const char* filename, READ_CALLBACK callback);
+	bool DecodeImageFile(const char* filename, const std::vector<unsigned char>& data, DECODED_IMAGE& image);
+	ResourceRef AddDecodedTexture(DECODED_IMAGE& image);
+
+	// get the basic shape meshes shared by all scenes
+	ShapeMeshes* GetShapeMeshes() { return(m_pShapeMeshes); }
+	// check and record whether a basic shape mesh is loaded,
+	// so that each mesh is loaded only by the first scene
+	bool IsShapeMeshLoaded(int meshIndex) const;
+	void SetShapeMeshLoaded(int meshIndex);
+
+	// get the manager that owns the cached resources
+	ResourceManager* GetResourceManager() { return(m_pResourceManager); }
+	// set the pack that the image files are read from first,
+	// before any texture is requested
+	void SetAssetPack(AssetPack* pAssetPack) { m_pAssetPack = pAssetPack; }
+	// set the virtual textures that large images are paged into,
+	// before any texture is requested
+	void SetVirtualTextures(VirtualTextures* pVirtualTextures) { m_pVirtualTextures = pVirtualTextures; }
+
+private:
+	struct CACHED_TEXTURE
+	{
+		std::string filename;
+		ResourceRef texture;
+		// only the preview levels are loaded, and the full image
+		// is still to be uploaded into the same texture
+		bool bPreview;
+	};
+
+	// pointer to the manager that owns the OpenGL resources
+	ResourceManager* m_pResourceManager;
+	// pointer to the pack of pre-decoded images, may be NULL
+	AssetPack* m_pAssetPack;
+	// pointer to the virtual textures, may be NULL
+	VirtualTextures* m_pVirtualTextures;
+	// the loaded textures, searched by file name
+	std::vector<CACHED_TEXTURE> m_textures;
+	// the shared basic shape meshes and which are loaded
+	ShapeMeshes* m_pShapeMeshes;
+	std::vector<bool> m_loadedShapeMeshes;
+
+	// files requested but not uploaded yet, and files that could
+	// not be loaded - only used on the OpenGL thread
+	std::vector<std::string> m_pendingFiles;
+	std::vector<std::string> m_failedFiles;
+	// loader thread and the queues shared with it
+	std::thread m_loaderThread;
+	std::mutex m_loaderMutex;
+	std::condition_variable m_loaderCondition;
+	std::deque<std::string> m_requestedFiles;
+	std::vector<DECODED_IMAGE> m_decodedImages;
+	bool m_bStopLoader;
+	// reader of the requested files that are not in the asset
+	// pack, and the files it has read that wait to be decoded
+	AsyncFileReader* m_pFileReader;
+	std::deque<AsyncFileReader::READ_RESULT> m_readFiles;
+	// reader of the files loaded outside the loader thread, and
+	// the functions waiting for each file it reads
+	AsyncFileReader* m_pStageReader;
+	std::mutex m_stageMutex;
+	std::multimap<std::string, READ_CALLBACK> m_stageReads;
+
+	// load an image file into a new OpenGL texture
+	ResourceRef LoadTexture(const char* filename);
+	// read and decode an image file into memory
+	bool DecodeImage(const char* filename, DECODED_IMAGE& image);
+	// find the pre-decoded pixels of an image in the asset pack
+	bool FindPackedImage(const char* filename, DECODED_IMAGE& image);
+	// decode an image file that has already been read
+	bool DecodeImageData(
+		const std::string& filename,
+		const unsigned char* pData,
+		size_t size,
+		DECODED_IMAGE& image);
+	// decode the reduced size preview of a large JPEG file
+	bool DecodePreviewData(
+		const std::string& filename,
+		const unsigned char* pData,
+		size_t size,
+		DECODED_IMAGE& image);
+	// create an OpenGL texture from a decoded image
+	ResourceRef CreateTexture(DECODED_IMAGE& image);
+	// upload the full image into the texture of its preview
+	void UpgradePreviewTexture(CACHED_TEXTURE& cached, DECODED_IMAGE& image);
+	// free the pixels of a decoded image
+	void FreeImage(DECODED_IMAGE& image);
+	// read and decode the requested image files until stopped
+	void LoaderThread();
+};
@@ -0,0 +1,437 @@
+///////////////////////////////////////////////////////////////////////////////
+// resourcemanager.cpp
+// ============
+// manage the lifetime of the OpenGL resources used by the 3D scenes
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ResourceManager.h"
+
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// the number of frames the CPU may record ahead of the GPU
+	// before EndFrame() waits for the oldest frame to finish
+	const int g_MaxFramesInFlight = 3;
+
+	// names of the resource types for the live resource report
+	const char* g_ResourceTypeNames[] =
+	{
+		"textures",
+		"buffers",
+		"vertex arrays",
+		"programs",
+		"renderbuffers",
+		"framebuffers"
+	};
+}
+
+/***********************************************************
+ *  ResourceManager()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ResourceManager::ResourceManager()
+{
+	m_currentFrame = 0;
+	for (int i = 0; i < RESOURCE_TYPE_COUNT; i++)
+	{
+		m_liveCount[i] = 0;
+		m_liveBytes[i] = 0;
+	}
+}
+
+/***********************************************************
+ *  ~ResourceManager()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ResourceManager::~ResourceManager()
+{
+	// wait for the GPU so that everything can be deleted now
+	glFinish();
+	for (int i = 0; i < m_frameFences.size(); i++)
+	{
+		glDeleteSync(m_frameFences[i]);
+	}
+	m_frameFences.clear();
+	m_fenceFrames.clear();
+	DeletePendingBefore(m_currentFrame + 1);
+
+	// anything still referenced at this point has leaked
+	int leakedCount = m_entries.Size();
+	const RESOURCE_ENTRY* pEntries = m_entries.Data();
+	for (int i = 0; i < leakedCount; i++)
+	{
+		DeleteObject(pEntries[i].type, pEntries[i].name);
+		m_liveCount[pEntries[i].type]--;
+		m_liveBytes[pEntries[i].type] -= pEntries[i].bytes;
+	}
+	if (leakedCount > 0)
+	{
+		std::cout << "WARNING: " << leakedCount << " OpenGL resources were still referenced at shutdown" << std::endl;
+	}
+	m_entries.Clear();
+}
+
+/***********************************************************
+ *  Register()
+ *
+ *  This method is used for taking ownership of an existing
+ *  OpenGL object.  The returned handle holds one reference.
+ ***********************************************************/
+ResourceManager::RESOURCE_HANDLE ResourceManager::Register(
+	RESOURCE_TYPE type,
+	GLuint name,
+	size_t bytes)
+{
+	RESOURCE_ENTRY entry;
+	entry.type = type;
+	entry.name = name;
+	entry.bytes = bytes;
+	entry.referenceCount = 1;
+
+	RESOURCE_HANDLE handle = m_entries.Add(entry);
+	if (handle == HandlePool<RESOURCE_ENTRY>::InvalidHandle())
+	{
+		std::cout << "Could not register OpenGL resource, all handles are in use" << std::endl;
+		DeleteObject(type, name);
+		return(handle);
+	}
+
+	m_liveCount[type]++;
+	m_liveBytes[type] += bytes;
+
+	return(handle);
+}
+
+/***********************************************************
+ *  AddReference()
+ *
+ *  This method is used for adding a reference to the
+ *  resource for the passed in handle.
+ ***********************************************************/
+void ResourceManager::AddReference(RESOURCE_HANDLE handle)
+{
+	RESOURCE_ENTRY* pEntry = m_entries.Get(handle);
+	if (NULL != pEntry)
+	{
+		pEntry->referenceCount++;
+	}
+}
+
+/***********************************************************
+ *  Release()
+ *
+ *  This method is used for releasing a reference to the
+ *  resource for the passed in handle.  When the last
+ *  reference is released, the handle is freed immediately
+ *  but the OpenGL object is kept until the GPU has finished
+ *  the frames that were recorded while it was alive.
+ ***********************************************************/
+void ResourceManager::Release(RESOURCE_HANDLE handle)
+{
+	RESOURCE_ENTRY* pEntry = m_entries.Get(handle);
+	if (NULL == pEntry)
+	{
+		return;
+	}
+
+	pEntry->referenceCount--;
+	if (pEntry->referenceCount > 0)
+	{
+		return;
+	}
+
+	PENDING_DELETE pending;
+	pending.type = pEntry->type;
+	pending.name = pEntry->name;
+	pending.bytes = pEntry->bytes;
+	pending.frame = m_currentFrame;
+	m_pendingDeletes.push_back(pending);
+
+	// removing the entry makes the existing handles stale
+	m_entries.Remove(handle);
+}
+
+/***********************************************************
+ *  IsValid()
+ *
+ *  This method is used for checking whether the passed in
+ *  handle still refers to a live resource.
+ ***********************************************************/
+bool ResourceManager::IsValid(RESOURCE_HANDLE handle) const
+{
+	return(m_entries.IsValid(handle));
+}
+
+/***********************************************************
+ *  GetName()
+ *
+ *  This method is used for getting the OpenGL object name
+ *  for the passed in handle.
+ ***********************************************************/
+GLuint ResourceManager::GetName(RESOURCE_HANDLE handle) const
+{
+	const RESOURCE_ENTRY* pEntry = m_entries.Get(handle);
+	if (NULL == pEntry)
+	{
+		return(0);
+	}
+
+	return(pEntry->name);
+}
+
+/***********************************************************
+ *  GetReferenceCount()
+ *
+ *  This method is used for getting the number of references
+ *  held to the resource for the passed in handle.
+ ***********************************************************/
+int ResourceManager::GetReferenceCount(RESOURCE_HANDLE handle) const
+{
+	const RESOURCE_ENTRY* pEntry = m_entries.Get(handle);
+	if (NULL == pEntry)
+	{
+		return(0);
+	}
+
+	return(pEntry->referenceCount);
+}
+
+/***********************************************************
+ *  GetBytes()
+ *
+ *  This method is used for getting the estimated GPU memory
+ *  used by the resource for the passed in handle.
+ ***********************************************************/
+size_t ResourceManager::GetBytes(RESOURCE_HANDLE handle) const
+{
+	const RESOURCE_ENTRY* pEntry = m_entries.Get(handle);
+	if (NULL == pEntry)
+	{
+		return(0);
+	}
+
+	return(pEntry->bytes);
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for fencing the commands recorded in
+ *  the current frame and deleting the released resources
+ *  from every frame that the GPU has finished.
+ ***********************************************************/
+void ResourceManager::EndFrame()
+{
+	m_frameFences.push_back(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+	m_fenceFrames.push_back(m_currentFrame);
+	m_currentFrame++;
+
+	// retire every finished frame, waiting on the oldest one
+	// only when too many frames are in flight
+	while (m_frameFences.size() > 0)
+	{
+		GLuint64 timeout = 0;
+		if (m_frameFences.size() > g_MaxFramesInFlight)
+		{
+			timeout = 1000000000;
+		}
+
+		GLenum result = glClientWaitSync(m_frameFences[0], 0, timeout);
+		if ((result != GL_ALREADY_SIGNALED) && (result != GL_CONDITION_SATISFIED))
+		{
+			break;
+		}
+
+		DeletePendingBefore(m_fenceFrames[0] + 1);
+		glDeleteSync(m_frameFences[0]);
+		m_frameFences.erase(m_frameFences.begin());
+		m_fenceFrames.erase(m_fenceFrames.begin());
+	}
+}
+
+/***********************************************************
+ *  ReportLiveResources()
+ *
+ *  This method is used for printing the number and the size
+ *  of the live resources of each type.
+ ***********************************************************/
+void ResourceManager::ReportLiveResources() const
+{
+	std::cout << "INFO: Live OpenGL resources" << std::endl;
+	for (int i = 0; i < RESOURCE_TYPE_COUNT; i++)
+	{
+		std::cout << "    " << g_ResourceTypeNames[i] << ": " << m_liveCount[i]
+			<< " (" << (m_liveBytes[i] / 1024) << " KB)" << std::endl;
+	}
+	std::cout << "    pending deletes: " << m_pendingDeletes.size() << std::endl;
+}
+
+/***********************************************************
+ *  DeleteObject()
+ *
+ *  This method is used for deleting the OpenGL object of
+ *  the passed in type.
+ ***********************************************************/
+void ResourceManager::DeleteObject(RESOURCE_TYPE type, GLuint name)
+{
+	switch (type)
+	{
+	case RESOURCE_TEXTURE:
+		glDeleteTextures(1, &name);
+		break;
+	case RESOURCE_BUFFER:
+		glDeleteBuffers(1, &name);
+		break;
+	case RESOURCE_VERTEX_ARRAY:
+		glDeleteVertexArrays(1, &name);
+		break;
+	case RESOURCE_PROGRAM:
+		glDeleteProgram(name);
+		break;
+	case RESOURCE_RENDERBUFFER:
+		glDeleteRenderbuffers(1, &name);
+		break;
+	case RESOURCE_FRAMEBUFFER:
+		glDeleteFramebuffers(1, &name);
+		break;
+	default:
+		break;
+	}
+}
+
+/***********************************************************
+ *  DeletePendingBefore()
+ *
+ *  This method is used for deleting the pending resources
+ *  that were released before the passed in frame.
+ ***********************************************************/
+void ResourceManager::DeletePendingBefore(uint64_t frame)
+{
+	int index = 0;
+	while (index < m_pendingDeletes.size())
+	{
+		const PENDING_DELETE& pending = m_pendingDeletes[index];
+		if (pending.frame < frame)
+		{
+			DeleteObject(pending.type, pending.name);
+			m_liveCount[pending.type]--;
+			m_liveBytes[pending.type] -= pending.bytes;
+
+			m_pendingDeletes[index] = m_pendingDeletes.back();
+			m_pendingDeletes.pop_back();
+		}
+		else
+		{
+			index++;
+		}
+	}
+}
+
+/***********************************************************
+ *  ResourceRef()
+ *
+ *  The constructors for the class - a reference created from
+ *  a handle takes over the reference that the handle holds.
+ ***********************************************************/
+ResourceRef::ResourceRef()
+{
+	m_pManager = NULL;
+	m_handle.value = 0;
+}
+
+ResourceRef::ResourceRef(ResourceManager* pManager, ResourceManager::RESOURCE_HANDLE handle)
+{
+	m_pManager = pManager;
+	m_handle = handle;
+}
+
+ResourceRef::ResourceRef(const ResourceRef& other)
+{
+	m_pManager = other.m_pManager;
+	m_handle = other.m_handle;
+	if (NULL != m_pManager)
+	{
+		m_pManager->AddReference(m_handle);
+	}
+}
+
+/***********************************************************
+ *  operator=()
+ *
+ *  This method is used for sharing the reference held by
+ *  another object, releasing the current reference.
+ ***********************************************************/
+ResourceRef& ResourceRef::operator=(const ResourceRef& other)
+{
+	if (this != &other)
+	{
+		// add the new reference first, in case both refer
+		// to the same resource
+		if (NULL != other.m_pManager)
+		{
+			other.m_pManager->AddReference(other.m_handle);
+		}
+		Reset();
+		m_pManager = other.m_pManager;
+		m_handle = other.m_handle;
+	}
+
+	return(*this);
+}
+
+/***********************************************************
+ *  ~ResourceRef()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ResourceRef::~ResourceRef()
+{
+	Reset();
+}
+
+/***********************************************************
+ *  Reset()
+ *
+ *  This method is used for releasing the held reference.
+ ***********************************************************/
+void ResourceRef::Reset()
+{
+	if (NULL != m_pManager)
+	{
+		m_pManager->Release(m_handle);
+	}
+	m_pManager = NULL;
+	m_handle.value = 0;
+}
+
+/***********************************************************
+ *  IsValid()
+ *
+ *  This method is used for checking whether the held
+ *  reference refers to a live resource.
+ ***********************************************************/
+bool ResourceRef::IsValid() const
+{
+	return((NULL != m_pManager) && (m_pManager->IsValid(m_handle)));
+}
+
+/***********************************************************
+ *  GetName()
+ *
+ *  This method is used for getting the OpenGL object name
+ *  of the referenced resource.
+ ***********************************************************/
+GLuint ResourceRef::GetName() const
+{
+	if (NULL == m_pManager)
+	{
+		return(0);
+	}
+
+	return(m_pManager->GetName(m_handle));
+}
@@ -0,0 +1,147 @@
+///////////////////////////////////////////////////////////////////////////////
+// resourcemanager.h
+// ============
+// manage the lifetime of the OpenGL resources used by the 3D scenes
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include "HandlePool.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  ResourceManager
+ *
+ *  This class owns the OpenGL textures, buffers, vertex
+ *  arrays, shader programs and render targets used by the
+ *  3D scenes.  Each resource is reference counted and
+ *  addressed through a generational handle, so a handle to
+ *  a deleted resource is detected instead of reaching a
+ *  reused OpenGL name.
+ *  Resources whose last reference is released are deleted
+ *  only after the GPU has finished the frames that may
+ *  still be using them.
+ ***********************************************************/
+class ResourceManager
+{
+public:
+	// constructor
+	ResourceManager();
+	// destructor
+	~ResourceManager();
+
+	enum RESOURCE_TYPE
+	{
+		RESOURCE_TEXTURE,
+		RESOURCE_BUFFER,
+		RESOURCE_VERTEX_ARRAY,
+		RESOURCE_PROGRAM,
+		RESOURCE_RENDERBUFFER,
+		RESOURCE_FRAMEBUFFER,
+		RESOURCE_TYPE_COUNT
+	};
+
+private:
+	struct RESOURCE_ENTRY
+	{
+		RESOURCE_TYPE type;
+		GLuint name;
+		size_t bytes;
+		int referenceCount;
+	};
+
+public:
+	// slot index in the low 16 bits, slot generation in the
+	// high 16 bits - a value of zero is never a valid handle
+	typedef HandlePool<RESOURCE_ENTRY>::HANDLE RESOURCE_HANDLE;
+
+	// take ownership of an existing OpenGL object, the passed in
+	// size is the estimated GPU memory used by the object
+	RESOURCE_HANDLE Register(RESOURCE_TYPE type, GLuint name, size_t bytes);
+
+	// adjust the reference count of a resource, the resource is
+	// queued for deletion when the last reference is released
+	void AddReference(RESOURCE_HANDLE handle);
+	void Release(RESOURCE_HANDLE handle);
+
+	// check whether a handle still refers to a live resource
+	bool IsValid(RESOURCE_HANDLE handle) const;
+	// get the OpenGL name for a handle, 0 for a stale handle
+	GLuint GetName(RESOURCE_HANDLE handle) const;
+	// get the number of references held to a resource
+	int GetReferenceCount(RESOURCE_HANDLE handle) const;
+	// get the estimated GPU memory of a resource, 0 for a stale handle
+	size_t GetBytes(RESOURCE_HANDLE handle) const;
+
+	// mark the end of a rendered frame and delete the resources
+	// that the GPU has finished using
+	void EndFrame();
+
+	// print the live resource counts and sizes per type
+	void ReportLiveResources() const;
+	// get the live resource totals for one type
+	int GetLiveCount(RESOURCE_TYPE type) const { return(m_liveCount[type]); }
+	size_t GetLiveBytes(RESOURCE_TYPE type) const { return(m_liveBytes[type]); }
+
+private:
+	struct PENDING_DELETE
+	{
+		RESOURCE_TYPE type;
+		GLuint name;
+		size_t bytes;
+		// frame in which the last reference was released
+		uint64_t frame;
+	};
+
+	// live resources, addressed by handle
+	HandlePool<RESOURCE_ENTRY> m_entries;
+	// released resources waiting for the GPU to finish with them
+	std::vector<PENDING_DELETE> m_pendingDeletes;
+	// fences for the frames that may still be in flight
+	std::vector<GLsync> m_frameFences;
+	std::vector<uint64_t> m_fenceFrames;
+	// number of the frame currently being recorded
+	uint64_t m_currentFrame;
+
+	// live resource totals per type
+	int m_liveCount[RESOURCE_TYPE_COUNT];
+	size_t m_liveBytes[RESOURCE_TYPE_COUNT];
+
+	// delete the OpenGL object for a resource
+	void DeleteObject(RESOURCE_TYPE type, GLuint name);
+	// delete the pending resources released before a frame
+	void DeletePendingBefore(uint64_t frame);
+};
+
+/***********************************************************
+ *  ResourceRef
+ *
+ *  This class holds one reference to a managed resource and
+ *  releases it automatically when it goes out of scope.
+ ***********************************************************/
+class ResourceRef
+{
+public:
+	ResourceRef();
+	ResourceRef(ResourceManager* pManager, ResourceManager::RESOURCE_HANDLE handle);
+	ResourceRef(const ResourceRef& other);
+	ResourceRef& operator=(const ResourceRef& other);
+	~ResourceRef();
+
+	// release the held reference, leaving the object empty
+	void Reset();
+
+	bool IsValid() const;
+	GLuint GetName() const;
+	ResourceManager::RESOURCE_HANDLE GetHandle() const { return(m_handle); }
+
+private:
+	ResourceManager* m_pManager;
+	ResourceManager::RESOURCE_HANDLE m_handle;
+};
@@ -0,0 +1,273 @@
+///////////////////////////////////////////////////////////////////////////////
+// sceneeditqueue.cpp
+// ============
+// queue scene changes from any thread for the render thread to apply
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneEditQueue.h"
+
+/***********************************************************
+ *  SceneEditQueue()
+ *
+ *  The constructor for the class.  The list starts with one
+ *  entry that stands for an applied edit, so that a push
+ *  always has a previous entry to link to.
+ ***********************************************************/
+SceneEditQueue::SceneEditQueue()
+{
+	EDIT_ENTRY* pEntry = new EDIT_ENTRY();
+	pEntry->pNext.store(NULL, std::memory_order_relaxed);
+	m_pOldest = pEntry;
+	m_pNewest.store(pEntry, std::memory_order_relaxed);
+}
+
+/***********************************************************
+ *  ~SceneEditQueue()
+ *
+ *  The destructor for the class.  The edits that were not
+ *  applied are dropped, once no thread pushes any more.
+ ***********************************************************/
+SceneEditQueue::~SceneEditQueue()
+{
+	while (NULL != m_pOldest)
+	{
+		EDIT_ENTRY* pNext = m_pOldest->pNext.load(std::memory_order_acquire);
+		delete m_pOldest;
+		m_pOldest = pNext;
+	}
+	m_pNewest.store(NULL, std::memory_order_relaxed);
+}
+
+/***********************************************************
+ *  Push()
+ *
+ *  This method is used for queueing an edit from any
+ *  thread.  The entry becomes the newest with one swap, and
+ *  is then linked from the entry that was newest before it.
+ *  The release of the link makes the edit visible to the
+ *  render thread together with the link.
+ ***********************************************************/
+void SceneEditQueue::Push(const SCENE_EDIT& edit)
+{
+	EDIT_ENTRY* pEntry = new EDIT_ENTRY();
+	pEntry->pNext.store(NULL, std::memory_order_relaxed);
+	pEntry->edit = edit;
+
+	EDIT_ENTRY* pPrevious = m_pNewest.exchange(pEntry, std::memory_order_acq_rel);
+	pPrevious->pNext.store(pEntry, std::memory_order_release);
+}
+
+/***********************************************************
+ *  AddNode()
+ *
+ *  These methods are used for queueing the edits of each
+ *  kind from any thread.
+ ***********************************************************/
+void SceneEditQueue::AddNode(
+	std::string nodeTag,
+	SceneManager::MESH_TYPE mesh,
+	glm::vec3 scaleXYZ,
+	glm::vec3 rotationDegrees,
+	glm::vec3 positionXYZ,
+	glm::vec4 color,
+	std::string materialTag,
+	std::string textureTag)
+{
+	SCENE_EDIT edit = MakeEdit(EDIT_ADD_NODE, nodeTag);
+	edit.mesh = mesh;
+	edit.scaleXYZ = scaleXYZ;
+	edit.rotationDegrees = rotationDegrees;
+	edit.positionXYZ = positionXYZ;
+	edit.color = color;
+	edit.materialTag = materialTag;
+	edit.textureTag = textureTag;
+	Push(edit);
+}
+
+void SceneEditQueue::RemoveNode(std::string nodeTag)
+{
+	Push(MakeEdit(EDIT_REMOVE_NODE, nodeTag));
+}
+
+void SceneEditQueue::SetTransform(
+	std::string nodeTag,
+	glm::vec3 scaleXYZ,
+	glm::vec3 rotationDegrees,
+	glm::vec3 positionXYZ)
+{
+	SCENE_EDIT edit = MakeEdit(EDIT_SET_TRANSFORM, nodeTag);
+	edit.scaleXYZ = scaleXYZ;
+	edit.rotationDegrees = rotationDegrees;
+	edit.positionXYZ = positionXYZ;
+	Push(edit);
+}
+
+void SceneEditQueue::SetMaterial(std::string nodeTag, std::string materialTag)
+{
+	SCENE_EDIT edit = MakeEdit(EDIT_SET_MATERIAL, nodeTag);
+	edit.materialTag = materialTag;
+	Push(edit);
+}
+
+void SceneEditQueue::SetTexture(std::string nodeTag, std::string textureTag)
+{
+	SCENE_EDIT edit = MakeEdit(EDIT_SET_TEXTURE, nodeTag);
+	edit.textureTag = textureTag;
+	Push(edit);
+}
+
+void SceneEditQueue::SetLight(int lightIndex, const SceneManager::LIGHT_SOURCE& light)
+{
+	SCENE_EDIT edit = MakeEdit(EDIT_SET_LIGHT, "");
+	edit.lightIndex = lightIndex;
+	edit.light = light;
+	Push(edit);
+}
+
+/***********************************************************
+ *  ApplyEdits()
+ *
+ *  This method is used for applying the queued edits to a
+ *  scene, on the thread that renders it.  Each entry that
+ *  is linked from the oldest one holds the next edit, and
+ *  becomes the oldest once the edit is applied.  The walk
+ *  stops at an entry that is not linked yet, so the edits
+ *  are applied in the order they were pushed.  The lights
+ *  are set into the current program once, after the last
+ *  edit of the frame.
+ ***********************************************************/
+int SceneEditQueue::ApplyEdits(SceneManager* pSceneManager)
+{
+	int appliedCount = 0;
+	bool bLightsChanged = false;
+
+	if (NULL == pSceneManager)
+	{
+		return(0);
+	}
+
+	EDIT_ENTRY* pNext = m_pOldest->pNext.load(std::memory_order_acquire);
+	while (NULL != pNext)
+	{
+		if (ApplyEdit(pSceneManager, pNext->edit) == true)
+		{
+			appliedCount++;
+			if (pNext->edit.type == EDIT_SET_LIGHT)
+			{
+				bLightsChanged = true;
+			}
+		}
+
+		delete m_pOldest;
+		m_pOldest = pNext;
+		pNext = m_pOldest->pNext.load(std::memory_order_acquire);
+	}
+
+	if (bLightsChanged == true)
+	{
+		pSceneManager->SetupSceneLights();
+	}
+
+	return(appliedCount);
+}
+
+/***********************************************************
+ *  MakeEdit()
+ *
+ *  This method is used for getting an edit of the passed in
+ *  kind, with the values that it does not use cleared.
+ ***********************************************************/
+SceneEditQueue::SCENE_EDIT SceneEditQueue::MakeEdit(EDIT_TYPE type, std::string nodeTag) const
+{
+	SCENE_EDIT edit;
+
+	edit.type = type;
+	edit.nodeTag = nodeTag;
+	edit.mesh = SceneManager::MESH_BOX;
+	edit.scaleXYZ = glm::vec3(1.0f);
+	edit.rotationDegrees = glm::vec3(0.0f);
+	edit.positionXYZ = glm::vec3(0.0f);
+	edit.color = glm::vec4(1.0f);
+	edit.lightIndex = -1;
+	edit.light = SceneManager::LIGHT_SOURCE();
+
+	return(edit);
+}
+
+/***********************************************************
+ *  ApplyEdit()
+ *
+ *  This method is used for applying one edit to a scene.
+ *  The tags are resolved to handles here, on the render
+ *  thread, and a material or texture tag that the scene
+ *  does not know clears the node's material or texture.
+ *  A removed node takes its animation tracks with it.
+ ***********************************************************/
+bool SceneEditQueue::ApplyEdit(SceneManager* pSceneManager, const SCENE_EDIT& edit)
+{
+	SceneManager::SCENE_NODE node;
+
+	// the node edits find their node by tag, and an empty tag
+	// would not name one
+	if ((edit.type != EDIT_SET_LIGHT) && (edit.nodeTag.empty() == true))
+	{
+		return(false);
+	}
+
+	switch (edit.type)
+	{
+	case EDIT_ADD_NODE:
+		pSceneManager->AddSceneNode(
+			edit.nodeTag,
+			pSceneManager->GetMeshHandle(edit.mesh),
+			edit.scaleXYZ,
+			edit.rotationDegrees.x,
+			edit.rotationDegrees.y,
+			edit.rotationDegrees.z,
+			edit.positionXYZ,
+			edit.color,
+			pSceneManager->GetMaterialHandle(edit.materialTag),
+			pSceneManager->GetTextureHandle(edit.textureTag));
+		return(true);
+
+	case EDIT_REMOVE_NODE:
+	{
+		int nodeIndex = pSceneManager->FindSceneNode(edit.nodeTag);
+		if (nodeIndex < 0)
+		{
+			return(false);
+		}
+		pSceneManager->RemoveSceneNode(nodeIndex);
+		return(true);
+	}
+
+	case EDIT_SET_TRANSFORM:
+	case EDIT_SET_MATERIAL:
+	case EDIT_SET_TEXTURE:
+		if (pSceneManager->GetSceneNode(edit.nodeTag, node) == false)
+		{
+			return(false);
+		}
+		if (edit.type == EDIT_SET_TRANSFORM)
+		{
+			node.scaleXYZ = edit.scaleXYZ;
+			node.rotationDegrees = edit.rotationDegrees;
+			node.positionXYZ = edit.positionXYZ;
+		}
+		else if (edit.type == EDIT_SET_MATERIAL)
+		{
+			node.material = pSceneManager->GetMaterialHandle(edit.materialTag);
+		}
+		else
+		{
+			node.texture = pSceneManager->GetTextureHandle(edit.textureTag);
+		}
+		return(pSceneManager->SetSceneNode(edit.nodeTag, node));
+
+	case EDIT_SET_LIGHT:
+		return(pSceneManager->SetSceneLight(edit.lightIndex, edit.light));
+	}
+
+	return(false);
+}
@@ -0,0 +1,114 @@
+///////////////////////////////////////////////////////////////////////////////
+// sceneeditqueue.h
+// ============
+// queue scene changes from any thread for the render thread to apply
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneManager.h"
+
+#include <atomic>
+#include <string>
+
+/***********************************************************
+ *  SceneEditQueue
+ *
+ *  This class passes changes to a scene from other threads,
+ *  such as a tool, a reload of a file or a render server
+ *  client, to the thread that renders it.  Any number of
+ *  threads push edits, and the render thread applies all of
+ *  them at one point of each frame, before the scene is
+ *  culled, so that a frame never sees half of a change.
+ *  The edits are kept in a linked list with no locks - a
+ *  push only swaps the newest entry and links the previous
+ *  one to it, so it never waits for the render thread, and
+ *  the render thread never waits for a push.  An edit whose
+ *  push has swapped the newest entry but not linked it yet
+ *  is applied at the next frame.
+ ***********************************************************/
+class SceneEditQueue
+{
+public:
+	// constructor
+	SceneEditQueue();
+	// destructor
+	~SceneEditQueue();
+
+	// the kinds of scene edits
+	enum EDIT_TYPE
+	{
+		EDIT_ADD_NODE,
+		EDIT_REMOVE_NODE,
+		EDIT_SET_TRANSFORM,
+		EDIT_SET_MATERIAL,
+		EDIT_SET_TEXTURE,
+		EDIT_SET_LIGHT
+	};
+
+	// one scene edit - nodes, materials and textures are named by
+	// their tags, since handles are only valid on the render thread,
+	// and only the values that the kind of edit uses are read
+	struct SCENE_EDIT
+	{
+		EDIT_TYPE type;
+		std::string nodeTag;
+		SceneManager::MESH_TYPE mesh;
+		glm::vec3 scaleXYZ;
+		glm::vec3 rotationDegrees;
+		glm::vec3 positionXYZ;
+		glm::vec4 color;
+		std::string materialTag;
+		std::string textureTag;
+		int lightIndex;
+		SceneManager::LIGHT_SOURCE light;
+	};
+
+	// queue an edit, from any thread
+	void Push(const SCENE_EDIT& edit);
+	// queue the edits of each kind, from any thread
+	void AddNode(
+		std::string nodeTag,
+		SceneManager::MESH_TYPE mesh,
+		glm::vec3 scaleXYZ,
+		glm::vec3 rotationDegrees,
+		glm::vec3 positionXYZ,
+		glm::vec4 color,
+		std::string materialTag,
+		std::string textureTag);
+	void RemoveNode(std::string nodeTag);
+	void SetTransform(
+		std::string nodeTag,
+		glm::vec3 scaleXYZ,
+		glm::vec3 rotationDegrees,
+		glm::vec3 positionXYZ);
+	void SetMaterial(std::string nodeTag, std::string materialTag);
+	void SetTexture(std::string nodeTag, std::string textureTag);
+	void SetLight(int lightIndex, const SceneManager::LIGHT_SOURCE& light);
+
+	// apply the queued edits to a scene in the order they were
+	// pushed, only from the thread that renders it - returns the
+	// number of edits that were applied
+	int ApplyEdits(SceneManager* pSceneManager);
+
+private:
+	// an entry of the list, the oldest entry is always one whose
+	// edit has been applied already
+	struct EDIT_ENTRY
+	{
+		std::atomic<EDIT_ENTRY*> pNext;
+		SCENE_EDIT edit;
+	};
+
+	// the newest entry, swapped by the pushing threads
+	std::atomic<EDIT_ENTRY*> m_pNewest;
+	// the oldest entry, only used by the render thread
+	EDIT_ENTRY* m_pOldest;
+
+	// get an edit with the unused values set to defaults
+	SCENE_EDIT MakeEdit(EDIT_TYPE type, std::string nodeTag) const;
+	// apply one edit, returns false when it names a node that
+	// is not in the scene
+	bool ApplyEdit(SceneManager* pSceneManager, const SCENE_EDIT& edit);
+};
@@ -8,14 +8,18 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "SceneManager.h"
-
-#ifndef STB_IMAGE_IMPLEMENTATION
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
-#endif
+#include "ResourceCache.h"
+#include "SceneStreamer.h"
+#include "ImpostorSystem.h"
+#include "TaskGraph.h"
+#include "LoadScheduler.h"
 
 #include <glm/gtx/transform.hpp>
 
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+
 // declaration of global variables
 namespace
 {
@@ -23,7 +27,45 @@ namespace
 	const char* g_ColorValueName = "objectColor";
 	const char* g_TextureValueName = "objectTexture";
 	const char* g_UseTextureName = "bUseTexture";
+	// the slot number, for programs that look up paged textures
+	const char* g_TextureSlotName = "objectTextureSlot";
 	const char* g_UseLightingName = "bUseLighting";
+
+	// the basic meshes fit in a unit cube, so a node's bounding
+	// sphere radius is its largest scale times half the diagonal
+	const float g_NodeBoundsRadius = 0.87f;
+
+	// the material data is copied into uniform blocks as-is
+	static_assert(sizeof(SceneManager::MATERIAL_DATA) == 48,
+		"MATERIAL_DATA must match the std140 material layout");
+
+	// the awaitable that reads an image file on the file reader
+	// of the cache, and continues the awaiting coroutine on a
+	// worker thread once the data has arrived
+	struct IMAGE_FILE_READ
+	{
+		ResourceCache* pResourceCache;
+		LoadScheduler* pScheduler;
+		const char* filename;
+		std::vector<unsigned char>* pData;
+		bool bRead;
+
+		bool await_ready() const { return(false); }
+		void await_suspend(std::coroutine_handle<> handle)
+		{
+			// the coroutine may be resumed before this returns, so
+			// nothing is touched after the read is started
+			IMAGE_FILE_READ* pRead = this;
+			pResourceCache->ReadImageFileAsync(filename,
+				[pRead, handle](bool bFileRead, std::vector<unsigned char>& data)
+				{
+					pRead->bRead = bFileRead;
+					pRead->pData->swap(data);
+					pRead->pScheduler->ResumeOnWorker(handle);
+				});
+		}
+		bool await_resume() const { return(bRead); }
+	};
 }
 
 /***********************************************************
@@ -31,10 +73,33 @@ namespace
  *
  *  The constructor for the class
  ***********************************************************/
-SceneManager::SceneManager(ShaderManager *pShaderManager)
+SceneManager::SceneManager(
+	ShaderManager *pShaderManager,
+	ResourceCache *pResourceCache)
 {
 	m_pShaderManager = pShaderManager;
-	m_basicMeshes = new ShapeMeshes();
+	m_pResourceCache = pResourceCache;
+	// the basic meshes are shared by every scene using the cache
+	m_basicMeshes = pResourceCache->GetShapeMeshes();
+	m_loadedTextures = 0;
+	m_cullingViewCount = 0;
+	m_drawCount = 0;
+	m_animationTime = 0.0f;
+	m_previousAnimationTime = 0.0f;
+	m_pVisibleSet = NULL;
+	m_visibleSetNodeCount = 0;
+	m_pCollectedTextureFiles = NULL;
+	for (int i = 0; i < 16; i++)
+	{
+		m_textureIDs[i] = 0;
+		m_textureUseCounts[i] = 0;
+	}
+	m_pStreamer = new SceneStreamer(this, pResourceCache);
+	DefineSceneLights();
+	for (int i = 0; i < MESH_TYPE_COUNT; i++)
+	{
+		m_meshHandles[i] = HandlePool<MESH_DATA>::InvalidHandle();
+	}
 }
 
 /***********************************************************
@@ -45,88 +110,172 @@ SceneManager::SceneManager(ShaderManager *pShaderManager)
 SceneManager::~SceneManager()
 {
 	// free up the allocated memory
+	UnloadScene();
+	if (NULL != m_pStreamer)
+	{
+		delete m_pStreamer;
+		m_pStreamer = NULL;
+	}
 	m_pShaderManager = NULL;
-	if (NULL != m_basicMeshes)
+	m_pResourceCache = NULL;
+	// the basic meshes are owned by the resource cache
+	m_basicMeshes = NULL;
+}
+
+/***********************************************************
+ *  UnloadScene()
+ *
+ *  This method is used for releasing the textures and the
+ *  definitions of the prepared 3D scene, so that another
+ *  scene can be prepared without leaking GPU memory.
+ ***********************************************************/
+void SceneManager::UnloadScene()
+{
+	// remove the streamed objects while their textures are placed
+	if (NULL != m_pStreamer)
 	{
-		delete m_basicMeshes;
-		m_basicMeshes = NULL;
+		m_pStreamer->Clear();
 	}
+	// release the loaded textures
+	DestroyGLTextures();
 	// clear the collection of defined materials
-	m_objectMaterials.clear();
+	m_materials.Clear();
+	m_materialTags.clear();
+	m_materialHandles.clear();
+	// clear the registered meshes
+	m_meshes.Clear();
+	// clear the defined scene nodes and their animations
+	m_animations.Clear();
+	m_sceneNodes.clear();
+	m_sceneNodeTags.clear();
+	m_freeSceneNodes.clear();
+	// the visible sets were made for the removed nodes
+	m_pVisibleSet = NULL;
+	m_visibleSetNodeCount = 0;
+	m_changedNodeBits.clear();
 }
 
 /***********************************************************
  *  CreateGLTexture()
  *
- *  This method is used for loading textures from image files,
- *  configuring the texture mapping parameters in OpenGL,
- *  generating the mipmaps, and loading the read texture into
- *  the next available texture slot in memory.
+ *  This method is used for getting the texture for an image
+ *  file from the resource cache, which only loads the file
+ *  the first time any scene uses it, and placing the texture
+ *  into the next available texture slot in memory.
  ***********************************************************/
 bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
 {
-	int width = 0;
-	int height = 0;
-	int colorChannels = 0;
-	GLuint textureID = 0;
-
-	// indicate to always flip images vertically when loaded
-	stbi_set_flip_vertically_on_load(true);
-
-	// try to parse the image data from the specified image file
-	unsigned char* image = stbi_load(
-		filename,
-		&width,
-		&height,
-		&colorChannels,
-		0);
-
-	// if the image was successfully read from the image file
-	if (image)
-	{
-		std::cout << "Successfully loaded image:" << filename << ", width:" << width << ", height:" << height << ", channels:" << colorChannels << std::endl;
-
-		glGenTextures(1, &textureID);
-		glBindTexture(GL_TEXTURE_2D, textureID);
-
-		// set the texture wrapping parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		// set texture filtering parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		// if the loaded image is in RGB format
-		if (colorChannels == 3)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-		// if the loaded image is in RGBA format - it supports transparency
-		else if (colorChannels == 4)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
+	// while the texture files are collected, the file is only noted
+	if (NULL != m_pCollectedTextureFiles)
+	{
+		m_pCollectedTextureFiles->push_back(filename);
+		return(true);
+	}
+
+	// all of the texture slots are already in use
+	if (m_loadedTextures >= 16)
+	{
+		std::cout << "Could not load image:" << filename << ", all texture slots are in use" << std::endl;
+		return false;
+	}
+
+	ResourceRef texture = m_pResourceCache->AcquireTexture(filename);
+	if (texture.IsValid() == false)
+	{
+		// Error loading the image
+		return false;
+	}
+
+	// register the loaded texture and associate it with the special tag string
+	return(AddSceneTexture(texture, tag) != HandlePool<TEXTURE_DATA>::InvalidHandle());
+}
+
+/***********************************************************
+ *  AddSceneTexture()
+ *
+ *  This method is used for placing a loaded texture into a
+ *  texture slot.  A texture with a tag that is already
+ *  placed shares that slot, and slots freed by removed
+ *  textures are reused before new slots are taken.
+ ***********************************************************/
+SceneManager::TEXTURE_HANDLE SceneManager::AddSceneTexture(const ResourceRef& texture, std::string tag)
+{
+	if (texture.IsValid() == false)
+	{
+		return(HandlePool<TEXTURE_DATA>::InvalidHandle());
+	}
+
+	int textureSlot = FindTextureSlot(tag);
+	if (textureSlot >= 0)
+	{
+		m_textureUseCounts[textureSlot]++;
+		return(m_textureHandles[textureSlot]);
+	}
+
+	// reuse a freed slot, or take the next one
+	int index = 0;
+	while ((index < m_loadedTextures) && (textureSlot < 0))
+	{
+		if (m_textureUseCounts[index] == 0)
+		{
+			textureSlot = index;
+		}
 		else
 		{
-			std::cout << "Not implemented to handle image with " << colorChannels << " channels" << std::endl;
-			return false;
+			index++;
+		}
+	}
+	if (textureSlot < 0)
+	{
+		if (m_loadedTextures >= 16)
+		{
+			std::cout << "Could not add texture:" << tag << ", all texture slots are in use" << std::endl;
+			return(HandlePool<TEXTURE_DATA>::InvalidHandle());
 		}
+		textureSlot = m_loadedTextures;
+		m_loadedTextures++;
+	}
 
-		// generate the texture mipmaps for mapping textures to lower resolutions
-		glGenerateMipmap(GL_TEXTURE_2D);
+	m_textureIDs[textureSlot] = texture.GetName();
+	m_textureRefs[textureSlot] = texture;
+	m_textureTags[textureSlot] = tag;
+	m_textureUseCounts[textureSlot] = 1;
 
-		// free the image data from local memory
-		stbi_image_free(image);
-		glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
+	TEXTURE_DATA textureData;
+	textureData.textureID = texture.GetName();
+	textureData.textureSlot = textureSlot;
+	m_textureHandles[textureSlot] = m_textures.Add(textureData);
 
-		// register the loaded texture and associate it with the special tag string
-		m_textureIDs[m_loadedTextures].ID = textureID;
-		m_textureIDs[m_loadedTextures].tag = tag;
-		m_loadedTextures++;
+	return(m_textureHandles[textureSlot]);
+}
 
-		return true;
+/***********************************************************
+ *  RemoveSceneTexture()
+ *
+ *  This method is used for releasing one use of a texture
+ *  slot.  The texture reference is dropped and the slot is
+ *  freed when its last user is removed.
+ ***********************************************************/
+void SceneManager::RemoveSceneTexture(TEXTURE_HANDLE texture)
+{
+	const TEXTURE_DATA* pTexture = m_textures.Get(texture);
+	if (NULL == pTexture)
+	{
+		return;
 	}
 
-	std::cout << "Could not load image:" << filename << std::endl;
+	int textureSlot = pTexture->textureSlot;
+	m_textureUseCounts[textureSlot]--;
+	if (m_textureUseCounts[textureSlot] > 0)
+	{
+		return;
+	}
 
-	// Error loading the image
-	return false;
+	m_textureRefs[textureSlot].Reset();
+	m_textureIDs[textureSlot] = 0;
+	m_textureTags[textureSlot].clear();
+	m_textureHandles[textureSlot] = HandlePool<TEXTURE_DATA>::InvalidHandle();
+	m_textures.Remove(texture);
 }
 
 /***********************************************************
@@ -137,11 +286,16 @@ bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
  ***********************************************************/
 void SceneManager::BindGLTextures()
 {
+	if (NULL != m_pCollectedTextureFiles)
+	{
+		return;
+	}
+
 	for (int i = 0; i < m_loadedTextures; i++)
 	{
 		// bind textures on corresponding texture units
 		glActiveTexture(GL_TEXTURE0 + i);
-		glBindTexture(GL_TEXTURE_2D, m_textureIDs[i].ID);
+		glBindTexture(GL_TEXTURE_2D, m_textureIDs[i]);
 	}
 }
 
@@ -155,8 +309,17 @@ void SceneManager::DestroyGLTextures()
 {
 	for (int i = 0; i < m_loadedTextures; i++)
 	{
-		glGenTextures(1, &m_textureIDs[i].ID);
+		// the textures are deleted by the resource manager once
+		// no scene refers to them and the GPU has finished
+		m_textureRefs[i].Reset();
+		m_textureIDs[i] = 0;
+		m_textureUseCounts[i] = 0;
+		m_textureTags[i].clear();
+		m_textureHandles[i] = HandlePool<TEXTURE_DATA>::InvalidHandle();
 	}
+	m_loadedTextures = 0;
+	// any handles to the released textures are now stale
+	m_textures.Clear();
 }
 
 /***********************************************************
@@ -173,9 +336,9 @@ int SceneManager::FindTextureID(std::string tag)
 
 	while ((index < m_loadedTextures) && (bFound == false))
 	{
-		if (m_textureIDs[index].tag.compare(tag) == 0)
+		if (m_textureTags[index].compare(tag) == 0)
 		{
-			textureID = m_textureIDs[index].ID;
+			textureID = m_textureIDs[index];
 			bFound = true;
 		}
 		else
@@ -199,7 +362,7 @@ int SceneManager::FindTextureSlot(std::string tag)
 
 	while ((index < m_loadedTextures) && (bFound == false))
 	{
-		if (m_textureIDs[index].tag.compare(tag) == 0)
+		if (m_textureTags[index].compare(tag) == 0)
 		{
 			textureSlot = index;
 			bFound = true;
@@ -211,6 +374,28 @@ int SceneManager::FindTextureSlot(std::string tag)
 	return(textureSlot);
 }
 
+/***********************************************************
+ *  AddObjectMaterial()
+ *
+ *  This method is used for storing a material definition,
+ *  splitting the lighting values from the tag so that the
+ *  values can be read without touching the tag strings.
+ ***********************************************************/
+void SceneManager::AddObjectMaterial(const OBJECT_MATERIAL& material)
+{
+	MATERIAL_DATA data;
+
+	data.ambientColor = material.ambientColor;
+	data.ambientStrength = material.ambientStrength;
+	data.diffuseColor = material.diffuseColor;
+	data.shininess = material.shininess;
+	data.specularColor = material.specularColor;
+	data.padding = 0.0f;
+
+	m_materialTags.push_back(material.tag);
+	m_materialHandles.push_back(m_materials.Add(data));
+}
+
 /***********************************************************
  *  FindMaterial()
  *
@@ -219,40 +404,29 @@ int SceneManager::FindTextureSlot(std::string tag)
  ***********************************************************/
 bool SceneManager::FindMaterial(std::string tag, OBJECT_MATERIAL& material)
 {
-	if (m_objectMaterials.size() == 0)
+	const MATERIAL_DATA* pData = m_materials.Get(GetMaterialHandle(tag));
+	if (NULL == pData)
 	{
 		return(false);
 	}
 
-	int index = 0;
-	bool bFound = false;
-	while ((index < m_objectMaterials.size()) && (bFound == false))
-	{
-		if (m_objectMaterials[index].tag.compare(tag) == 0)
-		{
-			bFound = true;
-			material.ambientColor = m_objectMaterials[index].ambientColor;
-			material.ambientStrength = m_objectMaterials[index].ambientStrength;
-			material.diffuseColor = m_objectMaterials[index].diffuseColor;
-			material.specularColor = m_objectMaterials[index].specularColor;
-			material.shininess = m_objectMaterials[index].shininess;
-		}
-		else
-		{
-			index++;
-		}
-	}
+	material.ambientColor = pData->ambientColor;
+	material.ambientStrength = pData->ambientStrength;
+	material.diffuseColor = pData->diffuseColor;
+	material.specularColor = pData->specularColor;
+	material.shininess = pData->shininess;
+	material.tag = tag;
 
 	return(true);
 }
 
 /***********************************************************
- *  SetTransformations()
+ *  BuildModelMatrix()
  *
- *  This method is used for setting the transform buffer
- *  using the passed in transformation values.
+ *  This method is used for building the model matrix from
+ *  the passed in transformation values.
  ***********************************************************/
-void SceneManager::SetTransformations(
+glm::mat4 SceneManager::BuildModelMatrix(
 	glm::vec3 scaleXYZ,
 	float XrotationDegrees,
 	float YrotationDegrees,
@@ -260,7 +434,6 @@ void SceneManager::SetTransformations(
 	glm::vec3 positionXYZ)
 {
 	// variables for this method
-	glm::mat4 modelView;
 	glm::mat4 scale;
 	glm::mat4 rotationX;
 	glm::mat4 rotationY;
@@ -276,7 +449,31 @@ void SceneManager::SetTransformations(
 	// set the translation value in the transform buffer
 	translation = glm::translate(positionXYZ);
 
-	modelView = translation * rotationX * rotationY * rotationZ * scale;
+	return(translation * rotationX * rotationY * rotationZ * scale);
+}
+
+/***********************************************************
+ *  SetTransformations()
+ *
+ *  This method is used for setting the transform buffer
+ *  using the passed in transformation values.
+ ***********************************************************/
+void SceneManager::SetTransformations(
+	glm::vec3 scaleXYZ,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees,
+	glm::vec3 positionXYZ)
+{
+	// variables for this method
+	glm::mat4 modelView;
+
+	modelView = BuildModelMatrix(
+		scaleXYZ,
+		XrotationDegrees,
+		YrotationDegrees,
+		ZrotationDegrees,
+		positionXYZ);
 
 	if (NULL != m_pShaderManager)
 	{
@@ -327,6 +524,27 @@ void SceneManager::SetShaderTexture(
 		int textureID = -1;
 		textureID = FindTextureSlot(textureTag);
 		m_pShaderManager->setSampler2DValue(g_TextureValueName, textureID);
+		m_pShaderManager->setIntValue(g_TextureSlotName, textureID);
+	}
+}
+
+/***********************************************************
+ *  SetShaderTexture()
+ *
+ *  This method is used for setting the texture data for
+ *  the passed in texture handle into the shader.  A stale
+ *  handle leaves the current shader texture unchanged.
+ ***********************************************************/
+void SceneManager::SetShaderTexture(
+	TEXTURE_HANDLE texture)
+{
+	const TEXTURE_DATA* pTexture = m_textures.Get(texture);
+
+	if ((NULL != m_pShaderManager) && (NULL != pTexture))
+	{
+		m_pShaderManager->setIntValue(g_UseTextureName, true);
+		m_pShaderManager->setSampler2DValue(g_TextureValueName, pTexture->textureSlot);
+		m_pShaderManager->setIntValue(g_TextureSlotName, pTexture->textureSlot);
 	}
 
 }
@@ -354,20 +572,28 @@ void SceneManager::SetTextureUVScale(float u, float v)
 void SceneManager::SetShaderMaterial(
 	std::string materialTag)
 {
-	if (m_objectMaterials.size() > 0)
-	{
-		OBJECT_MATERIAL material;
-		bool bReturn = false;
+	SetShaderMaterial(GetMaterialHandle(materialTag));
+}
 
-		bReturn = FindMaterial(materialTag, material);
-		if (bReturn == true)
-		{
-			m_pShaderManager->setVec3Value("material.ambientColor", material.ambientColor);
-			m_pShaderManager->setFloatValue("material.ambientStrength", material.ambientStrength);
-			m_pShaderManager->setVec3Value("material.diffuseColor", material.diffuseColor);
-			m_pShaderManager->setVec3Value("material.specularColor", material.specularColor);
-			m_pShaderManager->setFloatValue("material.shininess", material.shininess);
-		}
+/***********************************************************
+ *  SetShaderMaterial()
+ *
+ *  This method is used for passing the values of the material
+ *  for the passed in handle into the shader.  A stale handle
+ *  leaves the current shader material unchanged.
+ ***********************************************************/
+void SceneManager::SetShaderMaterial(
+	MATERIAL_HANDLE material)
+{
+	const MATERIAL_DATA* pMaterial = m_materials.Get(material);
+
+	if (NULL != pMaterial)
+	{
+		m_pShaderManager->setVec3Value("material.ambientColor", pMaterial->ambientColor);
+		m_pShaderManager->setFloatValue("material.ambientStrength", pMaterial->ambientStrength);
+		m_pShaderManager->setVec3Value("material.diffuseColor", pMaterial->diffuseColor);
+		m_pShaderManager->setVec3Value("material.specularColor", pMaterial->specularColor);
+		m_pShaderManager->setFloatValue("material.shininess", pMaterial->shininess);
 	}
 }
 
@@ -433,7 +659,7 @@ void SceneManager::DefineObjectMaterials()
 	goldMaterial.shininess = 22.0;
 	goldMaterial.tag = "gold";
 
-	m_objectMaterials.push_back(goldMaterial);
+	AddObjectMaterial(goldMaterial);
 
 	OBJECT_MATERIAL appleMaterial;
 	appleMaterial.ambientColor = glm::vec3(0.2f, 0.2f, 0.1f);
@@ -443,7 +669,7 @@ void SceneManager::DefineObjectMaterials()
 	appleMaterial.shininess = 5.0;
 	appleMaterial.tag = "appleskin";
 
-	m_objectMaterials.push_back(appleMaterial);
+	AddObjectMaterial(appleMaterial);
 
 	OBJECT_MATERIAL cementMaterial;
 	cementMaterial.ambientColor = glm::vec3(0.2f, 0.2f, 0.2f);
@@ -453,7 +679,7 @@ void SceneManager::DefineObjectMaterials()
 	cementMaterial.shininess = 0.5;
 	cementMaterial.tag = "cement";
 
-	m_objectMaterials.push_back(cementMaterial);
+	AddObjectMaterial(cementMaterial);
 
 	OBJECT_MATERIAL woodMaterial;
 	woodMaterial.ambientColor = glm::vec3(0.2f, 0.2f, 0.2f);
@@ -463,7 +689,7 @@ void SceneManager::DefineObjectMaterials()
 	woodMaterial.shininess = 0.3;
 	woodMaterial.tag = "wood";
 
-	m_objectMaterials.push_back(woodMaterial);
+	AddObjectMaterial(woodMaterial);
 
 	OBJECT_MATERIAL polishwoodMaterial;
 	polishwoodMaterial.ambientColor = glm::vec3(0.4f, 0.3f, 0.1f);
@@ -473,7 +699,7 @@ void SceneManager::DefineObjectMaterials()
 	polishwoodMaterial.shininess = 11.0;
 	polishwoodMaterial.tag = "polishWood";
 
-	m_objectMaterials.push_back(polishwoodMaterial);
+	AddObjectMaterial(polishwoodMaterial);
 
 	OBJECT_MATERIAL tileMaterial;
 	tileMaterial.ambientColor = glm::vec3(0.2f, 0.3f, 0.4f);
@@ -483,7 +709,7 @@ void SceneManager::DefineObjectMaterials()
 	tileMaterial.shininess = 25.0;
 	tileMaterial.tag = "tile";
 
-	m_objectMaterials.push_back(tileMaterial);
+	AddObjectMaterial(tileMaterial);
 
 	OBJECT_MATERIAL glassMaterial;
 	glassMaterial.ambientColor = glm::vec3(0.4f, 0.4f, 0.4f);
@@ -493,7 +719,7 @@ void SceneManager::DefineObjectMaterials()
 	glassMaterial.shininess = 85.0;
 	glassMaterial.tag = "glass";
 
-	m_objectMaterials.push_back(glassMaterial);
+	AddObjectMaterial(glassMaterial);
 
 	OBJECT_MATERIAL clayMaterial;
 	clayMaterial.ambientColor = glm::vec3(0.2f, 0.2f, 0.3f);
@@ -503,7 +729,7 @@ void SceneManager::DefineObjectMaterials()
 	clayMaterial.shininess = 0.5;
 	clayMaterial.tag = "clay";
 
-	m_objectMaterials.push_back(clayMaterial);
+	AddObjectMaterial(clayMaterial);
 
 	OBJECT_MATERIAL polishclayMaterial;
 	polishclayMaterial.ambientColor = glm::vec3(0.4f, 0.3f, 0.1f);
@@ -513,9 +739,52 @@ void SceneManager::DefineObjectMaterials()
 	polishclayMaterial.shininess = 30.0;
 	polishclayMaterial.tag = "polishClay";
 
-	m_objectMaterials.push_back(polishclayMaterial);
+	AddObjectMaterial(polishclayMaterial);
+}
+
+void SceneManager::DefineSceneLights()
+{
+	/*** STUDENTS - add the code BELOW for setting up light sources ***/
+	/*** Up to four light sources can be defined. Refer to the code ***/
+	/*** in the OpenGL Sample for help                              ***/
+
+	m_lightSources[0].position = glm::vec3(3.0f, 14.0f, 0.0f);
+	m_lightSources[0].ambientColor = glm::vec3(0.01f, 0.01f, 0.01f);
+	m_lightSources[0].diffuseColor = glm::vec3(0.4f, 0.4f, 0.4f);
+	m_lightSources[0].specularColor = glm::vec3(0.1f, 0.1f, 0.1f);
+	m_lightSources[0].focalStrength = 32.0f;
+	m_lightSources[0].specularIntensity = 0.05f;
+
+	m_lightSources[1].position = glm::vec3(-3.0f, 14.0f, 0.0f);
+	m_lightSources[1].ambientColor = glm::vec3(0.01f, 0.01f, 0.01f);
+	m_lightSources[1].diffuseColor = glm::vec3(0.4f, 0.4f, 0.4f);
+	m_lightSources[1].specularColor = glm::vec3(0.0f, 0.0f, 0.0f);
+	m_lightSources[1].focalStrength = 32.0f;
+	m_lightSources[1].specularIntensity = 0.05f;
+
+	m_lightSources[2].position = glm::vec3(0.6f, 5.0f, 6.0f);
+	m_lightSources[2].ambientColor = glm::vec3(0.01f, 0.01f, 0.01f);
+	m_lightSources[2].diffuseColor = glm::vec3(0.3f, 0.3f, 0.3f);
+	m_lightSources[2].specularColor = glm::vec3(0.3f, 0.3f, 0.3f);
+	m_lightSources[2].focalStrength = 12.0f;
+	m_lightSources[2].specularIntensity = 0.5f;
+
+	m_lightSources[3].position = glm::vec3(-0.6f, 5.0f, 6.0f);
+	m_lightSources[3].ambientColor = glm::vec3(0.01f, 0.01f, 0.01f);
+	m_lightSources[3].diffuseColor = glm::vec3(0.3f, 0.3f, 0.3f);
+	m_lightSources[3].specularColor = glm::vec3(0.3f, 0.3f, 0.3f);
+	m_lightSources[3].focalStrength = 12.0f;
+	m_lightSources[3].specularIntensity = 0.5f;
 }
 
+/***********************************************************
+ *  SetupSceneLights()
+ *
+ *  This method is used for setting the light sources into
+ *  the current program.  The lights are program state, so
+ *  this is called again for each program that lights the
+ *  scene, and after the lights have changed.
+ ***********************************************************/
 void SceneManager::SetupSceneLights()
 {
 	// this line of code is NEEDED for telling the shaders to render 
@@ -524,40 +793,50 @@ void SceneManager::SetupSceneLights()
 	// default OpenGL lighting then comment out the following line
 	m_pShaderManager->setBoolValue(g_UseLightingName, true);
 
-	/*** STUDENTS - add the code BELOW for setting up light sources ***/
-	/*** Up to four light sources can be defined. Refer to the code ***/
-	/*** in the OpenGL Sample for help                              ***/
-
-	m_pShaderManager->setVec3Value("lightSources[0].position", 3.0f, 14.0f, 0.0f);
-	m_pShaderManager->setVec3Value("lightSources[0].ambientColor", 0.01f, 0.01f, 0.01f);
-	m_pShaderManager->setVec3Value("lightSources[0].diffuseColor", 0.4f, 0.4f, 0.4f);
-	m_pShaderManager->setVec3Value("lightSources[0].specularColor", 0.1f, 0.1f, 0.1f);
-	m_pShaderManager->setFloatValue("lightSources[0].focalStrength", 32.0f);
-	m_pShaderManager->setFloatValue("lightSources[0].specularIntensity", 0.05f);
-
-	m_pShaderManager->setVec3Value("lightSources[1].position", -3.0f, 14.0f, 0.0f);
-	m_pShaderManager->setVec3Value("lightSources[1].ambientColor", 0.01f, 0.01f, 0.01f);
-	m_pShaderManager->setVec3Value("lightSources[1].diffuseColor", 0.4f, 0.4f, 0.4f);
-	m_pShaderManager->setVec3Value("lightSources[1].specularColor", 0.0f, 0.0f, 0.0f);
-	m_pShaderManager->setFloatValue("lightSources[1].focalStrength", 32.0f);
-	m_pShaderManager->setFloatValue("lightSources[1].specularIntensity", 0.05f);
+	for (int i = 0; i < MAX_LIGHT_SOURCES; i++)
+	{
+		std::string lightName = "lightSources[" + std::to_string(i) + "].";
+		m_pShaderManager->setVec3Value(lightName + "position", m_lightSources[i].position);
+		m_pShaderManager->setVec3Value(lightName + "ambientColor", m_lightSources[i].ambientColor);
+		m_pShaderManager->setVec3Value(lightName + "diffuseColor", m_lightSources[i].diffuseColor);
+		m_pShaderManager->setVec3Value(lightName + "specularColor", m_lightSources[i].specularColor);
+		m_pShaderManager->setFloatValue(lightName + "focalStrength", m_lightSources[i].focalStrength);
+		m_pShaderManager->setFloatValue(lightName + "specularIntensity", m_lightSources[i].specularIntensity);
+	}
+}
 
-	m_pShaderManager->setVec3Value("lightSources[2].position", 0.6f, 5.0f, 6.0f);
-	m_pShaderManager->setVec3Value("lightSources[2].ambientColor", 0.01f, 0.01f, 0.01f);
-	m_pShaderManager->setVec3Value("lightSources[2].diffuseColor", 0.3f, 0.3f, 0.3f);
-	m_pShaderManager->setVec3Value("lightSources[2].specularColor", 0.3f, 0.3f, 0.3f);
-	m_pShaderManager->setFloatValue("lightSources[2].focalStrength", 12.0f);
-	m_pShaderManager->setFloatValue("lightSources[2].specularIntensity", 0.5f);
+/***********************************************************
+ *  SetSceneLight()
+ *
+ *  This method is used for replacing one light source.  The
+ *  programs see it once SetupSceneLights() is called.
+ ***********************************************************/
+bool SceneManager::SetSceneLight(int lightIndex, const LIGHT_SOURCE& light)
+{
+	if ((lightIndex < 0) || (lightIndex >= MAX_LIGHT_SOURCES))
+	{
+		return(false);
+	}
 
-	m_pShaderManager->setVec3Value("lightSources[3].position", -0.6f, 5.0f, 6.0f);
-	m_pShaderManager->setVec3Value("lightSources[3].ambientColor", 0.01f, 0.01f, 0.01f);
-	m_pShaderManager->setVec3Value("lightSources[3].diffuseColor", 0.3f, 0.3f, 0.3f);
-	m_pShaderManager->setVec3Value("lightSources[3].specularColor", 0.3f, 0.3f, 0.3f);
-	m_pShaderManager->setFloatValue("lightSources[3].focalStrength", 12.0f);
-	m_pShaderManager->setFloatValue("lightSources[3].specularIntensity", 0.5f);
+	m_lightSources[lightIndex] = light;
+	return(true);
+}
 
-	m_pShaderManager->setBoolValue("bUseLighting", true);
+/***********************************************************
+ *  GetSceneLight()
+ *
+ *  This method is used for getting a copy of one light
+ *  source.
+ ***********************************************************/
+bool SceneManager::GetSceneLight(int lightIndex, LIGHT_SOURCE& light) const
+{
+	if ((lightIndex < 0) || (lightIndex >= MAX_LIGHT_SOURCES))
+	{
+		return(false);
+	}
 
+	light = m_lightSources[lightIndex];
+	return(true);
 }
 
 /***********************************************************
@@ -565,57 +844,328 @@ void SceneManager::SetupSceneLights()
  *
  *  This method is used for preparing the 3D scene by loading
  *  the shapes, textures in memory to support the 3D scene 
- *  rendering
+ *  rendering.  Each stage is a task that waits only on the
+ *  stages it needs - the texture files are all read at once
+ *  by the file reader of the cache and decoded on worker
+ *  threads as they arrive, while the meshes are uploaded
+ *  and the lights are set on this thread, which owns the
+ *  OpenGL context, and the scene nodes are defined once the
+ *  textures, materials and meshes they refer to are ready.
  ***********************************************************/
 void SceneManager::PrepareScene()
 {
-	// load the textures for the 3D scene
+	// the state of one texture file as it goes through the tasks
+	struct TEXTURE_LOAD
+	{
+		std::string filename;
+		std::vector<unsigned char> data;
+		ResourceCache::DECODED_IMAGE image;
+		bool bRead;
+		bool bDecoded;
+		// the task that the file reader finishes once the data
+		// has arrived
+		int readTask;
+	};
+
+	TaskGraph loadGraph;
+
+	// find out which image files the textures are loaded from
+	std::vector<std::string> textureFiles;
+	m_pCollectedTextureFiles = &textureFiles;
 	LoadSceneTextures();
+	m_pCollectedTextureFiles = NULL;
+
+	// placing the textures into their slots finds them in the
+	// cache, once every file has been read, decoded and uploaded
+	int texturesTask = loadGraph.AddTask(
+		"textures", TaskGraph::TASK_CONTEXT_THREAD, [this]() { LoadSceneTextures(); });
+
+	std::vector<TEXTURE_LOAD> textureLoads(textureFiles.size());
+	for (int i = 0; i < textureFiles.size(); i++)
+	{
+		if (m_pResourceCache->GetTextureState(textureFiles[i].c_str()) == ResourceCache::TEXTURE_LOADED)
+		{
+			continue;
+		}
+
+		TEXTURE_LOAD* pLoad = &textureLoads[i];
+		pLoad->filename = textureFiles[i];
+		pLoad->image.pixels = NULL;
+		pLoad->bRead = false;
+		pLoad->bDecoded = false;
+
+		// the read task only hands the file to the reader, and
+		// the reader finishes it from its own thread, so every
+		// read is in flight together without holding a worker,
+		// and the graph does not return before each has arrived
+		ResourceCache* pResourceCache = m_pResourceCache;
+		TaskGraph* pLoadGraph = &loadGraph;
+		pLoad->readTask = loadGraph.AddAsyncTask(
+			"read " + textureFiles[i], TaskGraph::TASK_ANY_THREAD,
+			[pResourceCache, pLoadGraph, pLoad]()
+			{
+				pResourceCache->ReadImageFileAsync(pLoad->filename.c_str(),
+					[pLoadGraph, pLoad](bool bRead, std::vector<unsigned char>& data)
+					{
+						pLoad->data.swap(data);
+						pLoad->bRead = bRead;
+						pLoadGraph->FinishTask(pLoad->readTask);
+					});
+			});
+		int decodeTask = loadGraph.AddTask(
+			"decode " + textureFiles[i], TaskGraph::TASK_ANY_THREAD,
+			[pResourceCache, pLoad]()
+			{
+				if (pLoad->bRead == true)
+				{
+					pLoad->bDecoded = pResourceCache->DecodeImageFile(
+						pLoad->filename.c_str(), pLoad->data, pLoad->image);
+				}
+				pLoad->data.clear();
+				pLoad->data.shrink_to_fit();
+			});
+		int uploadTask = loadGraph.AddTask(
+			"upload " + textureFiles[i], TaskGraph::TASK_CONTEXT_THREAD,
+			[pResourceCache, pLoad]()
+			{
+				if (pLoad->bDecoded == true)
+				{
+					pResourceCache->AddDecodedTexture(pLoad->image);
+				}
+			});
+		loadGraph.AddDependency(decodeTask, pLoad->readTask);
+		loadGraph.AddDependency(uploadTask, decodeTask);
+		loadGraph.AddDependency(texturesTask, uploadTask);
+	}
 
 	// define the materials for objects in the scene
-	DefineObjectMaterials();
+	int materialsTask = loadGraph.AddTask(
+		"materials", TaskGraph::TASK_ANY_THREAD, [this]() { DefineObjectMaterials(); });
 	// add and define the light sources for the scene
-	SetupSceneLights();
+	loadGraph.AddTask(
+		"lights", TaskGraph::TASK_CONTEXT_THREAD, [this]() { SetupSceneLights(); });
+
+	// define the scene nodes and their keyframe animations
+	int nodesTask = loadGraph.AddTask(
+		"nodes", TaskGraph::TASK_ANY_THREAD, [this]() { DefineSceneNodes(); });
+	int animationsTask = loadGraph.AddTask(
+		"animations", TaskGraph::TASK_ANY_THREAD, [this]() { DefineSceneAnimations(); });
+	loadGraph.AddDependency(nodesTask, texturesTask);
+	loadGraph.AddDependency(nodesTask, materialsTask);
+	loadGraph.AddDependency(animationsTask, nodesTask);
 
 	// only one instance of a particular mesh needs to be
-	// loaded in memory no matter how many times it is drawn
-	// in the rendered 3D scene
+	// loaded in memory no matter how many times it is drawn,
+	// and no matter how many scenes draw it - register the
+	// loaded meshes so that scene nodes can refer to them
+	for (int i = 0; i < MESH_TYPE_COUNT; i++)
+	{
+		MESH_DATA mesh;
+		mesh.type = (MESH_TYPE)i;
+		m_meshHandles[i] = m_meshes.Add(mesh);
+
+		// the shape meshes generate and upload their vertices in
+		// one call, so each mesh is a single context thread task
+		int meshTask = loadGraph.AddTask(
+			"mesh", TaskGraph::TASK_CONTEXT_THREAD, [this, i]() { LoadSceneMesh((MESH_TYPE)i); });
+		loadGraph.AddDependency(nodesTask, meshTask);
+	}
 
-	m_basicMeshes->LoadBoxMesh();
-	m_basicMeshes->LoadPlaneMesh();
-	m_basicMeshes->LoadCylinderMesh();
-	m_basicMeshes->LoadConeMesh();
-	m_basicMeshes->LoadPrismMesh();
-	m_basicMeshes->LoadPyramid4Mesh();
-	m_basicMeshes->LoadSphereMesh();
-	m_basicMeshes->LoadTaperedCylinderMesh();
-	m_basicMeshes->LoadTorusMesh();
+	if (loadGraph.Run() == true)
+	{
+		std::cout << "Prepared scene in " << loadGraph.GetElapsedSeconds() * 1000.0 <<
+			" ms, critical path " << loadGraph.GetCriticalPathSeconds() * 1000.0 <<
+			" ms, all tasks " << loadGraph.GetTaskSeconds() * 1000.0 << " ms" << std::endl;
+	}
 }
 
 /***********************************************************
- *  RenderScene()
+ *  CacheTextureAsync()
  *
- *  This method is used for rendering the 3D scene by 
- *  transforming and drawing the basic 3D shapes
+ *  This coroutine is used for getting the texture for an
+ *  image file into the resource cache.  The file is read by
+ *  the file reader of the cache, decoded on a worker thread
+ *  once it has arrived, and the texture is created back on
+ *  the context thread.
  ***********************************************************/
-void SceneManager::RenderScene()
+LoadTask<bool> SceneManager::CacheTextureAsync(LoadScheduler* pScheduler, std::string filename)
 {
-	// declare the variables for the transformations
-	glm::vec3 scaleXYZ;
-	float XrotationDegrees = 0.0f;
-	float YrotationDegrees = 0.0f;
-	float ZrotationDegrees = 0.0f;
-	glm::vec3 positionXYZ;
+	ResourceCache::DECODED_IMAGE image;
+	std::vector<unsigned char> data;
+	bool bDecoded = false;
 
-	glm::mat4 scale;
-	glm::mat4 rotation;
-	glm::mat4 rotation2;
-	glm::mat4 translation;
-	glm::mat4 model;
+	co_await pScheduler->OnContext();
+	if (m_pResourceCache->GetTextureState(filename.c_str()) == ResourceCache::TEXTURE_LOADED)
+	{
+		co_return(true);
+	}
+
+	// resumes on a worker thread
+	bool bRead = co_await IMAGE_FILE_READ{ m_pResourceCache, pScheduler, filename.c_str(), &data, false };
+	if (bRead == true)
+	{
+		bDecoded = m_pResourceCache->DecodeImageFile(filename.c_str(), data, image);
+	}
+	data.clear();
+	data.shrink_to_fit();
+
+	co_await pScheduler->OnContext();
+	if (bDecoded == false)
+	{
+		co_return(false);
+	}
 
-	/*** Set needed transformations before drawing the basic mesh.  ***/
-	/*** This same ordering of code should be used for transforming ***/
-	/*** and drawing all the basic 3D shapes.						***/
+	co_return(m_pResourceCache->AddDecodedTexture(image).IsValid());
+}
+
+/***********************************************************
+ *  LoadTextureAsync()
+ *
+ *  This coroutine is used for loading the texture for an
+ *  image file and placing it into a texture slot.
+ ***********************************************************/
+LoadTask<bool> SceneManager::LoadTextureAsync(LoadScheduler* pScheduler, std::string filename, std::string tag)
+{
+	bool bCached = co_await CacheTextureAsync(pScheduler, filename);
+	if (bCached == false)
+	{
+		co_return(false);
+	}
+
+	co_await pScheduler->OnContext();
+	co_return(CreateGLTexture(filename.c_str(), tag));
+}
+
+/***********************************************************
+ *  LoadMeshAsync()
+ *
+ *  This coroutine is used for loading a basic mesh.  The
+ *  shape meshes generate and upload their vertices in one
+ *  call, so all of it runs on the context thread.
+ ***********************************************************/
+LoadTask<bool> SceneManager::LoadMeshAsync(LoadScheduler* pScheduler, MESH_TYPE mesh)
+{
+	co_await pScheduler->OnContext();
+	LoadSceneMesh(mesh);
+
+	co_return(m_pResourceCache->IsShapeMeshLoaded(mesh));
+}
+
+/***********************************************************
+ *  PrepareSceneAsync()
+ *
+ *  This coroutine is used for preparing the 3D scene in the
+ *  same steps as PrepareScene().  Every texture file starts
+ *  loading at once, and the materials, lights and meshes
+ *  are set up while the files are read and decoded.
+ ***********************************************************/
+LoadTask<bool> SceneManager::PrepareSceneAsync(LoadScheduler* pScheduler)
+{
+	co_await pScheduler->OnContext();
+
+	// find out which image files the textures are loaded from,
+	// and start loading all of them
+	std::vector<std::string> textureFiles;
+	m_pCollectedTextureFiles = &textureFiles;
+	LoadSceneTextures();
+	m_pCollectedTextureFiles = NULL;
+
+	std::vector<LoadTask<bool>> textureLoads;
+	for (int i = 0; i < textureFiles.size(); i++)
+	{
+		textureLoads.push_back(CacheTextureAsync(pScheduler, textureFiles[i]));
+		textureLoads.back().Start();
+	}
+
+	// define the materials and lights of the scene
+	DefineObjectMaterials();
+	SetupSceneLights();
+
+	// register and load the shared basic meshes
+	for (int i = 0; i < MESH_TYPE_COUNT; i++)
+	{
+		MESH_DATA mesh;
+		mesh.type = (MESH_TYPE)i;
+		m_meshHandles[i] = m_meshes.Add(mesh);
+
+		co_await LoadMeshAsync(pScheduler, (MESH_TYPE)i);
+	}
+
+	// place the textures into their slots once they are cached
+	for (int i = 0; i < textureLoads.size(); i++)
+	{
+		co_await textureLoads[i];
+	}
+	co_await pScheduler->OnContext();
+	LoadSceneTextures();
+
+	// define the scene nodes and their keyframe animations
+	DefineSceneNodes();
+	DefineSceneAnimations();
+
+	co_return(true);
+}
+
+/***********************************************************
+ *  LoadSceneMesh()
+ *
+ *  This method is used for loading a basic mesh into the
+ *  shared meshes, unless another scene already loaded it.
+ ***********************************************************/
+void SceneManager::LoadSceneMesh(MESH_TYPE mesh)
+{
+	if (m_pResourceCache->IsShapeMeshLoaded(mesh) == true)
+	{
+		return;
+	}
+
+	switch (mesh)
+	{
+	case MESH_BOX:
+		m_basicMeshes->LoadBoxMesh();
+		break;
+	case MESH_PLANE:
+		m_basicMeshes->LoadPlaneMesh();
+		break;
+	case MESH_CYLINDER:
+		m_basicMeshes->LoadCylinderMesh();
+		break;
+	case MESH_CONE:
+		m_basicMeshes->LoadConeMesh();
+		break;
+	case MESH_PRISM:
+		m_basicMeshes->LoadPrismMesh();
+		break;
+	case MESH_PYRAMID4:
+		m_basicMeshes->LoadPyramid4Mesh();
+		break;
+	case MESH_SPHERE:
+		m_basicMeshes->LoadSphereMesh();
+		break;
+	case MESH_TAPERED_CYLINDER:
+		m_basicMeshes->LoadTaperedCylinderMesh();
+		break;
+	case MESH_TORUS:
+		m_basicMeshes->LoadTorusMesh();
+		break;
+	default:
+		return;
+	}
+	m_pResourceCache->SetShapeMeshLoaded(mesh);
+}
+
+/***********************************************************
+ *  DefineSceneNodes()
+ *
+ *  This method is used for defining the scene nodes that
+ *  are drawn each frame - one node per transformed basic
+ *  3D shape, with its color, material and texture
+ ***********************************************************/
+void SceneManager::DefineSceneNodes()
+{
+	/*** Declare the transformations for each basic mesh and    ***/
+	/*** add a scene node for it.  The nodes are drawn in the   ***/
+	/*** same order that they are added.						***/
 	/******************************************************************/
 
 	/****************************************************************/
@@ -629,22 +1179,18 @@ void SceneManager::RenderScene()
 	float newPlaneZrotationDegrees = 0.0f;
 	glm::vec3 newPlanePositionXYZ = glm::vec3(0.0f, 1.5f, 0.0f); // Adjusted position above the original plane
 
-	// Set transformations for the new plane
-	SetTransformations(
+	// Add the scene node for the new plane
+	AddSceneNode(
+		"table",
+		MESH_PLANE,
 		newPlaneScaleXYZ,
 		newPlaneXrotationDegrees,
 		newPlaneYrotationDegrees,
 		newPlaneZrotationDegrees,
-		newPlanePositionXYZ);
-
-	// Set color for the new plane (light brown/beige)
-	SetShaderColor(0.9f, 0.8f, 0.7f, 1.0f); // Light brown/beige color
-
-	// Draw the new plane
-
-	SetShaderMaterial("polishWood");
-	SetShaderTexture("table");
-	m_basicMeshes->DrawPlaneMesh();
+		newPlanePositionXYZ,
+		glm::vec4(0.9f, 0.8f, 0.7f, 1.0f),
+		"polishWood",
+		"table");
 
 
 	/****************************************************************/
@@ -659,24 +1205,20 @@ void SceneManager::RenderScene()
 	float appleZrotationDegrees = -1.0f;
 	glm::vec3 applePositionXYZ = glm::vec3(0.0f, 2.5f, 0.0f); // Adjusted position
 
-	// Set the transformations for the apple
-	SetTransformations(
+	// Add the scene node for the apple
+	AddSceneNode(
+		"apple",
+		MESH_SPHERE,
 		appleScaleXYZ,
 		appleXrotationDegrees,
 		appleYrotationDegrees,
 		appleZrotationDegrees,
-		applePositionXYZ);
-
-	// Set the color for the apple (green)
-	//SetShaderColor(0.55f, 0.71f, 0.0f, 1.0f); // Green apple color
+		applePositionXYZ,
+		glm::vec4(0.9f, 0.8f, 0.7f, 1.0f),
+		"appleskin",
+		"apple");
 
-	// Draw the apple (sphere mesh)
-
-	SetShaderMaterial("appleskin");
-	SetShaderTexture("apple");
-	m_basicMeshes->DrawSphereMesh(); // Draw apple-shaped sphere
-
-	/****************************************************************/
+	/****************************************************************/
 
    // Cylinder for apple stem
    // Declare the variables for the stem transformations
@@ -686,22 +1228,18 @@ void SceneManager::RenderScene()
 	float stemZrotationDegrees = -15.0f;
 	glm::vec3 stemPositionXYZ = glm::vec3(0.0f, 3.0f, 0.0f); // Positioned on top of the apple
 
-	// Set the transformations for the stem
-	SetTransformations(
+	// Add the scene node for the stem
+	AddSceneNode(
+		"stem",
+		MESH_CYLINDER,
 		stemScaleXYZ,
 		stemXrotationDegrees,
 		stemYrotationDegrees,
 		stemZrotationDegrees,
-		stemPositionXYZ);
-
-	// Set the color for the stem (brown)
-	//SetShaderColor(0.55f, 0.27f, 0.07f, 1.0f); // Brown color
-
-	// Draw the stem (cylinder mesh)
-
-	SetShaderMaterial("wood");
-	SetShaderTexture("stem");
-	m_basicMeshes->DrawCylinderMesh(); // Draw stem-shaped cylinder
+		stemPositionXYZ,
+		glm::vec4(0.9f, 0.8f, 0.7f, 1.0f),
+		"wood",
+		"stem");
 
 	/****************************************************************/
 	//Ceremic container
@@ -716,21 +1254,18 @@ void SceneManager::RenderScene()
 	float containerZrotationDegrees = 0.0f;
 	glm::vec3 containerPositionXYZ = glm::vec3(2.5f, 1.5f, 0.0f); // Adjusted position to be next to apple
 
-	// Set the transformations for the container
-	SetTransformations(
+	// Add the scene node for the container
+	AddSceneNode(
+		"container",
+		MESH_CYLINDER,
 		containerScaleXYZ,
 		containerXrotationDegrees,
 		containerYrotationDegrees,
 		containerZrotationDegrees,
-		containerPositionXYZ);
-
-	//SetShaderColor(0.55f, 0.71f, 0.0f, 1.0f); // Green apple color
-
-	// Draw the apple (sphere mesh)
-
-	SetShaderMaterial("polishClay");
-	SetShaderTexture("ceramic");
-	m_basicMeshes->DrawCylinderMesh(); // Draw cylinder
+		containerPositionXYZ,
+		glm::vec4(0.9f, 0.8f, 0.7f, 1.0f),
+		"polishClay",
+		"ceramic");
 
 	//Sphere for container lid top
 // Declare the variables for the container transformations
@@ -740,21 +1275,18 @@ void SceneManager::RenderScene()
 	float lidZrotationDegrees = 0.0f;
 	glm::vec3 lidPositionXYZ = glm::vec3(2.5f, 3.85f, 0.0f); //Positioned to rest on container
 
-	// Set the transformations for lid
-	SetTransformations(
+	// Add the scene node for lid
+	AddSceneNode(
+		"lid",
+		MESH_SPHERE,
 		lidScaleXYZ,
 		lidXrotationDegrees,
 		lidYrotationDegrees,
 		lidZrotationDegrees,
-		lidPositionXYZ);
-
-	//SetShaderColor(0.55f, 0.71f, 0.0f, 1.0f); // Green apple color
-
-	// Draw the apple (sphere mesh)
-
-	SetShaderMaterial("polishClay");
-	SetShaderTexture("ceramic");
-	m_basicMeshes->DrawSphereMesh(); // Draw sphere
+		lidPositionXYZ,
+		glm::vec4(0.9f, 0.8f, 0.7f, 1.0f),
+		"polishClay",
+		"ceramic");
 
 	//Torus for lid2
 	// Declare the variables for the container transformations
@@ -764,21 +1296,18 @@ void SceneManager::RenderScene()
 	float lid2ZrotationDegrees = 0.0f;
 	glm::vec3 lid2PositionXYZ = glm::vec3(2.5f, 3.45f, 0.0f); // Adjusted to be radial around container top edge
 
-	// Set the transformations for lid2
-	SetTransformations(
+	// Add the scene node for lid2
+	AddSceneNode(
+		"lid2",
+		MESH_TORUS,
 		lid2ScaleXYZ,
 		lid2XrotationDegrees,
 		lid2YrotationDegrees,
 		lid2ZrotationDegrees,
-		lid2PositionXYZ);
-
-	//SetShaderColor(0.55f, 0.71f, 0.0f, 1.0f); // Green apple color
-
-	// Draw the apple (sphere mesh)
-
-	SetShaderMaterial("polishClay");
-	SetShaderTexture("ceramic");
-	m_basicMeshes->DrawTorusMesh(); // Draw sphere
+		lid2PositionXYZ,
+		glm::vec4(0.9f, 0.8f, 0.7f, 1.0f),
+		"polishClay",
+		"ceramic");
 
 	//Cylinder for lid3
 // Declare the variables for the container transformations
@@ -788,20 +1317,18 @@ void SceneManager::RenderScene()
 	float lid3ZrotationDegrees = 0.0f;
 	glm::vec3 lid3PositionXYZ = glm::vec3(2.5f, 3.45f, 0.0f); // Adjusted to fill space inside the torus
 
-	// Set the transformations for lid3
-	SetTransformations(
+	// Add the scene node for lid3
+	AddSceneNode(
+		"lid3",
+		MESH_CYLINDER,
 		lid3ScaleXYZ,
 		lid3XrotationDegrees,
 		lid3YrotationDegrees,
 		lid3ZrotationDegrees,
-		lid3PositionXYZ);
-
-	//SetShaderColor(0.55f, 0.71f, 0.0f, 1.0f); // Green apple color
-
-
-	SetShaderMaterial("polishClay");
-	SetShaderTexture("ceramic");
-	m_basicMeshes->DrawCylinderMesh(); // Draw cylinder
+		lid3PositionXYZ,
+		glm::vec4(0.9f, 0.8f, 0.7f, 1.0f),
+		"polishClay",
+		"ceramic");
 
 	/****************************************************************/
 	//Box 1
@@ -815,19 +1342,18 @@ void SceneManager::RenderScene()
 	float box1ZrotationDegrees = 0.0f;
 	glm::vec3 box1PositionXYZ = glm::vec3(2.5f, 3.0f, -3.5f); // Adjusted to fill space inside the torus
 
-	// Set the transformations for the box
-	SetTransformations(
+	// Add the scene node for the box
+	AddSceneNode(
+		"box1",
+		MESH_BOX,
 		box1ScaleXYZ,
 		box1XrotationDegrees,
 		box1YrotationDegrees,
 		box1ZrotationDegrees,
-		box1PositionXYZ);
-
-	SetShaderColor(1.0f, 1.0f, 1.0f, 1.0f); // Regular white color
-
-	SetShaderMaterial("wood");
-	SetShaderTexture("cardboard");
-	m_basicMeshes->DrawBoxMesh(); // Draw box1
+		box1PositionXYZ,
+		glm::vec4(1.0f, 1.0f, 1.0f, 1.0f),
+		"wood",
+		"cardboard");
 
 	/****************************************************************/
 	//Box 2
@@ -841,19 +1367,18 @@ void SceneManager::RenderScene()
 	float box2ZrotationDegrees = 0.0f;
 	glm::vec3 box2PositionXYZ = glm::vec3(-0.35f, 3.25f, -1.5f); // Behind apple
 
-	// Set the transformations for the box
-	SetTransformations(
+	// Add the scene node for the box
+	AddSceneNode(
+		"box2",
+		MESH_BOX,
 		box2ScaleXYZ,
 		box2XrotationDegrees,
 		box2YrotationDegrees,
 		box2ZrotationDegrees,
-		box2PositionXYZ);
-
-	SetShaderColor(1.0f, 1.0f, 1.0f, 1.0f); // Regular white color
-
-	SetShaderMaterial("wood");
-	SetShaderTexture("cardboard");
-	m_basicMeshes->DrawBoxMesh(); // Draw box2
+		box2PositionXYZ,
+		glm::vec4(1.0f, 1.0f, 1.0f, 1.0f),
+		"wood",
+		"cardboard");
 
 	/****************************************************************/
 	//Teacup
@@ -866,19 +1391,18 @@ void SceneManager::RenderScene()
 	float teacupZrotationDegrees = 0.0f;
 	glm::vec3 teacupPositionXYZ = glm::vec3(2.5f, 6.0f, -3.5f); // On top of box1
 
-	// Set the transformations for the teacup
-	SetTransformations(
+	// Add the scene node for the teacup
+	AddSceneNode(
+		"teacup",
+		MESH_TAPERED_CYLINDER,
 		teacupScaleXYZ,
 		teacupXrotationDegrees,
 		teacupYrotationDegrees,
 		teacupZrotationDegrees,
-		teacupPositionXYZ);
-
-	SetShaderColor(1.0f, 1.0f, 1.0f, 1.0f); // Regular white color
-
-	SetShaderMaterial("polishClay");
-	SetShaderTexture("ceramic");
-	m_basicMeshes->DrawTaperedCylinderMesh(); // Draw teacup
+		teacupPositionXYZ,
+		glm::vec4(1.0f, 1.0f, 1.0f, 1.0f),
+		"polishClay",
+		"ceramic");
 
 	//Torus for teacup handle
 	glm::vec3 handleScaleXYZ = glm::vec3(0.5f, 0.5f, 0.5f); // Tall, thin, wide handle
@@ -887,18 +1411,1098 @@ void SceneManager::RenderScene()
 	float handleZrotationDegrees = 0.0f;
 	glm::vec3 handlePositionXYZ = glm::vec3(3.5f, 5.25f, -3.5f); // On top of box1
 
-	// Set the transformations for the handle
-	SetTransformations(
+	// Add the scene node for the handle
+	AddSceneNode(
+		"handle",
+		MESH_TORUS,
 		handleScaleXYZ,
 		handleXrotationDegrees,
 		handleYrotationDegrees,
 		handleZrotationDegrees,
-		handlePositionXYZ);
+		handlePositionXYZ,
+		glm::vec4(1.0f, 1.0f, 1.0f, 1.0f),
+		"polishClay",
+		"ceramic");
+}
+
+
+/***********************************************************
+ *  DefineSceneAnimations()
+ *
+ *  This method is used for defining the keyframe animation
+ *  tracks for the scene nodes and object materials
+ ***********************************************************/
+void SceneManager::DefineSceneAnimations()
+{
+	std::vector<AnimationSystem::KEYFRAME> keyframes;
+	AnimationSystem::KEYFRAME keyframe;
+
+	// slowly turn the apple about its vertical axis, keeping
+	// the slight tilt that the apple is defined with
+	keyframe.time = 0.0f;
+	keyframe.value = glm::vec3(0.0f, 0.0f, -1.0f);
+	keyframes.push_back(keyframe);
+	keyframe.time = 12.0f;
+	keyframe.value = glm::vec3(0.0f, 360.0f, -1.0f);
+	keyframes.push_back(keyframe);
+
+	AddNodeAnimation(
+		"apple",
+		AnimationSystem::CHANNEL_ROTATION,
+		keyframes,
+		true);
+}
+
+/***********************************************************
+ *  DefineSceneImpostors()
+ *
+ *  This method is used for defining the compound props whose
+ *  distant copies are drawn as impostor billboards.  Copies
+ *  are placed through the impostor system.
+ ***********************************************************/
+void SceneManager::DefineSceneImpostors(ImpostorSystem* pImpostors)
+{
+	std::vector<std::string> nodeTags;
+
+	if (NULL == pImpostors)
+	{
+		return;
+	}
+
+	// ceramic container with its three lid parts
+	nodeTags.push_back("container");
+	nodeTags.push_back("lid");
+	nodeTags.push_back("lid2");
+	nodeTags.push_back("lid3");
+	pImpostors->DefineProp("container", nodeTags);
+
+	// teacup with its handle
+	nodeTags.clear();
+	nodeTags.push_back("teacup");
+	nodeTags.push_back("handle");
+	pImpostors->DefineProp("teacup", nodeTags);
+}
+
+/***********************************************************
+ *  DefineStreamedObjects()
+ *
+ *  This method is used for defining the crates and fruit
+ *  that stand in a wide ring around the table.  They are
+ *  added through the streamer, so only the ones near the
+ *  camera are in the scene and have their textures loaded.
+ *  Their image files are not used by the rest of the scene,
+ *  so they are only loaded when the camera comes near.
+ ***********************************************************/
+void SceneManager::DefineStreamedObjects()
+{
+	const char* textureFiles[] =
+	{
+		"../../Utilities/textures/pavers.jpg",
+		"../../Utilities/textures/breadcrust.jpg",
+		"../../Utilities/textures/red_apple.jpg",
+		"../../Utilities/textures/cheese_wheel.jpg"
+	};
+	const int textureCount = sizeof(textureFiles) / sizeof(textureFiles[0]);
+	// the ring is further out than the streamer loads from the
+	// starting camera position
+	const int objectCount = 48;
+	const float ringRadius = 64.0f;
+
+	if (NULL == m_pStreamer)
+	{
+		return;
+	}
+
+	for (int i = 0; i < objectCount; i++)
+	{
+		float angleDegrees = 360.0f * i / objectCount;
+		float angle = glm::radians(angleDegrees);
+		SceneStreamer::STREAMED_OBJECT object;
+
+		object.tag = "streamed" + std::to_string(i);
+		object.rotationDegrees = glm::vec3(0.0f, -angleDegrees, 0.0f);
+		object.color = glm::vec4(1.0f);
+		object.textureFile = textureFiles[i % textureCount];
+		if (i % 2 == 0)
+		{
+			// crate standing on the ground
+			object.mesh = MESH_BOX;
+			object.scaleXYZ = glm::vec3(3.0f, 2.0f, 2.0f);
+			object.positionXYZ = glm::vec3(std::cos(angle) * ringRadius, 1.0f, std::sin(angle) * ringRadius);
+			object.materialTag = "wood";
+		}
+		else
+		{
+			// fruit resting on the ground
+			object.mesh = MESH_SPHERE;
+			object.scaleXYZ = glm::vec3(1.0f, 1.1f, 1.0f);
+			object.positionXYZ = glm::vec3(std::cos(angle) * ringRadius, 1.1f, std::sin(angle) * ringRadius);
+			object.materialTag = "appleskin";
+		}
+		m_pStreamer->AddObject(object);
+	}
+}
+
+/***********************************************************
+ *  AddSceneNode()
+ *
+ *  This method is used for adding a node to the scene that
+ *  draws one basic mesh with the passed in transformation,
+ *  color, material and texture.  The tags are resolved to
+ *  handles once, so drawing never compares strings.
+ ***********************************************************/
+int SceneManager::AddSceneNode(
+	std::string tag,
+	MESH_TYPE mesh,
+	glm::vec3 scaleXYZ,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees,
+	glm::vec3 positionXYZ,
+	glm::vec4 color,
+	std::string materialTag,
+	std::string textureTag)
+{
+	return(AddSceneNode(
+		tag,
+		GetMeshHandle(mesh),
+		scaleXYZ,
+		XrotationDegrees,
+		YrotationDegrees,
+		ZrotationDegrees,
+		positionXYZ,
+		color,
+		GetMaterialHandle(materialTag),
+		GetTextureHandle(textureTag)));
+}
+
+/***********************************************************
+ *  AddSceneNode()
+ *
+ *  This method is used for adding a node to the scene that
+ *  draws the mesh for the passed in handle.
+ ***********************************************************/
+int SceneManager::AddSceneNode(
+	std::string tag,
+	MESH_HANDLE mesh,
+	glm::vec3 scaleXYZ,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees,
+	glm::vec3 positionXYZ,
+	glm::vec4 color,
+	MATERIAL_HANDLE material,
+	TEXTURE_HANDLE texture)
+{
+	SCENE_NODE node;
+
+	node.mesh = mesh;
+	node.scaleXYZ = scaleXYZ;
+	node.rotationDegrees = glm::vec3(XrotationDegrees, YrotationDegrees, ZrotationDegrees);
+	node.positionXYZ = positionXYZ;
+	node.color = color;
+	node.material = material;
+	node.texture = texture;
+	// the model matrix is built the first time the node is drawn
+	node.modelMatrix = glm::mat4(1.0f);
+	node.bDirty = true;
+	node.bHidden = false;
+
+	// reuse the index of a removed node when there is one
+	if (m_freeSceneNodes.size() > 0)
+	{
+		int nodeIndex = m_freeSceneNodes.back();
+		m_freeSceneNodes.pop_back();
+		m_sceneNodes[nodeIndex] = node;
+		m_sceneNodeTags[nodeIndex] = tag;
+		// the visible sets were made for the node that was removed
+		MarkSceneNodeChanged(nodeIndex);
+		return(nodeIndex);
+	}
+
+	m_sceneNodes.push_back(node);
+	m_sceneNodeTags.push_back(tag);
+
+	return((int)m_sceneNodes.size() - 1);
+}
+
+/***********************************************************
+ *  RemoveSceneNode()
+ *
+ *  This method is used for removing a scene node.  The node
+ *  stays in place with no mesh, so that the indices of the
+ *  other nodes do not change, and its index is reused by
+ *  the next added node.  The animation tracks of the node
+ *  are removed with it, so they do not drive the next node
+ *  at the same index.  A node that is already removed is
+ *  left alone, so its index is never handed out twice.
+ ***********************************************************/
+void SceneManager::RemoveSceneNode(int nodeIndex)
+{
+	if ((nodeIndex < 0) || (nodeIndex >= m_sceneNodes.size()) ||
+		(m_sceneNodes[nodeIndex].mesh == HandlePool<MESH_DATA>::InvalidHandle()))
+	{
+		return;
+	}
+
+	for (int track = 0; track < m_animations.GetTrackCount(); track++)
+	{
+		if ((m_animations.GetTrackTarget(track) == nodeIndex) &&
+			(AnimationSystem::IsMaterialChannel(m_animations.GetTrackChannel(track)) == false))
+		{
+			m_animations.RemoveTrack(track);
+		}
+	}
+
+	m_sceneNodes[nodeIndex].mesh = HandlePool<MESH_DATA>::InvalidHandle();
+	m_sceneNodes[nodeIndex].texture = HandlePool<TEXTURE_DATA>::InvalidHandle();
+	m_sceneNodeTags[nodeIndex].clear();
+	m_freeSceneNodes.push_back(nodeIndex);
+}
+
+/***********************************************************
+ *  GetSceneNode()
+ *
+ *  This method is used for getting a copy of the scene node
+ *  with the passed in tag.  Returns false when there is no
+ *  node with the tag.
+ ***********************************************************/
+bool SceneManager::GetSceneNode(std::string tag, SCENE_NODE& node)
+{
+	int nodeIndex = FindSceneNode(tag);
+	if (nodeIndex < 0)
+	{
+		return(false);
+	}
+
+	node = m_sceneNodes[nodeIndex];
+	return(true);
+}
+
+/***********************************************************
+ *  GetSceneNode()
+ *
+ *  This method is used for getting a copy of the scene node
+ *  at the passed in index.  Returns false when there is no
+ *  node at the index or it was removed.
+ ***********************************************************/
+bool SceneManager::GetSceneNode(int nodeIndex, SCENE_NODE& node)
+{
+	if ((nodeIndex < 0) || (nodeIndex >= m_sceneNodes.size()) ||
+		(NULL == m_meshes.Get(m_sceneNodes[nodeIndex].mesh)))
+	{
+		return(false);
+	}
+
+	node = m_sceneNodes[nodeIndex];
+	return(true);
+}
+
+/***********************************************************
+ *  SetSceneNode()
+ *
+ *  This method is used for replacing the state of the scene
+ *  node with the passed in tag.  The model matrix is rebuilt
+ *  the next time the node is drawn.  A node that is moved or
+ *  given another mesh is drawn from then on whatever the
+ *  visible sets say, since they were made for its old place.
+ ***********************************************************/
+bool SceneManager::SetSceneNode(std::string tag, const SCENE_NODE& node)
+{
+	int nodeIndex = FindSceneNode(tag);
+	if (nodeIndex < 0)
+	{
+		return(false);
+	}
+
+	const SCENE_NODE& oldNode = m_sceneNodes[nodeIndex];
+	if ((oldNode.positionXYZ != node.positionXYZ) ||
+		(oldNode.scaleXYZ != node.scaleXYZ) ||
+		(oldNode.rotationDegrees != node.rotationDegrees) ||
+		(oldNode.mesh != node.mesh))
+	{
+		MarkSceneNodeChanged(nodeIndex);
+	}
+
+	m_sceneNodes[nodeIndex] = node;
+	m_sceneNodes[nodeIndex].bDirty = true;
+	return(true);
+}
+
+/***********************************************************
+ *  SetSceneNodeHidden()
+ *
+ *  This method is used for hiding or showing a scene node,
+ *  keeping its index and state.
+ ***********************************************************/
+void SceneManager::SetSceneNodeHidden(int nodeIndex, bool bHidden)
+{
+	if ((nodeIndex >= 0) && (nodeIndex < m_sceneNodes.size()))
+	{
+		m_sceneNodes[nodeIndex].bHidden = bHidden;
+	}
+}
+
+/***********************************************************
+ *  UpdateStreaming()
+ *
+ *  This method is used for loading the streamed objects
+ *  around the passed in camera position and removing the
+ *  ones that the camera has moved away from.
+ ***********************************************************/
+bool SceneManager::UpdateStreaming(const glm::vec3& cameraPosition)
+{
+	if (NULL == m_pStreamer)
+	{
+		return(false);
+	}
+
+	return(m_pStreamer->Update(cameraPosition));
+}
+
+/***********************************************************
+ *  GetMeshHandle()
+ *
+ *  This method is used for getting the handle of the loaded
+ *  mesh for the passed in mesh type.
+ ***********************************************************/
+SceneManager::MESH_HANDLE SceneManager::GetMeshHandle(MESH_TYPE mesh)
+{
+	if ((mesh < 0) || (mesh >= MESH_TYPE_COUNT))
+	{
+		return(HandlePool<MESH_DATA>::InvalidHandle());
+	}
+
+	return(m_meshHandles[mesh]);
+}
+
+/***********************************************************
+ *  GetTextureHandle()
+ *
+ *  This method is used for getting the handle of the loaded
+ *  texture associated with the passed in tag.
+ ***********************************************************/
+SceneManager::TEXTURE_HANDLE SceneManager::GetTextureHandle(std::string tag)
+{
+	int textureSlot = FindTextureSlot(tag);
+	if (textureSlot < 0)
+	{
+		return(HandlePool<TEXTURE_DATA>::InvalidHandle());
+	}
+
+	return(m_textureHandles[textureSlot]);
+}
+
+/***********************************************************
+ *  GetMaterialHandle()
+ *
+ *  This method is used for getting the handle of the defined
+ *  material associated with the passed in tag.
+ ***********************************************************/
+SceneManager::MATERIAL_HANDLE SceneManager::GetMaterialHandle(std::string tag)
+{
+	for (int i = 0; i < m_materialTags.size(); i++)
+	{
+		if (m_materialTags[i].compare(tag) == 0)
+		{
+			return(m_materialHandles[i]);
+		}
+	}
+
+	return(HandlePool<MATERIAL_DATA>::InvalidHandle());
+}
+
+/***********************************************************
+ *  GetMaterialData()
+ *
+ *  This method is used for getting the lighting values of
+ *  the defined material for the passed in handle.
+ ***********************************************************/
+const SceneManager::MATERIAL_DATA* SceneManager::GetMaterialData(MATERIAL_HANDLE material) const
+{
+	return(m_materials.Get(material));
+}
+
+/***********************************************************
+ *  GetTextureSlot()
+ *
+ *  This method is used for getting the texture slot that
+ *  the loaded texture for the passed in handle is bound to.
+ ***********************************************************/
+int SceneManager::GetTextureSlot(TEXTURE_HANDLE texture) const
+{
+	const TEXTURE_DATA* pTexture = m_textures.Get(texture);
+	if (NULL == pTexture)
+	{
+		return(-1);
+	}
+
+	return(pTexture->textureSlot);
+}
+
+/***********************************************************
+ *  GetTextureSlotName()
+ *
+ *  This method is used for getting the OpenGL texture that
+ *  is bound to a texture slot, or 0 when the slot is empty.
+ ***********************************************************/
+GLuint SceneManager::GetTextureSlotName(int textureSlot) const
+{
+	if ((textureSlot < 0) || (textureSlot >= 16))
+	{
+		return(0);
+	}
+
+	return(m_textureIDs[textureSlot]);
+}
+
+/***********************************************************
+ *  DrawSceneMesh()
+ *
+ *  This method is used for drawing a basic mesh without any
+ *  scene node, loading it into the shared meshes first when
+ *  no scene has used it yet.
+ ***********************************************************/
+void SceneManager::DrawSceneMesh(MESH_TYPE mesh)
+{
+	if ((mesh < 0) || (mesh >= MESH_TYPE_COUNT))
+	{
+		return;
+	}
+
+	LoadSceneMesh(mesh);
+	DrawSceneNodeMesh(mesh);
+}
+
+/***********************************************************
+ *  FindSceneNode()
+ *
+ *  This method is used for getting the index of a previously
+ *  added scene node associated with the passed in tag.  The
+ *  removed nodes have no tag, so an empty tag finds nothing.
+ ***********************************************************/
+int SceneManager::FindSceneNode(std::string tag)
+{
+	int nodeIndex = -1;
+	int index = 0;
+	bool bFound = false;
+
+	if (tag.empty() == true)
+	{
+		return(-1);
+	}
+
+	while ((index < m_sceneNodeTags.size()) && (bFound == false))
+	{
+		if (m_sceneNodeTags[index].compare(tag) == 0)
+		{
+			nodeIndex = index;
+			bFound = true;
+		}
+		else
+			index++;
+	}
+
+	return(nodeIndex);
+}
+
+/***********************************************************
+ *  AddNodeAnimation()
+ *
+ *  This method is used for adding a keyframe animation
+ *  track that drives the translation, rotation or scale of
+ *  the scene node associated with the passed in tag.
+ ***********************************************************/
+int SceneManager::AddNodeAnimation(
+	std::string nodeTag,
+	AnimationSystem::ANIMATION_CHANNEL channel,
+	const std::vector<AnimationSystem::KEYFRAME>& keyframes,
+	bool bLooping)
+{
+	int nodeIndex = FindSceneNode(nodeTag);
+	if ((nodeIndex < 0) || (AnimationSystem::IsMaterialChannel(channel) == true))
+	{
+		std::cout << "Could not add animation for scene node:" << nodeTag << std::endl;
+		return(-1);
+	}
+
+	return(m_animations.AddTrack(nodeIndex, channel, keyframes, bLooping));
+}
+
+/***********************************************************
+ *  AddMaterialAnimation()
+ *
+ *  This method is used for adding a keyframe animation
+ *  track that drives one of the lighting parameters of the
+ *  material associated with the passed in tag.
+ ***********************************************************/
+int SceneManager::AddMaterialAnimation(
+	std::string materialTag,
+	AnimationSystem::ANIMATION_CHANNEL channel,
+	const std::vector<AnimationSystem::KEYFRAME>& keyframes,
+	bool bLooping)
+{
+	MATERIAL_HANDLE material = GetMaterialHandle(materialTag);
+
+	if ((m_materials.IsValid(material) == false) || (AnimationSystem::IsMaterialChannel(channel) == false))
+	{
+		std::cout << "Could not add animation for material:" << materialTag << std::endl;
+		return(-1);
+	}
+
+	// material tracks target the material handle
+	return(m_animations.AddTrack((int)material.value, channel, keyframes, bLooping));
+}
+
+/***********************************************************
+ *  UpdateAnimations()
+ *
+ *  This method is used for evaluating all of the active
+ *  animation tracks at the passed in simulation time.  It
+ *  is called once per fixed update step.
+ ***********************************************************/
+void SceneManager::UpdateAnimations(float timeSeconds)
+{
+	// evaluate every active track in one batched pass
+	m_animations.Evaluate(timeSeconds);
+	m_previousAnimationTime = m_animationTime;
+	m_animationTime = timeSeconds;
+}
+
+/***********************************************************
+ *  ApplyAnimations()
+ *
+ *  This method is used for writing the animation results
+ *  back into the scene nodes and materials, blended between
+ *  the last two update steps by the passed in interpolation
+ *  factor.  Only the nodes whose values actually changed
+ *  are marked dirty, so static nodes keep their cached
+ *  model matrices, and a moved node is marked changed so
+ *  that the visible sets no longer hide it.  Returns true
+ *  when anything changed.
+ ***********************************************************/
+bool SceneManager::ApplyAnimations(float interpolation)
+{
+	bool bChanged = false;
+
+	for (int track = 0; track < m_animations.GetTrackCount(); track++)
+	{
+		if (m_animations.IsTrackActive(track) == false)
+		{
+			continue;
+		}
+
+		int target = m_animations.GetTrackTarget(track);
+		AnimationSystem::ANIMATION_CHANNEL channel = m_animations.GetTrackChannel(track);
+		glm::vec3 previous = m_animations.GetTrackPreviousResult(track);
+		glm::vec3 current = m_animations.GetTrackResult(track);
+
+		// a looping rotation wraps from 360 back to 0 degrees,
+		// so blend across the wrap instead of spinning back
+		if (channel == AnimationSystem::CHANNEL_ROTATION)
+		{
+			for (int i = 0; i < 3; i++)
+			{
+				if (current[i] - previous[i] > 180.0f)
+					previous[i] += 360.0f;
+				else if (previous[i] - current[i] > 180.0f)
+					previous[i] -= 360.0f;
+			}
+		}
+
+		glm::vec3 value = previous + (current - previous) * interpolation;
+
+		// material tracks target a material handle, which is
+		// stale once the material has been unloaded
+		MATERIAL_DATA* pMaterial = NULL;
+		if (AnimationSystem::IsMaterialChannel(channel) == true)
+		{
+			MATERIAL_HANDLE material;
+			material.value = (uint32_t)target;
+			pMaterial = m_materials.Get(material);
+			if (NULL == pMaterial)
+			{
+				continue;
+			}
+		}
+
+		switch (channel)
+		{
+		case AnimationSystem::CHANNEL_TRANSLATION:
+			if (m_sceneNodes[target].positionXYZ != value)
+			{
+				m_sceneNodes[target].positionXYZ = value;
+				m_sceneNodes[target].bDirty = true;
+				MarkSceneNodeChanged(target);
+				bChanged = true;
+			}
+			break;
+		case AnimationSystem::CHANNEL_ROTATION:
+			if (m_sceneNodes[target].rotationDegrees != value)
+			{
+				m_sceneNodes[target].rotationDegrees = value;
+				m_sceneNodes[target].bDirty = true;
+				MarkSceneNodeChanged(target);
+				bChanged = true;
+			}
+			break;
+		case AnimationSystem::CHANNEL_SCALE:
+			if (m_sceneNodes[target].scaleXYZ != value)
+			{
+				m_sceneNodes[target].scaleXYZ = value;
+				m_sceneNodes[target].bDirty = true;
+				MarkSceneNodeChanged(target);
+				bChanged = true;
+			}
+			break;
+		case AnimationSystem::CHANNEL_MATERIAL_AMBIENT_STRENGTH:
+			if (pMaterial->ambientStrength != value.x)
+			{
+				pMaterial->ambientStrength = value.x;
+				bChanged = true;
+			}
+			break;
+		case AnimationSystem::CHANNEL_MATERIAL_DIFFUSE_COLOR:
+			if (pMaterial->diffuseColor != value)
+			{
+				pMaterial->diffuseColor = value;
+				bChanged = true;
+			}
+			break;
+		case AnimationSystem::CHANNEL_MATERIAL_SPECULAR_COLOR:
+			if (pMaterial->specularColor != value)
+			{
+				pMaterial->specularColor = value;
+				bChanged = true;
+			}
+			break;
+		case AnimationSystem::CHANNEL_MATERIAL_SHININESS:
+			if (pMaterial->shininess != value.x)
+			{
+				pMaterial->shininess = value.x;
+				bChanged = true;
+			}
+			break;
+		}
+	}
+
+	return(bChanged);
+}
+
+/***********************************************************
+ *  DrawSceneNodeMesh()
+ *
+ *  This method is used for drawing the basic mesh that is
+ *  associated with the passed in mesh type.
+ ***********************************************************/
+void SceneManager::DrawSceneNodeMesh(MESH_TYPE mesh)
+{
+	m_drawCount++;
+	switch (mesh)
+	{
+	case MESH_BOX:
+		m_basicMeshes->DrawBoxMesh();
+		break;
+	case MESH_PLANE:
+		m_basicMeshes->DrawPlaneMesh();
+		break;
+	case MESH_CYLINDER:
+		m_basicMeshes->DrawCylinderMesh();
+		break;
+	case MESH_CONE:
+		m_basicMeshes->DrawConeMesh();
+		break;
+	case MESH_PRISM:
+		m_basicMeshes->DrawPrismMesh();
+		break;
+	case MESH_PYRAMID4:
+		m_basicMeshes->DrawPyramid4Mesh();
+		break;
+	case MESH_SPHERE:
+		m_basicMeshes->DrawSphereMesh();
+		break;
+	case MESH_TAPERED_CYLINDER:
+		m_basicMeshes->DrawTaperedCylinderMesh();
+		break;
+	case MESH_TORUS:
+		m_basicMeshes->DrawTorusMesh();
+		break;
+	default:
+		break;
+	}
+}
+
+/***********************************************************
+ *  RenderScene()
+ *
+ *  This method is used for rendering the 3D scene by 
+ *  transforming and drawing the basic 3D shapes.  Only the
+ *  translucent nodes are blended, the opaque ones simply
+ *  replace what is behind them.
+ ***********************************************************/
+void SceneManager::RenderScene(bool bOpaqueOnly)
+{
+	// the texture units are shared with the other scenes and
+	// the render targets, so bind this scene's textures again
+	BindGLTextures();
+
+	for (int i = NextSceneNode(-1); i < m_sceneNodes.size(); i = NextSceneNode(i))
+	{
+		SCENE_NODE& node = m_sceneNodes[i];
+
+		// skip hidden nodes and nodes that are outside of every view
+		if ((node.bHidden == true) || (IsSceneNodeVisible(node) == false))
+		{
+			continue;
+		}
+
+		if (IsSceneNodeTranslucent(node) == true)
+		{
+			if (bOpaqueOnly == true)
+			{
+				continue;
+			}
+			glEnable(GL_BLEND);
+			DrawSceneNode(node);
+			glDisable(GL_BLEND);
+		}
+		else
+		{
+			DrawSceneNode(node);
+		}
+	}
+}
+
+/***********************************************************
+ *  HasTranslucentNodes()
+ *
+ *  This method is used for checking whether any visible
+ *  node is translucent, so that a transparency pass can be
+ *  skipped when there is nothing for it to draw.
+ ***********************************************************/
+bool SceneManager::HasTranslucentNodes() const
+{
+	for (int i = NextSceneNode(-1); i < m_sceneNodes.size(); i = NextSceneNode(i))
+	{
+		const SCENE_NODE& node = m_sceneNodes[i];
+
+		if ((node.bHidden == false) &&
+			(IsSceneNodeTranslucent(node) == true) &&
+			(IsSceneNodeVisible(node) == true))
+		{
+			return(true);
+		}
+	}
+
+	return(false);
+}
+
+/***********************************************************
+ *  RenderSceneTranslucent()
+ *
+ *  This method is used for drawing the visible translucent
+ *  nodes, in the order they were added.  The blending is
+ *  set up by the caller.
+ ***********************************************************/
+void SceneManager::RenderSceneTranslucent()
+{
+	BindGLTextures();
+
+	for (int i = NextSceneNode(-1); i < m_sceneNodes.size(); i = NextSceneNode(i))
+	{
+		SCENE_NODE& node = m_sceneNodes[i];
+
+		if ((node.bHidden == true) ||
+			(IsSceneNodeTranslucent(node) == false) ||
+			(IsSceneNodeVisible(node) == false))
+		{
+			continue;
+		}
+
+		DrawSceneNode(node);
+	}
+}
+
+/***********************************************************
+ *  RenderSceneNodes()
+ *
+ *  This method is used for drawing only the listed scene
+ *  nodes, whether they are hidden or not and without
+ *  culling, such as for rendering a group of nodes on its
+ *  own into an offscreen target.
+ ***********************************************************/
+void SceneManager::RenderSceneNodes(const std::vector<int>& nodeIndices)
+{
+	BindGLTextures();
+
+	for (int i = 0; i < nodeIndices.size(); i++)
+	{
+		if ((nodeIndices[i] < 0) || (nodeIndices[i] >= m_sceneNodes.size()))
+		{
+			continue;
+		}
+
+		SCENE_NODE& node = m_sceneNodes[nodeIndices[i]];
+		if (IsSceneNodeTranslucent(node) == true)
+		{
+			glEnable(GL_BLEND);
+			DrawSceneNode(node);
+			glDisable(GL_BLEND);
+		}
+		else
+		{
+			DrawSceneNode(node);
+		}
+	}
+}
+
+/***********************************************************
+ *  RenderSceneShapes()
+ *
+ *  This method is used for drawing the visible scene nodes
+ *  with only their transformations, such as for the depth
+ *  of the scene.  Nodes that are not opaque can be left out,
+ *  so they do not hide the nodes seen through them.
+ ***********************************************************/
+void SceneManager::RenderSceneShapes(bool bOpaqueOnly)
+{
+	for (int i = NextSceneNode(-1); i < m_sceneNodes.size(); i = NextSceneNode(i))
+	{
+		SCENE_NODE& node = m_sceneNodes[i];
+
+		if ((node.bHidden == true) || (IsSceneNodeVisible(node) == false))
+		{
+			continue;
+		}
+		if ((bOpaqueOnly == true) && (IsSceneNodeTranslucent(node) == true))
+		{
+			continue;
+		}
+
+		DrawSceneNode(node, false);
+	}
+}
+
+/***********************************************************
+ *  DrawSceneNode()
+ *
+ *  This method is used for setting the transformation,
+ *  color, material and texture of a scene node into the
+ *  shader and drawing its mesh.  Programs that do no
+ *  shading only get the transformation.
+ ***********************************************************/
+void SceneManager::DrawSceneNode(SCENE_NODE& node, bool bShaded)
+{
+	// skip nodes whose mesh is no longer loaded
+	const MESH_DATA* pMesh = m_meshes.Get(node.mesh);
+	if (NULL == pMesh)
+	{
+		return;
+	}
+
+	// only rebuild the model matrix when the node has
+	// changed since it was last drawn
+	if (node.bDirty == true)
+	{
+		node.modelMatrix = BuildModelMatrix(
+			node.scaleXYZ,
+			node.rotationDegrees.x,
+			node.rotationDegrees.y,
+			node.rotationDegrees.z,
+			node.positionXYZ);
+		node.bDirty = false;
+	}
+
+	if (NULL != m_pShaderManager)
+	{
+		m_pShaderManager->setMat4Value(g_ModelName, node.modelMatrix);
+	}
+
+	if (bShaded == true)
+	{
+		SetShaderColor(node.color.r, node.color.g, node.color.b, node.color.a);
+		SetShaderMaterial(node.material);
+		SetShaderTexture(node.texture);
+	}
+	DrawSceneNodeMesh(pMesh->type);
+}
+
+/***********************************************************
+ *  SetCullingViews()
+ *
+ *  This method is used for extracting the frustum planes of
+ *  the views that the next render draws into.  Each plane
+ *  is a sum or difference of the view-projection rows, and
+ *  is normalized so that the distance to a bounding sphere
+ *  center can be compared with its radius.
+ ***********************************************************/
+void SceneManager::SetCullingViews(const glm::mat4* viewProjections, int viewCount)
+{
+	m_cullingViewCount = 0;
+	for (int i = 0; (i < viewCount) && (i < MAX_CULLING_VIEWS); i++)
+	{
+		const glm::mat4& m = viewProjections[i];
+		glm::vec4 row0 = glm::vec4(m[0][0], m[1][0], m[2][0], m[3][0]);
+		glm::vec4 row1 = glm::vec4(m[0][1], m[1][1], m[2][1], m[3][1]);
+		glm::vec4 row2 = glm::vec4(m[0][2], m[1][2], m[2][2], m[3][2]);
+		glm::vec4 row3 = glm::vec4(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+		glm::vec4* pPlanes = m_cullingPlanes[m_cullingViewCount];
+		pPlanes[0] = row3 + row0;	// left
+		pPlanes[1] = row3 - row0;	// right
+		pPlanes[2] = row3 + row1;	// bottom
+		pPlanes[3] = row3 - row1;	// top
+		pPlanes[4] = row3 + row2;	// near
+		pPlanes[5] = row3 - row2;	// far
+
+		for (int j = 0; j < 6; j++)
+		{
+			float length = glm::length(glm::vec3(pPlanes[j]));
+			if (length > 0.0f)
+			{
+				pPlanes[j] /= length;
+			}
+		}
+		m_cullingViewCount++;
+	}
+}
 
-	SetShaderColor(1.0f, 1.0f, 1.0f, 1.0f); // Regular white color
+/***********************************************************
+ *  SetVisibleSet()
+ *
+ *  This method is used for limiting the next renders to the
+ *  nodes whose bits are set in the passed in bitset, one bit
+ *  per node index.  Nodes at or past the passed in count
+ *  were added after the set was made, and are always drawn.
+ ***********************************************************/
+void SceneManager::SetVisibleSet(const uint32_t* pNodeBits, int nodeCount)
+{
+	m_pVisibleSet = pNodeBits;
+	m_visibleSetNodeCount = (NULL != pNodeBits) ? nodeCount : 0;
+}
+
+/***********************************************************
+ *  NextSceneNode()
+ *
+ *  This method is used for stepping to the next node that
+ *  the render loops need to look at.  Without a visible set
+ *  that is simply the next index, otherwise the bitset is
+ *  scanned a word at a time, so the nodes hidden from the
+ *  view cell are skipped without being touched.
+ ***********************************************************/
+int SceneManager::NextSceneNode(int nodeIndex) const
+{
+	int next = nodeIndex + 1;
+
+	if ((NULL == m_pVisibleSet) || (next >= m_visibleSetNodeCount))
+	{
+		return(next);
+	}
+
+	// the nodes changed since the set was made are always looked at
+	int wordCount = (m_visibleSetNodeCount + 31) / 32;
+	int changedWordCount = (int)m_changedNodeBits.size();
+	int word = next / 32;
+	uint32_t bits = m_pVisibleSet[word];
+	if (word < changedWordCount)
+	{
+		bits |= m_changedNodeBits[word];
+	}
+	bits &= (0xFFFFFFFFu << (next % 32));
+
+	while (bits == 0)
+	{
+		word++;
+		if (word >= wordCount)
+		{
+			// the rest of the nodes are newer than the set
+			return(m_visibleSetNodeCount);
+		}
+		bits = m_pVisibleSet[word];
+		if (word < changedWordCount)
+		{
+			bits |= m_changedNodeBits[word];
+		}
+	}
+
+	int bit = 0;
+	while ((bits & 1u) == 0)
+	{
+		bits >>= 1;
+		bit++;
+	}
+
+	// a changed node past the set is newer than it anyway
+	return(std::min(word * 32 + bit, m_visibleSetNodeCount));
+}
+
+/***********************************************************
+ *  MarkSceneNodeChanged()
+ *
+ *  This method is used for recording that a node no longer
+ *  matches the visible sets, because it was moved or its
+ *  index was reused, so that it is drawn from any view cell.
+ ***********************************************************/
+void SceneManager::MarkSceneNodeChanged(int nodeIndex)
+{
+	int word = nodeIndex / 32;
 
-	SetShaderMaterial("polishClay");
-	SetShaderTexture("ceramic");
-	m_basicMeshes->DrawTorusMesh(); // Draw handle
+	if (word >= m_changedNodeBits.size())
+	{
+		m_changedNodeBits.resize(word + 1, 0);
+	}
+	m_changedNodeBits[word] |= (1u << (nodeIndex % 32));
 }
 
+/***********************************************************
+ *  IsSceneNodeVisible()
+ *
+ *  This method is used for checking whether the bounding
+ *  sphere of a scene node is inside any of the culling
+ *  views.  When several views are drawn in one pass, a node
+ *  has to be drawn if any one of them can see it.
+ ***********************************************************/
+bool SceneManager::IsSceneNodeVisible(const SCENE_NODE& node) const
+{
+	if (m_cullingViewCount == 0)
+	{
+		return(true);
+	}
+
+	float radius = GetSceneNodeRadius(node);
+
+	for (int i = 0; i < m_cullingViewCount; i++)
+	{
+		bool bInside = true;
+		for (int j = 0; (j < 6) && (bInside == true); j++)
+		{
+			const glm::vec4& plane = m_cullingPlanes[i][j];
+			float distance = glm::dot(glm::vec3(plane), node.positionXYZ) + plane.w;
+			if (distance < -radius)
+			{
+				bInside = false;
+			}
+		}
+
+		if (bInside == true)
+		{
+			return(true);
+		}
+	}
+
+	return(false);
+}
+
+/***********************************************************
+ *  GetSceneNodeRadius()
+ *
+ *  This method is used for getting the radius of a sphere
+ *  around the node position that contains the node's mesh
+ *  at any rotation.
+ ***********************************************************/
+float SceneManager::GetSceneNodeRadius(const SCENE_NODE& node) const
+{
+	return(g_NodeBoundsRadius * glm::max(
+		glm::abs(node.scaleXYZ.x),
+		glm::max(glm::abs(node.scaleXYZ.y), glm::abs(node.scaleXYZ.z))));
+}
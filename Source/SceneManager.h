@@ -11,6 +11,15 @@
 
 #include "ShaderManager.h"
 #include "ShapeMeshes.h"
+#include "AnimationSystem.h"
+#include "ResourceManager.h"
+#include "HandlePool.h"
+#include "LoadTask.h"
+
+class ResourceCache;
+class LoadScheduler;
+class SceneStreamer;
+class ImpostorSystem;
 
 #include <string>
 #include <vector>
@@ -25,42 +34,164 @@ class SceneManager
 {
 public:
 	// constructor
-	SceneManager(ShaderManager *pShaderManager);
+	SceneManager(
+		ShaderManager *pShaderManager,
+		ResourceCache *pResourceCache);
 	// destructor
 	~SceneManager();
 
-	struct TEXTURE_INFO
+	// material definition, used when the scene is prepared
+	struct OBJECT_MATERIAL
 	{
+		float ambientStrength;
+		glm::vec3 ambientColor;
+		glm::vec3 diffuseColor;
+		glm::vec3 specularColor;
+		float shininess;
 		std::string tag;
-		uint32_t ID;
 	};
 
-	struct OBJECT_MATERIAL
+	// material lighting values as they are stored for rendering,
+	// packed to match the std140 layout of a uniform block
+	struct MATERIAL_DATA
 	{
+		glm::vec3 ambientColor;
 		float ambientStrength;
+		glm::vec3 diffuseColor;
+		float shininess;
+		glm::vec3 specularColor;
+		float padding;
+	};
+
+	// the basic shape meshes that a scene node can draw
+	enum MESH_TYPE
+	{
+		MESH_BOX,
+		MESH_PLANE,
+		MESH_CYLINDER,
+		MESH_CONE,
+		MESH_PRISM,
+		MESH_PYRAMID4,
+		MESH_SPHERE,
+		MESH_TAPERED_CYLINDER,
+		MESH_TORUS,
+		MESH_TYPE_COUNT
+	};
+
+	// loaded mesh as it is stored for rendering
+	struct MESH_DATA
+	{
+		MESH_TYPE type;
+	};
+
+	// loaded texture as it is stored for rendering
+	struct TEXTURE_DATA
+	{
+		GLuint textureID;
+		int textureSlot;
+	};
+
+	// light source values as they are set into the shaders
+	struct LIGHT_SOURCE
+	{
+		glm::vec3 position;
 		glm::vec3 ambientColor;
 		glm::vec3 diffuseColor;
 		glm::vec3 specularColor;
-		float shininess;
-		std::string tag;
+		float focalStrength;
+		float specularIntensity;
+	};
+	// number of light sources that the shaders have
+	static const int MAX_LIGHT_SOURCES = 4;
+
+	// generational handles to the loaded scene resources
+	typedef HandlePool<MESH_DATA>::HANDLE MESH_HANDLE;
+	typedef HandlePool<TEXTURE_DATA>::HANDLE TEXTURE_HANDLE;
+	typedef HandlePool<MATERIAL_DATA>::HANDLE MATERIAL_HANDLE;
+
+	struct SCENE_NODE
+	{
+		MESH_HANDLE mesh;
+		glm::vec3 scaleXYZ;
+		glm::vec3 rotationDegrees;
+		glm::vec3 positionXYZ;
+		glm::vec4 color;
+		MATERIAL_HANDLE material;
+		TEXTURE_HANDLE texture;
+		// cached model matrix, rebuilt only when the node is dirty
+		glm::mat4 modelMatrix;
+		bool bDirty;
+		// hidden nodes are skipped by RenderScene
+		bool bHidden;
 	};
 
 private:
 	// pointer to shader manager object
 	ShaderManager* m_pShaderManager;
-	// pointer to basic shapes object
+	// pointer to the cache of resources shared between scenes
+	ResourceCache* m_pResourceCache;
+	// pointer to basic shapes object, shared through the cache
 	ShapeMeshes* m_basicMeshes;
 	// total number of loaded textures
 	int m_loadedTextures;
-	// loaded textures info
-	TEXTURE_INFO m_textureIDs[16];
-	// defined object materials
-	std::vector<OBJECT_MATERIAL> m_objectMaterials;
+	// loaded OpenGL texture IDs, indexed by texture slot
+	GLuint m_textureIDs[16];
+	// references that keep the loaded textures alive
+	ResourceRef m_textureRefs[16];
+	// number of users of each texture slot, a slot is free to
+	// be reused once its count drops to zero
+	int m_textureUseCounts[16];
+	// tags and handles of the loaded textures, only used for
+	// lookups while the scene is prepared
+	std::string m_textureTags[16];
+	TEXTURE_HANDLE m_textureHandles[16];
+	// pools of the loaded meshes, textures and defined materials
+	HandlePool<MESH_DATA> m_meshes;
+	HandlePool<TEXTURE_DATA> m_textures;
+	HandlePool<MATERIAL_DATA> m_materials;
+	// handles of the loaded meshes, indexed by mesh type
+	MESH_HANDLE m_meshHandles[MESH_TYPE_COUNT];
+	// tags and handles of the defined materials, only used for
+	// lookups while the scene is prepared
+	std::vector<std::string> m_materialTags;
+	std::vector<MATERIAL_HANDLE> m_materialHandles;
+	// defined scene nodes, drawn in order
+	std::vector<SCENE_NODE> m_sceneNodes;
+	// tags of the defined scene nodes
+	std::vector<std::string> m_sceneNodeTags;
+	// indices of removed scene nodes that can be reused
+	std::vector<int> m_freeSceneNodes;
+	// streamer that adds and removes objects around the camera
+	SceneStreamer* m_pStreamer;
+	// keyframe animation tracks for the scene nodes and materials,
+	// and the times of the last two steps they were evaluated at
+	AnimationSystem m_animations;
+	float m_animationTime;
+	float m_previousAnimationTime;
+	// the light sources, set into each program that lights the scene
+	LIGHT_SOURCE m_lightSources[MAX_LIGHT_SOURCES];
+	// number of meshes drawn since the count was reset
+	int m_drawCount;
+	// frustum planes of the views that the next render draws into,
+	// a node is drawn when it is inside any of them
+	static const int MAX_CULLING_VIEWS = 4;
+	glm::vec4 m_cullingPlanes[MAX_CULLING_VIEWS][6];
+	int m_cullingViewCount;
+	// bitset of the nodes that can be seen from the current view
+	// cell, NULL when every node is looked at
+	const uint32_t* m_pVisibleSet;
+	int m_visibleSetNodeCount;
+	// bitset of the nodes that were moved or whose index was
+	// reused after the visible sets were made, which are drawn
+	// whatever the sets say
+	std::vector<uint32_t> m_changedNodeBits;
+	// while set, the image files that LoadSceneTextures() asks
+	// for are only collected here, so that they can be read and
+	// decoded ahead of it
+	std::vector<std::string>* m_pCollectedTextureFiles;
 
 	// load texture images and convert to OpenGL texture data
 	bool CreateGLTexture(const char* filename, std::string tag);
-	// bind loaded OpenGL textures to slots in memory
-	void BindGLTextures();
 	// free the loaded OpenGL textures
 	void DestroyGLTextures();
 	// find a loaded texture by tag
@@ -69,6 +200,14 @@ private:
 	// find a defined material by tag
 	bool FindMaterial(std::string tag, OBJECT_MATERIAL& material);
 
+	// build the model matrix from the transformation values
+	glm::mat4 BuildModelMatrix(
+		glm::vec3 scaleXYZ,
+		float XrotationDegrees,
+		float YrotationDegrees,
+		float ZrotationDegrees,
+		glm::vec3 positionXYZ);
+
 	// set the transformation values 
 	// into the transform buffer
 	void SetTransformations(
@@ -88,6 +227,8 @@ private:
 	// set the texture data into the shader
 	void SetShaderTexture(
 		std::string textureTag);
+	void SetShaderTexture(
+		TEXTURE_HANDLE texture);
 
 	// set the UV scale for the texture mapping
 	void SetTextureUVScale(
@@ -96,20 +237,190 @@ private:
 	// set the object material into the shader
 	void SetShaderMaterial(
 		std::string materialTag);
+	void SetShaderMaterial(
+		MATERIAL_HANDLE material);
+
+	// add a node that draws a basic mesh in the scene
+	int AddSceneNode(
+		std::string tag,
+		MESH_TYPE mesh,
+		glm::vec3 scaleXYZ,
+		float XrotationDegrees,
+		float YrotationDegrees,
+		float ZrotationDegrees,
+		glm::vec3 positionXYZ,
+		glm::vec4 color,
+		std::string materialTag,
+		std::string textureTag);
+	// load a basic mesh unless another scene already did
+	void LoadSceneMesh(MESH_TYPE mesh);
+	// draw the basic mesh for a scene node
+	void DrawSceneNodeMesh(MESH_TYPE mesh);
+	// get the index of the next node for the render loops to look
+	// at, skipping the nodes outside of the visible set
+	int NextSceneNode(int nodeIndex) const;
+	// record that a node no longer matches the visible sets
+	void MarkSceneNodeChanged(int nodeIndex);
+	// check whether a scene node is inside any culling view
+	bool IsSceneNodeVisible(const SCENE_NODE& node) const;
+	// check whether a scene node lets the nodes behind it show
+	bool IsSceneNodeTranslucent(const SCENE_NODE& node) const { return(node.color.a < 1.0f); }
+	// set a node's transformation, color, material and texture
+	// into the shader and draw its mesh - without shading, only
+	// the transformation is set
+	void DrawSceneNode(SCENE_NODE& node, bool bShaded = true);
 
 public:
 
 	// The following methods are for the students to 
-	// customize for their own 3D scene
+	// customize for their own 3D scene - the preparation runs
+	// its stages as a graph of dependent tasks
 	void PrepareScene();
-	void RenderScene();
+	// draw the visible nodes - the translucent ones are blended
+	// in the order they were added, unless they are left out
+	// for a separate transparency pass
+	void RenderScene(bool bOpaqueOnly = false);
+	// set the view-projections that the next render draws into,
+	// a count of zero disables culling
+	void SetCullingViews(const glm::mat4* viewProjections, int viewCount);
+	// set the bitset of the nodes that can be seen from the view
+	// cell of the next render, NULL draws every node
+	void SetVisibleSet(const uint32_t* pNodeBits, int nodeCount);
+	// release everything loaded by PrepareScene
+	void UnloadScene();
+
+	// the loading steps as coroutines, which switch to a worker
+	// thread to read and decode files and to the context thread
+	// for OpenGL - they can be awaited from other coroutines, or
+	// started and polled from the render loop
+	// get the texture for an image file into the cache
+	LoadTask<bool> CacheTextureAsync(LoadScheduler* pScheduler, std::string filename);
+	// load a texture and place it into a slot with the tag
+	LoadTask<bool> LoadTextureAsync(LoadScheduler* pScheduler, std::string filename, std::string tag);
+	// load a basic mesh into the shared meshes
+	LoadTask<bool> LoadMeshAsync(LoadScheduler* pScheduler, MESH_TYPE mesh);
+	// prepare the whole scene, like PrepareScene()
+	LoadTask<bool> PrepareSceneAsync(LoadScheduler* pScheduler);
+
+	// place a texture into a free texture slot, sharing the slot
+	// when a texture with the same tag is already placed
+	TEXTURE_HANDLE AddSceneTexture(const ResourceRef& texture, std::string tag);
+	// release one use of a texture slot
+	void RemoveSceneTexture(TEXTURE_HANDLE texture);
+	// add a node that draws a loaded mesh in the scene
+	int AddSceneNode(
+		std::string tag,
+		MESH_HANDLE mesh,
+		glm::vec3 scaleXYZ,
+		float XrotationDegrees,
+		float YrotationDegrees,
+		float ZrotationDegrees,
+		glm::vec3 positionXYZ,
+		glm::vec4 color,
+		MATERIAL_HANDLE material,
+		TEXTURE_HANDLE texture);
+	// remove a scene node and its animation tracks, its index may
+	// be reused by a new node
+	void RemoveSceneNode(int nodeIndex);
+	// get and replace the state of a scene node by tag, used
+	// for temporary changes that are undone after rendering
+	bool GetSceneNode(std::string tag, SCENE_NODE& node);
+	bool SetSceneNode(std::string tag, const SCENE_NODE& node);
+	// get the state of a scene node by index, and the number of
+	// node indices in use
+	bool GetSceneNode(int nodeIndex, SCENE_NODE& node);
+	int GetSceneNodeCount() const { return((int)m_sceneNodes.size()); }
+	// find a defined scene node by tag
+	int FindSceneNode(std::string tag);
+	// hide or show a scene node without removing it
+	void SetSceneNodeHidden(int nodeIndex, bool bHidden);
+	// get the radius of a sphere that contains a scene node
+	float GetSceneNodeRadius(const SCENE_NODE& node) const;
+	// draw only the listed scene nodes, hidden or not, without
+	// culling - used to render parts of the scene on their own
+	void RenderSceneNodes(const std::vector<int>& nodeIndices);
+	// draw the visible nodes with only their transformations set,
+	// for passes whose programs do no shading - optionally only
+	// the nodes whose color is opaque
+	void RenderSceneShapes(bool bOpaqueOnly);
+	// check whether any translucent node is inside the culling views
+	bool HasTranslucentNodes() const;
+	// draw only the visible translucent nodes, in any order, for
+	// a program that blends them without sorting
+	void RenderSceneTranslucent();
+
+	// get the streamer for the objects loaded around the camera
+	SceneStreamer* GetStreamer() { return(m_pStreamer); }
+	// load and unload the streamed objects around the camera,
+	// returns true when the scene nodes have changed
+	bool UpdateStreaming(const glm::vec3& cameraPosition);
+
+	// get the handles of the loaded resources, for use on the
+	// paths that run every frame instead of the tags
+	MESH_HANDLE GetMeshHandle(MESH_TYPE mesh);
+	TEXTURE_HANDLE GetTextureHandle(std::string tag);
+	MATERIAL_HANDLE GetMaterialHandle(std::string tag);
+	// get the values behind the handles, for passes that keep
+	// their own copies on the GPU - returns NULL or -1 when stale
+	const MATERIAL_DATA* GetMaterialData(MATERIAL_HANDLE material) const;
+	int GetTextureSlot(TEXTURE_HANDLE texture) const;
+	// get the OpenGL texture bound to a texture slot, for passes
+	// that look up what the slot holds
+	GLuint GetTextureSlotName(int textureSlot) const;
+	// add a material definition to the material data
+	void AddObjectMaterial(const OBJECT_MATERIAL& material);
+	// bind loaded OpenGL textures to slots in memory
+	void BindGLTextures();
+	// draw a basic mesh on its own, loading it first when needed -
+	// used for capturing the vertices of the shared meshes
+	void DrawSceneMesh(MESH_TYPE mesh);
 
 	// loads textures from image files
 	void LoadSceneTextures();
 
-	// pre-set light sources for 3D scene
+	// pre-define the light sources for 3D scene
+	void DefineSceneLights();
+	// set the light sources into the current program
 	void SetupSceneLights();
+	// replace a light source, which is set into the programs the
+	// next time SetupSceneLights() is called - returns false for
+	// an index out of range
+	bool SetSceneLight(int lightIndex, const LIGHT_SOURCE& light);
+	// get a light source - returns false for an index out of range
+	bool GetSceneLight(int lightIndex, LIGHT_SOURCE& light) const;
+
+	// get the number of meshes drawn since the count was reset,
+	// each is one draw call, or a few for the meshes with caps
+	int GetDrawCount() const { return(m_drawCount); }
+	void ResetDrawCount() { m_drawCount = 0; }
 	// pre-define the object materials for lighting
 	void DefineObjectMaterials();
+	// pre-define the scene nodes that are drawn
+	void DefineSceneNodes();
+	// pre-define the keyframe animations for the scene
+	void DefineSceneAnimations();
+	// pre-define the props that are drawn as impostors when distant
+	void DefineSceneImpostors(ImpostorSystem* pImpostors);
+	// pre-define the objects that are only loaded near the camera
+	void DefineStreamedObjects();
+
+	// add keyframe animation tracks for a node or material
+	int AddNodeAnimation(
+		std::string nodeTag,
+		AnimationSystem::ANIMATION_CHANNEL channel,
+		const std::vector<AnimationSystem::KEYFRAME>& keyframes,
+		bool bLooping);
+	int AddMaterialAnimation(
+		std::string materialTag,
+		AnimationSystem::ANIMATION_CHANNEL channel,
+		const std::vector<AnimationSystem::KEYFRAME>& keyframes,
+		bool bLooping);
+	// evaluate the animations at the passed in simulation time
+	void UpdateAnimations(float timeSeconds);
+	// get the times of the last two animation steps
+	float GetAnimationTime() const { return(m_animationTime); }
+	float GetPreviousAnimationTime() const { return(m_previousAnimationTime); }
+	// blend the last two animation steps into the scene nodes
+	bool ApplyAnimations(float interpolation);
 
 };
\ No newline at end of file
@@ -0,0 +1,475 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenestreamer.cpp
+// ============
+// load and unload the parts of a large 3D scene around the camera
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneStreamer.h"
+#include "LoadScheduler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// width and depth of one cell, in scene units
+	const float g_CellSize = 16.0f;
+	// cells closer to the camera than this are loaded
+	const float g_LoadDistance = 24.0f;
+	// loaded cells further from the camera than this are removed,
+	// the gap to the load distance keeps cells from flickering
+	const float g_UnloadDistance = 32.0f;
+	// default texture memory budget, in bytes
+	const size_t g_DefaultMemoryBudget = 256 * 1024 * 1024;
+	// decoded textures uploaded per update, to bound the stall
+	const int g_MaxUploadsPerUpdate = 2;
+	// cells that start loading per update
+	const int g_MaxCellLoadsPerUpdate = 1;
+
+	// get the cell coordinate that contains a position
+	int CellCoordinate(float position)
+	{
+		return((int)std::floor(position / g_CellSize));
+	}
+
+	// combine the two cell coordinates into one key
+	long long CellKey(int x, int z)
+	{
+		return(((long long)x << 32) ^ (unsigned int)z);
+	}
+}
+
+/***********************************************************
+ *  SceneStreamer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneStreamer::SceneStreamer(SceneManager* pSceneManager, ResourceCache* pResourceCache)
+{
+	m_pSceneManager = pSceneManager;
+	m_pResourceCache = pResourceCache;
+	m_pLoadScheduler = NULL;
+	m_memoryBudget = g_DefaultMemoryBudget;
+	m_streamedBytes = 0;
+}
+
+/***********************************************************
+ *  ~SceneStreamer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+SceneStreamer::~SceneStreamer()
+{
+	Clear();
+	m_pSceneManager = NULL;
+	m_pResourceCache = NULL;
+	m_pLoadScheduler = NULL;
+}
+
+/***********************************************************
+ *  AddObject()
+ *
+ *  This method is used for adding a streamed object to the
+ *  cell that contains its position.  The object is only
+ *  added to the scene while its cell is loaded.
+ ***********************************************************/
+void SceneStreamer::AddObject(const STREAMED_OBJECT& object)
+{
+	int x = CellCoordinate(object.positionXYZ.x);
+	int z = CellCoordinate(object.positionXYZ.z);
+	long long key = CellKey(x, z);
+
+	std::map<long long, int>::iterator found = m_cellIndices.find(key);
+	if (found == m_cellIndices.end())
+	{
+		CELL cell;
+		cell.x = x;
+		cell.z = z;
+		cell.state = CELL_UNLOADED;
+		cell.distance = 0.0f;
+		m_cells.push_back(cell);
+		found = m_cellIndices.insert(std::make_pair(key, (int)m_cells.size() - 1)).first;
+	}
+
+	m_cells[found->second].objects.push_back(object);
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing the objects of every
+ *  loaded cell from the scene and forgetting all cells.
+ ***********************************************************/
+void SceneStreamer::Clear()
+{
+	FinishTextureLoads();
+	for (int i = 0; i < m_cells.size(); i++)
+	{
+		UnloadCell(m_cells[i]);
+	}
+	m_cells.clear();
+	m_cellIndices.clear();
+}
+
+/***********************************************************
+ *  FinishTextureLoads()
+ *
+ *  This method is used for running the texture loading
+ *  coroutines that are still in flight to their end, and
+ *  forgetting all of them.
+ ***********************************************************/
+void SceneStreamer::FinishTextureLoads()
+{
+	std::map<std::string, LoadTask<bool>>::iterator load = m_textureLoads.begin();
+	for (; load != m_textureLoads.end(); load++)
+	{
+		if (load->second.IsDone() == false)
+		{
+			m_pLoadScheduler->RunUntilDone(load->second);
+		}
+	}
+	m_textureLoads.clear();
+}
+
+/***********************************************************
+ *  GetLoadedCellCount()
+ *
+ *  This method is used for getting the number of cells whose
+ *  objects are in the scene.
+ ***********************************************************/
+int SceneStreamer::GetLoadedCellCount() const
+{
+	int loadedCount = 0;
+	for (int i = 0; i < m_cells.size(); i++)
+	{
+		if (m_cells[i].state == CELL_LOADED)
+		{
+			loadedCount++;
+		}
+	}
+
+	return(loadedCount);
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for loading the cells around the
+ *  camera and removing the cells it has moved away from.
+ *  Returns true when objects were added to or removed from
+ *  the scene.
+ ***********************************************************/
+bool SceneStreamer::Update(const glm::vec3& cameraPosition)
+{
+	bool bSceneChanged = false;
+	bool bUnloaded = false;
+	std::vector<int> candidates;
+
+	if ((NULL == m_pSceneManager) || (NULL == m_pResourceCache) || (m_cells.size() == 0))
+	{
+		return(false);
+	}
+
+	// create the textures that the loader thread has decoded
+	m_pResourceCache->UploadLoadedTextures(g_MaxUploadsPerUpdate);
+
+	// drop the coroutines whose textures are in the cache
+	std::map<std::string, LoadTask<bool>>::iterator load = m_textureLoads.begin();
+	while (load != m_textureLoads.end())
+	{
+		if ((load->second.IsDone() == true) && (load->second.GetResult() == true))
+		{
+			load = m_textureLoads.erase(load);
+		}
+		else
+		{
+			load++;
+		}
+	}
+
+	for (int i = 0; i < m_cells.size(); i++)
+	{
+		CELL& cell = m_cells[i];
+		cell.distance = GetCellDistance(cell, cameraPosition);
+
+		if ((cell.state != CELL_UNLOADED) && (cell.distance > g_UnloadDistance))
+		{
+			if (cell.state == CELL_LOADED)
+			{
+				bSceneChanged = true;
+			}
+			UnloadCell(cell);
+			bUnloaded = true;
+		}
+		else if (cell.state == CELL_LOADING)
+		{
+			if (IsCellReady(cell) == true)
+			{
+				InstantiateCell(cell);
+				bSceneChanged = true;
+			}
+		}
+		else if ((cell.state == CELL_UNLOADED) && (cell.distance <= g_LoadDistance))
+		{
+			candidates.push_back(i);
+		}
+	}
+
+	// while the streamed textures are over budget, make room by
+	// removing a cell in the margin instead of starting new cells
+	if (m_streamedBytes > m_memoryBudget)
+	{
+		if (EvictFurthestCell() == true)
+		{
+			bSceneChanged = true;
+			bUnloaded = true;
+		}
+		candidates.clear();
+	}
+
+	// start the nearest cells first
+	std::sort(candidates.begin(), candidates.end(),
+		[this](int a, int b) { return(m_cells[a].distance < m_cells[b].distance); });
+	for (int i = 0; (i < candidates.size()) && (i < g_MaxCellLoadsPerUpdate); i++)
+	{
+		CELL& cell = m_cells[candidates[i]];
+		cell.state = CELL_LOADING;
+		for (int j = 0; j < cell.objects.size(); j++)
+		{
+			if (cell.objects[j].textureFile.size() > 0)
+			{
+				StartTextureLoad(cell.objects[j].textureFile);
+			}
+		}
+	}
+
+	// drop the textures that no loaded cell refers to anymore
+	if (bUnloaded == true)
+	{
+		m_pResourceCache->ReleaseUnusedTextures();
+	}
+
+	return(bSceneChanged);
+}
+
+/***********************************************************
+ *  GetCellDistance()
+ *
+ *  This method is used for getting the distance on the
+ *  ground plane from a position to the nearest point of a
+ *  cell, zero when the position is inside the cell.
+ ***********************************************************/
+float SceneStreamer::GetCellDistance(const CELL& cell, const glm::vec3& position) const
+{
+	float minX = cell.x * g_CellSize;
+	float minZ = cell.z * g_CellSize;
+	float dx = std::max(std::max(minX - position.x, position.x - (minX + g_CellSize)), 0.0f);
+	float dz = std::max(std::max(minZ - position.z, position.z - (minZ + g_CellSize)), 0.0f);
+
+	return(std::sqrt(dx * dx + dz * dz));
+}
+
+/***********************************************************
+ *  StartTextureLoad()
+ *
+ *  This method is used for starting to load the texture for
+ *  an image file.  With a load scheduler, a coroutine reads
+ *  and decodes the file and adds the texture to the cache,
+ *  otherwise the file is requested from the loader thread.
+ *  A file that is already being loaded is not started again.
+ ***********************************************************/
+void SceneStreamer::StartTextureLoad(const std::string& textureFile)
+{
+	if (NULL == m_pLoadScheduler)
+	{
+		m_pResourceCache->RequestTexture(textureFile.c_str());
+		return;
+	}
+
+	if (m_textureLoads.find(textureFile) != m_textureLoads.end())
+	{
+		return;
+	}
+
+	// the coroutine runs until it first suspends, and is then
+	// carried on by the workers and the render loop
+	LoadTask<bool>& load = m_textureLoads[textureFile];
+	load = m_pSceneManager->CacheTextureAsync(m_pLoadScheduler, textureFile);
+	load.Start();
+}
+
+/***********************************************************
+ *  IsCellReady()
+ *
+ *  This method is used for checking whether the textures of
+ *  a loading cell have all been uploaded, or have failed.
+ *  Textures that were released while the cell was loading
+ *  are requested again.
+ ***********************************************************/
+bool SceneStreamer::IsCellReady(const CELL& cell)
+{
+	bool bReady = true;
+
+	for (int i = 0; i < cell.objects.size(); i++)
+	{
+		const char* textureFile = cell.objects[i].textureFile.c_str();
+		if (cell.objects[i].textureFile.size() == 0)
+		{
+			continue;
+		}
+
+		// a texture with a coroutine is ready once it has finished,
+		// whether it was loaded or not
+		std::map<std::string, LoadTask<bool>>::iterator load = m_textureLoads.find(cell.objects[i].textureFile);
+		if (load != m_textureLoads.end())
+		{
+			if (load->second.IsDone() == false)
+			{
+				bReady = false;
+			}
+			continue;
+		}
+
+		ResourceCache::TEXTURE_STATE state = m_pResourceCache->GetTextureState(textureFile);
+		if (state == ResourceCache::TEXTURE_NOT_LOADED)
+		{
+			StartTextureLoad(cell.objects[i].textureFile);
+			bReady = false;
+		}
+		else if (state == ResourceCache::TEXTURE_LOADING)
+		{
+			bReady = false;
+		}
+	}
+
+	return(bReady);
+}
+
+/***********************************************************
+ *  InstantiateCell()
+ *
+ *  This method is used for adding the objects of a cell to
+ *  the scene, once all of its textures are uploaded.  When
+ *  every texture slot of the scene is taken, the object is
+ *  added without its texture.
+ ***********************************************************/
+void SceneStreamer::InstantiateCell(CELL& cell)
+{
+	ResourceManager* pResourceManager = m_pResourceCache->GetResourceManager();
+
+	for (int i = 0; i < cell.objects.size(); i++)
+	{
+		const STREAMED_OBJECT& object = cell.objects[i];
+		SceneManager::TEXTURE_HANDLE texture = HandlePool<SceneManager::TEXTURE_DATA>::InvalidHandle();
+
+		if ((object.textureFile.size() > 0) &&
+			(m_pResourceCache->GetTextureState(object.textureFile.c_str()) == ResourceCache::TEXTURE_LOADED))
+		{
+			ResourceRef textureRef = m_pResourceCache->AcquireTexture(object.textureFile.c_str());
+			texture = m_pSceneManager->AddSceneTexture(textureRef, object.textureFile);
+			if (texture == HandlePool<SceneManager::TEXTURE_DATA>::InvalidHandle())
+			{
+				std::cout << "Could not place streamed texture:" << object.textureFile <<
+					", drawing " << object.tag << " without a texture" << std::endl;
+			}
+			else
+			{
+				cell.textures.push_back(texture);
+				cell.textureFiles.push_back(object.textureFile);
+
+				// a texture shared by several cells is counted once
+				if (m_textureUseCounts[object.textureFile]++ == 0)
+				{
+					size_t bytes = 0;
+					if (NULL != pResourceManager)
+					{
+						bytes = pResourceManager->GetBytes(textureRef.GetHandle());
+					}
+					m_textureBytes[object.textureFile] = bytes;
+					m_streamedBytes += bytes;
+				}
+			}
+		}
+
+		cell.nodes.push_back(m_pSceneManager->AddSceneNode(
+			object.tag,
+			m_pSceneManager->GetMeshHandle(object.mesh),
+			object.scaleXYZ,
+			object.rotationDegrees.x,
+			object.rotationDegrees.y,
+			object.rotationDegrees.z,
+			object.positionXYZ,
+			object.color,
+			m_pSceneManager->GetMaterialHandle(object.materialTag),
+			texture));
+	}
+
+	cell.state = CELL_LOADED;
+}
+
+/***********************************************************
+ *  UnloadCell()
+ *
+ *  This method is used for removing the objects of a cell
+ *  from the scene and releasing its textures.
+ ***********************************************************/
+void SceneStreamer::UnloadCell(CELL& cell)
+{
+	if (NULL != m_pSceneManager)
+	{
+		for (int i = 0; i < cell.nodes.size(); i++)
+		{
+			m_pSceneManager->RemoveSceneNode(cell.nodes[i]);
+		}
+		for (int i = 0; i < cell.textures.size(); i++)
+		{
+			m_pSceneManager->RemoveSceneTexture(cell.textures[i]);
+		}
+	}
+	for (int i = 0; i < cell.textureFiles.size(); i++)
+	{
+		if (--m_textureUseCounts[cell.textureFiles[i]] == 0)
+		{
+			m_streamedBytes -= m_textureBytes[cell.textureFiles[i]];
+			m_textureUseCounts.erase(cell.textureFiles[i]);
+			m_textureBytes.erase(cell.textureFiles[i]);
+		}
+	}
+	cell.nodes.clear();
+	cell.textures.clear();
+	cell.textureFiles.clear();
+	cell.state = CELL_UNLOADED;
+}
+
+/***********************************************************
+ *  EvictFurthestCell()
+ *
+ *  This method is used for removing the loaded cell that is
+ *  furthest from the camera, as long as it is outside of
+ *  the load distance.  Returns false when there is none.
+ ***********************************************************/
+bool SceneStreamer::EvictFurthestCell()
+{
+	int furthestCell = -1;
+
+	for (int i = 0; i < m_cells.size(); i++)
+	{
+		if ((m_cells[i].state != CELL_UNLOADED) &&
+			(m_cells[i].distance > g_LoadDistance) &&
+			((furthestCell < 0) || (m_cells[i].distance > m_cells[furthestCell].distance)))
+		{
+			furthestCell = i;
+		}
+	}
+
+	if (furthestCell < 0)
+	{
+		return(false);
+	}
+
+	UnloadCell(m_cells[furthestCell]);
+	return(true);
+}
@@ -0,0 +1,137 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenestreamer.h
+// ============
+// load and unload the parts of a large 3D scene around the camera
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneManager.h"
+#include "ResourceCache.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  SceneStreamer
+ *
+ *  This class splits the streamed objects of a scene into
+ *  square cells on the ground plane.  Cells near the camera
+ *  have their textures decoded on the loader thread and are
+ *  added to the scene once the textures are uploaded.  Cells
+ *  are removed again when the camera moves further away than
+ *  the load distance plus a margin, so that moving back and
+ *  forth along a cell border does not reload it each time.
+ *  New cells are not started while the textures held by the
+ *  loaded cells are over the memory budget, and the furthest
+ *  cells in the margin are removed first to make room.  The
+ *  budget only counts the textures that the streamer placed,
+ *  not the other textures owned by the resource manager.
+ *  When a load scheduler is set, each texture is loaded by a
+ *  coroutine instead, which the render loop carries on, and
+ *  the streamer polls the coroutines on each update.
+ ***********************************************************/
+class SceneStreamer
+{
+public:
+	// constructor
+	SceneStreamer(SceneManager* pSceneManager, ResourceCache* pResourceCache);
+	// destructor
+	~SceneStreamer();
+
+	// an object that is only in the scene while its cell is loaded
+	struct STREAMED_OBJECT
+	{
+		std::string tag;
+		SceneManager::MESH_TYPE mesh;
+		glm::vec3 scaleXYZ;
+		glm::vec3 rotationDegrees;
+		glm::vec3 positionXYZ;
+		glm::vec4 color;
+		std::string materialTag;
+		// image file of the texture, empty for no texture
+		std::string textureFile;
+	};
+
+	// add an object to the cell that contains its position
+	void AddObject(const STREAMED_OBJECT& object);
+	// remove every cell and its objects from the scene
+	void Clear();
+
+	// set the most texture memory that the streamed cells may use
+	void SetMemoryBudget(size_t bytes) { m_memoryBudget = bytes; }
+	// set the scheduler of the texture loading coroutines, NULL
+	// to request the textures from the loader thread of the cache
+	void SetLoadScheduler(LoadScheduler* pLoadScheduler) { m_pLoadScheduler = pLoadScheduler; }
+	// wait for the texture loads in flight, which has to be done
+	// before the scheduler is stopped
+	void FinishTextureLoads();
+	// load and unload cells for the passed in camera position,
+	// returns true when objects were added or removed
+	bool Update(const glm::vec3& cameraPosition);
+
+	// get the number of cells and of loaded cells
+	int GetCellCount() const { return((int)m_cells.size()); }
+	int GetLoadedCellCount() const;
+	// get the texture memory held by the loaded cells
+	size_t GetStreamedBytes() const { return(m_streamedBytes); }
+
+private:
+	enum CELL_STATE
+	{
+		CELL_UNLOADED,
+		CELL_LOADING,
+		CELL_LOADED
+	};
+
+	struct CELL
+	{
+		int x;
+		int z;
+		CELL_STATE state;
+		std::vector<STREAMED_OBJECT> objects;
+		// scene nodes and textures added while the cell is loaded,
+		// and the image file of each texture
+		std::vector<int> nodes;
+		std::vector<SceneManager::TEXTURE_HANDLE> textures;
+		std::vector<std::string> textureFiles;
+		// distance from the camera at the last update
+		float distance;
+	};
+
+	// pointer to the scene that the cells are added to
+	SceneManager* m_pSceneManager;
+	// pointer to the cache that loads the textures
+	ResourceCache* m_pResourceCache;
+	// pointer to the scheduler of the texture loads, may be NULL
+	LoadScheduler* m_pLoadScheduler;
+	// the texture loading coroutines by image file - finished
+	// loads are dropped, except for the files that failed, so
+	// that those are not loaded again and again
+	std::map<std::string, LoadTask<bool>> m_textureLoads;
+	// the cells, and the cell index for each cell coordinate
+	std::vector<CELL> m_cells;
+	std::map<long long, int> m_cellIndices;
+	// most texture memory the streamed cells may use
+	size_t m_memoryBudget;
+	// number of loaded cells using each image file, and the
+	// memory of the textures of those files
+	std::map<std::string, int> m_textureUseCounts;
+	std::map<std::string, size_t> m_textureBytes;
+	size_t m_streamedBytes;
+
+	// get the distance from a position to the edge of a cell
+	float GetCellDistance(const CELL& cell, const glm::vec3& position) const;
+	// start loading the texture for an image file
+	void StartTextureLoad(const std::string& textureFile);
+	// check whether every texture of a loading cell is uploaded
+	bool IsCellReady(const CELL& cell);
+	// add the objects of a cell to the scene
+	void InstantiateCell(CELL& cell);
+	// remove the objects of a cell from the scene
+	void UnloadCell(CELL& cell);
+	// remove the furthest cell that is outside the load distance
+	bool EvictFurthestCell();
+};
@@ -0,0 +1,329 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderlibrary.cpp
+// ============
+// compile and link the additional shader programs used by the 3D scenes
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShaderLibrary.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+/***********************************************************
+ *  ShaderLibrary()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ShaderLibrary::ShaderLibrary(ResourceManager* pResourceManager)
+{
+	m_pResourceManager = pResourceManager;
+	m_pAssetPack = NULL;
+}
+
+/***********************************************************
+ *  ~ShaderLibrary()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ShaderLibrary::~ShaderLibrary()
+{
+	// release the loaded programs to the resource manager
+	m_programRefs.clear();
+	m_programKeys.clear();
+	m_pResourceManager = NULL;
+}
+
+/***********************************************************
+ *  LoadProgram()
+ *
+ *  This method is used for loading the GLSL source files,
+ *  compiling each shader stage and linking them into one
+ *  shader program.  A program that was already loaded from
+ *  the same files is shared instead of being built again.
+ ***********************************************************/
+GLuint ShaderLibrary::LoadProgram(
+	const char* vertexShaderPath,
+	const char* geometryShaderPath,
+	const char* fragmentShaderPath)
+{
+	std::vector<GLuint> shaders;
+	bool bCompiled = true;
+
+	std::string programKey = std::string(vertexShaderPath) + "|";
+	if (NULL != geometryShaderPath)
+	{
+		programKey += geometryShaderPath;
+	}
+	programKey += std::string("|") + fragmentShaderPath;
+
+	GLuint loadedProgram = FindLoadedProgram(programKey);
+	if (loadedProgram != 0)
+	{
+		return(loadedProgram);
+	}
+
+	shaders.push_back(CompileShader(GL_VERTEX_SHADER, vertexShaderPath));
+	if (NULL != geometryShaderPath)
+	{
+		shaders.push_back(CompileShader(GL_GEOMETRY_SHADER, geometryShaderPath));
+	}
+	shaders.push_back(CompileShader(GL_FRAGMENT_SHADER, fragmentShaderPath));
+
+	for (int i = 0; i < shaders.size(); i++)
+	{
+		if (shaders[i] == 0)
+		{
+			bCompiled = false;
+		}
+	}
+
+	GLuint programID = 0;
+	if (bCompiled == true)
+	{
+		programID = LinkProgram(shaders);
+	}
+
+	return(KeepProgram(programKey, programID, shaders));
+}
+
+/***********************************************************
+ *  LoadComputeProgram()
+ *
+ *  This method is used for loading a program that has only
+ *  a compute stage, shared like the other programs.
+ ***********************************************************/
+GLuint ShaderLibrary::LoadComputeProgram(const char* computeShaderPath)
+{
+	std::vector<GLuint> shaders;
+	std::string programKey = std::string("compute|") + computeShaderPath;
+
+	GLuint loadedProgram = FindLoadedProgram(programKey);
+	if (loadedProgram != 0)
+	{
+		return(loadedProgram);
+	}
+
+	shaders.push_back(CompileShader(GL_COMPUTE_SHADER, computeShaderPath));
+
+	GLuint programID = 0;
+	if (shaders[0] != 0)
+	{
+		programID = LinkProgram(shaders);
+	}
+
+	return(KeepProgram(programKey, programID, shaders));
+}
+
+/***********************************************************
+ *  LoadFeedbackProgram()
+ *
+ *  This method is used for loading a program that has only
+ *  a vertex stage, for capturing transformed vertices into
+ *  a buffer.  The captured outputs need to be named before
+ *  the program is linked.
+ ***********************************************************/
+GLuint ShaderLibrary::LoadFeedbackProgram(
+	const char* vertexShaderPath,
+	const char* const* feedbackVaryings,
+	int varyingCount)
+{
+	std::vector<GLuint> shaders;
+	std::string programKey = std::string("feedback|") + vertexShaderPath;
+
+	for (int i = 0; i < varyingCount; i++)
+	{
+		programKey += std::string("|") + feedbackVaryings[i];
+	}
+
+	GLuint loadedProgram = FindLoadedProgram(programKey);
+	if (loadedProgram != 0)
+	{
+		return(loadedProgram);
+	}
+
+	shaders.push_back(CompileShader(GL_VERTEX_SHADER, vertexShaderPath));
+
+	GLuint programID = 0;
+	if (shaders[0] != 0)
+	{
+		programID = LinkProgram(shaders, feedbackVaryings, varyingCount);
+	}
+
+	return(KeepProgram(programKey, programID, shaders));
+}
+
+/***********************************************************
+ *  FindLoadedProgram()
+ *
+ *  This method is used for finding a program that was
+ *  already loaded under the passed in key, returning 0 when
+ *  there is none.
+ ***********************************************************/
+GLuint ShaderLibrary::FindLoadedProgram(const std::string& programKey) const
+{
+	int index = 0;
+	while (index < m_programKeys.size())
+	{
+		if (m_programKeys[index].compare(programKey) == 0)
+		{
+			return(m_programRefs[index].GetName());
+		}
+		index++;
+	}
+
+	return(0);
+}
+
+/***********************************************************
+ *  KeepProgram()
+ *
+ *  This method is used for handing a linked program to the
+ *  resource manager and remembering it under its key, so
+ *  that it is only built once.
+ ***********************************************************/
+GLuint ShaderLibrary::KeepProgram(
+	const std::string& programKey,
+	GLuint programID,
+	const std::vector<GLuint>& shaders)
+{
+	// the shader objects are no longer needed once linked
+	for (int i = 0; i < shaders.size(); i++)
+	{
+		if (shaders[i] != 0)
+		{
+			glDeleteShader(shaders[i]);
+		}
+	}
+
+	if ((programID != 0) && (NULL != m_pResourceManager))
+	{
+		m_programKeys.push_back(programKey);
+		m_programRefs.push_back(ResourceRef(
+			m_pResourceManager,
+			m_pResourceManager->Register(
+				ResourceManager::RESOURCE_PROGRAM,
+				programID,
+				0)));
+	}
+
+	return(programID);
+}
+
+/***********************************************************
+ *  ReadShaderFile()
+ *
+ *  This method is used for reading the contents of a GLSL
+ *  source file into the passed in string.
+ ***********************************************************/
+bool ShaderLibrary::ReadShaderFile(const char* filePath, std::string& source)
+{
+	std::ifstream shaderFile(filePath);
+	if (!shaderFile.is_open())
+	{
+		std::cout << "Could not open shader file:" << filePath << std::endl;
+		return(false);
+	}
+
+	std::stringstream shaderStream;
+	shaderStream << shaderFile.rdbuf();
+	source = shaderStream.str();
+
+	return(true);
+}
+
+/***********************************************************
+ *  CompileShader()
+ *
+ *  This method is used for compiling one shader stage from
+ *  the passed in GLSL source file.
+ ***********************************************************/
+GLuint ShaderLibrary::CompileShader(GLenum stage, const char* filePath)
+{
+	std::string source;
+	const char* sourceText = NULL;
+	GLint sourceLength = 0;
+
+	// the source in the asset pack is compiled right where it
+	// is mapped, it is not null terminated so its length is set
+	AssetPack::ASSET asset;
+	if ((NULL != m_pAssetPack) &&
+		(m_pAssetPack->Find(filePath, asset) == true) &&
+		(asset.type == AssetPack::ASSET_FILE))
+	{
+		sourceText = (const char*)asset.pData;
+		sourceLength = (GLint)asset.size;
+	}
+	else
+	{
+		if (NULL != m_pAssetPack)
+		{
+			m_pAssetPack->RecordFileRead(filePath);
+		}
+		if (ReadShaderFile(filePath, source) == false)
+		{
+			return(0);
+		}
+		sourceText = source.c_str();
+		sourceLength = (GLint)source.size();
+	}
+
+	GLuint shaderID = glCreateShader(stage);
+	glShaderSource(shaderID, 1, &sourceText, &sourceLength);
+	glCompileShader(shaderID);
+
+	GLint compileStatus = GL_FALSE;
+	glGetShaderiv(shaderID, GL_COMPILE_STATUS, &compileStatus);
+	if (compileStatus != GL_TRUE)
+	{
+		char infoLog[1024];
+		glGetShaderInfoLog(shaderID, sizeof(infoLog), NULL, infoLog);
+		std::cout << "Could not compile shader:" << filePath << "\n" << infoLog << std::endl;
+		glDeleteShader(shaderID);
+		return(0);
+	}
+
+	return(shaderID);
+}
+
+/***********************************************************
+ *  LinkProgram()
+ *
+ *  This method is used for linking the compiled shader
+ *  stages into one shader program.
+ ***********************************************************/
+GLuint ShaderLibrary::LinkProgram(
+	const std::vector<GLuint>& shaders,
+	const char* const* feedbackVaryings,
+	int varyingCount)
+{
+	GLuint programID = glCreateProgram();
+	for (int i = 0; i < shaders.size(); i++)
+	{
+		glAttachShader(programID, shaders[i]);
+	}
+	if (varyingCount > 0)
+	{
+		glTransformFeedbackVaryings(programID, varyingCount, feedbackVaryings, GL_INTERLEAVED_ATTRIBS);
+	}
+	glLinkProgram(programID);
+
+	GLint linkStatus = GL_FALSE;
+	glGetProgramiv(programID, GL_LINK_STATUS, &linkStatus);
+	if (linkStatus != GL_TRUE)
+	{
+		char infoLog[1024];
+		glGetProgramInfoLog(programID, sizeof(infoLog), NULL, infoLog);
+		std::cout << "Could not link shader program:\n" << infoLog << std::endl;
+		glDeleteProgram(programID);
+		return(0);
+	}
+
+	for (int i = 0; i < shaders.size(); i++)
+	{
+		glDetachShader(programID, shaders[i]);
+	}
+
+	return(programID);
+}
@@ -0,0 +1,80 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderlibrary.h
+// ============
+// compile and link the additional shader programs used by the 3D scenes
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ResourceManager.h"
+#include "AssetPack.h"
+
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  ShaderLibrary
+ *
+ *  This class compiles and links the shader programs that
+ *  are used in addition to the main scene shader, such as
+ *  programs with geometry or compute stages.  The programs
+ *  are owned by the resource manager and stay alive for as
+ *  long as the library exists, and each one is only built
+ *  once for all of the scenes that use it.
+ ***********************************************************/
+class ShaderLibrary
+{
+public:
+	// constructor
+	ShaderLibrary(ResourceManager* pResourceManager);
+	// destructor
+	~ShaderLibrary();
+
+	// load, compile and link a program from GLSL files - the
+	// geometry shader path may be NULL, returns 0 on failure
+	GLuint LoadProgram(
+		const char* vertexShaderPath,
+		const char* geometryShaderPath,
+		const char* fragmentShaderPath);
+	// load a program with a single compute stage
+	GLuint LoadComputeProgram(const char* computeShaderPath);
+	// load a program with only a vertex stage, whose listed
+	// outputs are captured interleaved by transform feedback
+	GLuint LoadFeedbackProgram(
+		const char* vertexShaderPath,
+		const char* const* feedbackVaryings,
+		int varyingCount);
+
+	// set the pack that the GLSL files are read from first
+	void SetAssetPack(AssetPack* pAssetPack) { m_pAssetPack = pAssetPack; }
+
+private:
+	// pointer to the manager that owns the OpenGL resources
+	ResourceManager* m_pResourceManager;
+	// pointer to the pack of GLSL files, may be NULL
+	AssetPack* m_pAssetPack;
+	// references that keep the loaded programs alive, and the
+	// source files that each program was loaded from
+	std::vector<ResourceRef> m_programRefs;
+	std::vector<std::string> m_programKeys;
+
+	// read the contents of a GLSL source file
+	bool ReadShaderFile(const char* filePath, std::string& source);
+	// compile one shader stage, returns 0 on failure
+	GLuint CompileShader(GLenum stage, const char* filePath);
+	// link the compiled stages into a program, optionally with
+	// transform feedback outputs, returns 0 on failure
+	GLuint LinkProgram(
+		const std::vector<GLuint>& shaders,
+		const char* const* feedbackVaryings = NULL,
+		int varyingCount = 0);
+	// find a program that was already loaded from the same files
+	GLuint FindLoadedProgram(const std::string& programKey) const;
+	// keep a loaded program alive and shared under its key, and
+	// delete the compiled stages that it no longer needs
+	GLuint KeepProgram(
+		const std::string& programKey,
+		GLuint programID,
+		const std::vector<GLuint>& shaders);
+};
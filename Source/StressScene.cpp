@@ -0,0 +1,374 @@
+///////////////////////////////////////////////////////////////////////////////
+// stressscene.cpp
+// ============
+// generate scenes of any size for measuring how rendering scales
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "StressScene.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <random>
+
+// declaration of global variables
+namespace
+{
+	// the tags of the generated materials, textures and nodes,
+	// followed by their numbers
+	const char* g_MaterialTagPrefix = "stressMaterial";
+	const char* g_TextureTagPrefix = "stressTexture";
+	const char* g_NodeTagPrefix = "stressNode";
+
+	// size of the generated textures and of their squares
+	const int g_CheckerTextureSize = 128;
+	const int g_CheckerSquareSize = 16;
+	// the scale of an object is between these two
+	const float g_MinimumObjectScale = 0.2f;
+	const float g_MaximumObjectScale = 1.0f;
+	// spread of the objects around a cluster center, as a part
+	// of the extent
+	const float g_ClusterSpread = 0.08f;
+	// height of the generated lights above the ground
+	const float g_LightHeight = 12.0f;
+}
+
+/***********************************************************
+ *  StressScene()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+StressScene::StressScene(
+	SceneManager* pSceneManager,
+	ResourceManager* pResourceManager,
+	GpuCulling* pGpuCulling)
+{
+	m_pSceneManager = pSceneManager;
+	m_pResourceManager = pResourceManager;
+	m_pGpuCulling = pGpuCulling;
+	m_objectCount = 0;
+	m_lightCount = 0;
+	m_bLightsSaved = false;
+}
+
+/***********************************************************
+ *  ~StressScene()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+StressScene::~StressScene()
+{
+	Clear();
+	m_pSceneManager = NULL;
+	m_pResourceManager = NULL;
+	m_pGpuCulling = NULL;
+}
+
+/***********************************************************
+ *  GetDefaultParameters()
+ *
+ *  This method is used for getting the parameters of a
+ *  medium sized scene, which the callers change as needed.
+ ***********************************************************/
+StressScene::STRESS_PARAMETERS StressScene::GetDefaultParameters()
+{
+	STRESS_PARAMETERS parameters;
+
+	parameters.objectCount = 1000;
+	parameters.materialCount = 8;
+	parameters.textureCount = 4;
+	parameters.lightCount = SceneManager::MAX_LIGHT_SOURCES;
+	parameters.distribution = DISTRIBUTION_UNIFORM;
+	parameters.extent = 40.0f;
+	parameters.clusterCount = 16;
+	parameters.seed = 1;
+	parameters.bGpuInstances = false;
+
+	return(parameters);
+}
+
+/***********************************************************
+ *  Generate()
+ *
+ *  This method is used for replacing the generated objects
+ *  with a new set.  The materials are defined once for each
+ *  tag, from their number, so they are the same whatever
+ *  scene asked for them first.  Every other value is drawn
+ *  from one generator in a fixed order, so the seed decides
+ *  the whole scene.  The objects use the materials and
+ *  textures in turn, and each object stands on the ground.
+ ***********************************************************/
+bool StressScene::Generate(const STRESS_PARAMETERS& parameters)
+{
+	Clear();
+
+	if ((NULL == m_pSceneManager) || (NULL == m_pResourceManager) ||
+		(parameters.objectCount < 0) ||
+		((parameters.bGpuInstances == true) && (NULL == m_pGpuCulling)))
+	{
+		return(false);
+	}
+
+	std::mt19937 random(parameters.seed);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	std::vector<SceneManager::MESH_TYPE> meshes = parameters.meshes;
+	if (meshes.empty() == true)
+	{
+		for (int i = 0; i < SceneManager::MESH_TYPE_COUNT; i++)
+		{
+			meshes.push_back((SceneManager::MESH_TYPE)i);
+		}
+	}
+
+	// the materials are kept between scenes
+	std::vector<std::string> materialTags;
+	for (int i = 0; i < parameters.materialCount; i++)
+	{
+		std::string tag = g_MaterialTagPrefix + std::to_string(i);
+		if (NULL == m_pSceneManager->GetMaterialData(m_pSceneManager->GetMaterialHandle(tag)))
+		{
+			std::mt19937 materialRandom(i);
+			SceneManager::OBJECT_MATERIAL material;
+			material.ambientColor = glm::vec3(unit(materialRandom), unit(materialRandom), unit(materialRandom));
+			material.ambientStrength = 0.1f + 0.2f * unit(materialRandom);
+			material.diffuseColor = glm::vec3(unit(materialRandom), unit(materialRandom), unit(materialRandom));
+			material.specularColor = glm::vec3(0.5f * unit(materialRandom));
+			material.shininess = 2.0f + 62.0f * unit(materialRandom);
+			material.tag = tag;
+			m_pSceneManager->AddObjectMaterial(material);
+		}
+		materialTags.push_back(tag);
+	}
+
+	// the textures stop at the last free texture slot
+	std::vector<std::string> textureTags;
+	for (int i = 0; i < parameters.textureCount; i++)
+	{
+		std::string tag = g_TextureTagPrefix + std::to_string(i);
+		glm::vec3 color0(unit(random), unit(random), unit(random));
+		glm::vec3 color1(unit(random), unit(random), unit(random));
+		SceneManager::TEXTURE_HANDLE texture = m_pSceneManager->AddSceneTexture(
+			CreateCheckerTexture(color0, color1),
+			tag);
+		if (m_pSceneManager->GetTextureSlot(texture) < 0)
+		{
+			break;
+		}
+		m_textures.push_back(texture);
+		textureTags.push_back(tag);
+	}
+
+	// the lights share out the same brightness, and the lights
+	// that are not used are black
+	for (int i = 0; (m_bLightsSaved == false) && (i < SceneManager::MAX_LIGHT_SOURCES); i++)
+	{
+		m_pSceneManager->GetSceneLight(i, m_savedLights[i]);
+	}
+	m_bLightsSaved = true;
+	m_lightCount = std::min(std::max(parameters.lightCount, 0), (int)SceneManager::MAX_LIGHT_SOURCES);
+	for (int i = 0; i < SceneManager::MAX_LIGHT_SOURCES; i++)
+	{
+		SceneManager::LIGHT_SOURCE light;
+		light.position = glm::vec3(0.0f, g_LightHeight, 0.0f);
+		light.ambientColor = glm::vec3(0.0f);
+		light.diffuseColor = glm::vec3(0.0f);
+		light.specularColor = glm::vec3(0.0f);
+		light.focalStrength = 1.0f;
+		light.specularIntensity = 0.0f;
+		if (i < m_lightCount)
+		{
+			light.position = glm::vec3(
+				(unit(random) * 2.0f - 1.0f) * parameters.extent,
+				g_LightHeight,
+				(unit(random) * 2.0f - 1.0f) * parameters.extent);
+			light.ambientColor = glm::vec3(0.05f / m_lightCount);
+			light.diffuseColor = glm::vec3(0.8f / m_lightCount);
+			light.specularColor = glm::vec3(0.3f);
+			light.focalStrength = 16.0f;
+			light.specularIntensity = 0.3f;
+		}
+		m_pSceneManager->SetSceneLight(i, light);
+	}
+	m_pSceneManager->SetupSceneLights();
+
+	std::vector<glm::vec2> clusters;
+	for (int i = 0; (parameters.distribution == DISTRIBUTION_CLUSTERED) && (i < std::max(parameters.clusterCount, 1)); i++)
+	{
+		clusters.push_back(glm::vec2(
+			(unit(random) * 2.0f - 1.0f) * parameters.extent,
+			(unit(random) * 2.0f - 1.0f) * parameters.extent));
+	}
+	std::normal_distribution<float> clusterOffset(0.0f, parameters.extent * g_ClusterSpread);
+	int gridSide = std::max((int)std::ceil(std::sqrt((double)parameters.objectCount)), 1);
+	float gridSpacing = 2.0f * parameters.extent / gridSide;
+
+	// the handles are looked up once, and the copies for the GPU
+	// culling are batched by mesh, material and texture
+	std::vector<SceneManager::MATERIAL_HANDLE> materialHandles;
+	for (int i = 0; i < materialTags.size(); i++)
+	{
+		materialHandles.push_back(m_pSceneManager->GetMaterialHandle(materialTags[i]));
+	}
+	std::map<long long, int> batches;
+
+	for (int i = 0; i < parameters.objectCount; i++)
+	{
+		SceneManager::MESH_TYPE mesh = meshes[random() % meshes.size()];
+		float scale = g_MinimumObjectScale + (g_MaximumObjectScale - g_MinimumObjectScale) * unit(random);
+		glm::vec3 scaleXYZ = scale * glm::vec3(0.5f + unit(random), 0.5f + unit(random), 0.5f + unit(random));
+		float YrotationDegrees = 360.0f * unit(random);
+		glm::vec4 color(0.2f + 0.8f * unit(random), 0.2f + 0.8f * unit(random), 0.2f + 0.8f * unit(random), 1.0f);
+
+		glm::vec2 ground;
+		switch (parameters.distribution)
+		{
+		case DISTRIBUTION_CLUSTERED:
+			ground = clusters[random() % clusters.size()] +
+				glm::vec2(clusterOffset(random), clusterOffset(random));
+			break;
+		case DISTRIBUTION_GRID:
+			ground = glm::vec2(
+				-parameters.extent + ((i % gridSide) + 0.5f) * gridSpacing,
+				-parameters.extent + ((i / gridSide) + 0.5f) * gridSpacing);
+			break;
+		default:
+			ground = glm::vec2(
+				(unit(random) * 2.0f - 1.0f) * parameters.extent,
+				(unit(random) * 2.0f - 1.0f) * parameters.extent);
+			break;
+		}
+		glm::vec3 positionXYZ(ground.x, scaleXYZ.y * 0.5f, ground.y);
+
+		int material = materialTags.empty() ? -1 : (i % (int)materialTags.size());
+		int texture = textureTags.empty() ? -1 : (i % (int)textureTags.size());
+
+		if (parameters.bGpuInstances == true)
+		{
+			long long key = ((long long)mesh * (materialTags.size() + 1) + (material + 1)) *
+				(textureTags.size() + 1) + (texture + 1);
+			std::map<long long, int>::iterator found = batches.find(key);
+			if (found == batches.end())
+			{
+				int batch = m_pGpuCulling->AddBatch(
+					mesh,
+					color,
+					(material >= 0) ? materialTags[material] : "",
+					(texture >= 0) ? textureTags[texture] : "");
+				if (batch < 0)
+				{
+					return(false);
+				}
+				found = batches.insert(std::make_pair(key, batch)).first;
+			}
+			m_pGpuCulling->AddInstance(found->second, scaleXYZ, 0.0f, YrotationDegrees, 0.0f, positionXYZ);
+		}
+		else
+		{
+			m_nodes.push_back(m_pSceneManager->AddSceneNode(
+				g_NodeTagPrefix + std::to_string(i),
+				m_pSceneManager->GetMeshHandle(mesh),
+				scaleXYZ,
+				0.0f,
+				YrotationDegrees,
+				0.0f,
+				positionXYZ,
+				color,
+				(material >= 0) ? materialHandles[material] : HandlePool<SceneManager::MATERIAL_DATA>::InvalidHandle(),
+				(texture >= 0) ? m_textures[texture] : HandlePool<SceneManager::TEXTURE_DATA>::InvalidHandle()));
+		}
+		m_objectCount++;
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing the generated objects
+ *  and textures, and putting back the lights of the scene.
+ *  The GPU culling copies are all removed, since nothing
+ *  else adds any.
+ ***********************************************************/
+void StressScene::Clear()
+{
+	if (NULL == m_pSceneManager)
+	{
+		return;
+	}
+
+	for (int i = 0; i < m_nodes.size(); i++)
+	{
+		m_pSceneManager->RemoveSceneNode(m_nodes[i]);
+	}
+	m_nodes.clear();
+	for (int i = 0; i < m_textures.size(); i++)
+	{
+		m_pSceneManager->RemoveSceneTexture(m_textures[i]);
+	}
+	m_textures.clear();
+	if ((NULL != m_pGpuCulling) && (m_pGpuCulling->GetInstanceCount() > 0))
+	{
+		m_pGpuCulling->Clear();
+	}
+
+	if (m_bLightsSaved == true)
+	{
+		for (int i = 0; i < SceneManager::MAX_LIGHT_SOURCES; i++)
+		{
+			m_pSceneManager->SetSceneLight(i, m_savedLights[i]);
+		}
+		m_pSceneManager->SetupSceneLights();
+		m_bLightsSaved = false;
+	}
+	m_objectCount = 0;
+	m_lightCount = 0;
+}
+
+/***********************************************************
+ *  CreateCheckerTexture()
+ *
+ *  This method is used for creating a texture of squares in
+ *  two colors, with the same parameters as the textures of
+ *  image files.
+ ***********************************************************/
+ResourceRef StressScene::CreateCheckerTexture(const glm::vec3& color0, const glm::vec3& color1)
+{
+	std::vector<unsigned char> pixels((size_t)g_CheckerTextureSize * g_CheckerTextureSize * 4);
+	GLuint textureID = 0;
+
+	for (int y = 0; y < g_CheckerTextureSize; y++)
+	{
+		for (int x = 0; x < g_CheckerTextureSize; x++)
+		{
+			const glm::vec3& color = (((x / g_CheckerSquareSize) + (y / g_CheckerSquareSize)) % 2 == 0) ? color0 : color1;
+			unsigned char* pPixel = pixels.data() + ((size_t)y * g_CheckerTextureSize + x) * 4;
+			pPixel[0] = (unsigned char)(color.r * 255.0f);
+			pPixel[1] = (unsigned char)(color.g * 255.0f);
+			pPixel[2] = (unsigned char)(color.b * 255.0f);
+			pPixel[3] = 255;
+		}
+	}
+
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_2D, textureID);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, g_CheckerTextureSize, g_CheckerTextureSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+	glGenerateMipmap(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	size_t textureBytes = (size_t)g_CheckerTextureSize * g_CheckerTextureSize * 4;
+	textureBytes += textureBytes / 3;
+
+	return(ResourceRef(
+		m_pResourceManager,
+		m_pResourceManager->Register(
+			ResourceManager::RESOURCE_TEXTURE,
+			textureID,
+			textureBytes)));
+}
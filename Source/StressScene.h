@@ -0,0 +1,106 @@
+///////////////////////////////////////////////////////////////////////////////
+// stressscene.h
+// ============
+// generate scenes of any size for measuring how rendering scales
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneManager.h"
+#include "ResourceManager.h"
+#include "GpuCulling.h"
+
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  StressScene
+ *
+ *  This class adds generated objects to a scene, for
+ *  finding out where each part of the renderer stops
+ *  scaling.  The number of objects, the basic meshes they
+ *  are made of, the number of materials, textures and
+ *  lights, and how the objects are spread over the ground
+ *  are all parameters, and the same parameters and seed
+ *  always give the same scene.  The objects are added as
+ *  scene nodes, or as copies for the GPU culling, and the
+ *  textures are generated checker patterns.  The objects,
+ *  textures and lights are removed again by Clear(), and
+ *  the materials are kept for the next scene to reuse.
+ ***********************************************************/
+class StressScene
+{
+public:
+	// constructor - the GPU culling may be NULL
+	StressScene(
+		SceneManager* pSceneManager,
+		ResourceManager* pResourceManager,
+		GpuCulling* pGpuCulling);
+	// destructor
+	~StressScene();
+
+	// how the objects are spread over the ground
+	enum DISTRIBUTION
+	{
+		DISTRIBUTION_UNIFORM,
+		DISTRIBUTION_CLUSTERED,
+		DISTRIBUTION_GRID
+	};
+
+	struct STRESS_PARAMETERS
+	{
+		int objectCount;
+		// the meshes that the objects are picked from, all of
+		// the basic meshes when empty
+		std::vector<SceneManager::MESH_TYPE> meshes;
+		int materialCount;
+		// limited by the free texture slots of the scene
+		int textureCount;
+		// limited by the light sources of the shaders
+		int lightCount;
+		DISTRIBUTION distribution;
+		// half the width of the square that the objects cover
+		float extent;
+		// number of clusters for the clustered distribution
+		int clusterCount;
+		unsigned int seed;
+		// add the objects as copies for the GPU culling
+		bool bGpuInstances;
+	};
+
+	// get the parameters that the generation starts from
+	static STRESS_PARAMETERS GetDefaultParameters();
+
+	// replace the generated objects with a new set, returns
+	// false when the objects could not be added
+	bool Generate(const STRESS_PARAMETERS& parameters);
+	// remove the generated objects, textures and lights
+	void Clear();
+
+	// get the numbers of objects, textures and lights that were
+	// actually added
+	int GetObjectCount() const { return(m_objectCount); }
+	int GetTextureCount() const { return((int)m_textures.size()); }
+	int GetLightCount() const { return(m_lightCount); }
+
+private:
+	// pointer to the scene that the objects are added to
+	SceneManager* m_pSceneManager;
+	// pointer to the manager that owns the generated textures
+	ResourceManager* m_pResourceManager;
+	// pointer to the GPU culling, may be NULL
+	GpuCulling* m_pGpuCulling;
+
+	// the added scene nodes and textures
+	std::vector<int> m_nodes;
+	std::vector<SceneManager::TEXTURE_HANDLE> m_textures;
+	int m_objectCount;
+	// the lights of the scene from before the generation
+	SceneManager::LIGHT_SOURCE m_savedLights[SceneManager::MAX_LIGHT_SOURCES];
+	int m_lightCount;
+	bool m_bLightsSaved;
+
+	// create a checker pattern texture with two colors
+	ResourceRef CreateCheckerTexture(const glm::vec3& color0, const glm::vec3& color1);
+};
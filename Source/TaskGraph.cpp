@@ -0,0 +1,365 @@
+///////////////////////////////////////////////////////////////////////////////
+// taskgraph.cpp
+// ============
+// run dependent loading tasks concurrently, keeping OpenGL work on one thread
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TaskGraph.h"
+
+#include <algorithm>
+#include <iostream>
+#include <thread>
+
+/***********************************************************
+ *  TaskGraph()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TaskGraph::TaskGraph()
+{
+	m_finishedCount = 0;
+	m_bStopWorkers = false;
+	m_elapsedSeconds = 0.0;
+	m_criticalPathSeconds = 0.0;
+	m_taskSeconds = 0.0;
+}
+
+/***********************************************************
+ *  ~TaskGraph()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TaskGraph::~TaskGraph()
+{
+	Clear();
+}
+
+/***********************************************************
+ *  AddTask()
+ *
+ *  This method is used for adding a task to the graph.
+ ***********************************************************/
+int TaskGraph::AddTask(const std::string& name, TASK_THREAD thread, std::function<void()> work)
+{
+	TASK task;
+	task.name = name;
+	task.thread = thread;
+	task.work = work;
+	task.bAsync = false;
+	task.prerequisiteCount = 0;
+	task.waitingCount = 0;
+	task.seconds = 0.0;
+	m_tasks.push_back(task);
+
+	return((int)m_tasks.size() - 1);
+}
+
+/***********************************************************
+ *  AddAsyncTask()
+ *
+ *  This method is used for adding a task whose work starts
+ *  an operation that completes on another thread.  The
+ *  operation has to call FinishTask() once it is done, or
+ *  the run never ends.
+ ***********************************************************/
+int TaskGraph::AddAsyncTask(const std::string& name, TASK_THREAD thread, std::function<void()> work)
+{
+	int task = AddTask(name, thread, work);
+	m_tasks[task].bAsync = true;
+
+	return(task);
+}
+
+/***********************************************************
+ *  AddDependency()
+ *
+ *  This method is used for making a task wait until its
+ *  prerequisite has finished before it starts.
+ ***********************************************************/
+void TaskGraph::AddDependency(int task, int prerequisite)
+{
+	if ((task < 0) || (task >= m_tasks.size()) ||
+		(prerequisite < 0) || (prerequisite >= m_tasks.size()))
+	{
+		return;
+	}
+
+	m_tasks[prerequisite].dependents.push_back(task);
+	m_tasks[task].prerequisiteCount++;
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing every task.
+ ***********************************************************/
+void TaskGraph::Clear()
+{
+	m_tasks.clear();
+	m_readyTasks.clear();
+	m_readyContextTasks.clear();
+	m_finishedCount = 0;
+}
+
+/***********************************************************
+ *  Run()
+ *
+ *  This method is used for running every task.  The tasks
+ *  without prerequisites start right away, and each task
+ *  that finishes releases the tasks that waited only on it.
+ *  The calling thread runs the context thread tasks as they
+ *  become ready, and only takes on other tasks when there
+ *  are no worker threads, so that OpenGL work never waits
+ *  behind a long decode.
+ ***********************************************************/
+bool TaskGraph::Run()
+{
+	std::vector<int> order;
+
+	if (m_tasks.size() == 0)
+	{
+		return(true);
+	}
+	if (SortTasks(order) == false)
+	{
+		return(false);
+	}
+
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+	int anyThreadCount = 0;
+	m_readyTasks.clear();
+	m_readyContextTasks.clear();
+	m_finishedCount = 0;
+	m_bStopWorkers = false;
+	for (int i = 0; i < m_tasks.size(); i++)
+	{
+		m_tasks[i].waitingCount = m_tasks[i].prerequisiteCount;
+		m_tasks[i].seconds = 0.0;
+		if (m_tasks[i].thread == TASK_ANY_THREAD)
+		{
+			anyThreadCount++;
+		}
+		if (m_tasks[i].waitingCount == 0)
+		{
+			if (m_tasks[i].thread == TASK_CONTEXT_THREAD)
+				m_readyContextTasks.push_back(i);
+			else
+				m_readyTasks.push_back(i);
+		}
+	}
+
+	// one core is left for the context thread, but there is at
+	// least one worker, since reading files mostly waits on I/O
+	int workerCount = std::max((int)std::thread::hardware_concurrency() - 1, 1);
+	workerCount = std::min(workerCount, anyThreadCount);
+	std::vector<std::thread> workers;
+	for (int i = 0; i < workerCount; i++)
+	{
+		workers.push_back(std::thread(&TaskGraph::WorkerThread, this));
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		while (m_finishedCount < m_tasks.size())
+		{
+			int task = -1;
+			if (m_readyContextTasks.size() > 0)
+			{
+				task = m_readyContextTasks.front();
+				m_readyContextTasks.pop_front();
+			}
+			else if ((workers.size() == 0) && (m_readyTasks.size() > 0))
+			{
+				task = m_readyTasks.front();
+				m_readyTasks.pop_front();
+			}
+
+			if (task < 0)
+			{
+				m_contextCondition.wait(lock);
+				continue;
+			}
+
+			lock.unlock();
+			RunTask(task);
+			lock.lock();
+		}
+		m_bStopWorkers = true;
+	}
+	m_workerCondition.notify_all();
+	for (int i = 0; i < workers.size(); i++)
+	{
+		workers[i].join();
+	}
+
+	m_elapsedSeconds = std::chrono::duration<double>(
+		std::chrono::steady_clock::now() - startTime).count();
+
+	// the longest chain ending at each task is its own time plus
+	// the longest chain of any of its prerequisites
+	std::vector<double> pathSeconds(m_tasks.size(), 0.0);
+	std::vector<double> longestPrerequisite(m_tasks.size(), 0.0);
+	m_criticalPathSeconds = 0.0;
+	m_taskSeconds = 0.0;
+	for (int i = 0; i < order.size(); i++)
+	{
+		const TASK& task = m_tasks[order[i]];
+		pathSeconds[order[i]] = longestPrerequisite[order[i]] + task.seconds;
+		for (int j = 0; j < task.dependents.size(); j++)
+		{
+			longestPrerequisite[task.dependents[j]] = std::max(
+				longestPrerequisite[task.dependents[j]],
+				pathSeconds[order[i]]);
+		}
+		m_criticalPathSeconds = std::max(m_criticalPathSeconds, pathSeconds[order[i]]);
+		m_taskSeconds += task.seconds;
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  SortTasks()
+ *
+ *  This method is used for ordering the tasks so that each
+ *  one comes after all of its prerequisites.  Any task left
+ *  over is part of a dependency cycle.
+ ***********************************************************/
+bool TaskGraph::SortTasks(std::vector<int>& order) const
+{
+	std::vector<int> waitingCounts(m_tasks.size());
+
+	order.clear();
+	for (int i = 0; i < m_tasks.size(); i++)
+	{
+		waitingCounts[i] = m_tasks[i].prerequisiteCount;
+		if (waitingCounts[i] == 0)
+		{
+			order.push_back(i);
+		}
+	}
+	for (int i = 0; i < order.size(); i++)
+	{
+		const TASK& task = m_tasks[order[i]];
+		for (int j = 0; j < task.dependents.size(); j++)
+		{
+			waitingCounts[task.dependents[j]]--;
+			if (waitingCounts[task.dependents[j]] == 0)
+			{
+				order.push_back(task.dependents[j]);
+			}
+		}
+	}
+
+	if (order.size() < m_tasks.size())
+	{
+		for (int i = 0; i < m_tasks.size(); i++)
+		{
+			if (waitingCounts[i] > 0)
+			{
+				std::cout << "Could not run task graph, dependency cycle at:" << m_tasks[i].name << std::endl;
+				break;
+			}
+		}
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  RunTask()
+ *
+ *  This method is used for running a task.  An ordinary
+ *  task is finished as soon as its work returns, while an
+ *  asynchronous one is finished later by its operation.
+ ***********************************************************/
+void TaskGraph::RunTask(int task)
+{
+	m_tasks[task].startTime = std::chrono::steady_clock::now();
+	if (m_tasks[task].work)
+	{
+		m_tasks[task].work();
+	}
+
+	if (m_tasks[task].bAsync == false)
+	{
+		FinishTask(task);
+	}
+}
+
+/***********************************************************
+ *  FinishTask()
+ *
+ *  This method is used for recording that a task has
+ *  finished and queueing the tasks that were only waiting
+ *  on it.  It can be called from any thread.
+ ***********************************************************/
+void TaskGraph::FinishTask(int task)
+{
+	bool bReleasedWork = false;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_tasks[task].seconds = std::chrono::duration<double>(
+			std::chrono::steady_clock::now() - m_tasks[task].startTime).count();
+		m_finishedCount++;
+
+		const std::vector<int>& dependents = m_tasks[task].dependents;
+		for (int i = 0; i < dependents.size(); i++)
+		{
+			TASK& dependent = m_tasks[dependents[i]];
+			dependent.waitingCount--;
+			if (dependent.waitingCount == 0)
+			{
+				if (dependent.thread == TASK_CONTEXT_THREAD)
+				{
+					m_readyContextTasks.push_back(dependents[i]);
+				}
+				else
+				{
+					m_readyTasks.push_back(dependents[i]);
+					bReleasedWork = true;
+				}
+			}
+		}
+	}
+
+	// the context thread also wakes up for the finished count
+	m_contextCondition.notify_one();
+	if (bReleasedWork == true)
+	{
+		m_workerCondition.notify_all();
+	}
+}
+
+/***********************************************************
+ *  WorkerThread()
+ *
+ *  This method is run on each worker thread during a run.
+ *  It takes the ready tasks that can run on any thread, one
+ *  at a time, until the run is over.
+ ***********************************************************/
+void TaskGraph::WorkerThread()
+{
+	while (true)
+	{
+		int task = -1;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			while ((m_readyTasks.size() == 0) && (m_bStopWorkers == false))
+			{
+				m_workerCondition.wait(lock);
+			}
+			if (m_bStopWorkers == true)
+			{
+				return;
+			}
+			task = m_readyTasks.front();
+			m_readyTasks.pop_front();
+		}
+
+		RunTask(task);
+	}
+}
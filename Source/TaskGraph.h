@@ -0,0 +1,122 @@
+///////////////////////////////////////////////////////////////////////////////
+// taskgraph.h
+// ============
+// run dependent loading tasks concurrently, keeping OpenGL work on one thread
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  TaskGraph
+ *
+ *  This class runs a set of tasks in the order given by the
+ *  dependencies between them, rather than the order they
+ *  were added in.  Each task starts as soon as the tasks it
+ *  depends on have finished, so independent work - reading
+ *  and decoding files, defining materials, generating and
+ *  uploading meshes - overlaps, and the whole run takes
+ *  about as long as its longest chain of dependent tasks.
+ *  Tasks that call OpenGL are marked to run on the context
+ *  thread, which is the thread that calls Run(); the others
+ *  run on worker threads.  An asynchronous task only starts
+ *  work that finishes elsewhere, such as a file read, and
+ *  releases its dependents when FinishTask() is called for
+ *  it, so no thread is held while it waits.  The time of
+ *  each task is kept, so a run can report its critical path
+ *  next to the sum of all of its tasks.
+ ***********************************************************/
+class TaskGraph
+{
+public:
+	// constructor
+	TaskGraph();
+	// destructor
+	~TaskGraph();
+
+	// the thread that a task has to run on
+	enum TASK_THREAD
+	{
+		// any worker thread
+		TASK_ANY_THREAD,
+		// the thread that owns the OpenGL context
+		TASK_CONTEXT_THREAD
+	};
+
+	// add a task, returns its index for the dependencies
+	int AddTask(const std::string& name, TASK_THREAD thread, std::function<void()> work);
+	// add a task whose work only starts something that completes
+	// on another thread - the task is not finished when its work
+	// returns, but when FinishTask() is called for it
+	int AddAsyncTask(const std::string& name, TASK_THREAD thread, std::function<void()> work);
+	// finish an asynchronous task during a run, from any thread
+	void FinishTask(int task);
+	// make a task wait until another one has finished
+	void AddDependency(int task, int prerequisite);
+	// remove every task
+	void Clear();
+
+	// run every task and wait for them all - this has to be
+	// called on the thread that owns the OpenGL context, and
+	// returns false without running anything when the
+	// dependencies form a cycle
+	bool Run();
+
+	// get the times of the last run - from start to end, the
+	// longest chain of dependent tasks, and all tasks added up
+	double GetElapsedSeconds() const { return(m_elapsedSeconds); }
+	double GetCriticalPathSeconds() const { return(m_criticalPathSeconds); }
+	double GetTaskSeconds() const { return(m_taskSeconds); }
+
+private:
+	struct TASK
+	{
+		std::string name;
+		TASK_THREAD thread;
+		std::function<void()> work;
+		// the task is finished by FinishTask() rather than when
+		// its work returns
+		bool bAsync;
+		// the tasks waiting on this one
+		std::vector<int> dependents;
+		// the number of tasks this one waits on, in total and
+		// still unfinished during a run
+		int prerequisiteCount;
+		int waitingCount;
+		// when the task started, and the time it took in the last run
+		std::chrono::steady_clock::time_point startTime;
+		double seconds;
+	};
+
+	std::vector<TASK> m_tasks;
+
+	// the tasks that are ready to run, by thread, and the lock
+	// and signals shared with the worker threads
+	std::mutex m_mutex;
+	std::condition_variable m_workerCondition;
+	std::condition_variable m_contextCondition;
+	std::deque<int> m_readyTasks;
+	std::deque<int> m_readyContextTasks;
+	int m_finishedCount;
+	bool m_bStopWorkers;
+
+	double m_elapsedSeconds;
+	double m_criticalPathSeconds;
+	double m_taskSeconds;
+
+	// sort the tasks so that each comes after its prerequisites,
+	// returns false when there is a cycle
+	bool SortTasks(std::vector<int>& order) const;
+	// run one task and, unless it is asynchronous, finish it
+	void RunTask(int task);
+	// run ready tasks until the run is over
+	void WorkerThread();
+};
@@ -0,0 +1,353 @@
+///////////////////////////////////////////////////////////////////////////////
+// transparencypass.cpp
+// ============
+// draw the translucent scene nodes without sorting them
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TransparencyPass.h"
+
+#include <iostream>
+#include <string>
+
+// declaration of global variables
+namespace
+{
+	const char* g_ViewName = "view";
+	const char* g_ProjectionName = "projection";
+	const char* g_ViewCountName = "viewCount";
+	const char* g_ViewProjectionName = "viewProjection";
+	const char* g_ViewPositionName = "viewPosition";
+	const char* g_UVScaleName = "UVscale";
+	const char* g_AccumulationName = "accumulation";
+	const char* g_RevealageName = "revealage";
+}
+
+/***********************************************************
+ *  TransparencyPass()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TransparencyPass::TransparencyPass(
+	ShaderManager* pShaderManager,
+	ShaderLibrary* pShaderLibrary,
+	ResourceManager* pResourceManager)
+{
+	m_pShaderManager = pShaderManager;
+	m_pShaderLibrary = pShaderLibrary;
+	m_pResourceManager = pResourceManager;
+	m_translucentProgram = 0;
+	m_multiViewTranslucentProgram = 0;
+	m_compositeProgram = 0;
+	m_depthTexture = 0;
+	m_width = 0;
+	m_height = 0;
+}
+
+/***********************************************************
+ *  ~TransparencyPass()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TransparencyPass::~TransparencyPass()
+{
+	// release the targets to the resource manager
+	m_framebuffer.Reset();
+	m_revealageTexture.Reset();
+	m_accumulationTexture.Reset();
+	m_emptyVertexArray.Reset();
+	m_pShaderManager = NULL;
+	m_pShaderLibrary = NULL;
+	m_pResourceManager = NULL;
+}
+
+/***********************************************************
+ *  IsSupported()
+ *
+ *  This method is used for checking whether each draw
+ *  buffer can have its own blend function, which the two
+ *  targets need.
+ ***********************************************************/
+bool TransparencyPass::IsSupported()
+{
+	return((GLEW_VERSION_4_0 || GLEW_ARB_draw_buffers_blend) ? true : false);
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for loading the programs.  The
+ *  translucent nodes are lit by the same light sources as
+ *  the opaque ones, which are set into the program before
+ *  each pass.
+ ***********************************************************/
+bool TransparencyPass::Initialize(bool bMultiView)
+{
+	if ((NULL == m_pShaderLibrary) || (NULL == m_pResourceManager) || (IsSupported() == false))
+	{
+		return(false);
+	}
+
+	m_translucentProgram = m_pShaderLibrary->LoadProgram(
+		"../../Utilities/shaders/vertexShader.glsl",
+		NULL,
+		"../../Utilities/shaders/translucentFragmentShader.glsl");
+	if (bMultiView == true)
+	{
+		m_multiViewTranslucentProgram = m_pShaderLibrary->LoadProgram(
+			"../../Utilities/shaders/multiViewVertexShader.glsl",
+			"../../Utilities/shaders/multiViewGeometryShader.glsl",
+			"../../Utilities/shaders/translucentFragmentShader.glsl");
+	}
+	m_compositeProgram = m_pShaderLibrary->LoadProgram(
+		"../../Utilities/shaders/transparencyCompositeVertexShader.glsl",
+		NULL,
+		"../../Utilities/shaders/transparencyCompositeFragmentShader.glsl");
+	if ((m_translucentProgram == 0) || (m_compositeProgram == 0))
+	{
+		m_translucentProgram = 0;
+		return(false);
+	}
+
+	// the scene only sets the texture scale when it changes it
+	GLuint previousProgram = m_pShaderManager->m_programID;
+	GLuint programs[2] = { m_translucentProgram, m_multiViewTranslucentProgram };
+	for (int i = 0; i < 2; i++)
+	{
+		if (programs[i] != 0)
+		{
+			m_pShaderManager->m_programID = programs[i];
+			m_pShaderManager->use();
+			m_pShaderManager->setVec2Value(g_UVScaleName, glm::vec2(1.0f, 1.0f));
+		}
+	}
+	m_pShaderManager->m_programID = previousProgram;
+	m_pShaderManager->use();
+
+	GLuint vertexArrayID = 0;
+	glGenVertexArrays(1, &vertexArrayID);
+	m_emptyVertexArray = ResourceRef(
+		m_pResourceManager,
+		m_pResourceManager->Register(ResourceManager::RESOURCE_VERTEX_ARRAY, vertexArrayID, 0));
+
+	return(true);
+}
+
+/***********************************************************
+ *  Render()
+ *
+ *  This method is used for drawing the visible translucent
+ *  nodes of one pass.  The accumulation target adds up the
+ *  weighted colors and the revealage target multiplies by
+ *  the transparency of each node, so neither depends on the
+ *  order the nodes are drawn in.  Depth writes are off, so
+ *  the translucent nodes do not hide each other.
+ ***********************************************************/
+void TransparencyPass::Render(
+	SceneManager* pSceneManager,
+	const ViewManager::VIEW_DATA* pViews,
+	int viewCount,
+	GLuint depthTexture,
+	int width,
+	int height)
+{
+	GLint sceneFramebuffer = 0;
+
+	if ((m_translucentProgram == 0) ||
+		((viewCount > 1) && (m_multiViewTranslucentProgram == 0)) ||
+		(pSceneManager->HasTranslucentNodes() == false))
+	{
+		return;
+	}
+
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &sceneFramebuffer);
+	if (PrepareTargets(depthTexture, width, height) == false)
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, sceneFramebuffer);
+		return;
+	}
+
+	// nothing accumulated, and all of the scene revealed
+	const GLfloat clearAccumulation[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	const GLfloat clearRevealage[4] = { 1.0f, 0.0f, 0.0f, 0.0f };
+	glClearBufferfv(GL_COLOR, 0, clearAccumulation);
+	glClearBufferfv(GL_COLOR, 1, clearRevealage);
+
+	GLuint previousProgram = UseViewProgram(pViews, viewCount);
+	pSceneManager->SetupSceneLights();
+
+	glDepthMask(GL_FALSE);
+	glEnable(GL_BLEND);
+	glBlendFunci(0, GL_ONE, GL_ONE);
+	glBlendFunci(1, GL_ZERO, GL_ONE_MINUS_SRC_COLOR);
+	pSceneManager->RenderSceneTranslucent();
+	glDepthMask(GL_TRUE);
+
+	// blend the average translucent color over the scene, by
+	// how much of the scene is hidden
+	glBindFramebuffer(GL_FRAMEBUFFER, sceneFramebuffer);
+	m_pShaderManager->m_programID = m_compositeProgram;
+	m_pShaderManager->use();
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, m_accumulationTexture.GetName());
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, m_revealageTexture.GetName());
+	glActiveTexture(GL_TEXTURE0);
+	m_pShaderManager->setIntValue(g_AccumulationName, 0);
+	m_pShaderManager->setIntValue(g_RevealageName, 1);
+
+	glBlendFunc(GL_ONE_MINUS_SRC_ALPHA, GL_SRC_ALPHA);
+	glDisable(GL_DEPTH_TEST);
+	glBindVertexArray(m_emptyVertexArray.GetName());
+	for (int i = 0; i < viewCount; i++)
+	{
+		glViewport(pViews[i].x, pViews[i].y, pViews[i].width, pViews[i].height);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+	}
+	glBindVertexArray(0);
+	glEnable(GL_DEPTH_TEST);
+
+	// the opaque nodes are drawn without blending
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glDisable(GL_BLEND);
+
+	m_pShaderManager->m_programID = previousProgram;
+	m_pShaderManager->use();
+}
+
+/***********************************************************
+ *  PrepareTargets()
+ *
+ *  This method is used for binding the framebuffer of the
+ *  two targets, creating them at the size of the scene
+ *  target when it changed, and attaching the scene's
+ *  current depth texture.
+ ***********************************************************/
+bool TransparencyPass::PrepareTargets(GLuint depthTexture, int width, int height)
+{
+	bool bAttach = false;
+
+	if ((width <= 0) || (height <= 0) || (depthTexture == 0))
+	{
+		return(false);
+	}
+
+	if (m_framebuffer.IsValid() == false)
+	{
+		GLuint framebufferID = 0;
+		glGenFramebuffers(1, &framebufferID);
+		m_framebuffer = ResourceRef(
+			m_pResourceManager,
+			m_pResourceManager->Register(ResourceManager::RESOURCE_FRAMEBUFFER, framebufferID, 0));
+
+		glBindFramebuffer(GL_FRAMEBUFFER, framebufferID);
+		GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+		glDrawBuffers(2, drawBuffers);
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer.GetName());
+
+	if ((width != m_width) || (height != m_height))
+	{
+		// the accumulated colors can add up past one, so they
+		// need a floating point target
+		m_accumulationTexture = CreateTarget(GL_RGBA16F, width, height);
+		m_revealageTexture = CreateTarget(GL_R8, width, height);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+			GL_TEXTURE_2D, m_accumulationTexture.GetName(), 0);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1,
+			GL_TEXTURE_2D, m_revealageTexture.GetName(), 0);
+		m_width = width;
+		m_height = height;
+		bAttach = true;
+	}
+
+	if ((depthTexture != m_depthTexture) || (bAttach == true))
+	{
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+			GL_TEXTURE_2D, depthTexture, 0);
+		m_depthTexture = depthTexture;
+
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		{
+			std::cout << "Could not create transparency targets:" << width << "x" << height << std::endl;
+			m_depthTexture = 0;
+			m_width = 0;
+			m_height = 0;
+			return(false);
+		}
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  CreateTarget()
+ *
+ *  This method is used for creating one color target of the
+ *  passed in format.
+ ***********************************************************/
+ResourceRef TransparencyPass::CreateTarget(GLenum format, int width, int height)
+{
+	GLuint textureID = 0;
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_2D, textureID);
+	if (GLEW_ARB_texture_storage)
+	{
+		glTexStorage2D(GL_TEXTURE_2D, 1, format, width, height);
+	}
+	else
+	{
+		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0,
+			(format == GL_R8) ? GL_RED : GL_RGBA, GL_FLOAT, NULL);
+	}
+
+	// the targets are read one texel at a time
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	return(ResourceRef(
+		m_pResourceManager,
+		m_pResourceManager->Register(
+			ResourceManager::RESOURCE_TEXTURE,
+			textureID,
+			(size_t)width * height * ((format == GL_R8) ? 1 : 8))));
+}
+
+/***********************************************************
+ *  UseViewProgram()
+ *
+ *  This method is used for switching to the single or the
+ *  multi-view translucent program, by the number of views
+ *  in the pass, and setting the views into it.  The camera
+ *  view is the first one, and is used for the highlights
+ *  as it is in the opaque pass.
+ ***********************************************************/
+GLuint TransparencyPass::UseViewProgram(const ViewManager::VIEW_DATA* pViews, int viewCount)
+{
+	GLuint previousProgram = m_pShaderManager->m_programID;
+
+	m_pShaderManager->m_programID = (viewCount > 1) ? m_multiViewTranslucentProgram : m_translucentProgram;
+	m_pShaderManager->use();
+
+	if (viewCount > 1)
+	{
+		for (int i = 0; i < viewCount; i++)
+		{
+			m_pShaderManager->setMat4Value(
+				std::string(g_ViewProjectionName) + "[" + std::to_string(i) + "]",
+				pViews[i].projection * pViews[i].view);
+		}
+		m_pShaderManager->setIntValue(g_ViewCountName, viewCount);
+	}
+	else
+	{
+		m_pShaderManager->setMat4Value(g_ViewName, pViews[0].view);
+		m_pShaderManager->setMat4Value(g_ProjectionName, pViews[0].projection);
+	}
+	m_pShaderManager->setVec3Value(g_ViewPositionName, glm::vec3(glm::inverse(pViews[0].view)[3]));
+
+	return(previousProgram);
+}
@@ -0,0 +1,89 @@
+///////////////////////////////////////////////////////////////////////////////
+// transparencypass.h
+// ============
+// draw the translucent scene nodes without sorting them
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+#include "ShaderLibrary.h"
+#include "SceneManager.h"
+#include "ViewManager.h"
+#include "ResourceManager.h"
+
+/***********************************************************
+ *  TransparencyPass
+ *
+ *  This class draws the translucent scene nodes with
+ *  weighted blended order-independent transparency.  After
+ *  the opaque nodes, the translucent ones are drawn in any
+ *  order into an accumulation target, which sums their
+ *  premultiplied colors weighted by depth and coverage, and
+ *  a revealage target, which multiplies down how much of the
+ *  opaque scene still shows through.  A composite pass then
+ *  blends the weighted average color over the scene.  The
+ *  targets share the depth buffer of the scene, so opaque
+ *  nodes hide the translucent ones behind them.
+ ***********************************************************/
+class TransparencyPass
+{
+public:
+	// constructor
+	TransparencyPass(
+		ShaderManager* pShaderManager,
+		ShaderLibrary* pShaderLibrary,
+		ResourceManager* pResourceManager);
+	// destructor
+	~TransparencyPass();
+
+	// check whether separate blend functions per target are available
+	static bool IsSupported();
+	// load the translucent and composite programs, returns false
+	// when the translucent nodes need to be drawn with the
+	// opaque ones instead
+	bool Initialize(bool bMultiView);
+
+	// draw the translucent nodes of one pass into the passed in
+	// views of the bound scene target, whose depth texture and
+	// allocated size are passed in
+	void Render(
+		SceneManager* pSceneManager,
+		const ViewManager::VIEW_DATA* pViews,
+		int viewCount,
+		GLuint depthTexture,
+		int width,
+		int height);
+
+private:
+	// pointer to shader manager object
+	ShaderManager* m_pShaderManager;
+	// pointer to the library that builds the programs
+	ShaderLibrary* m_pShaderLibrary;
+	// pointer to the manager that owns the OpenGL resources
+	ResourceManager* m_pResourceManager;
+	// programs that draw the translucent nodes for single and
+	// multi-view passes, and the program of the composite pass
+	GLuint m_translucentProgram;
+	GLuint m_multiViewTranslucentProgram;
+	GLuint m_compositeProgram;
+	// empty vertex array for the full screen triangle
+	ResourceRef m_emptyVertexArray;
+
+	// the accumulation and revealage targets, and the scene
+	// depth texture that their framebuffer is attached to
+	ResourceRef m_accumulationTexture;
+	ResourceRef m_revealageTexture;
+	ResourceRef m_framebuffer;
+	GLuint m_depthTexture;
+	int m_width;
+	int m_height;
+
+	// create or resize the targets, and attach the depth texture
+	bool PrepareTargets(GLuint depthTexture, int width, int height);
+	// create one color target texture
+	ResourceRef CreateTarget(GLenum format, int width, int height);
+	// switch to a program and set the views of the pass into it
+	GLuint UseViewProgram(const ViewManager::VIEW_DATA* pViews, int viewCount);
+};
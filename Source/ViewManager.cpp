@@ -16,34 +16,22 @@
 // declaration of the global variables and defines
 namespace
 {
-	// Variables for window width and height
+	// Variables for the initial window width and height
 	const int WINDOW_WIDTH = 1000;
 	const int WINDOW_HEIGHT = 800;
 	const char* g_ViewName = "view";
 	const char* g_ProjectionName = "projection";
+	const char* g_ViewCountName = "viewCount";
+	const char* g_ViewProjectionName = "viewProjection";
 
-	// camera object used for viewing and interacting with
-	// the 3D scene
-	Camera* g_pCamera = nullptr;
+	// point that the orthographic top, front and side views of
+	// the split view layout are centered on
+	const glm::vec3 g_OrthoViewCenter = glm::vec3(1.0f, 3.5f, -1.5f);
+	// distance of the orthographic view cameras from the center
+	const float g_OrthoViewDistance = 50.0f;
 
-	// these variables are used for mouse movement processing
-	float gLastX = WINDOW_WIDTH / 2.0f;
-	float gLastY = WINDOW_HEIGHT / 2.0f;
-	bool gFirstMouse = true;
-
-	// time between current frame and last frame
-	float gDeltaTime = 0.0f; 
-	float gLastFrame = 0.0f;
-
-	// the following variable is false when orthographic projection
-	// is off and true when it is on
-	bool bOrthographicProjection = false;
-
-	float CamSpeed = 2.5f;
-
-	// State variables to track key states
-	bool prevKeyStateO = false;
-	bool prevKeyStateP = false;
+	// default speed of the camera movement
+	const float g_DefaultCameraSpeed = 2.5f;
 }
 
 /***********************************************************
@@ -57,12 +45,37 @@ ViewManager::ViewManager(
 	// initialize the member variables
 	m_pShaderManager = pShaderManager;
 	m_pWindow = NULL;
-	g_pCamera = new Camera();
+	m_pRenderWindow = NULL;
+	m_presentFramebuffer = 0;
+	m_lastX = WINDOW_WIDTH / 2.0f;
+	m_lastY = WINDOW_HEIGHT / 2.0f;
+	m_bFirstMouse = true;
+	m_cameraSpeed = g_DefaultCameraSpeed;
+	m_bPrevKeyStateO = false;
+	m_bPrevKeyStateP = false;
+	m_bPrevKeyStateV = false;
+	m_bOverdrawView = false;
+	m_framebufferWidth = WINDOW_WIDTH;
+	m_framebufferHeight = WINDOW_HEIGHT;
+	m_renderedCameraZoom = 0.0f;
+	m_bRenderedOrthographic = false;
+	m_renderedViewLayout = VIEW_LAYOUT_SINGLE;
+	m_renderedFramebufferWidth = 0;
+	m_renderedFramebufferHeight = 0;
+	m_bViewRendered = false;
+	m_viewLayout = VIEW_LAYOUT_SINGLE;
+	m_viewCount = 0;
+	m_viewPassCount = 0;
+	m_sceneProgram = 0;
+	m_multiViewProgram = 0;
+	m_bProgramChanged = false;
+	m_pCamera = new Camera();
 	// default camera view parameters
-	g_pCamera->Position = glm::vec3(0.0f, 5.0f, 12.0f);
-	g_pCamera->Front = glm::vec3(0.0f, -0.5f, -2.0f);
-	g_pCamera->Up = glm::vec3(0.0f, 1.0f, 0.0f);
-	g_pCamera->Zoom = 80;
+	m_pCamera->Position = glm::vec3(0.0f, 5.0f, 12.0f);
+	m_pCamera->Front = glm::vec3(0.0f, -0.5f, -2.0f);
+	m_pCamera->Up = glm::vec3(0.0f, 1.0f, 0.0f);
+	m_pCamera->Zoom = 80;
+	m_previousCameraPosition = m_pCamera->Position;
 
 }
 
@@ -76,10 +89,11 @@ ViewManager::~ViewManager()
 	// free up allocated memory
 	m_pShaderManager = NULL;
 	m_pWindow = NULL;
-	if (NULL != g_pCamera)
+	m_pRenderWindow = NULL;
+	if (NULL != m_pCamera)
 	{
-		delete g_pCamera;
-		g_pCamera = NULL;
+		delete m_pCamera;
+		m_pCamera = NULL;
 	}
 }
 
@@ -87,8 +101,11 @@ ViewManager::~ViewManager()
  *  CreateDisplayWindow()
  *
  *  This method is used to create the main display window.
+ *  When a render window is passed in, the new window shares
+ *  its OpenGL objects, and the scene is rendered in the
+ *  render window's context and only presented in this one.
  ***********************************************************/
-GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
+GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle, GLFWwindow* pRenderWindow)
 {
 	GLFWwindow* window = nullptr;
 
@@ -97,15 +114,22 @@ GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
 		WINDOW_WIDTH,
 		WINDOW_HEIGHT,
 		windowTitle,
-		NULL, NULL);
+		NULL, pRenderWindow);
 	if (window == NULL)
 	{
 		std::cout << "Failed to create GLFW window" << std::endl;
-		glfwTerminate();
+		if (NULL == pRenderWindow)
+		{
+			glfwTerminate();
+		}
 		return NULL;
 	}
 	glfwMakeContextCurrent(window);
 
+	// the callbacks are shared by all windows, so they find
+	// the view of a window through its user pointer
+	glfwSetWindowUserPointer(window, this);
+
 	// tell GLFW to capture all mouse events
 	//glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
@@ -115,15 +139,73 @@ GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
 	// this callback is used to recieve scrolling events
 	glfwSetScrollCallback(window, Scroll_Callback);
 
-	// enable blending for supporting tranparent rendering
-	glEnable(GL_BLEND);
+	// this callback is used to receive framebuffer resize events
+	glfwSetFramebufferSizeCallback(window, &ViewManager::Framebuffer_Size_Callback);
+	glfwGetFramebufferSize(window, &m_framebufferWidth, &m_framebufferHeight);
+
+	// blending is only enabled while the translucent scene nodes
+	// are drawn, the opaque ones do not need it
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
 	m_pWindow = window;
+	m_pRenderWindow = pRenderWindow;
+
+	// presenting windows do not wait for the vertical blank, so
+	// that each extra window does not add a full refresh interval
+	if (NULL != pRenderWindow)
+	{
+		glfwSwapInterval(0);
+		glfwMakeContextCurrent(pRenderWindow);
+	}
 
 	return(window);
 }
 
+/***********************************************************
+ *  PresentTexture()
+ *
+ *  This method is used for showing a texture that was
+ *  rendered in the render window's context in this window.
+ *  Textures are shared between the contexts, but
+ *  framebuffers are not, so this window's context keeps its
+ *  own framebuffer for reading the texture.  A fence makes
+ *  this context wait for the rendering to finish.
+ ***********************************************************/
+void ViewManager::PresentTexture(GLuint textureID, int width, int height)
+{
+	if ((NULL == m_pWindow) || (NULL == m_pRenderWindow) || (textureID == 0))
+	{
+		return;
+	}
+
+	GLsync renderedFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	glFlush();
+
+	glfwMakeContextCurrent(m_pWindow);
+	glWaitSync(renderedFence, 0, GL_TIMEOUT_IGNORED);
+	glDeleteSync(renderedFence);
+
+	if (m_presentFramebuffer == 0)
+	{
+		glGenFramebuffers(1, &m_presentFramebuffer);
+	}
+
+	// attach every time, the render target may have been
+	// allocated again under a reused texture name
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_presentFramebuffer);
+	glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+		GL_TEXTURE_2D, textureID, 0);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glBlitFramebuffer(
+		0, 0, width, height,
+		0, 0, width, height,
+		GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+	glfwSwapBuffers(m_pWindow);
+	glfwMakeContextCurrent(m_pRenderWindow);
+}
+
 /***********************************************************
  *  Mouse_Position_Callback()
  *
@@ -132,27 +214,35 @@ GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
  ***********************************************************/
 void ViewManager::Mouse_Position_Callback(GLFWwindow* window, double xMousePos, double yMousePos)
 {
+	// the callbacks are shared, so find the view of the window
+	ViewManager* pViewManager = (ViewManager*)glfwGetWindowUserPointer(window);
+	if ((NULL == pViewManager) || (NULL == pViewManager->m_pCamera))
+	{
+		return;
+	}
 
 	// when the first mouse move event is received, this needs to be recorded so that
 	// all subsequent mouse moves can correctly calculate the X position offset and Y
 	// position offset for proper operation
-	if (gFirstMouse)
+	if (pViewManager->m_bFirstMouse)
 	{
-		gLastX = xMousePos;
-		gLastY = yMousePos;
-		gFirstMouse = false;
+		pViewManager->m_lastX = xMousePos;
+		pViewManager->m_lastY = yMousePos;
+		pViewManager->m_bFirstMouse = false;
 	}
 
 	// calculate the X offset and Y offset values for moving the 3D camera accordingly
-	float xOffset = xMousePos - gLastX;
-	float yOffset = gLastY - yMousePos; // reversed since y-coordinates go from bottom to top
+	float xOffset = xMousePos - pViewManager->m_lastX;
+	float yOffset = pViewManager->m_lastY - yMousePos; // reversed since y-coordinates go from bottom to top
 
 	// set the current positions into the last position variables
-	gLastX = xMousePos;
-	gLastY = yMousePos;
+	pViewManager->m_lastX = xMousePos;
+	pViewManager->m_lastY = yMousePos;
 
 	// move the 3D camera according to the calculated offsets
-	g_pCamera->ProcessMouseMovement(xOffset * CamSpeed, yOffset * CamSpeed);
+	pViewManager->m_pCamera->ProcessMouseMovement(
+		xOffset * pViewManager->m_cameraSpeed,
+		yOffset * pViewManager->m_cameraSpeed);
 
 }
 
@@ -164,20 +254,60 @@ void ViewManager::Mouse_Position_Callback(GLFWwindow* window, double xMousePos,
 
 void ViewManager::Scroll_Callback(GLFWwindow* window, double xOffset, double yOffset)
 {
+	ViewManager* pViewManager = (ViewManager*)glfwGetWindowUserPointer(window);
+	if (NULL == pViewManager)
+	{
+		return;
+	}
+
 	// Adjust the camera speed based on the scroll input
-	CamSpeed += yOffset * 1.0f; // Adjust the multiplier as needed for sensitivity
-	if (CamSpeed < 0.1f) // Set a lower limit for the camera speed
-		CamSpeed = 0.1f;
+	pViewManager->m_cameraSpeed += yOffset * 1.0f; // Adjust the multiplier as needed for sensitivity
+	if (pViewManager->m_cameraSpeed < 0.1f) // Set a lower limit for the camera speed
+		pViewManager->m_cameraSpeed = 0.1f;
+
+}
 
+/***********************************************************
+ *  Framebuffer_Size_Callback()
+ *
+ *  This method is automatically called from GLFW whenever
+ *  the window framebuffer is resized.  Only the new size is
+ *  recorded here - the projection and the render targets
+ *  pick it up when the next frame is prepared.
+ ***********************************************************/
+void ViewManager::Framebuffer_Size_Callback(GLFWwindow* window, int width, int height)
+{
+	ViewManager* pViewManager = (ViewManager*)glfwGetWindowUserPointer(window);
+	if (NULL == pViewManager)
+	{
+		return;
+	}
+
+	pViewManager->m_framebufferWidth = width;
+	pViewManager->m_framebufferHeight = height;
+}
+
+/***********************************************************
+ *  GetFramebufferSize()
+ *
+ *  This method is used for getting the current size of the
+ *  window framebuffer in pixels.
+ ***********************************************************/
+void ViewManager::GetFramebufferSize(int& width, int& height) const
+{
+	width = m_framebufferWidth;
+	height = m_framebufferHeight;
 }
 
 /***********************************************************
  *  ProcessKeyboardEvents()
  *
  *  This method is called to process any keyboard events
- *  that may be waiting in the event queue.
+ *  that may be waiting in the event queue.  The camera is
+ *  moved by the passed in fixed update step, so the camera
+ *  speed does not depend on the rendering frame rate.
  ***********************************************************/
-void ViewManager::ProcessKeyboardEvents()
+void ViewManager::ProcessKeyboardEvents(float stepSeconds)
 {
 	// close the window if the escape key has been pressed
 	if (glfwGetKey(m_pWindow, GLFW_KEY_ESCAPE) == GLFW_PRESS)
@@ -187,22 +317,33 @@ void ViewManager::ProcessKeyboardEvents()
 
 	// Check if key O is pressed and released
 	bool currentKeyStateO = glfwGetKey(m_pWindow, GLFW_KEY_O) == GLFW_PRESS;
-	if (currentKeyStateO && !prevKeyStateO) {
+	if (currentKeyStateO && !m_bPrevKeyStateO) {
 		// Toggle orthographic projection mode
 		bOrthographicProjection = !bOrthographicProjection;
 	}
-	prevKeyStateO = currentKeyStateO;
+	m_bPrevKeyStateO = currentKeyStateO;
 
 	// Check if key P is pressed and released
 	bool currentKeyStateP = glfwGetKey(m_pWindow, GLFW_KEY_P) == GLFW_PRESS;
-	if (currentKeyStateP && !prevKeyStateP) {
-		// Toggle viewport covering window
-		bViewportCoveringWindow = !bViewportCoveringWindow;
+	if (currentKeyStateP && !m_bPrevKeyStateP) {
+		// Toggle between the single view and the split view layout
+		if (m_viewLayout == VIEW_LAYOUT_SINGLE)
+			m_viewLayout = VIEW_LAYOUT_SPLIT;
+		else
+			m_viewLayout = VIEW_LAYOUT_SINGLE;
+	}
+	m_bPrevKeyStateP = currentKeyStateP;
+
+	// Check if key V is pressed and released
+	bool currentKeyStateV = glfwGetKey(m_pWindow, GLFW_KEY_V) == GLFW_PRESS;
+	if (currentKeyStateV && !m_bPrevKeyStateV) {
+		// Toggle between the lit scene and the overdraw view
+		m_bOverdrawView = !m_bOverdrawView;
 	}
-	prevKeyStateP = currentKeyStateP;
+	m_bPrevKeyStateV = currentKeyStateV;
 
 	// if the camera object is null, then exit this method
-	if (NULL == g_pCamera)
+	if (NULL == m_pCamera)
 	{
 		return;
 	}
@@ -211,96 +352,422 @@ void ViewManager::ProcessKeyboardEvents()
 	// Process camera zooming in and out using W and S keys
 	if (glfwGetKey(m_pWindow, GLFW_KEY_W) == GLFW_PRESS)
 	{
-		g_pCamera->ProcessKeyboard(FORWARD, gDeltaTime * CamSpeed); //Use CamSpeed to modify movement foward
+		m_pCamera->ProcessKeyboard(FORWARD, stepSeconds * m_cameraSpeed); //Use the camera speed to modify movement foward
 	}
 	if (glfwGetKey(m_pWindow, GLFW_KEY_S) == GLFW_PRESS)
 	{
-		g_pCamera->ProcessKeyboard(BACKWARD, gDeltaTime * CamSpeed); //Use CamSpeed to modify movement backward
+		m_pCamera->ProcessKeyboard(BACKWARD, stepSeconds * m_cameraSpeed); //Use the camera speed to modify movement backward
 	}
 
 	// Process camera panning left and right using A and D keys
 	if (glfwGetKey(m_pWindow, GLFW_KEY_A) == GLFW_PRESS)
 	{
-		g_pCamera->ProcessKeyboard(LEFT, gDeltaTime * CamSpeed); //Use CamSpeed to modify movement left
+		m_pCamera->ProcessKeyboard(LEFT, stepSeconds * m_cameraSpeed); //Use the camera speed to modify movement left
 	}
 	if (glfwGetKey(m_pWindow, GLFW_KEY_D) == GLFW_PRESS)
 	{
-		g_pCamera->ProcessKeyboard(RIGHT, gDeltaTime * CamSpeed); //Use CamSpeed to modify movement right
+		m_pCamera->ProcessKeyboard(RIGHT, stepSeconds * m_cameraSpeed); //Use the camera speed to modify movement right
 	}
 
 	// Process camera panning up and down using Q and E keys
 	if (glfwGetKey(m_pWindow, GLFW_KEY_Q) == GLFW_PRESS)
 	{
-		g_pCamera->ProcessKeyboard(UP, gDeltaTime * CamSpeed); //Use CamSpeed to modify movement up
+		m_pCamera->ProcessKeyboard(UP, stepSeconds * m_cameraSpeed); //Use the camera speed to modify movement up
 	}
 	if (glfwGetKey(m_pWindow, GLFW_KEY_E) == GLFW_PRESS)
 	{
-		g_pCamera->ProcessKeyboard(DOWN, gDeltaTime * CamSpeed); //Use CamSpeed to modify movement down
+		m_pCamera->ProcessKeyboard(DOWN, stepSeconds * m_cameraSpeed); //Use the camera speed to modify movement down
+	}
+}
+
+
+/***********************************************************
+ *  UpdateView()
+ *
+ *  This method is used for advancing the camera by one
+ *  fixed update step, independent of the rendering rate.
+ ***********************************************************/
+void ViewManager::UpdateView(float stepSeconds)
+{
+	// if the camera object is null, then exit this method
+	if (NULL == m_pCamera)
+	{
+		return;
+	}
+
+	// remember where this step started for interpolation
+	m_previousCameraPosition = m_pCamera->Position;
+
+	// process any keyboard events that may be waiting in the 
+	// event queue
+	ProcessKeyboardEvents(stepSeconds);
+}
+
+/***********************************************************
+ *  HasViewChanged()
+ *
+ *  This method is used for checking whether the camera or
+ *  the projection has changed since the last prepared frame.
+ ***********************************************************/
+bool ViewManager::HasViewChanged()
+{
+	if ((NULL == m_pCamera) || (m_bViewRendered == false))
+	{
+		return(true);
 	}
+
+	return((m_renderedCameraPosition != m_pCamera->Position) ||
+		(m_renderedCameraFront != m_pCamera->Front) ||
+		(m_renderedCameraZoom != m_pCamera->Zoom) ||
+		(m_bRenderedOrthographic != bOrthographicProjection) ||
+		(m_renderedViewLayout != m_viewLayout) ||
+		(m_renderedFramebufferWidth != m_framebufferWidth) ||
+		(m_renderedFramebufferHeight != m_framebufferHeight));
 }
 
+/***********************************************************
+ *  SetMultiViewProgram()
+ *
+ *  This method is used for setting the shader program that
+ *  draws every view of the split view layout in one pass.
+ *  Without it, the split views are drawn in one pass each.
+ ***********************************************************/
+void ViewManager::SetMultiViewProgram(GLuint programID)
+{
+	if (NULL != m_pShaderManager)
+	{
+		m_sceneProgram = m_pShaderManager->m_programID;
+	}
+	m_multiViewProgram = programID;
+}
+
+/***********************************************************
+ *  UseProgram()
+ *
+ *  This method is used for switching the shader program that
+ *  the shader manager sets its values into.
+ ***********************************************************/
+void ViewManager::UseProgram(GLuint programID)
+{
+	if ((NULL == m_pShaderManager) || (programID == 0) ||
+		(m_pShaderManager->m_programID == programID))
+	{
+		return;
+	}
+
+	m_pShaderManager->m_programID = programID;
+	m_pShaderManager->use();
+	m_bProgramChanged = true;
+}
+
+/***********************************************************
+ *  ConsumeProgramChanged()
+ *
+ *  This method is used for checking whether the shader
+ *  program was switched since the last check, in which case
+ *  the scene lights need to be set into the new program.
+ ***********************************************************/
+bool ViewManager::ConsumeProgramChanged()
+{
+	bool bChanged = m_bProgramChanged;
+	m_bProgramChanged = false;
+	return(bChanged);
+}
+
+/***********************************************************
+ *  AddView()
+ *
+ *  This method is used for adding a view to the current
+ *  layout, with its viewport rectangle in the window.
+ ***********************************************************/
+void ViewManager::AddView(
+	glm::mat4 view,
+	glm::mat4 projection,
+	int x, int y, int width, int height)
+{
+	if (m_viewCount >= MAX_VIEWS)
+	{
+		return;
+	}
+
+	m_views[m_viewCount].view = view;
+	m_views[m_viewCount].projection = projection;
+	m_views[m_viewCount].x = x;
+	m_views[m_viewCount].y = y;
+	m_views[m_viewCount].width = width;
+	m_views[m_viewCount].height = height;
+	m_viewCount++;
+}
 
 /***********************************************************
  *  PrepareSceneView()
  *
  *  This method is used for preparing the 3D scene by loading
  *  the shapes, textures in memory to support the 3D scene 
- *  rendering
+ *  rendering.  The camera position is blended between the
+ *  last two update steps by the passed in interpolation.
  ***********************************************************/
-void ViewManager::PrepareSceneView()
+void ViewManager::PrepareSceneView(float interpolation)
 {
 	glm::mat4 view;
 	glm::mat4 projection;
+	glm::mat4 orthoProjection;
+	glm::vec3 cameraPosition;
+	GLfloat aspectRatio = 1.0f;
 
-	// per-frame timing
-	float currentFrame = glfwGetTime();
-	gDeltaTime = currentFrame - gLastFrame;
-	gLastFrame = currentFrame;
+	// nothing is visible while the window is minimized
+	if ((m_framebufferWidth <= 0) || (m_framebufferHeight <= 0))
+	{
+		m_viewCount = 0;
+		m_viewPassCount = 0;
+		return;
+	}
+	aspectRatio = (GLfloat)m_framebufferWidth / (GLfloat)m_framebufferHeight;
 
-	// process any keyboard events that may be waiting in the 
-	// event queue
-	ProcessKeyboardEvents();
+	// blend the camera between the last two update steps
+	cameraPosition = m_previousCameraPosition +
+		(m_pCamera->Position - m_previousCameraPosition) * interpolation;
 
 	// get the current view matrix from the camera
-	view = g_pCamera->GetViewMatrix();
+	view = glm::lookAt(
+		cameraPosition,
+		cameraPosition + m_pCamera->Front,
+		m_pCamera->Up);
+
+	// Define orthographic projection matrix
+	// Adjust parameters as needed, widened to the framebuffer aspect
+	orthoProjection = glm::ortho(-10.0f * aspectRatio, 10.0f * aspectRatio, -10.0f, 10.0f, 0.1f, 100.0f);
 
 	// Define the projection matrix based on whether orthographic projection is enabled
 	if (bOrthographicProjection)
 	{
-		// Define orthographic projection matrix
-		// Adjust parameters as needed
-		projection = glm::ortho(-10.0f, 10.0f, -10.0f, 10.0f, 0.1f, 100.0f);
+		projection = orthoProjection;
 	}
 	else
 	{
 		// Define perspective projection matrix
 		// Adjust parameters as needed
-		projection = glm::perspective(glm::radians(g_pCamera->Zoom),
-			(GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT,
+		projection = glm::perspective(glm::radians(m_pCamera->Zoom),
+			aspectRatio,
 			0.1f, 100.0f);
 	}
 
-	// Set the viewport
-	if (bViewportCoveringWindow)
+	// build the views of the current layout
+	m_viewCount = 0;
+	if (m_viewLayout == VIEW_LAYOUT_SPLIT)
 	{
-		glViewport(0, 0, WINDOW_WIDTH / 2, WINDOW_HEIGHT / 2);
+		int halfWidth = m_framebufferWidth / 2;
+		int halfHeight = m_framebufferHeight / 2;
+
+		// camera view in the top left, orthographic top view in
+		// the top right, front view in the bottom left and side
+		// view in the bottom right
+		AddView(view, projection, 0, halfHeight, halfWidth, halfHeight);
+		AddView(
+			glm::lookAt(
+				g_OrthoViewCenter + glm::vec3(0.0f, g_OrthoViewDistance, 0.0f),
+				g_OrthoViewCenter,
+				glm::vec3(0.0f, 0.0f, -1.0f)),
+			orthoProjection,
+			halfWidth, halfHeight, halfWidth, halfHeight);
+		AddView(
+			glm::lookAt(
+				g_OrthoViewCenter + glm::vec3(0.0f, 0.0f, g_OrthoViewDistance),
+				g_OrthoViewCenter,
+				glm::vec3(0.0f, 1.0f, 0.0f)),
+			orthoProjection,
+			0, 0, halfWidth, halfHeight);
+		AddView(
+			glm::lookAt(
+				g_OrthoViewCenter + glm::vec3(g_OrthoViewDistance, 0.0f, 0.0f),
+				g_OrthoViewCenter,
+				glm::vec3(0.0f, 1.0f, 0.0f)),
+			orthoProjection,
+			halfWidth, 0, halfWidth, halfHeight);
 	}
 	else
 	{
 		// Set the default for the viewport
-		glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+		AddView(view, projection, 0, 0, m_framebufferWidth, m_framebufferHeight);
 	}
 
+	// several views are drawn in a single pass when the multi-view
+	// program is available - its geometry stage replicates every
+	// triangle into each view's viewport
+	if ((m_viewCount > 1) && (m_multiViewProgram != 0))
+	{
+		UseProgram(m_multiViewProgram);
+		m_viewPassCount = 1;
+
+		for (int i = 0; i < m_viewCount; i++)
+		{
+			glViewportIndexedf(i,
+				(GLfloat)m_views[i].x,
+				(GLfloat)m_views[i].y,
+				(GLfloat)m_views[i].width,
+				(GLfloat)m_views[i].height);
+			if (NULL != m_pShaderManager)
+			{
+				m_pShaderManager->setMat4Value(
+					std::string(g_ViewProjectionName) + "[" + std::to_string(i) + "]",
+					m_views[i].projection * m_views[i].view);
+			}
+		}
+		if (NULL != m_pShaderManager)
+		{
+			m_pShaderManager->setIntValue(g_ViewCountName, m_viewCount);
+		}
+	}
+	else
+	{
+		UseProgram(m_sceneProgram);
+		m_viewPassCount = m_viewCount;
+	}
+
+	// if the shader manager object is valid
+	if (NULL != m_pShaderManager)
+	{
+		// set the view position of the camera into the shader for proper rendering
+		m_pShaderManager->setVec3Value("viewPosition", cameraPosition);
+	}
+
+	// record the view state that this frame was rendered with
+	m_renderedCameraPosition = cameraPosition;
+	m_renderedCameraFront = m_pCamera->Front;
+	m_renderedCameraZoom = m_pCamera->Zoom;
+	m_bRenderedOrthographic = bOrthographicProjection;
+	m_renderedViewLayout = m_viewLayout;
+	m_renderedFramebufferWidth = m_framebufferWidth;
+	m_renderedFramebufferHeight = m_framebufferHeight;
+	m_bViewRendered = true;
+
+}
+
+/***********************************************************
+ *  PrepareExternalView()
+ *
+ *  This method is used for preparing a single view with a
+ *  view and projection that are passed in, such as for an
+ *  image requested from outside of the application.  The
+ *  interactive camera and view layout are left unchanged.
+ ***********************************************************/
+void ViewManager::PrepareExternalView(
+	const glm::mat4& view,
+	const glm::mat4& projection,
+	const glm::vec3& cameraPosition,
+	int x, int y, int width, int height)
+{
+	m_viewCount = 0;
+	AddView(view, projection, x, y, width, height);
+
+	// a single view is always drawn by the main scene program
+	UseProgram(m_sceneProgram);
+	m_viewPassCount = m_viewCount;
+
+	if (NULL != m_pShaderManager)
+	{
+		m_pShaderManager->setVec3Value("viewPosition", cameraPosition);
+	}
+
+	// the interactive view needs to be rendered again
+	m_bViewRendered = false;
+}
+
+/***********************************************************
+ *  PrepareViewPass()
+ *
+ *  This method is used for preparing one rendering pass of
+ *  the current view layout.  When all of the views share a
+ *  single pass, everything was already set up by
+ *  PrepareSceneView().
+ ***********************************************************/
+void ViewManager::PrepareViewPass(int pass)
+{
+	if ((m_viewPassCount != m_viewCount) || (pass < 0) || (pass >= m_viewCount))
+	{
+		return;
+	}
+
+	// Set the viewport
+	glViewport(
+		m_views[pass].x,
+		m_views[pass].y,
+		m_views[pass].width,
+		m_views[pass].height);
 
 	// if the shader manager object is valid
 	if (NULL != m_pShaderManager)
 	{
 		// set the view matrix into the shader for proper rendering
-		m_pShaderManager->setMat4Value(g_ViewName, view);
+		m_pShaderManager->setMat4Value(g_ViewName, m_views[pass].view);
 		// set the view matrix into the shader for proper rendering
-		m_pShaderManager->setMat4Value(g_ProjectionName, projection);
-		// set the view position of the camera into the shader for proper rendering
-		m_pShaderManager->setVec3Value("viewPosition", g_pCamera->Position);
+		m_pShaderManager->setMat4Value(g_ProjectionName, m_views[pass].projection);
+	}
+}
+
+/***********************************************************
+ *  GetCullingViews()
+ *
+ *  This method is used for getting the view-projection
+ *  matrices of the views drawn by the passed in pass.  An
+ *  object needs to be drawn when it is inside any of them.
+ ***********************************************************/
+int ViewManager::GetCullingViews(int pass, glm::mat4* viewProjections)
+{
+	if (m_viewPassCount == m_viewCount)
+	{
+		if ((pass < 0) || (pass >= m_viewCount))
+		{
+			return(0);
+		}
+		viewProjections[0] = m_views[pass].projection * m_views[pass].view;
+		return(1);
 	}
 
-}
\ No newline at end of file
+	for (int i = 0; i < m_viewCount; i++)
+	{
+		viewProjections[i] = m_views[i].projection * m_views[i].view;
+	}
+	return(m_viewCount);
+}
+
+/***********************************************************
+ *  GetPassViews()
+ *
+ *  This method is used for getting the views drawn by the
+ *  passed in pass, for drawing that is done once per view
+ *  with the view's own viewport.
+ ***********************************************************/
+int ViewManager::GetPassViews(int pass, VIEW_DATA* pViews) const
+{
+	if (m_viewPassCount == m_viewCount)
+	{
+		if ((pass < 0) || (pass >= m_viewCount))
+		{
+			return(0);
+		}
+		pViews[0] = m_views[pass];
+		return(1);
+	}
+
+	for (int i = 0; i < m_viewCount; i++)
+	{
+		pViews[i] = m_views[i];
+	}
+	return(m_viewCount);
+}
+
+/***********************************************************
+ *  GetViews()
+ *
+ *  This method is used for getting every view of the
+ *  current layout, whichever passes they are drawn by.
+ ***********************************************************/
+int ViewManager::GetViews(VIEW_DATA* pViews) const
+{
+	for (int i = 0; i < m_viewCount; i++)
+	{
+		pViews[i] = m_views[i];
+	}
+	return(m_viewCount);
+}
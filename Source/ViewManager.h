@@ -12,6 +12,8 @@
 #include "ShaderManager.h"
 #include "camera.h"
 
+#include <glm/glm.hpp>
+
 // GLFW library
 #include "GLFW/glfw3.h" 
 
@@ -28,24 +30,143 @@ public:
 	static void Mouse_Position_Callback(GLFWwindow* window, double xMousePos, double yMousePos);
 	//scroll wheel callback for interaction with 3D scene
 	static void Scroll_Callback(GLFWwindow* window, double xOffset, double yOffset);
+	// framebuffer size callback for resizing the window
+	static void Framebuffer_Size_Callback(GLFWwindow* window, int width, int height);
+
+	// the most views that a layout can contain
+	static const int MAX_VIEWS = 4;
+
+	// the available arrangements of views in the window
+	enum VIEW_LAYOUT
+	{
+		VIEW_LAYOUT_SINGLE,
+		VIEW_LAYOUT_SPLIT
+	};
 
+	struct VIEW_DATA
+	{
+		glm::mat4 view;
+		glm::mat4 projection;
+		int x;
+		int y;
+		int width;
+		int height;
+	};
 
 private:
 	// pointer to shader manager object
 	ShaderManager* m_pShaderManager;
 	// active OpenGL display window
 	GLFWwindow* m_pWindow;
+	// window whose context renders the scene, NULL when the
+	// scene is rendered in this window's own context
+	GLFWwindow* m_pRenderWindow;
+	// framebuffer in this window's context for presenting
+	GLuint m_presentFramebuffer;
+	// camera object used for viewing and interacting with
+	// the 3D scene
+	Camera* m_pCamera;
+
+	// these variables are used for mouse movement processing
+	float m_lastX;
+	float m_lastY;
+	bool m_bFirstMouse;
+	float m_cameraSpeed;
+
+	// State variables to track key states
+	bool m_bPrevKeyStateO;
+	bool m_bPrevKeyStateP;
+	bool m_bPrevKeyStateV;
+
+	// current size of the window framebuffer in pixels, which
+	// differs from the window size on high DPI displays
+	int m_framebufferWidth;
+	int m_framebufferHeight;
+
+	// camera position at the start of the last update step,
+	// used to blend the rendered view between update steps
+	glm::vec3 m_previousCameraPosition;
+
+	// view state from the last prepared frame, used to detect
+	// whether the view needs to be rendered again
+	glm::vec3 m_renderedCameraPosition;
+	glm::vec3 m_renderedCameraFront;
+	float m_renderedCameraZoom;
+	bool m_bRenderedOrthographic;
+	VIEW_LAYOUT m_renderedViewLayout;
+	int m_renderedFramebufferWidth;
+	int m_renderedFramebufferHeight;
+	bool m_bViewRendered;
 
 	bool bOrthographicProjection = false;
-	bool bViewportCoveringWindow = false; // Add this line to declare bViewportCoveringWindow
+	// when true, the overdraw of the scene is shown instead of
+	// the lit scene
+	bool m_bOverdrawView;
+
+	// the current view layout and its views
+	VIEW_LAYOUT m_viewLayout;
+	VIEW_DATA m_views[MAX_VIEWS];
+	int m_viewCount;
+	// number of rendering passes needed for the views
+	int m_viewPassCount;
+	// the main scene program and the single pass multi-view program
+	GLuint m_sceneProgram;
+	GLuint m_multiViewProgram;
+	bool m_bProgramChanged;
+
+	// add a view to the current layout
+	void AddView(
+		glm::mat4 view,
+		glm::mat4 projection,
+		int x, int y, int width, int height);
+	// switch the program that the shader manager sets values into
+	void UseProgram(GLuint programID);
 
 	// process keyboard events for interaction with the 3D scene
-	void ProcessKeyboardEvents();
+	void ProcessKeyboardEvents(float stepSeconds);
 
 public:
-	// create the initial OpenGL display window
-	GLFWwindow* CreateDisplayWindow(const char* windowTitle);
+	// create the initial OpenGL display window, or a window that
+	// presents scenes rendered in another window's context
+	GLFWwindow* CreateDisplayWindow(const char* windowTitle, GLFWwindow* pRenderWindow = NULL);
+	// show a texture rendered in the render window's context
+	void PresentTexture(GLuint textureID, int width, int height);
+	// get the display window of the view
+	GLFWwindow* GetWindow() const { return(m_pWindow); }
+	// get the current position of the camera
+	glm::vec3 GetCameraPosition() const { return(m_pCamera->Position); }
+	// check whether the overdraw view was switched on
+	bool IsOverdrawView() const { return(m_bOverdrawView); }
 	
+	// advance the camera by one fixed update step
+	void UpdateView(float stepSeconds);
+	// check whether the view changed since the last frame
+	bool HasViewChanged();
+	// get the current size of the window framebuffer in pixels
+	void GetFramebufferSize(int& width, int& height) const;
+
 	// prepare the conversion from 3D object display to 2D scene display
-	void PrepareSceneView();
+	void PrepareSceneView(float interpolation = 1.0f);
+	// prepare a single view from a passed in camera instead of
+	// the interactive one, drawn into the passed in viewport
+	void PrepareExternalView(
+		const glm::mat4& view,
+		const glm::mat4& projection,
+		const glm::vec3& cameraPosition,
+		int x, int y, int width, int height);
+	// prepare one rendering pass of the current view layout
+	void PrepareViewPass(int pass);
+	// get the number of rendering passes for the current layout
+	int GetViewPassCount() const { return(m_viewPassCount); }
+	// get the view-projections drawn by a pass, for culling
+	int GetCullingViews(int pass, glm::mat4* viewProjections);
+	// get the views drawn by a pass, with their viewports
+	int GetPassViews(int pass, VIEW_DATA* pViews) const;
+	// get every view of the current layout
+	int GetViews(VIEW_DATA* pViews) const;
+
+	// set the program that draws all views in one pass
+	void SetMultiViewProgram(GLuint programID);
+	// check whether the shader program was switched
+	bool ConsumeProgramChanged();
 };
\ No newline at end of file
@@ -0,0 +1,1032 @@
+///////////////////////////////////////////////////////////////////////////////
+// virtualtextures.cpp
+// ============
+// page large textures into a fixed cache by what the frame samples
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "VirtualTextures.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+// declaration of global variables
+namespace
+{
+	const char* g_ViewName = "view";
+	const char* g_ProjectionName = "projection";
+	const char* g_ViewCountName = "viewCount";
+	const char* g_ViewProjectionName = "viewProjection";
+	const char* g_ViewPositionName = "viewPosition";
+	const char* g_UVScaleName = "UVscale";
+	const char* g_LodBiasName = "lodBias";
+	const char* g_VirtualTexturesName = "virtualTextures";
+	const char* g_PageCacheName = "pageCache";
+	const char* g_PageTableName = "pageTable";
+
+	// the size of a page, and of the border around it that lets
+	// filtering read past its edges - these match the shaders
+	const int g_PageSize = 128;
+	const int g_PageBorder = 4;
+	const int g_SlotSize = g_PageSize + 2 * g_PageBorder;
+	// the cache holds 16x16 pages, about 19MB of video memory
+	const int g_CacheSlotsPerSide = 16;
+	// each page table layer covers up to 64x64 pages, so the
+	// largest paged texture is 8192 texels on a side
+	const int g_PageTableSize = 64;
+	const int g_PageTableLevels = 7;
+	const int g_MaxTextures = 64;
+	// the texture slots of a scene
+	const int g_SceneTextureSlots = 16;
+	// the texture units after the scene's slots
+	const int g_PageCacheUnit = 16;
+	const int g_PageTableUnit = 17;
+
+	// the feedback pass is drawn at an eighth of the frame size
+	const int g_FeedbackDivisor = 8;
+	// most pages loaded per frame, so a sudden view change does
+	// not stall a frame
+	const int g_MaxPageLoadsPerFrame = 16;
+}
+
+/***********************************************************
+ *  VirtualTextures()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+VirtualTextures::VirtualTextures(
+	ShaderManager* pShaderManager,
+	ShaderLibrary* pShaderLibrary,
+	ResourceManager* pResourceManager)
+{
+	m_pShaderManager = pShaderManager;
+	m_pShaderLibrary = pShaderLibrary;
+	m_pResourceManager = pResourceManager;
+	m_pagedProgram = 0;
+	m_multiViewPagedProgram = 0;
+	m_feedbackProgram = 0;
+	m_textureCount = 0;
+	m_frame = 0;
+	m_feedbackWidth = 0;
+	m_feedbackHeight = 0;
+	m_feedbackFrame = 0;
+	for (int i = 0; i < FEEDBACK_FRAMES; i++)
+	{
+		m_readbackWidths[i] = 0;
+		m_readbackHeights[i] = 0;
+	}
+}
+
+/***********************************************************
+ *  ~VirtualTextures()
+ *
+ *  The destructor for the class.  The textures of the
+ *  resident levels belong to the callers of AddTexture().
+ ***********************************************************/
+VirtualTextures::~VirtualTextures()
+{
+	// release the cache, page table and feedback target to the
+	// resource manager
+	for (int i = 0; i < FEEDBACK_FRAMES; i++)
+	{
+		m_readbackBuffers[i].Reset();
+	}
+	m_feedbackFramebuffer.Reset();
+	m_feedbackDepth.Reset();
+	m_feedbackTexture.Reset();
+	m_pageTable.Reset();
+	m_cacheTexture.Reset();
+	m_textures.clear();
+	m_slots.clear();
+	m_pShaderManager = NULL;
+	m_pShaderLibrary = NULL;
+	m_pResourceManager = NULL;
+}
+
+/***********************************************************
+ *  IsSupported()
+ *
+ *  This method is used for checking for the integer targets
+ *  and texture arrays, the immutable texture storage, and
+ *  the texture units that the cache and page table use.
+ ***********************************************************/
+bool VirtualTextures::IsSupported()
+{
+	GLint textureUnits = 0;
+
+	if (!GLEW_VERSION_3_0 || !(GLEW_VERSION_4_2 || GLEW_ARB_texture_storage))
+	{
+		return(false);
+	}
+	glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &textureUnits);
+
+	return(textureUnits > g_PageTableUnit);
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for loading the programs and
+ *  creating the cache and the page table.  The cache is
+ *  filtered, and the page table is read one entry at a
+ *  time.  The feedback target is created at the first
+ *  frame, once its size is known.
+ ***********************************************************/
+bool VirtualTextures::Initialize(bool bMultiView)
+{
+	if ((NULL == m_pShaderManager) || (NULL == m_pShaderLibrary) ||
+		(NULL == m_pResourceManager) || (IsSupported() == false))
+	{
+		return(false);
+	}
+
+	m_pagedProgram = m_pShaderLibrary->LoadProgram(
+		"../../Utilities/shaders/vertexShader.glsl",
+		NULL,
+		"../../Utilities/shaders/virtualTextureFragmentShader.glsl");
+	if (bMultiView == true)
+	{
+		m_multiViewPagedProgram = m_pShaderLibrary->LoadProgram(
+			"../../Utilities/shaders/multiViewVertexShader.glsl",
+			"../../Utilities/shaders/multiViewGeometryShader.glsl",
+			"../../Utilities/shaders/virtualTextureFragmentShader.glsl");
+	}
+	m_feedbackProgram = m_pShaderLibrary->LoadProgram(
+		"../../Utilities/shaders/vertexShader.glsl",
+		NULL,
+		"../../Utilities/shaders/virtualFeedbackFragmentShader.glsl");
+	if ((m_pagedProgram == 0) || (m_feedbackProgram == 0))
+	{
+		m_pagedProgram = 0;
+		m_multiViewPagedProgram = 0;
+		m_feedbackProgram = 0;
+		return(false);
+	}
+
+	// the scene only sets the texture scale when it changes it
+	GLuint previousProgram = m_pShaderManager->m_programID;
+	GLuint programs[3] = { m_pagedProgram, m_multiViewPagedProgram, m_feedbackProgram };
+	for (int i = 0; i < 3; i++)
+	{
+		if (programs[i] != 0)
+		{
+			m_pShaderManager->m_programID = programs[i];
+			m_pShaderManager->use();
+			m_pShaderManager->setVec2Value(g_UVScaleName, glm::vec2(1.0f, 1.0f));
+		}
+	}
+	m_pShaderManager->m_programID = previousProgram;
+	m_pShaderManager->use();
+
+	m_cacheTexture = CreateTexture(
+		GL_TEXTURE_2D,
+		GL_RGBA8,
+		g_CacheSlotsPerSide * g_SlotSize,
+		g_CacheSlotsPerSide * g_SlotSize,
+		1,
+		1);
+	glBindTexture(GL_TEXTURE_2D, m_cacheTexture.GetName());
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	m_pageTable = CreateTexture(
+		GL_TEXTURE_2D_ARRAY,
+		GL_RGBA8,
+		g_PageTableSize,
+		g_PageTableSize,
+		g_MaxTextures,
+		g_PageTableLevels);
+
+	CACHE_SLOT emptySlot;
+	emptySlot.texture = -1;
+	emptySlot.level = 0;
+	emptySlot.pageX = 0;
+	emptySlot.pageY = 0;
+	emptySlot.lastUsedFrame = 0;
+	m_slots.assign(g_CacheSlotsPerSide * g_CacheSlotsPerSide, emptySlot);
+	m_textures.resize(g_MaxTextures);
+	m_pageBuffer.resize((size_t)g_SlotSize * g_SlotSize * 4);
+
+	return(true);
+}
+
+/***********************************************************
+ *  CanAddTexture()
+ *
+ *  This method is used for checking whether an image is
+ *  paged.  An image that fits in one page is cheaper as a
+ *  regular texture.
+ ***********************************************************/
+bool VirtualTextures::CanAddTexture(int width, int height, int colorChannels) const
+{
+	if ((m_pagedProgram == 0) || (m_textureCount >= g_MaxTextures) ||
+		((colorChannels != 3) && (colorChannels != 4)))
+	{
+		return(false);
+	}
+
+	return(((width > g_PageSize) || (height > g_PageSize)) &&
+		(GetPageCount(width, 0) <= g_PageTableSize) &&
+		(GetPageCount(height, 0) <= g_PageTableSize));
+}
+
+/***********************************************************
+ *  AddTexture()
+ *
+ *  This method is used for building the mip levels of an
+ *  image in system memory, averaging each level down from
+ *  the one before it, until a level fits in one page.  That
+ *  level is uploaded as a regular mipmapped texture and
+ *  sampled wherever the paged levels are too small on
+ *  screen or not loaded, and the levels above it are paged.
+ ***********************************************************/
+GLuint VirtualTextures::AddTexture(
+	const unsigned char* pPixels,
+	int width,
+	int height,
+	int colorChannels,
+	size_t& textureBytes)
+{
+	textureBytes = 0;
+
+	if ((NULL == pPixels) || (CanAddTexture(width, height, colorChannels) == false))
+	{
+		return(0);
+	}
+
+	int index = 0;
+	while ((index < m_textures.size()) && (m_textures[index].bUsed == true))
+	{
+		index++;
+	}
+	if (index >= m_textures.size())
+	{
+		return(0);
+	}
+	PAGED_TEXTURE& texture = m_textures[index];
+	texture.width = width;
+	texture.height = height;
+	texture.levels.clear();
+
+	// the first level in RGBA, so every page has the same layout
+	texture.levels.push_back(std::vector<unsigned char>((size_t)width * height * 4));
+	unsigned char* pLevel = texture.levels[0].data();
+	for (size_t i = 0; i < (size_t)width * height; i++)
+	{
+		pLevel[i * 4 + 0] = pPixels[i * colorChannels + 0];
+		pLevel[i * 4 + 1] = pPixels[i * colorChannels + 1];
+		pLevel[i * 4 + 2] = pPixels[i * colorChannels + 2];
+		pLevel[i * 4 + 3] = (colorChannels == 4) ? pPixels[i * colorChannels + 3] : 255;
+	}
+
+	int level = 0;
+	while ((GetLevelSize(width, level) > g_PageSize) || (GetLevelSize(height, level) > g_PageSize))
+	{
+		int sourceWidth = GetLevelSize(width, level);
+		int sourceHeight = GetLevelSize(height, level);
+		int levelWidth = GetLevelSize(width, level + 1);
+		int levelHeight = GetLevelSize(height, level + 1);
+		std::vector<unsigned char> pixels((size_t)levelWidth * levelHeight * 4);
+		const unsigned char* pSource = texture.levels[level].data();
+
+		for (int y = 0; y < levelHeight; y++)
+		{
+			int y0 = std::min(y * 2, sourceHeight - 1);
+			int y1 = std::min(y * 2 + 1, sourceHeight - 1);
+			for (int x = 0; x < levelWidth; x++)
+			{
+				int x0 = std::min(x * 2, sourceWidth - 1);
+				int x1 = std::min(x * 2 + 1, sourceWidth - 1);
+				for (int c = 0; c < 4; c++)
+				{
+					int sum =
+						pSource[((size_t)y0 * sourceWidth + x0) * 4 + c] +
+						pSource[((size_t)y0 * sourceWidth + x1) * 4 + c] +
+						pSource[((size_t)y1 * sourceWidth + x0) * 4 + c] +
+						pSource[((size_t)y1 * sourceWidth + x1) * 4 + c];
+					pixels[((size_t)y * levelWidth + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+				}
+			}
+		}
+		texture.levels.push_back(std::vector<unsigned char>());
+		texture.levels.back().swap(pixels);
+		level++;
+	}
+	texture.pagedLevels = level;
+
+	// the resident level is mipmapped, since it is sampled wherever
+	// the texture is small on screen
+	int residentWidth = GetLevelSize(width, level);
+	int residentHeight = GetLevelSize(height, level);
+	GLuint textureID = 0;
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_2D, textureID);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, residentWidth, residentHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, texture.levels[level].data());
+	glGenerateMipmap(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	texture.levels.pop_back();
+
+	textureBytes = (size_t)residentWidth * residentHeight * 4;
+	textureBytes += textureBytes / 3;
+
+	// the pages of every paged level, none of them loaded yet
+	int pageCount = 0;
+	texture.pageOffsets.clear();
+	for (int i = 0; i < texture.pagedLevels; i++)
+	{
+		texture.pageOffsets.push_back(pageCount);
+		pageCount += GetPageCount(width, i) * GetPageCount(height, i);
+	}
+	texture.pageSlots.assign(pageCount, -1);
+	texture.textureName = textureID;
+	texture.bTableChanged = true;
+	texture.bUsed = true;
+	m_textureCount++;
+
+	return(textureID);
+}
+
+/***********************************************************
+ *  RemoveTexture()
+ *
+ *  This method is used for freeing the cache slots and the
+ *  system memory of a paged texture, when the texture of
+ *  its resident level is released.
+ ***********************************************************/
+void VirtualTextures::RemoveTexture(GLuint textureName)
+{
+	int index = FindTexture(textureName);
+	if (index < 0)
+	{
+		return;
+	}
+
+	for (int i = 0; i < m_slots.size(); i++)
+	{
+		if (m_slots[i].texture == index)
+		{
+			m_slots[i].texture = -1;
+			m_slots[i].lastUsedFrame = 0;
+		}
+	}
+
+	PAGED_TEXTURE& texture = m_textures[index];
+	std::vector<std::vector<unsigned char>>().swap(texture.levels);
+	std::vector<int>().swap(texture.pageOffsets);
+	std::vector<int>().swap(texture.pageSlots);
+	texture.textureName = 0;
+	texture.bUsed = false;
+	m_textureCount--;
+}
+
+/***********************************************************
+ *  RenderFeedback()
+ *
+ *  This method is used for drawing the opaque nodes into
+ *  the feedback target, each view into its own part of it
+ *  at the reduced size, and starting the read back of the
+ *  target into the oldest pixel buffer.  The mip level is
+ *  biased by the size reduction, so the pages are those
+ *  that the full size frame samples.
+ ***********************************************************/
+void VirtualTextures::RenderFeedback(
+	SceneManager* pSceneManager,
+	const ViewManager::VIEW_DATA* pViews,
+	int viewCount,
+	int frameWidth,
+	int frameHeight)
+{
+	GLint previousFramebuffer = 0;
+	GLint previousViewport[4] = { 0, 0, 0, 0 };
+
+	if ((m_feedbackProgram == 0) || (m_textureCount == 0) || (viewCount <= 0))
+	{
+		return;
+	}
+
+	int width = std::max((frameWidth + g_FeedbackDivisor - 1) / g_FeedbackDivisor, 1);
+	int height = std::max((frameHeight + g_FeedbackDivisor - 1) / g_FeedbackDivisor, 1);
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+	glGetIntegerv(GL_VIEWPORT, previousViewport);
+	if (PrepareFeedbackTarget(width, height) == false)
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+		return;
+	}
+
+	// zero means that no page was sampled
+	const GLuint clearRequest[4] = { 0, 0, 0, 0 };
+	glClearBufferuiv(GL_COLOR, 0, clearRequest);
+	glClear(GL_DEPTH_BUFFER_BIT);
+
+	GLuint previousProgram = m_pShaderManager->m_programID;
+	m_pShaderManager->m_programID = m_feedbackProgram;
+	m_pShaderManager->use();
+	m_pShaderManager->setFloatValue(g_LodBiasName, -std::log2((float)g_FeedbackDivisor));
+	SetSlotTextures(pSceneManager);
+
+	for (int i = 0; i < viewCount; i++)
+	{
+		glViewport(
+			pViews[i].x / g_FeedbackDivisor,
+			pViews[i].y / g_FeedbackDivisor,
+			std::max(pViews[i].width / g_FeedbackDivisor, 1),
+			std::max(pViews[i].height / g_FeedbackDivisor, 1));
+		m_pShaderManager->setMat4Value(g_ViewName, pViews[i].view);
+		m_pShaderManager->setMat4Value(g_ProjectionName, pViews[i].projection);
+
+		glm::mat4 viewProjection = pViews[i].projection * pViews[i].view;
+		pSceneManager->SetCullingViews(&viewProjection, 1);
+		pSceneManager->RenderScene(true);
+	}
+
+	// copy the requests into the pixel buffer for this frame
+	// without waiting for them - the buffers are dropped when the
+	// feedback target changes size
+	size_t byteCount = (size_t)width * height * 4;
+	ResourceRef& readbackBuffer = m_readbackBuffers[m_feedbackFrame];
+	if (readbackBuffer.IsValid() == false)
+	{
+		GLuint bufferID = 0;
+		glGenBuffers(1, &bufferID);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, bufferID);
+		glBufferData(GL_PIXEL_PACK_BUFFER, byteCount, NULL, GL_STREAM_READ);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		readbackBuffer = ResourceRef(
+			m_pResourceManager,
+			m_pResourceManager->Register(ResourceManager::RESOURCE_BUFFER, bufferID, byteCount));
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, readbackBuffer.GetName());
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, width, height, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, 0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	m_readbackWidths[m_feedbackFrame] = width;
+	m_readbackHeights[m_feedbackFrame] = height;
+	m_feedbackFrame = (m_feedbackFrame + 1) % FEEDBACK_FRAMES;
+
+	m_pShaderManager->m_programID = previousProgram;
+	m_pShaderManager->use();
+	glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+	glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+}
+
+/***********************************************************
+ *  UpdatePages()
+ *
+ *  This method is used for reading the oldest feedback and
+ *  loading the pages that it asked for.  Every page that a
+ *  pixel sampled, and every coarser page above it, is kept
+ *  for this frame, and the missing ones are loaded coarse
+ *  first, so that each texture sharpens step by step.  The
+ *  page tables of the textures whose pages changed are
+ *  uploaded again afterwards.
+ ***********************************************************/
+void VirtualTextures::UpdatePages()
+{
+	std::vector<uint64_t> requestedPages;
+	std::vector<uint64_t> missingPages;
+
+	if ((m_pagedProgram == 0) || (m_textureCount == 0))
+	{
+		return;
+	}
+	m_frame++;
+
+	// the pixel buffer after the one just written is the oldest
+	int frame = m_feedbackFrame;
+	if ((m_readbackWidths[frame] > 0) && (m_readbackBuffers[frame].IsValid() == true))
+	{
+		int pixelCount = m_readbackWidths[frame] * m_readbackHeights[frame];
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, m_readbackBuffers[frame].GetName());
+		const unsigned char* pRequests = (const unsigned char*)glMapBufferRange(
+			GL_PIXEL_PACK_BUFFER,
+			0,
+			(GLsizeiptr)pixelCount * 4,
+			GL_MAP_READ_BIT);
+		if (NULL != pRequests)
+		{
+			for (int i = 0; i < pixelCount; i++)
+			{
+				const unsigned char* pRequest = pRequests + (size_t)i * 4;
+				if (pRequest[3] == 0)
+				{
+					continue;
+				}
+				requestedPages.push_back(
+					((uint64_t)(pRequest[3] - 1) << 24) |
+					((uint64_t)pRequest[2] << 16) |
+					((uint64_t)pRequest[1] << 8) |
+					(uint64_t)pRequest[0]);
+			}
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		m_readbackWidths[frame] = 0;
+	}
+
+	// many pixels sample the same page
+	std::sort(requestedPages.begin(), requestedPages.end());
+	requestedPages.erase(std::unique(requestedPages.begin(), requestedPages.end()), requestedPages.end());
+	for (int i = 0; i < requestedPages.size(); i++)
+	{
+		int texture = (int)(requestedPages[i] >> 24);
+		int level = (int)((requestedPages[i] >> 16) & 255);
+		int pageY = (int)((requestedPages[i] >> 8) & 255);
+		int pageX = (int)(requestedPages[i] & 255);
+		// the feedback can be from before a texture was removed
+		if ((texture >= m_textures.size()) ||
+			(m_textures[texture].bUsed == false) ||
+			(level >= m_textures[texture].pagedLevels) ||
+			(pageX >= GetPageCount(m_textures[texture].width, level)) ||
+			(pageY >= GetPageCount(m_textures[texture].height, level)))
+		{
+			continue;
+		}
+		RequestPage(texture, level, pageX, pageY, missingPages);
+	}
+
+	// the missing pages are keyed with the coarse levels first
+	std::sort(missingPages.begin(), missingPages.end());
+	missingPages.erase(std::unique(missingPages.begin(), missingPages.end()), missingPages.end());
+	for (int i = 0; (i < missingPages.size()) && (i < g_MaxPageLoadsPerFrame); i++)
+	{
+		int level = g_PageTableLevels - (int)(missingPages[i] >> 48);
+		int texture = (int)((missingPages[i] >> 32) & 0xFFFF);
+		int pageY = (int)((missingPages[i] >> 16) & 0xFFFF);
+		int pageX = (int)(missingPages[i] & 0xFFFF);
+		if (LoadPage(texture, level, pageX, pageY) == false)
+		{
+			break;
+		}
+	}
+
+	for (int i = 0; i < m_textures.size(); i++)
+	{
+		if ((m_textures[i].bUsed == true) && (m_textures[i].bTableChanged == true))
+		{
+			UploadPageTable(i);
+		}
+	}
+}
+
+/***********************************************************
+ *  BeginPass()
+ *
+ *  This method is used for switching to the paged program
+ *  for the views of a pass, setting the views, the lights
+ *  and the paged texture of each slot into it, and binding
+ *  the cache and the page table after the scene's slots.
+ *  When there is nothing paged, or no program for the kind
+ *  of pass, the current program stays.
+ ***********************************************************/
+GLuint VirtualTextures::BeginPass(SceneManager* pSceneManager, const ViewManager::VIEW_DATA* pViews, int viewCount)
+{
+	GLuint previousProgram = m_pShaderManager->m_programID;
+	GLuint program = (viewCount > 1) ? m_multiViewPagedProgram : m_pagedProgram;
+
+	if ((program == 0) || (m_textureCount == 0))
+	{
+		return(previousProgram);
+	}
+
+	m_pShaderManager->m_programID = program;
+	m_pShaderManager->use();
+	if (viewCount > 1)
+	{
+		for (int i = 0; i < viewCount; i++)
+		{
+			m_pShaderManager->setMat4Value(
+				std::string(g_ViewProjectionName) + "[" + std::to_string(i) + "]",
+				pViews[i].projection * pViews[i].view);
+		}
+		m_pShaderManager->setIntValue(g_ViewCountName, viewCount);
+	}
+	else
+	{
+		m_pShaderManager->setMat4Value(g_ViewName, pViews[0].view);
+		m_pShaderManager->setMat4Value(g_ProjectionName, pViews[0].projection);
+	}
+	m_pShaderManager->setVec3Value(g_ViewPositionName, glm::vec3(glm::inverse(pViews[0].view)[3]));
+	pSceneManager->SetupSceneLights();
+	SetSlotTextures(pSceneManager);
+
+	glActiveTexture(GL_TEXTURE0 + g_PageCacheUnit);
+	glBindTexture(GL_TEXTURE_2D, m_cacheTexture.GetName());
+	glActiveTexture(GL_TEXTURE0 + g_PageTableUnit);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_pageTable.GetName());
+	glActiveTexture(GL_TEXTURE0);
+	m_pShaderManager->setIntValue(g_PageCacheName, g_PageCacheUnit);
+	m_pShaderManager->setIntValue(g_PageTableName, g_PageTableUnit);
+
+	return(previousProgram);
+}
+
+/***********************************************************
+ *  EndPass()
+ *
+ *  This method is used for switching back to the program
+ *  that was current before BeginPass().
+ ***********************************************************/
+void VirtualTextures::EndPass(GLuint previousProgram)
+{
+	if (m_pShaderManager->m_programID != previousProgram)
+	{
+		m_pShaderManager->m_programID = previousProgram;
+		m_pShaderManager->use();
+	}
+}
+
+/***********************************************************
+ *  GetResidentPageCount()
+ *
+ *  This method is used for getting the number of pages that
+ *  are loaded into the cache.
+ ***********************************************************/
+int VirtualTextures::GetResidentPageCount() const
+{
+	int pageCount = 0;
+
+	for (int i = 0; i < m_slots.size(); i++)
+	{
+		if (m_slots[i].texture >= 0)
+		{
+			pageCount++;
+		}
+	}
+
+	return(pageCount);
+}
+
+/***********************************************************
+ *  GetLevelSize()
+ *
+ *  These methods are used for getting the width or height
+ *  of a mip level, and the number of pages across it.
+ ***********************************************************/
+int VirtualTextures::GetLevelSize(int size, int level) const
+{
+	return(std::max(size >> level, 1));
+}
+
+int VirtualTextures::GetPageCount(int size, int level) const
+{
+	return((GetLevelSize(size, level) + g_PageSize - 1) / g_PageSize);
+}
+
+/***********************************************************
+ *  FindTexture()
+ *
+ *  This method is used for finding the paged texture whose
+ *  resident level is the passed in texture.
+ ***********************************************************/
+int VirtualTextures::FindTexture(GLuint textureName) const
+{
+	for (int i = 0; i < m_textures.size(); i++)
+	{
+		if ((m_textures[i].bUsed == true) && (m_textures[i].textureName == textureName))
+		{
+			return(i);
+		}
+	}
+
+	return(-1);
+}
+
+/***********************************************************
+ *  PrepareFeedbackTarget()
+ *
+ *  This method is used for binding the feedback target,
+ *  creating it again when the frame size has changed.
+ ***********************************************************/
+bool VirtualTextures::PrepareFeedbackTarget(int width, int height)
+{
+	if ((m_feedbackFramebuffer.IsValid() == true) &&
+		(m_feedbackWidth == width) && (m_feedbackHeight == height))
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, m_feedbackFramebuffer.GetName());
+		return(true);
+	}
+
+	m_feedbackFramebuffer.Reset();
+	m_feedbackDepth.Reset();
+	m_feedbackTexture.Reset();
+	m_feedbackWidth = 0;
+	m_feedbackHeight = 0;
+	for (int i = 0; i < FEEDBACK_FRAMES; i++)
+	{
+		m_readbackBuffers[i].Reset();
+		m_readbackWidths[i] = 0;
+		m_readbackHeights[i] = 0;
+	}
+
+	m_feedbackTexture = CreateTexture(GL_TEXTURE_2D, GL_RGBA8UI, width, height, 1, 1);
+
+	GLuint depthID = 0;
+	glGenRenderbuffers(1, &depthID);
+	glBindRenderbuffer(GL_RENDERBUFFER, depthID);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	m_feedbackDepth = ResourceRef(
+		m_pResourceManager,
+		m_pResourceManager->Register(
+			ResourceManager::RESOURCE_RENDERBUFFER,
+			depthID,
+			(size_t)width * height * 4));
+
+	GLuint framebufferID = 0;
+	glGenFramebuffers(1, &framebufferID);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebufferID);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_feedbackTexture.GetName(), 0);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthID);
+	m_feedbackFramebuffer = ResourceRef(
+		m_pResourceManager,
+		m_pResourceManager->Register(ResourceManager::RESOURCE_FRAMEBUFFER, framebufferID, 0));
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "Could not create page feedback target:" << width << "x" << height << std::endl;
+		m_feedbackFramebuffer.Reset();
+		m_feedbackDepth.Reset();
+		m_feedbackTexture.Reset();
+		return(false);
+	}
+	m_feedbackWidth = width;
+	m_feedbackHeight = height;
+
+	return(true);
+}
+
+/***********************************************************
+ *  RequestPage()
+ *
+ *  This method is used for marking a sampled page, and the
+ *  coarser pages that cover it, as used this frame, so they
+ *  are not replaced, and listing the ones that are missing.
+ *  The list keys start with the level counted from the top,
+ *  so that sorting them puts the coarse pages first.
+ ***********************************************************/
+void VirtualTextures::RequestPage(int texture, int level, int pageX, int pageY, std::vector<uint64_t>& missingPages)
+{
+	PAGED_TEXTURE& pagedTexture = m_textures[texture];
+
+	for (int i = level; i < pagedTexture.pagedLevels; i++)
+	{
+		if (i > level)
+		{
+			pageX = std::min(pageX >> 1, GetPageCount(pagedTexture.width, i) - 1);
+			pageY = std::min(pageY >> 1, GetPageCount(pagedTexture.height, i) - 1);
+		}
+
+		int page = pagedTexture.pageOffsets[i] + pageY * GetPageCount(pagedTexture.width, i) + pageX;
+		int slot = pagedTexture.pageSlots[page];
+		if (slot >= 0)
+		{
+			m_slots[slot].lastUsedFrame = m_frame;
+		}
+		else
+		{
+			missingPages.push_back(
+				((uint64_t)(g_PageTableLevels - i) << 48) |
+				((uint64_t)texture << 32) |
+				((uint64_t)pageY << 16) |
+				(uint64_t)pageX);
+		}
+	}
+}
+
+/***********************************************************
+ *  LoadPage()
+ *
+ *  This method is used for copying a page with its border
+ *  into a cache slot.  A free slot is used first, then the
+ *  slot that was used least recently, but never one that is
+ *  used this frame.  The border repeats the texture across
+ *  its edges, as its wrapping does.  Returns false when
+ *  every slot is in use.
+ ***********************************************************/
+bool VirtualTextures::LoadPage(int texture, int level, int pageX, int pageY)
+{
+	int slot = -1;
+
+	for (int i = 0; i < m_slots.size(); i++)
+	{
+		if (m_slots[i].texture < 0)
+		{
+			slot = i;
+			break;
+		}
+		if ((m_slots[i].lastUsedFrame < m_frame) &&
+			((slot < 0) || (m_slots[i].lastUsedFrame < m_slots[slot].lastUsedFrame)))
+		{
+			slot = i;
+		}
+	}
+	if (slot < 0)
+	{
+		return(false);
+	}
+
+	// the replaced page falls back to a coarser one
+	CACHE_SLOT& cacheSlot = m_slots[slot];
+	if (cacheSlot.texture >= 0)
+	{
+		PAGED_TEXTURE& replaced = m_textures[cacheSlot.texture];
+		int page = replaced.pageOffsets[cacheSlot.level] +
+			cacheSlot.pageY * GetPageCount(replaced.width, cacheSlot.level) + cacheSlot.pageX;
+		replaced.pageSlots[page] = -1;
+		replaced.bTableChanged = true;
+	}
+
+	PAGED_TEXTURE& pagedTexture = m_textures[texture];
+	int levelWidth = GetLevelSize(pagedTexture.width, level);
+	int levelHeight = GetLevelSize(pagedTexture.height, level);
+	const unsigned char* pLevel = pagedTexture.levels[level].data();
+	for (int y = 0; y < g_SlotSize; y++)
+	{
+		int sourceY = pageY * g_PageSize + y - g_PageBorder;
+		sourceY = ((sourceY % levelHeight) + levelHeight) % levelHeight;
+		const unsigned char* pRow = pLevel + (size_t)sourceY * levelWidth * 4;
+		unsigned char* pOut = m_pageBuffer.data() + (size_t)y * g_SlotSize * 4;
+		for (int x = 0; x < g_SlotSize; x++)
+		{
+			int sourceX = pageX * g_PageSize + x - g_PageBorder;
+			sourceX = ((sourceX % levelWidth) + levelWidth) % levelWidth;
+			memcpy(pOut + x * 4, pRow + (size_t)sourceX * 4, 4);
+		}
+	}
+
+	glBindTexture(GL_TEXTURE_2D, m_cacheTexture.GetName());
+	glTexSubImage2D(
+		GL_TEXTURE_2D,
+		0,
+		(slot % g_CacheSlotsPerSide) * g_SlotSize,
+		(slot / g_CacheSlotsPerSide) * g_SlotSize,
+		g_SlotSize,
+		g_SlotSize,
+		GL_RGBA,
+		GL_UNSIGNED_BYTE,
+		m_pageBuffer.data());
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	cacheSlot.texture = texture;
+	cacheSlot.level = level;
+	cacheSlot.pageX = pageX;
+	cacheSlot.pageY = pageY;
+	cacheSlot.lastUsedFrame = m_frame;
+	pagedTexture.pageSlots[pagedTexture.pageOffsets[level] + pageY * GetPageCount(pagedTexture.width, level) + pageX] = slot;
+	pagedTexture.bTableChanged = true;
+
+	return(true);
+}
+
+/***********************************************************
+ *  UploadPageTable()
+ *
+ *  This method is used for filling the page table of a
+ *  texture from its coarsest level down.  A loaded page
+ *  points to its own slot, and a missing page copies the
+ *  entry of the coarser page that covers it, which is
+ *  empty when nothing above it is loaded either.
+ ***********************************************************/
+void VirtualTextures::UploadPageTable(int texture)
+{
+	PAGED_TEXTURE& pagedTexture = m_textures[texture];
+	std::vector<unsigned char> entries;
+	std::vector<unsigned char> coarserEntries;
+	int coarserPagesX = 0;
+	int coarserPagesY = 0;
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_pageTable.GetName());
+	for (int level = pagedTexture.pagedLevels - 1; level >= 0; level--)
+	{
+		int pagesX = GetPageCount(pagedTexture.width, level);
+		int pagesY = GetPageCount(pagedTexture.height, level);
+		entries.assign((size_t)pagesX * pagesY * 4, 0);
+
+		for (int y = 0; y < pagesY; y++)
+		{
+			for (int x = 0; x < pagesX; x++)
+			{
+				unsigned char* pEntry = entries.data() + ((size_t)y * pagesX + x) * 4;
+				int slot = pagedTexture.pageSlots[pagedTexture.pageOffsets[level] + y * pagesX + x];
+				if (slot >= 0)
+				{
+					pEntry[0] = (unsigned char)(slot % g_CacheSlotsPerSide);
+					pEntry[1] = (unsigned char)(slot / g_CacheSlotsPerSide);
+					pEntry[2] = (unsigned char)level;
+					pEntry[3] = 255;
+				}
+				else if (level + 1 < pagedTexture.pagedLevels)
+				{
+					int coarserX = std::min(x >> 1, coarserPagesX - 1);
+					int coarserY = std::min(y >> 1, coarserPagesY - 1);
+					memcpy(pEntry, coarserEntries.data() + ((size_t)coarserY * coarserPagesX + coarserX) * 4, 4);
+				}
+			}
+		}
+
+		glTexSubImage3D(
+			GL_TEXTURE_2D_ARRAY,
+			level,
+			0,
+			0,
+			texture,
+			pagesX,
+			pagesY,
+			1,
+			GL_RGBA,
+			GL_UNSIGNED_BYTE,
+			entries.data());
+
+		coarserEntries.swap(entries);
+		coarserPagesX = pagesX;
+		coarserPagesY = pagesY;
+	}
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	pagedTexture.bTableChanged = false;
+}
+
+/***********************************************************
+ *  SetSlotTextures()
+ *
+ *  This method is used for setting the size, page table
+ *  layer and number of paged levels of the texture in each
+ *  of the scene's texture slots into the current program.
+ *  Slots whose textures are not paged get a layer of -1.
+ ***********************************************************/
+void VirtualTextures::SetSlotTextures(SceneManager* pSceneManager)
+{
+	for (int i = 0; i < g_SceneTextureSlots; i++)
+	{
+		glm::vec4 info(0.0f, 0.0f, -1.0f, 0.0f);
+		GLuint textureName = pSceneManager->GetTextureSlotName(i);
+		int texture = (textureName != 0) ? FindTexture(textureName) : -1;
+		if (texture >= 0)
+		{
+			info = glm::vec4(
+				(float)m_textures[texture].width,
+				(float)m_textures[texture].height,
+				(float)texture,
+				(float)m_textures[texture].pagedLevels);
+		}
+		m_pShaderManager->setVec4Value(
+			std::string(g_VirtualTexturesName) + "[" + std::to_string(i) + "]",
+			info);
+	}
+}
+
+/***********************************************************
+ *  CreateTexture()
+ *
+ *  This method is used for creating a texture or texture
+ *  array with immutable storage, read one texel at a time
+ *  unless its filtering is changed afterwards.
+ ***********************************************************/
+ResourceRef VirtualTextures::CreateTexture(
+	GLenum target,
+	GLenum internalFormat,
+	int width,
+	int height,
+	int layers,
+	int levels)
+{
+	GLuint textureID = 0;
+
+	glGenTextures(1, &textureID);
+	glBindTexture(target, textureID);
+	if (target == GL_TEXTURE_2D_ARRAY)
+	{
+		glTexStorage3D(target, levels, internalFormat, width, height, layers);
+	}
+	else
+	{
+		glTexStorage2D(target, levels, internalFormat, width, height);
+	}
+	glTexParameteri(target, GL_TEXTURE_MIN_FILTER, (levels > 1) ? GL_NEAREST_MIPMAP_NEAREST : GL_NEAREST);
+	glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(target, 0);
+
+	size_t textureBytes = (size_t)width * height * layers * 4;
+	if (levels > 1)
+	{
+		textureBytes += textureBytes / 3;
+	}
+
+	return(ResourceRef(
+		m_pResourceManager,
+		m_pResourceManager->Register(
+			ResourceManager::RESOURCE_TEXTURE,
+			textureID,
+			textureBytes)));
+}
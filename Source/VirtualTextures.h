@@ -0,0 +1,178 @@
+///////////////////////////////////////////////////////////////////////////////
+// virtualtextures.h
+// ============
+// page large textures into a fixed cache by what the frame samples
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+#include "ShaderLibrary.h"
+#include "SceneManager.h"
+#include "ViewManager.h"
+#include "ResourceManager.h"
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  VirtualTextures
+ *
+ *  This class keeps the video memory used by large textures
+ *  proportional to what is on screen instead of to what is
+ *  loaded.  Each texture's mip levels are kept in system
+ *  memory and split into pages of a fixed size.  Only the
+ *  smallest mip level that fits in a single page is uploaded
+ *  as a regular texture, and the other pages are loaded into
+ *  slots of one cache texture when they are needed.  A
+ *  feedback pass draws the scene at a reduced size and
+ *  writes the page that each pixel would sample, which is
+ *  read back a few frames later so that the read never
+ *  stalls.  The missing pages are loaded coarse first, a
+ *  few per frame, replacing the pages that were used least
+ *  recently, and a page table - one layer per texture, one
+ *  level per mip level - maps every page to the cache slot
+ *  of the page itself or of the nearest coarser page that
+ *  is loaded, so a missing page shows blurred until it
+ *  arrives.
+ ***********************************************************/
+class VirtualTextures
+{
+public:
+	// constructor
+	VirtualTextures(
+		ShaderManager* pShaderManager,
+		ShaderLibrary* pShaderLibrary,
+		ResourceManager* pResourceManager);
+	// destructor
+	~VirtualTextures();
+
+	// check whether integer targets, texture arrays and enough
+	// texture units for the scene's slots, the cache and the
+	// page table are available
+	static bool IsSupported();
+	// load the paged and feedback programs, and create the cache,
+	// the page table and the feedback target
+	bool Initialize(bool bMultiView);
+
+	// check whether an image is paged - it has to be larger than
+	// one page and small enough for the page table
+	bool CanAddTexture(int width, int height, int colorChannels) const;
+	// take a copy of a decoded image, build its mip levels, and
+	// create the texture of its resident level - returns the
+	// texture, which the caller owns, and its size in bytes,
+	// or 0 on failure
+	GLuint AddTexture(
+		const unsigned char* pPixels,
+		int width,
+		int height,
+		int colorChannels,
+		size_t& textureBytes);
+	// drop the paged texture for a resident level texture
+	void RemoveTexture(GLuint textureName);
+
+	// draw the page feedback for the passed in views of the frame,
+	// and start reading it back
+	void RenderFeedback(
+		SceneManager* pSceneManager,
+		const ViewManager::VIEW_DATA* pViews,
+		int viewCount,
+		int frameWidth,
+		int frameHeight);
+	// read the oldest feedback, and load the pages it asked for
+	void UpdatePages();
+
+	// switch to the paged program for a lit pass of the scene,
+	// returning the previous program for EndPass()
+	GLuint BeginPass(SceneManager* pSceneManager, const ViewManager::VIEW_DATA* pViews, int viewCount);
+	void EndPass(GLuint previousProgram);
+
+	// get the number of paged textures, and of loaded pages
+	int GetTextureCount() const { return(m_textureCount); }
+	int GetResidentPageCount() const;
+
+private:
+	// frames that the feedback is read behind
+	static const int FEEDBACK_FRAMES = 3;
+
+	// a paged texture, with its mip levels in system memory as
+	// RGBA, and the cache slot of each of its pages or -1
+	struct PAGED_TEXTURE
+	{
+		bool bUsed;
+		GLuint textureName;
+		int width;
+		int height;
+		int pagedLevels;
+		std::vector<std::vector<unsigned char>> levels;
+		std::vector<int> pageOffsets;
+		std::vector<int> pageSlots;
+		bool bTableChanged;
+	};
+
+	// a slot of the cache, and the page that is loaded into it
+	struct CACHE_SLOT
+	{
+		int texture;
+		int level;
+		int pageX;
+		int pageY;
+		uint32_t lastUsedFrame;
+	};
+
+	// pointer to shader manager object
+	ShaderManager* m_pShaderManager;
+	// pointer to the library that builds the programs
+	ShaderLibrary* m_pShaderLibrary;
+	// pointer to the manager that owns the OpenGL resources
+	ResourceManager* m_pResourceManager;
+	// programs of the lit pass for single and multi-view passes,
+	// and of the feedback pass
+	GLuint m_pagedProgram;
+	GLuint m_multiViewPagedProgram;
+	GLuint m_feedbackProgram;
+
+	// the paged textures, indexed by their page table layer
+	std::vector<PAGED_TEXTURE> m_textures;
+	int m_textureCount;
+	// the cache texture and its slots, and the page table
+	ResourceRef m_cacheTexture;
+	std::vector<CACHE_SLOT> m_slots;
+	ResourceRef m_pageTable;
+	uint32_t m_frame;
+	// one page with its borders, copied before it is uploaded
+	std::vector<unsigned char> m_pageBuffer;
+
+	// the feedback target at the reduced size, and the pixel
+	// buffers that it is read back into, with their sizes
+	ResourceRef m_feedbackTexture;
+	ResourceRef m_feedbackDepth;
+	ResourceRef m_feedbackFramebuffer;
+	int m_feedbackWidth;
+	int m_feedbackHeight;
+	ResourceRef m_readbackBuffers[FEEDBACK_FRAMES];
+	int m_readbackWidths[FEEDBACK_FRAMES];
+	int m_readbackHeights[FEEDBACK_FRAMES];
+	int m_feedbackFrame;
+
+	// get the size of a mip level and its number of pages
+	int GetLevelSize(int size, int level) const;
+	int GetPageCount(int size, int level) const;
+	// find the paged texture for a resident level texture
+	int FindTexture(GLuint textureName) const;
+	// create the feedback target at the reduced frame size
+	bool PrepareFeedbackTarget(int width, int height);
+	// mark a requested page and the coarser pages above it as
+	// used, and list the ones that are not loaded
+	void RequestPage(int texture, int level, int pageX, int pageY, std::vector<uint64_t>& missingPages);
+	// load a page into the least recently used cache slot
+	bool LoadPage(int texture, int level, int pageX, int pageY);
+	// rebuild and upload the page table of a texture
+	void UploadPageTable(int texture);
+	// set the paged texture of each scene texture slot into the
+	// current program
+	void SetSlotTextures(SceneManager* pSceneManager);
+	// create a texture with the passed in parameters
+	ResourceRef CreateTexture(GLenum target, GLenum internalFormat, int width, int height, int layers, int levels);
+};
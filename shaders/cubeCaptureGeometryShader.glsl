@@ -0,0 +1,53 @@
+#version 440 core
+
+// geometry stage of the cube capture program - each invocation
+// projects the triangle into one face of the cube map and routes
+// it to that face's layer, so all six faces are drawn in one pass
+
+#define FACE_COUNT 6
+
+layout (triangles, invocations = FACE_COUNT) in;
+layout (triangle_strip, max_vertices = 3) out;
+
+in vec3 vertexWorldPosition[];
+in vec3 vertexWorldNormal[];
+in vec2 vertexTextureCoordinate[];
+
+// inputs of the main scene fragment shader
+out vec3 fragmentPosition;
+out vec3 fragmentVertexNormal;
+out vec2 fragmentTextureCoordinate;
+
+uniform mat4 faceViewProjection[FACE_COUNT];
+// layer of the first face of the cube in the cube map array
+uniform int cubeLayer;
+
+void main()
+{
+	vec4 clipPosition[3];
+	for (int i = 0; i < 3; i++)
+	{
+		clipPosition[i] = faceViewProjection[gl_InvocationID] * vec4(vertexWorldPosition[i], 1.0f);
+	}
+
+	// most triangles only cover one or two faces, so skip the
+	// faces where the whole triangle is outside the same side
+	if ((clipPosition[0].x > clipPosition[0].w && clipPosition[1].x > clipPosition[1].w && clipPosition[2].x > clipPosition[2].w) ||
+		(clipPosition[0].x < -clipPosition[0].w && clipPosition[1].x < -clipPosition[1].w && clipPosition[2].x < -clipPosition[2].w) ||
+		(clipPosition[0].y > clipPosition[0].w && clipPosition[1].y > clipPosition[1].w && clipPosition[2].y > clipPosition[2].w) ||
+		(clipPosition[0].y < -clipPosition[0].w && clipPosition[1].y < -clipPosition[1].w && clipPosition[2].y < -clipPosition[2].w))
+	{
+		return;
+	}
+
+	for (int i = 0; i < 3; i++)
+	{
+		gl_Position = clipPosition[i];
+		gl_Layer = cubeLayer + gl_InvocationID;
+		fragmentPosition = vertexWorldPosition[i];
+		fragmentVertexNormal = vertexWorldNormal[i];
+		fragmentTextureCoordinate = vertexTextureCoordinate[i];
+		EmitVertex();
+	}
+	EndPrimitive();
+}
@@ -0,0 +1,8 @@
+#version 440 core
+
+// fragment stage of the depth pass - nothing is shaded, only the
+// depth of the nearest surfaces is kept for the lit pass
+
+void main()
+{
+}
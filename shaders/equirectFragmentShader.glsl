@@ -0,0 +1,27 @@
+#version 440 core
+
+// fragment stage of the equirectangular conversion - looks up the
+// direction of each pixel's longitude and latitude in a captured
+// cube, with the middle of the image facing down the -Z axis
+
+in vec2 fragmentTextureCoordinate;
+
+out vec4 outFragmentColor;
+
+uniform samplerCubeArray cubeMaps;
+uniform int cubeIndex;
+
+const float PI = 3.14159265358979f;
+
+void main()
+{
+	float longitude = (fragmentTextureCoordinate.x * 2.0f - 1.0f) * PI;
+	float latitude = (fragmentTextureCoordinate.y - 0.5f) * PI;
+
+	vec3 direction = vec3(
+		cos(latitude) * sin(longitude),
+		sin(latitude),
+		-cos(latitude) * cos(longitude));
+
+	outFragmentColor = texture(cubeMaps, vec4(direction, float(cubeIndex)));
+}
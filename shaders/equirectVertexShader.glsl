@@ -0,0 +1,14 @@
+#version 440 core
+
+// vertex stage of the equirectangular conversion - draws one
+// triangle that covers the whole target, without a vertex buffer
+
+out vec2 fragmentTextureCoordinate;
+
+void main()
+{
+	vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+
+	fragmentTextureCoordinate = position;
+	gl_Position = vec4(position * 2.0f - 1.0f, 0.0f, 1.0f);
+}
@@ -0,0 +1,13 @@
+#version 440 core
+
+// fragment stage of the frame reprojection - writes the color
+// that the moved pixel had in the last frame
+
+flat in vec4 pointColor;
+
+out vec4 outFragmentColor;
+
+void main()
+{
+	outFragmentColor = pointColor;
+}
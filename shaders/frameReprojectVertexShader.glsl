@@ -0,0 +1,39 @@
+#version 440 core
+
+// vertex stage of the frame reprojection - draws one point for
+// each pixel of the last frame, at the place where the new view
+// sees the surface that the pixel showed, without a vertex buffer
+
+flat out vec4 pointColor;
+
+uniform sampler2D previousColor;
+uniform sampler2D previousDepth;
+uniform mat4 previousInverseViewProjection;
+uniform mat4 viewProjection;
+uniform vec2 viewportOrigin;
+uniform vec2 viewportSize;
+
+void main()
+{
+	int width = int(viewportSize.x);
+	ivec2 pixel = ivec2(gl_VertexID % width, gl_VertexID / width);
+	ivec2 texel = ivec2(viewportOrigin) + pixel;
+	float depth = texelFetch(previousDepth, texel, 0).r;
+
+	pointColor = texelFetch(previousColor, texel, 0);
+
+	// pixels that nothing was drawn into are left out, so the
+	// background is not moved over newly visible objects
+	if (depth >= 1.0f)
+	{
+		gl_Position = vec4(2.0f, 2.0f, 2.0f, 1.0f);
+		return;
+	}
+
+	// from the last frame's window coordinates back to the world
+	vec3 ndc = vec3((vec2(pixel) + 0.5f) / viewportSize, depth) * 2.0f - 1.0f;
+	vec4 worldPosition = previousInverseViewProjection * vec4(ndc, 1.0f);
+	worldPosition /= worldPosition.w;
+
+	gl_Position = viewProjection * worldPosition;
+}
@@ -0,0 +1,120 @@
+#version 440 core
+
+// compute stage of the GPU culling - runs in two phases for each
+// view.  The first tests one copy per thread against the frustum
+// and the minimum size on screen, and writes the index of each
+// visible copy into its batch's range.  The second turns the
+// visible count of one batch per thread into an indirect draw
+// command, packing the commands of the non-empty batches together
+
+layout (local_size_x = 64) in;
+
+struct Instance
+{
+	mat4 model;
+	vec4 sphere;
+	uint batch;
+};
+
+struct Batch
+{
+	vec4 color;
+	vec4 ambient;
+	vec4 diffuse;
+	vec4 specular;
+	int textureSlot;
+	uint firstVertex;
+	uint vertexCount;
+	uint firstInstance;
+};
+
+struct DrawCommand
+{
+	uint count;
+	uint instanceCount;
+	uint first;
+	uint baseInstance;
+};
+
+layout (std430, binding = 0) readonly buffer InstanceBuffer { Instance instances[]; };
+layout (std430, binding = 1) readonly buffer BatchBuffer { Batch batches[]; };
+layout (std430, binding = 2) writeonly buffer VisibleBuffer { uint visibleInstances[]; };
+layout (std430, binding = 3) buffer CountBuffer
+{
+	uint drawCount;
+	uint visibleCounts[];
+};
+layout (std430, binding = 4) writeonly buffer CommandBuffer { DrawCommand commands[]; };
+
+uniform int cullPhase;
+uniform int instanceCount;
+uniform int batchCount;
+uniform vec4 frustumPlanes[6];
+uniform vec3 cameraPosition;
+uniform bool bPerspective;
+uniform float pixelScale;
+uniform float minimumPixelRadius;
+
+void CullInstance(uint index)
+{
+	vec4 sphere = instances[index].sphere;
+
+	for (int i = 0; i < 6; i++)
+	{
+		if (dot(frustumPlanes[i].xyz, sphere.xyz) + frustumPlanes[i].w < -sphere.w)
+		{
+			return;
+		}
+	}
+
+	// copies too small on screen to be seen are left out - the
+	// size shrinks with the distance only in perspective views
+	float distance = 1.0f;
+	if (bPerspective == true)
+	{
+		distance = max(length(sphere.xyz - cameraPosition), 1e-3f);
+	}
+	if (sphere.w * pixelScale / distance < minimumPixelRadius)
+	{
+		return;
+	}
+
+	uint batch = instances[index].batch;
+	uint slot = atomicAdd(visibleCounts[batch], 1u);
+	visibleInstances[batches[batch].firstInstance + slot] = index;
+}
+
+void BuildCommand(uint batch)
+{
+	uint visibleCount = visibleCounts[batch];
+	if (visibleCount == 0u)
+	{
+		return;
+	}
+
+	uint command = atomicAdd(drawCount, 1u);
+	commands[command].count = batches[batch].vertexCount;
+	commands[command].instanceCount = visibleCount;
+	commands[command].first = batches[batch].firstVertex;
+	commands[command].baseInstance = batches[batch].firstInstance;
+}
+
+void main()
+{
+	uint index = gl_GlobalInvocationID.x;
+
+	if (cullPhase == 0)
+	{
+		if (index < uint(instanceCount))
+		{
+			CullInstance(index);
+		}
+	}
+	else
+	{
+		if (index < uint(batchCount))
+		{
+			BuildCommand(index);
+		}
+	}
+}
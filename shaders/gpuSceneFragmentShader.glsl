@@ -0,0 +1,86 @@
+#version 440 core
+
+// fragment stage of the GPU culled copies - lights each fragment
+// with the scene's light sources like the scene nodes, using the
+// color, material and texture slot of the copy's batch.  All the
+// copies of one draw command share a batch, so the texture slot is
+// the same across each draw
+
+in vec3 fragmentPosition;
+in vec3 fragmentVertexNormal;
+in vec2 fragmentTextureCoordinate;
+flat in uint fragmentBatch;
+
+out vec4 outFragmentColor;
+
+struct Batch
+{
+	vec4 color;
+	vec4 ambient;
+	vec4 diffuse;
+	vec4 specular;
+	int textureSlot;
+	uint firstVertex;
+	uint vertexCount;
+	uint firstInstance;
+};
+
+layout (std430, binding = 1) readonly buffer BatchBuffer { Batch batches[]; };
+
+struct LightSource
+{
+	vec3 position;
+	vec3 ambientColor;
+	vec3 diffuseColor;
+	vec3 specularColor;
+	float focalStrength;
+	float specularIntensity;
+};
+
+#define TOTAL_LIGHTS 4
+#define TOTAL_TEXTURES 16
+
+uniform bool bUseLighting;
+uniform vec3 viewPosition;
+uniform sampler2D sceneTextures[TOTAL_TEXTURES];
+uniform LightSource lightSources[TOTAL_LIGHTS];
+
+vec3 CalculateLight(LightSource light, Batch batch, vec3 normal, vec3 viewDirection)
+{
+	vec3 lightDirection = normalize(light.position - fragmentPosition);
+
+	vec3 ambient = light.ambientColor * batch.ambient.rgb * batch.ambient.a;
+	vec3 diffuse = light.diffuseColor * batch.diffuse.rgb * max(dot(normal, lightDirection), 0.0f);
+
+	vec3 reflectDirection = reflect(-lightDirection, normal);
+	float specularComponent = pow(max(dot(viewDirection, reflectDirection), 0.0f), light.focalStrength);
+	vec3 specular = light.specularIntensity * light.specularColor * batch.specular.rgb * specularComponent;
+
+	return(ambient + diffuse + specular);
+}
+
+void main()
+{
+	Batch batch = batches[fragmentBatch];
+
+	vec4 baseColor = batch.color;
+	if ((batch.textureSlot >= 0) && (batch.textureSlot < TOTAL_TEXTURES))
+	{
+		baseColor = texture(sceneTextures[batch.textureSlot], fragmentTextureCoordinate);
+	}
+
+	vec3 color = baseColor.rgb;
+	if (bUseLighting == true)
+	{
+		vec3 normal = normalize(fragmentVertexNormal);
+		vec3 viewDirection = normalize(viewPosition - fragmentPosition);
+		vec3 lighting = vec3(0.0f);
+		for (int i = 0; i < TOTAL_LIGHTS; i++)
+		{
+			lighting += CalculateLight(lightSources[i], batch, normal, viewDirection);
+		}
+		color *= lighting;
+	}
+
+	outFragmentColor = vec4(color, baseColor.a);
+}
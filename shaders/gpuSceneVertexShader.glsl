@@ -0,0 +1,39 @@
+#version 440 core
+
+// vertex stage of the GPU culled copies - each drawn copy reads
+// the index of its visible copy from an instanced attribute, and
+// takes its transformation and batch from the culling buffers
+
+layout (location = 0) in vec3 inVertexPosition;
+layout (location = 1) in vec3 inVertexNormal;
+layout (location = 2) in vec2 inTextureCoordinate;
+layout (location = 3) in uint inVisibleInstance;
+
+struct Instance
+{
+	mat4 model;
+	vec4 sphere;
+	uint batch;
+};
+
+layout (std430, binding = 0) readonly buffer InstanceBuffer { Instance instances[]; };
+
+out vec3 fragmentPosition;
+out vec3 fragmentVertexNormal;
+out vec2 fragmentTextureCoordinate;
+flat out uint fragmentBatch;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+	mat4 model = instances[inVisibleInstance].model;
+
+	fragmentPosition = vec3(model * vec4(inVertexPosition, 1.0f));
+	fragmentVertexNormal = mat3(transpose(inverse(model))) * inVertexNormal;
+	fragmentTextureCoordinate = inTextureCoordinate;
+	fragmentBatch = instances[inVisibleInstance].batch;
+
+	gl_Position = projection * view * vec4(fragmentPosition, 1.0f);
+}
@@ -0,0 +1,22 @@
+#version 440 core
+
+// fragment stage of the impostor billboards - shows the baked
+// view, dropping the transparent pixels around the prop so the
+// billboards need no sorting
+
+in vec2 fragmentTextureCoordinate;
+
+out vec4 outFragmentColor;
+
+uniform sampler2D impostorAtlas;
+
+void main()
+{
+	vec4 color = texture(impostorAtlas, fragmentTextureCoordinate);
+	if (color.a < 0.5f)
+	{
+		discard;
+	}
+
+	outFragmentColor = vec4(color.rgb, 1.0f);
+}
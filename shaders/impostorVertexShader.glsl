@@ -0,0 +1,50 @@
+#version 440 core
+
+// vertex stage of the impostor billboards - turns a quad towards
+// the camera for each impostor and picks the baked atlas view
+// whose direction is nearest to the direction it is seen from
+
+layout (location = 0) in vec4 impostorCenterSize;
+layout (location = 1) in float impostorAtlasRow;
+
+out vec2 fragmentTextureCoordinate;
+
+uniform mat4 viewProjection;
+uniform vec3 cameraPosition;
+uniform int azimuthCount;
+uniform int elevationCount;
+uniform float elevationStep;
+uniform vec2 atlasCellSize;
+
+const float PI = 3.14159265358979f;
+
+void main()
+{
+	vec3 center = impostorCenterSize.xyz;
+	float halfSize = impostorCenterSize.w;
+	vec3 toCamera = normalize(cameraPosition - center);
+
+	// the views were baked around the Y axis, starting at +Z
+	float azimuthStep = 2.0f * PI / float(azimuthCount);
+	int azimuth = int(round(atan(toCamera.x, toCamera.z) / azimuthStep));
+	azimuth = (azimuth + azimuthCount) % azimuthCount;
+	int elevation = int(round(asin(clamp(toCamera.y, -1.0f, 1.0f)) / elevationStep));
+	elevation = clamp(elevation, 0, elevationCount - 1);
+
+	// the same axes as the baking camera, which looked at the
+	// prop with the Y axis up
+	vec3 right = cross(vec3(0.0f, 1.0f, 0.0f), toCamera);
+	if (dot(right, right) < 0.0001f)
+	{
+		right = vec3(1.0f, 0.0f, 0.0f);
+	}
+	right = normalize(right);
+	vec3 up = cross(toCamera, right);
+
+	vec2 corner = vec2(gl_VertexID & 1, (gl_VertexID >> 1) & 1);
+	vec3 position = center + (right * (corner.x * 2.0f - 1.0f) + up * (corner.y * 2.0f - 1.0f)) * halfSize;
+
+	vec2 cell = vec2(float(elevation * azimuthCount + azimuth), impostorAtlasRow);
+	fragmentTextureCoordinate = (cell + corner) * atlasCellSize;
+	gl_Position = viewProjection * vec4(position, 1.0f);
+}
@@ -0,0 +1,20 @@
+#version 440 core
+
+// vertex stage of the mesh capture - passes the vertices of a basic
+// mesh through unchanged, so transform feedback can copy them into
+// the shared vertex buffer of the GPU culled copies
+
+layout (location = 0) in vec3 inVertexPosition;
+layout (location = 1) in vec3 inVertexNormal;
+layout (location = 2) in vec2 inTextureCoordinate;
+
+out vec3 capturedPosition;
+out vec3 capturedNormal;
+out vec2 capturedTextureCoordinate;
+
+void main()
+{
+	capturedPosition = inVertexPosition;
+	capturedNormal = inVertexNormal;
+	capturedTextureCoordinate = inTextureCoordinate;
+}
@@ -0,0 +1,42 @@
+#version 440 core
+
+// geometry stage of the multi-view program - each invocation
+// projects the triangle into one view and routes it to that
+// view's viewport, so all of the views are drawn in one pass
+
+#define MAX_VIEWS 4
+
+layout (triangles, invocations = MAX_VIEWS) in;
+layout (triangle_strip, max_vertices = 3) out;
+
+in vec3 vertexWorldPosition[];
+in vec3 vertexWorldNormal[];
+in vec2 vertexTextureCoordinate[];
+
+// inputs of the main scene fragment shader
+out vec3 fragmentPosition;
+out vec3 fragmentVertexNormal;
+out vec2 fragmentTextureCoordinate;
+
+uniform int viewCount;
+uniform mat4 viewProjection[MAX_VIEWS];
+
+void main()
+{
+	// the unused invocations emit nothing
+	if (gl_InvocationID >= viewCount)
+	{
+		return;
+	}
+
+	for (int i = 0; i < 3; i++)
+	{
+		gl_Position = viewProjection[gl_InvocationID] * vec4(vertexWorldPosition[i], 1.0f);
+		gl_ViewportIndex = gl_InvocationID;
+		fragmentPosition = vertexWorldPosition[i];
+		fragmentVertexNormal = vertexWorldNormal[i];
+		fragmentTextureCoordinate = vertexTextureCoordinate[i];
+		EmitVertex();
+	}
+	EndPrimitive();
+}
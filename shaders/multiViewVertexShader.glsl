@@ -0,0 +1,22 @@
+#version 440 core
+
+// vertex stage of the multi-view program - the vertices are only
+// transformed to world space here, the geometry stage projects
+// them once for every active view
+
+layout (location = 0) in vec3 inVertexPosition;
+layout (location = 1) in vec3 inVertexNormal;
+layout (location = 2) in vec2 inTextureCoordinate;
+
+out vec3 vertexWorldPosition;
+out vec3 vertexWorldNormal;
+out vec2 vertexTextureCoordinate;
+
+uniform mat4 model;
+
+void main()
+{
+	vertexWorldPosition = vec3(model * vec4(inVertexPosition, 1.0f));
+	vertexWorldNormal = mat3(transpose(inverse(model))) * inVertexNormal;
+	vertexTextureCoordinate = inTextureCoordinate;
+}
@@ -0,0 +1,13 @@
+#version 440 core
+
+// fragment stage of the overdraw view - every fragment adds the
+// same brightness, so pixels covered by more surfaces are brighter
+
+out vec4 outFragmentColor;
+
+uniform float overdrawIncrement;
+
+void main()
+{
+	outFragmentColor = vec4(vec3(overdrawIncrement), 1.0f);
+}
@@ -0,0 +1,89 @@
+#version 440 core
+
+// fragment stage of the translucent scene nodes - lights each
+// fragment with the scene's light sources like the opaque pass,
+// then writes its premultiplied color into the accumulation
+// target and its coverage into the revealage target.  The weight
+// favors the fragments nearest to the camera and the most opaque
+// ones, so the average color looks as if it had been sorted
+
+in vec3 fragmentPosition;
+in vec3 fragmentVertexNormal;
+in vec2 fragmentTextureCoordinate;
+
+layout (location = 0) out vec4 outAccumulation;
+layout (location = 1) out float outRevealage;
+
+struct Material
+{
+	vec3 ambientColor;
+	float ambientStrength;
+	vec3 diffuseColor;
+	vec3 specularColor;
+	float shininess;
+};
+
+struct LightSource
+{
+	vec3 position;
+	vec3 ambientColor;
+	vec3 diffuseColor;
+	vec3 specularColor;
+	float focalStrength;
+	float specularIntensity;
+};
+
+#define TOTAL_LIGHTS 4
+
+uniform bool bUseTexture;
+uniform bool bUseLighting;
+uniform vec4 objectColor;
+uniform sampler2D objectTexture;
+uniform vec2 UVscale;
+uniform vec3 viewPosition;
+uniform Material material;
+uniform LightSource lightSources[TOTAL_LIGHTS];
+
+vec3 CalculateLight(LightSource light, vec3 normal, vec3 viewDirection)
+{
+	vec3 lightDirection = normalize(light.position - fragmentPosition);
+
+	vec3 ambient = light.ambientColor * material.ambientColor * material.ambientStrength;
+	vec3 diffuse = light.diffuseColor * material.diffuseColor * max(dot(normal, lightDirection), 0.0f);
+
+	vec3 reflectDirection = reflect(-lightDirection, normal);
+	float specularComponent = pow(max(dot(viewDirection, reflectDirection), 0.0f), light.focalStrength);
+	vec3 specular = light.specularIntensity * light.specularColor * material.specularColor * specularComponent;
+
+	return(ambient + diffuse + specular);
+}
+
+void main()
+{
+	// the node color's alpha makes a textured node translucent
+	vec4 baseColor = objectColor;
+	if (bUseTexture == true)
+	{
+		vec4 textureColor = texture(objectTexture, fragmentTextureCoordinate * UVscale);
+		baseColor = vec4(textureColor.rgb, textureColor.a * objectColor.a);
+	}
+
+	vec3 color = baseColor.rgb;
+	if (bUseLighting == true)
+	{
+		vec3 normal = normalize(fragmentVertexNormal);
+		vec3 viewDirection = normalize(viewPosition - fragmentPosition);
+		vec3 lighting = vec3(0.0f);
+		for (int i = 0; i < TOTAL_LIGHTS; i++)
+		{
+			lighting += CalculateLight(lightSources[i], normal, viewDirection);
+		}
+		color *= lighting;
+	}
+
+	float alpha = baseColor.a;
+	float weight = clamp(alpha * max(1e-2f, 3e3f * pow(1.0f - gl_FragCoord.z, 3.0f)), 1e-2f, 3e3f);
+
+	outAccumulation = vec4(color * alpha, alpha) * weight;
+	outRevealage = alpha;
+}
@@ -0,0 +1,29 @@
+#version 440 core
+
+// fragment stage of the transparency composite - turns the
+// weighted sums into the average translucent color, which is
+// blended over the scene by how much of it the translucent
+// nodes hide
+
+out vec4 outFragmentColor;
+
+uniform sampler2D accumulation;
+uniform sampler2D revealage;
+
+void main()
+{
+	ivec2 texel = ivec2(gl_FragCoord.xy);
+	float revealed = texelFetch(revealage, texel, 0).r;
+
+	// nothing translucent covers this pixel
+	if (revealed >= 1.0f)
+	{
+		discard;
+	}
+
+	vec4 accumulated = texelFetch(accumulation, texel, 0);
+	vec3 averageColor = accumulated.rgb / max(accumulated.a, 1e-5f);
+
+	// blended as color * (1 - revealed) + scene * revealed
+	outFragmentColor = vec4(averageColor, revealed);
+}
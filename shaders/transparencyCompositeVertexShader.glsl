@@ -0,0 +1,11 @@
+#version 440 core
+
+// vertex stage of the transparency composite - draws one
+// triangle that covers the whole viewport, without a vertex buffer
+
+void main()
+{
+	vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+
+	gl_Position = vec4(position * 2.0f - 1.0f, 0.0f, 1.0f);
+}
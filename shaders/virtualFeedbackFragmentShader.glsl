@@ -0,0 +1,51 @@
+#version 440 core
+
+// fragment stage of the page feedback pass - writes the page that
+// the paged texture sampling would read at each pixel, as its x and
+// y in the level, the mip level, and the page table layer plus one.
+// Zero means no page.  The pass is drawn at a reduced size, so the
+// level is biased to what the full size frame would sample
+
+in vec3 fragmentPosition;
+in vec3 fragmentVertexNormal;
+in vec2 fragmentTextureCoordinate;
+
+out uvec4 outPageRequest;
+
+#define TOTAL_TEXTURES 16
+#define PAGE_SIZE 128
+
+uniform bool bUseTexture;
+uniform int objectTextureSlot;
+uniform vec2 UVscale;
+uniform float lodBias;
+uniform vec4 virtualTextures[TOTAL_TEXTURES];
+
+void main()
+{
+	outPageRequest = uvec4(0);
+	if ((bUseTexture == false) || (objectTextureSlot < 0) || (objectTextureSlot >= TOTAL_TEXTURES))
+	{
+		return;
+	}
+	vec4 info = virtualTextures[objectTextureSlot];
+	if (info.z < 0.0f)
+	{
+		return;
+	}
+
+	vec2 uv = fragmentTextureCoordinate * UVscale;
+	vec2 texel = uv * info.xy;
+	vec2 dx = dFdx(texel);
+	vec2 dy = dFdy(texel);
+	float lod = 0.5f * log2(max(max(dot(dx, dx), dot(dy, dy)), 1e-8f)) + lodBias;
+	int level = int(floor(max(lod, 0.0f)));
+	if (level >= int(info.w))
+	{
+		return;
+	}
+
+	ivec2 levelSize = max(ivec2(info.xy) >> level, ivec2(1));
+	ivec2 page = min(ivec2(fract(uv) * vec2(levelSize)) / PAGE_SIZE, (levelSize + PAGE_SIZE - 1) / PAGE_SIZE - 1);
+	outPageRequest = uvec4(page, level, int(info.z) + 1);
+}
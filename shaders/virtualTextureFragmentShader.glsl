@@ -0,0 +1,145 @@
+#version 440 core
+
+// fragment stage of the opaque scene nodes when their textures are
+// paged - lights each fragment like the scene's own program, but
+// samples a paged texture through its page table.  The page table
+// has one level per mip level of the texture, and each entry holds
+// the cache slot of the page, or of the nearest coarser page that
+// is loaded.  Mip levels that fit in one page, and pages with no
+// loaded page above them, are sampled from the node's texture,
+// which holds the small resident levels
+
+in vec3 fragmentPosition;
+in vec3 fragmentVertexNormal;
+in vec2 fragmentTextureCoordinate;
+
+out vec4 outFragmentColor;
+
+struct Material
+{
+	vec3 ambientColor;
+	float ambientStrength;
+	vec3 diffuseColor;
+	vec3 specularColor;
+	float shininess;
+};
+
+struct LightSource
+{
+	vec3 position;
+	vec3 ambientColor;
+	vec3 diffuseColor;
+	vec3 specularColor;
+	float focalStrength;
+	float specularIntensity;
+};
+
+#define TOTAL_LIGHTS 4
+#define TOTAL_TEXTURES 16
+#define PAGE_SIZE 128
+#define PAGE_BORDER 4
+#define SLOT_SIZE 136
+
+uniform bool bUseTexture;
+uniform bool bUseLighting;
+uniform vec4 objectColor;
+uniform sampler2D objectTexture;
+uniform int objectTextureSlot;
+uniform vec2 UVscale;
+uniform vec3 viewPosition;
+uniform Material material;
+uniform LightSource lightSources[TOTAL_LIGHTS];
+
+// width, height, page table layer (-1 when not paged) and number of
+// paged mip levels of the texture in each slot
+uniform vec4 virtualTextures[TOTAL_TEXTURES];
+uniform sampler2DArray pageTable;
+uniform sampler2D pageCache;
+
+vec3 CalculateLight(LightSource light, vec3 normal, vec3 viewDirection)
+{
+	vec3 lightDirection = normalize(light.position - fragmentPosition);
+
+	vec3 ambient = light.ambientColor * material.ambientColor * material.ambientStrength;
+	vec3 diffuse = light.diffuseColor * material.diffuseColor * max(dot(normal, lightDirection), 0.0f);
+
+	vec3 reflectDirection = reflect(-lightDirection, normal);
+	float specularComponent = pow(max(dot(viewDirection, reflectDirection), 0.0f), light.focalStrength);
+	vec3 specular = light.specularIntensity * light.specularColor * material.specularColor * specularComponent;
+
+	return(ambient + diffuse + specular);
+}
+
+vec4 SampleVirtualTexture(vec2 uv)
+{
+	// the resident levels are sampled outside of any branch, so
+	// their mip level is taken from well defined derivatives
+	vec4 residentColor = texture(objectTexture, uv);
+	if ((objectTextureSlot < 0) || (objectTextureSlot >= TOTAL_TEXTURES))
+	{
+		return(residentColor);
+	}
+	vec4 info = virtualTextures[objectTextureSlot];
+	if (info.z < 0.0f)
+	{
+		return(residentColor);
+	}
+
+	vec2 texel = uv * info.xy;
+	vec2 dx = dFdx(texel);
+	vec2 dy = dFdy(texel);
+	float lod = 0.5f * log2(max(max(dot(dx, dx), dot(dy, dy)), 1e-8f));
+	int level = int(floor(max(lod, 0.0f)));
+	if (level >= int(info.w))
+	{
+		return(residentColor);
+	}
+
+	// the page of the level, and its entry in the page table
+	vec2 wrapped = fract(uv);
+	ivec2 levelSize = max(ivec2(info.xy) >> level, ivec2(1));
+	ivec2 page = min(ivec2(wrapped * vec2(levelSize)) / PAGE_SIZE, (levelSize + PAGE_SIZE - 1) / PAGE_SIZE - 1);
+	vec4 entry = texelFetch(pageTable, ivec3(page, int(info.z)), level);
+	if (entry.a < 0.5f)
+	{
+		return(residentColor);
+	}
+
+	// the loaded page may be coarser than the one asked for
+	ivec3 slot = ivec3(entry.rgb * 255.0f + 0.5f);
+	int residentLevel = slot.z;
+	ivec2 residentSize = max(ivec2(info.xy) >> residentLevel, ivec2(1));
+	ivec2 residentPage = min(page >> (residentLevel - level), (residentSize + PAGE_SIZE - 1) / PAGE_SIZE - 1);
+	vec2 pageTexel = clamp(
+		wrapped * vec2(residentSize) - vec2(residentPage * PAGE_SIZE),
+		vec2(0.5f - PAGE_BORDER),
+		vec2(PAGE_SIZE + PAGE_BORDER - 0.5f));
+
+	vec2 cacheTexel = vec2(slot.xy * SLOT_SIZE + PAGE_BORDER) + pageTexel;
+	return(textureLod(pageCache, cacheTexel / vec2(textureSize(pageCache, 0)), 0.0f));
+}
+
+void main()
+{
+	vec4 baseColor = objectColor;
+	if (bUseTexture == true)
+	{
+		vec4 textureColor = SampleVirtualTexture(fragmentTextureCoordinate * UVscale);
+		baseColor = vec4(textureColor.rgb, textureColor.a * objectColor.a);
+	}
+
+	vec3 color = baseColor.rgb;
+	if (bUseLighting == true)
+	{
+		vec3 normal = normalize(fragmentVertexNormal);
+		vec3 viewDirection = normalize(viewPosition - fragmentPosition);
+		vec3 lighting = vec3(0.0f);
+		for (int i = 0; i < TOTAL_LIGHTS; i++)
+		{
+			lighting += CalculateLight(lightSources[i], normal, viewDirection);
+		}
+		color *= lighting;
+	}
+
+	outFragmentColor = vec4(color, baseColor.a);
+}